@@ -89,8 +89,17 @@
 #define ID3D_INIT_DOUT()    Debug( libcw_do.on() )
 #define ID3D_INIT_WARNING() Debug( dc::warning.on() )
 #define ID3D_INIT_NOTICE()  Debug( dc::notice.on() )
-#define ID3D_NOTICE(x)      Dout( dc::notice, x )
-#define ID3D_WARNING(x)     Dout( dc::warning, x )
+/* the batch updater and the scanner write from several threads */
+#if defined (HAVE_PTHREAD_H) && defined (HAVE_LIBPTHREAD)
+#include <pthread.h>
+extern pthread_mutex_t id3d_lock;
+#define ID3D_OUT(c, x)      do { pthread_mutex_lock(&id3d_lock); Dout( c, x ); pthread_mutex_unlock(&id3d_lock); } while (0)
+#else
+#define ID3D_OUT(c, x)      Dout( c, x )
+#endif
+
+#define ID3D_NOTICE(x)      ID3D_OUT( dc::notice, x )
+#define ID3D_WARNING(x)     ID3D_OUT( dc::warning, x )
 
 #else
 
@@ -0,0 +1,103 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Measures the cost of parsing frames.  The tag is made of small text and url
+// frames, spread over the whole frame table, so that the time per frame is
+// dominated by parsing the frame header and looking up its definition.
+//
+// usage: benchframes [iterations]
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <time.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/io_strings.h"
+
+using namespace dami;
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+  if (iterations <= 0)
+  {
+    iterations = 2000;
+  }
+
+  ID3_Tag tag;
+  ID3_FrameInfo info;
+  for (int id = ID3FID_NOFRAME + 1; id <= info.MaxFrameID(); ++id)
+  {
+    ID3_FrameID fid = static_cast<ID3_FrameID>(id);
+    const char* name = info.LongName(fid);
+    if (name == NULL || (name[0] != 'T' && name[0] != 'W') ||
+        fid == ID3FID_USERTEXT || fid == ID3FID_WWWUSER)
+    {
+      continue;
+    }
+    // several frames of each id, so that the tag has a realistic size
+    for (int i = 0; i < 4; ++i)
+    {
+      ID3_Frame* frame = new ID3_Frame(fid);
+      ID3_Field* fld = frame->GetField(name[0] == 'W' ? ID3FN_URL : ID3FN_TEXT);
+      if (fld != NULL)
+      {
+        fld->Set("x");
+      }
+      tag.AttachFrame(frame);
+    }
+  }
+  tag.SetPadding(false);
+
+  size_t numFrames = tag.NumFrames();
+  BString buffer;
+  io::BStringWriter writer(buffer);
+  size_t size = tag.Render(writer, ID3TT_ID3V2);
+
+  clock_t beg = clock();
+  for (int i = 0; i < iterations; ++i)
+  {
+    ID3_Tag parsed;
+    parsed.Parse(buffer.data(), size);
+  }
+  clock_t end = clock();
+
+  double secs = double(end - beg) / CLOCKS_PER_SEC;
+  cout << "frames per tag:  " << numFrames << endl;
+  cout << "tag size:        " << size << " bytes" << endl;
+  cout << "iterations:      " << iterations << endl;
+  cout << "time per frame:  " << (secs * 1e9 / (double(iterations) * numFrames))
+       << " ns" << endl;
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Measures how long Strip() takes to remove an id3v2 tag from the front of a
+// large file, which means moving all of the audio data after it.  The tag
+// isn't a multiple of the block size, so the data really has to be moved.
+//
+// usage: benchstrip [megabytes] [buffer kilobytes]
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <fstream>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using namespace std;
+
+static const char* const TEMPFILE = "bench-strip.mp3";
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  int megabytes = (argc > 1) ? atoi(argv[1]) : 128;
+  if (megabytes <= 0)
+  {
+    megabytes = 128;
+  }
+  int kilobytes = (argc > 2) ? atoi(argv[2]) : 0;
+
+  {
+    ID3_Tag tag;
+    tag.SetPadding(false);
+    ID3_AddTitle(&tag, "The title");
+    ID3_AddArtist(&tag, "The artist");
+    uchar buffer[1024];
+    size_t size = tag.Render(buffer, ID3TT_ID3V2);
+
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(buffer), size);
+    char block[65536];
+    for (size_t i = 0; i < sizeof(block); ++i)
+    {
+      block[i] = static_cast<char>(i * 7 + 1);
+    }
+    for (int i = 0; i < megabytes * 16; ++i)
+    {
+      file.write(block, sizeof(block));
+    }
+  }
+
+  ID3_Tag tag(TEMPFILE);
+  if (kilobytes > 0)
+  {
+    tag.SetFileBufferSize(kilobytes * 1024);
+  }
+  double beg = now();
+  flags_t stripped = tag.Strip(ID3TT_ID3V2);
+  double end = now();
+
+  // the data has to have arrived intact
+  bool intact = true;
+  {
+    ifstream file(TEMPFILE, ios::in | ios::binary);
+    char block[65536];
+    for (int i = 0; intact && i < megabytes * 16; ++i)
+    {
+      file.read(block, sizeof(block));
+      for (size_t j = 0; intact && j < sizeof(block); ++j)
+      {
+        intact = file && block[j] == static_cast<char>(j * 7 + 1);
+      }
+    }
+    intact = intact && file.get() == EOF;
+  }
+  remove(TEMPFILE);
+
+  if (!(stripped & ID3TT_ID3V2))
+  {
+    cout << "couldn't strip the tag" << endl;
+    return 1;
+  }
+  if (!intact)
+  {
+    cout << "the data was damaged when it was moved" << endl;
+    return 1;
+  }
+  cout << "file size:       " << megabytes << " MB" << endl;
+  cout << "buffer size:     " << tag.GetFileBufferSize() / 1024 << " KB" << endl;
+  cout << "time:            " << (end - beg) << " s" << endl;
+  cout << "throughput:      " << (megabytes / (end - beg)) << " MB/s" << endl;
+
+  return 0;
+}
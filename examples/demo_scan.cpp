@@ -0,0 +1,101 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <id3/tag.h>
+#include <id3/scan.h>
+
+#include "demo_scan_options.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Writes a line of JSON for each file in the directories (or for each file)
+// given, e.g.
+//
+//   id3scan -2 -t 8 /music | grep '"v2":false'
+int main( int argc, char * const argv[])
+{
+  ID3D_INIT_DOUT();
+
+  gengetopt_args_info args;
+
+  if (cmdline_parser(argc, argv, &args) != 0)
+  {
+    exit(1);
+  }
+
+#if defined ID3_ENABLE_DEBUG
+  if (args.warning_flag)
+  {
+    ID3D_INIT_WARNING();
+    ID3D_WARNING ( "warnings turned on" );
+  }
+  if (args.notice_flag)
+  {
+    ID3D_INIT_NOTICE();
+    ID3D_NOTICE ( "notices turned on" );
+  }
+#endif
+
+  flags_t tags = ID3TT_ALL;
+  if (args.v1tag_flag || args.v2tag_flag)
+  {
+    tags = ID3TT_NONE;
+    if (args.v1tag_flag)
+    {
+      tags |= ID3TT_ID3V1;
+    }
+    if (args.v2tag_flag)
+    {
+      tags |= ID3TT_ID3V2;
+    }
+  }
+
+  ID3_Scanner scanner(args.threads_given && args.threads_arg > 0 ? args.threads_arg : 0);
+  scanner.SetTagTypes(tags);
+  scanner.SetLazyParsing(args.lazy_flag != 0);
+
+  // the scanner writes many lines at once, so the stream needn't keep in
+  // step with stdio
+  std::ios::sync_with_stdio(false);
+  size_t scanned = 0;
+  for (size_t i = 0; i < args.inputs_num; ++i)
+  {
+    scanned += scanner.ScanToJSON(args.inputs[i], cout);
+  }
+  cout.flush();
+  if (args.inputs_num > 0 && scanned == 0)
+  {
+    cerr << "id3scan: no files scanned" << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,264 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+// counts the allocations made while a tag is parsed
+static size_t numNews = 0;
+
+#if __cplusplus >= 201103L
+#  define ID3_TEST_NOTHROW noexcept
+#  define ID3_TEST_THROW
+#else
+#  define ID3_TEST_NOTHROW throw()
+#  define ID3_TEST_THROW throw(std::bad_alloc)
+#endif
+
+void* operator new(size_t size) ID3_TEST_THROW
+{
+  ++numNews;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) ID3_TEST_NOTHROW
+{
+  free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, size_t) ID3_TEST_NOTHROW
+{
+  free(p);
+}
+#endif
+
+static const char* const TEMPFILE = "test-arena.mp3";
+static const size_t NUM_COMMENTS = 40;
+
+static String description(size_t i)
+{
+  char desc[32];
+  sprintf(desc, "comment %lu", (unsigned long) i);
+  return desc;
+}
+
+static void writeFile()
+{
+  {
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    BString audio(10000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  ID3_Tag tag(TEMPFILE);
+  ID3_AddTitle(&tag, "The title");
+  ID3_AddArtist(&tag, "The artist");
+  ID3_AddTrack(&tag, 3, 12);
+  for (size_t i = 0; i < NUM_COMMENTS; ++i)
+  {
+    ID3_AddComment(&tag, "some comment", description(i).c_str());
+  }
+  tag.Update(ID3TT_ID3V2);
+}
+
+static BString render(const ID3_Tag& tag)
+{
+  BString bytes;
+  io::BStringWriter writer(bytes);
+  tag.Render(writer, ID3TT_ID3V2);
+  return bytes;
+}
+
+// Links the tag to the file, and returns the number of allocations it took
+static size_t link(ID3_Tag& tag)
+{
+  tag.Clear();
+  const size_t before = numNews;
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+  return numNews - before;
+}
+
+// The same file parses into the same tag with the arena, and with far fewer
+// allocations once the arena has grown to hold it
+static size_t checkParse(bool lazy)
+{
+  const char* name = lazy ? "lazy" : "eager";
+  size_t errors = 0;
+  ID3_Tag heap, arena;
+  heap.SetLazyParsing(lazy);
+  arena.SetLazyParsing(lazy);
+  arena.SetArenaAllocation(true);
+
+  const size_t heapNews = link(heap);
+  link(arena);
+  const size_t arenaNews = link(arena);
+  if (!arena.GetArenaAllocation() || heap.GetArenaAllocation() ||
+      arena.NumFrames() != NUM_COMMENTS + 3 || render(arena) != render(heap))
+  {
+    cout << name << ": the arena tag differs" << endl;
+    ++errors;
+  }
+  if (arenaNews * 2 > heapNews)
+  {
+    cout << name << ": " << arenaNews << " allocations with the arena, " <<
+      heapNews << " without" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// Frames leave the arena when they leave the tag
+static size_t checkRemove()
+{
+  size_t errors = 0;
+  ID3_Frame* title = NULL;
+  ID3_Frame* comment = NULL;
+  {
+    ID3_Tag tag;
+    tag.SetArenaAllocation(true);
+    link(tag);
+    title = tag.RemoveFrame(tag.FindFirst(ID3FID_TITLE));
+    comment = tag.RemoveFrame(tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION,
+                                            description(5).c_str()));
+    if (title == NULL || comment == NULL ||
+        tag.NumFrames() != NUM_COMMENTS + 1 || tag.FindFirst(ID3FID_TITLE) != NULL)
+    {
+      cout << "remove: frames not removed" << endl;
+      return 1;
+    }
+    link(tag);
+    // put one back, which goes on the heap
+    tag.AttachFrame(title);
+    title = NULL;
+  }
+  char* desc = ID3_GetString(comment, ID3FN_DESCRIPTION);
+  if (desc == NULL || description(5) != desc)
+  {
+    cout << "remove: the removed frame didn't survive its tag" << endl;
+    ++errors;
+  }
+  ID3_FreeString(desc);
+  delete comment;
+  return errors;
+}
+
+// A tag parsed into its arena can be changed and written as usual
+static size_t checkUpdate()
+{
+  size_t errors = 0;
+  {
+    ID3_Tag tag;
+    tag.SetArenaAllocation(true);
+    link(tag);
+    tag.FindFirst(ID3FID_TITLE)->GetField(ID3FN_TEXT)->Set("A new title");
+    tag.FindFirst(ID3FID_TRACKNUM)->SetID(ID3FID_PARTINSET);
+    ID3_RemoveComments(&tag, description(0).c_str());
+    // frames are added to the arena tag after the arena is switched off
+    tag.SetArenaAllocation(false);
+    ID3_AddAlbum(&tag, "The album");
+    tag.Update(ID3TT_ID3V2);
+  }
+  ID3_Tag tag(TEMPFILE);
+  char* title = ID3_GetTitle(&tag);
+  char* album = ID3_GetAlbum(&tag);
+  if (title == NULL || String("A new title") != title ||
+      album == NULL || String("The album") != album ||
+      tag.FindFirst(ID3FID_PARTINSET) == NULL ||
+      tag.NumFrames() != NUM_COMMENTS + 3)
+  {
+    cout << "update: the changes weren't written" << endl;
+    ++errors;
+  }
+  ID3_FreeString(title);
+  ID3_FreeString(album);
+  return errors;
+}
+
+// Frames the application attaches and removes over and over reuse the
+// arena's memory for their list entries, rather than growing the arena
+static size_t checkChurn()
+{
+  ID3_Tag tag;
+  tag.SetArenaAllocation(true);
+  link(tag);
+  size_t footprint = 0;
+  for (size_t i = 0; i < 20000; ++i)
+  {
+    ID3_Frame* frame = new ID3_Frame(ID3FID_ALBUM);
+    tag.AttachFrame(frame);
+    delete tag.RemoveFrame(frame);
+    if (i == 10)
+    {
+      footprint = tag.GetMemoryFootprint();
+    }
+  }
+  if (tag.GetMemoryFootprint() > footprint || tag.NumFrames() != NUM_COMMENTS + 3)
+  {
+    cout << "churn: the tag grew from " << footprint << " to " <<
+      tag.GetMemoryFootprint() << " bytes" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  writeFile();
+  size_t errors = checkParse(false);
+  errors += checkParse(true);
+  errors += checkRemove();
+  errors += checkUpdate();
+  errors += checkChurn();
+  remove(TEMPFILE);
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "tags parse into their arenas" << endl;
+  return 0;
+}
@@ -0,0 +1,149 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdlib.h>
+#include <vector>
+#include <iostream>
+#include <id3/tag.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const ID3_FrameID ids[] =
+{
+  ID3FID_UNIQUEFILEID, ID3FID_CRYPTOREG, ID3FID_GROUPINGREG, ID3FID_USERTEXT
+};
+static const size_t numIds = sizeof(ids) / sizeof(ids[0]);
+static const char* owners[] =
+{
+  "http://www.id3.org", "http://musicbrainz.org", "mailto:me@example.com",
+  "ftp://ftp.example.com", "not an owner"
+};
+static const size_t numOwners = sizeof(owners) / sizeof(owners[0]);
+
+static ID3_Frame* newFrame(size_t n)
+{
+  ID3_Frame* frame = new ID3_Frame(ids[rand() % numIds]);
+  if (frame->Contains(ID3FN_OWNER))
+  {
+    frame->GetField(ID3FN_OWNER)->Set(owners[rand() % numOwners]);
+  }
+  if (frame->Contains(ID3FN_ID))
+  {
+    frame->GetField(ID3FN_ID)->Set(0x80 + rand() % 4);
+  }
+  if (frame->Contains(ID3FN_DESCRIPTION))
+  {
+    frame->GetField(ID3FN_DESCRIPTION)->Set("description");
+  }
+  // tells the frames apart
+  if (frame->Contains(ID3FN_DATA))
+  {
+    frame->GetField(ID3FN_DATA)->Set(reinterpret_cast<const uchar*>(&n), sizeof(n));
+  }
+  else
+  {
+    frame->GetField(ID3FN_TEXT)->Set(n % 2 ? "odd" : "even");
+  }
+  return frame;
+}
+
+static BString render(const ID3_Frame& frame)
+{
+  BString data;
+  io::BStringWriter writer(data);
+  frame.Render(writer);
+  return data;
+}
+
+static bool sameFrames(const ID3_Tag& lhs, const ID3_Tag& rhs)
+{
+  if (lhs.NumFrames() != rhs.NumFrames())
+  {
+    return false;
+  }
+  ID3_Tag::ConstIterator* li = lhs.CreateIterator();
+  ID3_Tag::ConstIterator* ri = rhs.CreateIterator();
+  bool same = true;
+  const ID3_Frame* lf = NULL;
+  while (same && NULL != (lf = li->GetNext()))
+  {
+    const ID3_Frame* rf = ri->GetNext();
+    same = rf != NULL && render(*lf) == render(*rf);
+  }
+  delete li;
+  delete ri;
+  return same;
+}
+
+int main()
+{
+  size_t errors = 0;
+  srand(7);
+  for (size_t round = 0; round < 200; ++round)
+  {
+    // what's already in the tag
+    ID3_Tag one, batch;
+    const size_t numOld = rand() % 8;
+    for (size_t i = 0; i < numOld; ++i)
+    {
+      ID3_Frame* frame = newFrame(i);
+      one.AttachFrame(new ID3_Frame(*frame));
+      batch.AttachFrame(frame);
+    }
+
+    // newest wins, whether the frames come one at a time or as a batch
+    vector<ID3_Frame*> frames;
+    const size_t numNew = rand() % 24;
+    for (size_t i = 0; i < numNew; ++i)
+    {
+      ID3_Frame* frame = newFrame(numOld + i);
+      one.AttachFrame(new ID3_Frame(*frame));
+      frames.push_back(frame);
+    }
+    if (!frames.empty())
+    {
+      batch.AttachFrames(&frames[0], frames.size());
+    }
+
+    if (!sameFrames(one, batch))
+    {
+      cout << "round " << round << ": AttachFrames differs from AttachFrame" << endl;
+      ++errors;
+    }
+  }
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "AttachFrames matches AttachFrame" << endl;
+  return 0;
+}
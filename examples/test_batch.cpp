@@ -0,0 +1,238 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <id3.h>
+#include <id3/batch.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const size_t NUM_FILES = 40;
+static const char* const MISSING = "test-batch-missing.mp3";
+
+static String fileName(size_t i)
+{
+  char name[64];
+  sprintf(name, "test-batch-%lu.mp3", (unsigned long) i);
+  return name;
+}
+
+static void writeFile(const String& name, size_t i)
+{
+  {
+    ofstream file(name.c_str(), ios::out | ios::binary | ios::trunc);
+    BString audio(10000 + 100 * i, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  ID3_Tag tag(name.c_str());
+  ID3_AddTitle(&tag, fileName(i).c_str());
+  ID3_Frame* counter = new ID3_Frame(ID3FID_PLAYCOUNTER);
+  counter->GetField(ID3FN_COUNTER)->Set((uint32) 0);
+  tag.AttachFrame(counter);
+  tag.Update(ID3TT_ID3V2);
+}
+
+static uint32 getCount(const String& name)
+{
+  ID3_Tag tag(name.c_str());
+  ID3_Frame* frame = tag.Find(ID3FID_PLAYCOUNTER);
+  return frame ? frame->GetField(ID3FN_COUNTER)->Get() : 0;
+}
+
+// Counts a play, and checks the tag is the one of the file
+static bool countPlay(ID3_Tag& tag, const char* name, void* data)
+{
+  ID3_Frame* frame = tag.Find(ID3FID_PLAYCOUNTER);
+  char* title = ID3_GetTitle(&tag);
+  bool ours = title != NULL && String(title) == name;
+  ID3_FreeString(title);
+  if (frame == NULL || !ours)
+  {
+    return false;
+  }
+  ID3_Field* count = frame->GetField(ID3FN_COUNTER);
+  count->Set(count->Get() + 1);
+  return true;
+}
+
+static bool leaveAlone(ID3_Tag&, const char*, void*)
+{
+  return false;
+}
+
+static bool fail(ID3_Tag&, const char*, void*)
+{
+  throw 1;
+}
+
+static bool CCONV countPlayC(ID3Tag* tag, const char* name, void* data)
+{
+  return countPlay(*reinterpret_cast<ID3_Tag*>(tag), name, data);
+}
+
+// Runs a batch over all the files, and checks the results and counts
+static size_t checkBatch(ID3_BatchUpdater& batch, uint32 count)
+{
+  const size_t first = batch.NumJobs();
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    batch.Add(fileName(i).c_str(), countPlay);
+  }
+  batch.Wait();
+
+  size_t errors = 0;
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    if (batch.GetResult(first + i) != ID3E_NoError ||
+        !(batch.GetUpdatedTags(first + i) & ID3TT_ID3V2))
+    {
+      cout << fileName(i) << ": result " << batch.GetResult(first + i) <<
+        ", updated " << batch.GetUpdatedTags(first + i) << endl;
+      ++errors;
+    }
+    if (getCount(fileName(i)) != count)
+    {
+      cout << fileName(i) << ": count " << getCount(fileName(i)) <<
+        ", expected " << count << endl;
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+static size_t checkCpp()
+{
+  size_t errors = 0;
+  ID3_BatchUpdater batch(4);
+  batch.SetQueueSize(2);
+  batch.SetTagTypes(ID3TT_ID3V2, ID3TT_ID3V2);
+  if (batch.GetNumWorkers() != 4 || batch.GetQueueSize() != 2)
+  {
+    cout << "workers " << batch.GetNumWorkers() << ", queue " <<
+      batch.GetQueueSize() << endl;
+    ++errors;
+  }
+  errors += checkBatch(batch, 1);
+  // the workers start anew
+  batch.SetLazyParsing(true);
+  errors += checkBatch(batch, 2);
+
+  // the jobs which don't update their files
+  remove(MISSING);
+  const size_t missing = batch.Add(MISSING, countPlay);
+  const size_t left = batch.Add(fileName(0).c_str(), leaveAlone);
+  const size_t failed = batch.Add(fileName(1).c_str(), fail);
+  batch.Wait();
+  if (batch.GetResult(missing) != ID3E_NoFile ||
+      batch.GetResult(left) != ID3E_NoError ||
+      batch.GetUpdatedTags(left) != ID3TT_NONE ||
+      batch.GetResult(failed) != ID3E_EditFailed)
+  {
+    cout << "missing " << batch.GetResult(missing) << ", left alone " <<
+      batch.GetResult(left) << "/" << batch.GetUpdatedTags(left) <<
+      ", failed " << batch.GetResult(failed) << endl;
+    ++errors;
+  }
+  if (batch.NumJobs() != 2 * NUM_FILES + 3 || batch.GetResult(failed + 1) != ID3E_NoData)
+  {
+    cout << batch.NumJobs() << " jobs" << endl;
+    ++errors;
+  }
+  batch.Clear();
+  if (batch.NumJobs() != 0)
+  {
+    cout << batch.NumJobs() << " jobs after Clear()" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+static size_t checkC()
+{
+  size_t errors = 0;
+  ID3BatchUpdater* batch = ID3BatchUpdater_New(3);
+  ID3BatchUpdater_SetTagTypes(batch, ID3TT_ID3V2, ID3TT_ID3V2);
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    ID3BatchUpdater_Add(batch, fileName(i).c_str(), countPlayC, NULL);
+  }
+  ID3BatchUpdater_Wait(batch);
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    if (ID3BatchUpdater_GetResult(batch, i) != ID3E_NoError ||
+        ID3BatchUpdater_GetUpdatedTags(batch, i) != ID3TT_ID3V2 ||
+        getCount(fileName(i)) != 3)
+    {
+      cout << fileName(i) << ": C result " << ID3BatchUpdater_GetResult(batch, i) <<
+        ", count " << getCount(fileName(i)) << endl;
+      ++errors;
+    }
+  }
+  // deleting the updater waits for the jobs
+  ID3BatchUpdater_Add(batch, fileName(0).c_str(), countPlayC, NULL);
+  ID3BatchUpdater_Delete(batch);
+  if (getCount(fileName(0)) != 4)
+  {
+    cout << "count " << getCount(fileName(0)) << " after Delete" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    writeFile(fileName(i), i);
+  }
+
+  size_t errors = checkCpp();
+  errors += checkC();
+
+  for (size_t i = 0; i < NUM_FILES; ++i)
+  {
+    remove(fileName(i).c_str());
+  }
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "batches update their files" << endl;
+  return 0;
+}
@@ -0,0 +1,311 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Sets, copies and rereads field values of every kind and size, which are
+// kept in the field when short and on the heap, shared by copies, when long.
+// A long text list is built with few allocations.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+// counts the allocations made while a list is built
+static size_t numNews = 0;
+
+#if __cplusplus >= 201103L
+#  define ID3_TEST_NOTHROW noexcept
+#  define ID3_TEST_THROW
+#else
+#  define ID3_TEST_NOTHROW throw()
+#  define ID3_TEST_THROW throw(std::bad_alloc)
+#endif
+
+void* operator new(size_t size) ID3_TEST_THROW
+{
+  ++numNews;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) ID3_TEST_NOTHROW
+{
+  free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, size_t) ID3_TEST_NOTHROW
+{
+  free(p);
+}
+#endif
+
+static const char* const TEMPFILE = "test-fieldstorage.mp3";
+static const char* const SHORT_TEXT = "Short title";
+static const char* const LONG_TEXT =
+  "A title much too long to be kept in the field itself";
+static const size_t PICTURE_SIZE = 5000;
+
+static String text(const ID3_Field* fld)
+{
+  const char* raw = (fld != NULL) ? fld->GetRawText() : NULL;
+  return (raw != NULL) ? raw : "";
+}
+
+static BString picture(uchar fill)
+{
+  return BString(PICTURE_SIZE, fill);
+}
+
+static BString binary(const ID3_Field* fld)
+{
+  return BString(fld->GetRawBinary(), fld->Size());
+}
+
+// Short and long text, text lists and fixed size text
+static size_t checkText()
+{
+  size_t errors = 0;
+  ID3_Frame frame(ID3FID_TITLE);
+  ID3_Field* fld = frame.GetField(ID3FN_TEXT);
+  fld->Set(SHORT_TEXT);
+  if (text(fld) != SHORT_TEXT || fld->Size() != strlen(SHORT_TEXT))
+  {
+    cout << "text: the short text is wrong" << endl;
+    ++errors;
+  }
+  fld->Set(LONG_TEXT);
+  if (text(fld) != LONG_TEXT || fld->Size() != strlen(LONG_TEXT))
+  {
+    cout << "text: the long text is wrong" << endl;
+    ++errors;
+  }
+  fld->Set(SHORT_TEXT);
+  if (text(fld) != SHORT_TEXT)
+  {
+    cout << "text: the text didn't shrink" << endl;
+    ++errors;
+  }
+
+  fld->Set("one");
+  fld->Add("two");
+  fld->Add(LONG_TEXT);
+  if (fld->GetNumTextItems() != 3 || String(fld->GetRawTextItem(1)) != "two" ||
+      String(fld->GetRawTextItem(2)) != LONG_TEXT)
+  {
+    cout << "text: the text list is wrong" << endl;
+    ++errors;
+  }
+
+  ID3_Frame comment(ID3FID_COMMENT);
+  ID3_Field* lang = comment.GetField(ID3FN_LANGUAGE);
+  lang->Set("english");
+  if (lang->Size() != 3 || String(lang->GetRawText(), 3) != "eng")
+  {
+    cout << "text: the fixed size text is wrong" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// A list of many items grows its value a few times, not once per item
+static size_t checkLongList()
+{
+  const size_t NUM_ITEMS = 20000;
+  ID3_Frame frame(ID3FID_INVOLVEDPEOPLE);
+  ID3_Field* fld = frame.GetField(ID3FN_TEXT);
+  fld->Set("first");
+  const size_t before = numNews;
+  for (size_t i = 1; i < NUM_ITEMS; ++i)
+  {
+    fld->Add("an item");
+  }
+  const size_t news = numNews - before;
+  if (fld->GetNumTextItems() != NUM_ITEMS ||
+      String(fld->GetRawTextItem(NUM_ITEMS - 1)) != "an item")
+  {
+    cout << "list: the list is wrong" << endl;
+    return 1;
+  }
+  if (news > 100)
+  {
+    cout << "list: " << news << " allocations for " << NUM_ITEMS << " items" <<
+      endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Unicode text, and its items
+static size_t checkUnicode()
+{
+  size_t errors = 0;
+  ID3_Frame frame(ID3FID_TITLE);
+  ID3_Field* fld = frame.GetField(ID3FN_TEXT);
+  fld->SetEncoding(ID3TE_UTF16);
+  const unicode_t first[] = { 'a', 0x263a, 'b', 0 };
+  const unicode_t second[] = { 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l',
+                               'm', 'n', 'o', 'p', 0 };
+  fld->Set(first);
+  fld->Add(second);
+
+  unicode_t buffer[3];
+  const unicode_t* item = fld->GetRawUnicodeTextItem(1);
+  if (fld->GetNumTextItems() != 2 || fld->Get(buffer, 3) != 3 ||
+      buffer[1] != 0x263a || item == NULL || item[0] != 'c' || item[13] != 'p' ||
+      item[14] != 0)
+  {
+    cout << "unicode: the text is wrong" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// Copies share their binary data, and don't see each other's changes
+static size_t checkCopies()
+{
+  size_t errors = 0;
+  ID3_Frame frame(ID3FID_PICTURE);
+  frame.GetField(ID3FN_DATA)->Set(picture(0xaa).data(), PICTURE_SIZE);
+  frame.GetField(ID3FN_DESCRIPTION)->Set(LONG_TEXT);
+  frame.GetField(ID3FN_PICTURETYPE)->Set(3);
+
+  ID3_Frame* copy = new ID3_Frame(frame);
+  ID3_Frame other(ID3FID_PICTURE);
+  other = frame;
+  copy->GetField(ID3FN_DATA)->Set(picture(0xbb).data(), PICTURE_SIZE);
+  copy->GetField(ID3FN_DESCRIPTION)->Set(SHORT_TEXT);
+  if (binary(frame.GetField(ID3FN_DATA)) != picture(0xaa) ||
+      binary(other.GetField(ID3FN_DATA)) != picture(0xaa) ||
+      binary(copy->GetField(ID3FN_DATA)) != picture(0xbb) ||
+      text(frame.GetField(ID3FN_DESCRIPTION)) != LONG_TEXT ||
+      text(copy->GetField(ID3FN_DESCRIPTION)) != SHORT_TEXT ||
+      other.GetField(ID3FN_PICTURETYPE)->Get() != 3)
+  {
+    cout << "copies: a change showed through to another copy" << endl;
+    ++errors;
+  }
+  delete copy;
+  if (binary(other.GetField(ID3FN_DATA)) != picture(0xaa))
+  {
+    cout << "copies: the data went with the copy" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// Values of every size survive a write and a read, and the tag's footprint
+// follows what it holds
+static size_t checkFile()
+{
+  size_t errors = 0;
+  {
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    BString audio(10000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  size_t small = 0;
+  {
+    ID3_Tag tag(TEMPFILE);
+    ID3_AddTitle(&tag, LONG_TEXT);
+    ID3_AddArtist(&tag, "An artist");
+    ID3_AddTrack(&tag, 3, 12);
+    small = tag.GetMemoryFootprint();
+    ID3_Frame* pic = new ID3_Frame(ID3FID_PICTURE);
+    pic->GetField(ID3FN_DATA)->Set(picture(0xcc).data(), PICTURE_SIZE);
+    tag.AttachFrame(pic);
+    if (small == 0 || tag.GetMemoryFootprint() < small + PICTURE_SIZE)
+    {
+      cout << "file: the footprint of " << tag.GetMemoryFootprint() <<
+        " bytes leaves out the picture" << endl;
+      ++errors;
+    }
+    tag.Update(ID3TT_ID3V2);
+  }
+
+  for (size_t lazy = 0; lazy < 2; ++lazy)
+  {
+    ID3_Tag tag;
+    tag.SetLazyParsing(lazy != 0);
+    tag.Link(TEMPFILE, ID3TT_ID3V2);
+    char* title = ID3_GetTitle(&tag);
+    char* track = ID3_GetTrack(&tag);
+    const ID3_Frame* pic = tag.FindFirst(ID3FID_PICTURE);
+    if (title == NULL || String(title) != LONG_TEXT || track == NULL ||
+        String(track) != "3/12" || pic == NULL ||
+        binary(pic->GetField(ID3FN_DATA)) != picture(0xcc) ||
+        tag.GetMemoryFootprint() < small + PICTURE_SIZE)
+    {
+      cout << "file: the tag wasn't read back" << endl;
+      ++errors;
+    }
+    ID3_FreeString(title);
+    ID3_FreeString(track);
+    tag.Clear();
+    if (tag.GetMemoryFootprint() >= small)
+    {
+      cout << "file: the cleared tag still takes up " <<
+        tag.GetMemoryFootprint() << " bytes" << endl;
+      ++errors;
+    }
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = checkText();
+  errors += checkUnicode();
+  errors += checkLongList();
+  errors += checkCopies();
+  errors += checkFile();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "field values of every size are kept" << endl;
+  return 0;
+}
@@ -0,0 +1,71 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Helpers the tests share for writing files and reading them back.  <fstream>
+// has to be included before id3/io_strings.h, which defines min().
+
+#ifndef _ID3LIB_TEST_FILES_H_
+#define _ID3LIB_TEST_FILES_H_
+
+#include <fstream>
+#include <id3/globals.h>
+#include <id3/id3lib_strings.h>
+
+// The whole of the file
+inline dami::BString readFile(const char* name)
+{
+  std::ifstream file(name, std::ios::in | std::ios::binary);
+  dami::BString data;
+  char buf[65536];
+  while (file.read(buf, sizeof(buf)) || file.gcount() > 0)
+  {
+    data.append(reinterpret_cast<uchar*>(buf), file.gcount());
+  }
+  return data;
+}
+
+// Replaces the file with data
+inline void writeFile(const char* name, const dami::BString& data)
+{
+  std::ofstream file(name, std::ios::out | std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// Bytes that stand in for the audio of a file, the same ones each time
+inline dami::BString audio(size_t size)
+{
+  dami::BString data;
+  data.reserve(size);
+  uint32 seed = 12345;
+  for (size_t i = 0; i < size; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data += static_cast<uchar>(seed >> 16);
+  }
+  return data;
+}
+
+#endif /* _ID3LIB_TEST_FILES_H_ */
@@ -0,0 +1,195 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#include "test_files.h"
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-filter.tag";
+
+static BString render(const ID3_Tag& tag)
+{
+  BString data;
+  io::BStringWriter writer(data);
+  tag.Render(writer);
+  return data;
+}
+
+static BString makeTag(ID3_V2Spec spec, bool unsync)
+{
+  ID3_Tag tag;
+  tag.SetSpec(spec);
+  tag.SetUnsync(unsync);
+  tag.SetPadding(false);
+  ID3_AddTitle(&tag, "The title");
+  ID3_AddArtist(&tag, "The artist");
+  ID3_AddComment(&tag, "A comment", "", "eng");
+
+  BString picture(50000, 0xFF);
+  ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+  frame->GetField(ID3FN_DATA)->Set(picture.data(), picture.size());
+  tag.AttachFrame(frame);
+
+  frame = new ID3_Frame(ID3FID_GENERALOBJECT);
+  frame->GetField(ID3FN_MIMETYPE)->Set("application/octet-stream");
+  frame->GetField(ID3FN_FILENAME)->Set("test.bin");
+  frame->GetField(ID3FN_DATA)->Set(picture.data(), 100);
+  tag.AttachFrame(frame);
+
+  ID3_AddAlbum(&tag, "The album");
+  return render(tag);
+}
+
+// Parses data through the filter and checks which frames are left
+static size_t checkFilter(const BString& data, bool lazy, const ID3_FrameID* ids,
+                          size_t numIds, bool keep, const char* expected)
+{
+  ID3_Tag tag;
+  tag.SetLazyParsing(lazy);
+  tag.SetFrameFilter(ids, numIds, keep);
+  io::BStringReader reader(data);
+  tag.Parse(reader);
+
+  String found;
+  ID3_Tag::Iterator* iter = tag.CreateIterator();
+  ID3_Frame* frame = NULL;
+  while (NULL != (frame = iter->GetNext()))
+  {
+    found += frame->GetTextID();
+    found += ' ';
+  }
+  delete iter;
+
+  size_t errors = 0;
+  if (found != expected)
+  {
+    cout << "expected frames \"" << expected << "\", found \"" << found << "\"" << endl;
+    ++errors;
+  }
+  if (tag.NumFrames() + tag.NumSkippedFrames() != 6)
+  {
+    cout << "skipped " << tag.NumSkippedFrames() << " of 6 frames, kept " <<
+      tag.NumFrames() << endl;
+    ++errors;
+  }
+  char* title = ID3_GetTitle(&tag);
+  if (title != NULL && String(title) != "The title")
+  {
+    cout << "title \"" << title << "\" differs" << endl;
+    ++errors;
+  }
+  ID3_FreeString(title);
+  return errors;
+}
+
+static size_t check(ID3_V2Spec spec, bool unsync, bool lazy)
+{
+  const BString data = makeTag(spec, unsync);
+  const ID3_FrameID binary[] = { ID3FID_PICTURE, ID3FID_PRIVATE, ID3FID_GENERALOBJECT };
+  const ID3_FrameID wanted[] = { ID3FID_TITLE, ID3FID_LEADARTIST };
+
+  size_t errors = 0;
+  errors += checkFilter(data, lazy, NULL, 0, false, "TIT2 TPE1 COMM APIC GEOB TALB ");
+  errors += checkFilter(data, lazy, binary, 3, false, "TIT2 TPE1 COMM TALB ");
+  errors += checkFilter(data, lazy, wanted, 2, true, "TIT2 TPE1 ");
+  errors += checkFilter(data, lazy, NULL, 0, true, "");
+  if (errors > 0)
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ", lazy " << lazy <<
+      ": " << errors << " errors" << endl;
+  }
+  return errors;
+}
+
+// Update() mustn't write a tag without the skipped frames
+static size_t checkUpdate()
+{
+  const BString data = makeTag(ID3V2_3_0, false) + BString(1000, 0x55);
+  writeFile(TEMPFILE, data);
+
+  size_t errors = 0;
+  ID3_Tag tag;
+  const ID3_FrameID binary[] = { ID3FID_PICTURE };
+  tag.SetFrameFilter(binary, 1, false);
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+  ID3_AddTitle(&tag, "Another title", true);
+  if ((tag.Update(ID3TT_ID3V2) & ID3TT_ID3V2) != 0 ||
+      tag.GetLastError() != ID3E_FramesSkipped)
+  {
+    cout << "filtered tag was written" << endl;
+    ++errors;
+  }
+  if (readFile(TEMPFILE) != data)
+  {
+    cout << "file was changed" << endl;
+    ++errors;
+  }
+
+  // without the filter, the tag is written as usual
+  tag.Clear();
+  tag.SetFrameFilter(NULL, 0);
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+  ID3_AddTitle(&tag, "Another title", true);
+  if ((tag.Update(ID3TT_ID3V2) & ID3TT_ID3V2) == 0 || tag.NumFrames() != 6)
+  {
+    cout << "unfiltered tag wasn't written" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  for (int i = 0; i < 8; ++i)
+  {
+    errors += check(i & 1 ? ID3V2_4_0 : ID3V2_3_0, (i & 2) != 0, (i & 4) != 0);
+  }
+  errors += checkUpdate();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "frame filter skips the requested frames" << endl;
+  return 0;
+}
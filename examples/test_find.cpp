@@ -0,0 +1,194 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include <id3/tag.h>
+
+using namespace std;
+
+static const ID3_FrameID ids[] =
+{
+  ID3FID_USERTEXT, ID3FID_COMMENT, ID3FID_WWWUSER, ID3FID_TITLE
+};
+static const size_t numIds = sizeof(ids) / sizeof(ids[0]);
+static const char* descs[] = { "", "a", "b", "Tempo", "Mood" };
+static const size_t numDescs = sizeof(descs) / sizeof(descs[0]);
+
+// The frames of the tag in order, via the public iterator
+static vector<ID3_Frame*> frames(ID3_Tag& tag)
+{
+  vector<ID3_Frame*> list;
+  ID3_Tag::Iterator* iter = tag.CreateIterator();
+  ID3_Frame* frame = NULL;
+  while (NULL != (frame = iter->GetNext()))
+  {
+    list.push_back(frame);
+  }
+  delete iter;
+  return list;
+}
+
+static bool hasDesc(const ID3_Frame* frame, const char* desc)
+{
+  if (!frame->Contains(ID3FN_DESCRIPTION))
+  {
+    return false;
+  }
+  const ID3_Field* fld = frame->GetField(ID3FN_DESCRIPTION);
+  const char* text = fld->GetRawText();
+  return text != NULL && fld->Size() == strlen(desc) && strcmp(text, desc) == 0;
+}
+
+// What Find used to do: walk the list from the cursor, wrapping around to it
+static ID3_Frame* modelFind(const vector<ID3_Frame*>& list, size_t& cursor,
+                            ID3_FrameID id, const char* desc)
+{
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    size_t begin = (0 == pass ? cursor : 0), end = (0 == pass ? list.size() : cursor);
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (list[i]->GetID() == id && (NULL == desc || hasDesc(list[i], desc)))
+      {
+        cursor = i + 1;
+        return list[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+static ID3_Frame* newFrame(ID3_FrameID id, const char* desc)
+{
+  ID3_Frame* frame = new ID3_Frame(id);
+  if (frame->Contains(ID3FN_DESCRIPTION))
+  {
+    frame->GetField(ID3FN_DESCRIPTION)->Set(desc);
+  }
+  return frame;
+}
+
+int main()
+{
+  ID3_Tag tag;
+  size_t cursor = 0;
+  size_t errors = 0;
+
+  srand(1);
+  for (size_t op = 0; op < 20000; ++op)
+  {
+    vector<ID3_Frame*> list = frames(tag);
+    const ID3_FrameID id = ids[rand() % numIds];
+    const char* desc = descs[rand() % numDescs];
+    switch (rand() % 10)
+    {
+      case 0:
+      case 1:
+      {
+        if (list.size() < 64)
+        {
+          tag.AttachFrame(newFrame(id, desc));
+          cursor = 0;
+        }
+        break;
+      }
+      case 2:
+      {
+        if (!list.empty())
+        {
+          ID3_Frame* frame = tag.RemoveFrame(list[rand() % list.size()]);
+          if (NULL == frame)
+          {
+            cout << "op " << op << ": RemoveFrame didn't find the frame" << endl;
+            ++errors;
+          }
+          delete frame;
+          cursor = 0;
+        }
+        break;
+      }
+      case 3:
+      {
+        // change the id of a frame behind the tag's back
+        if (!list.empty())
+        {
+          ID3_Frame* frame = list[rand() % list.size()];
+          frame->SetID(id);
+          if (frame->Contains(ID3FN_DESCRIPTION))
+          {
+            frame->GetField(ID3FN_DESCRIPTION)->Set(desc);
+          }
+        }
+        break;
+      }
+      case 4:
+      case 5:
+      case 6:
+      {
+        ID3_Frame* expected = modelFind(list, cursor, id, NULL);
+        ID3_Frame* found = tag.Find(id);
+        if (found != expected)
+        {
+          cout << "op " << op << ": Find(" << id << ") mismatch" << endl;
+          ++errors;
+        }
+        break;
+      }
+      default:
+      {
+        ID3_Frame* expected = modelFind(list, cursor, id, desc);
+        ID3_Frame* found = tag.Find(id, ID3FN_DESCRIPTION, desc);
+        if (found != expected)
+        {
+          cout << "op " << op << ": Find(" << id << ", \"" << desc
+               << "\") mismatch" << endl;
+          ++errors;
+        }
+        break;
+      }
+    }
+  }
+
+  tag.Clear();
+  if (tag.Find(ID3FID_USERTEXT) != NULL || tag.NumFrames() != 0)
+  {
+    cout << "Clear left frames behind" << endl;
+    ++errors;
+  }
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "Find matches the linear search" << endl;
+  return 0;
+}
@@ -0,0 +1,152 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Reads and skips more than 4 GiB at a time from the string readers, and
+// finds the ID3v1 tag at the end of a file of over 4 GiB.  The file is made
+// sparse; where the file system can't hold one, that part is skipped.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-largefile.mp3";
+static const uint64 FOUR_GIB = 0x100000000ULL;
+static const char* const TITLE = "Past four gigabytes";
+
+// Counts of more than 32 bits aren't cut down to their low bits
+static size_t checkReaders()
+{
+  size_t errors = 0;
+  const String text("0123456789");
+  const BString bytes(10, 0x55);
+  char buf[16];
+  uchar bbuf[16];
+  {
+    io::StringReader reader(text);
+    if (reader.readChars(buf, FOUR_GIB + 3) != text.size())
+    {
+      cout << "readers: a string read was cut short" << endl;
+      ++errors;
+    }
+  }
+  {
+    io::StringReader reader(text);
+    if (reader.skipChars(FOUR_GIB + 3) != text.size() || !reader.atEnd())
+    {
+      cout << "readers: a string skip was cut short" << endl;
+      ++errors;
+    }
+  }
+  {
+    io::BStringReader reader(bytes);
+    if (reader.readChars(bbuf, FOUR_GIB + 3) != bytes.size())
+    {
+      cout << "readers: a binary read was cut short" << endl;
+      ++errors;
+    }
+  }
+  {
+    io::BStringReader reader(bytes);
+    if (reader.skipChars(FOUR_GIB + 3) != bytes.size() || !reader.atEnd())
+    {
+      cout << "readers: a binary skip was cut short" << endl;
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+// The ID3v1 tag of a file of over 4 GiB
+static size_t checkFile()
+{
+  const uint64 size = FOUR_GIB + 4096;
+  {
+    char v1[128];
+    ::memset(v1, 0, sizeof(v1));
+    ::memcpy(v1, "TAG", 3);
+    ::memcpy(v1 + 3, TITLE, ::strlen(TITLE));
+    v1[127] = (char) 0xFF;
+    // an MPEG frame header up front, so the parser doesn't walk the hole
+    // looking for the audio
+    const char mpeg[4] = { (char) 0xFF, (char) 0xFB, (char) 0x90, 0x64 };
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    file.write(mpeg, sizeof(mpeg));
+    file.seekp(static_cast<streamoff>(size - sizeof(v1)));
+    file.write(v1, sizeof(v1));
+    if (!file)
+    {
+      file.close();
+      remove(TEMPFILE);
+      cout << "file: can't make a file of over 4 GiB here, skipped" << endl;
+      return 0;
+    }
+  }
+
+  size_t errors = 0;
+  ID3_Tag tag;
+  tag.Link(TEMPFILE, ID3TT_ID3V1);
+  char* title = ID3_GetTitle(&tag);
+  if (title == NULL || String(title) != TITLE || !tag.HasV1Tag())
+  {
+    cout << "file: the tag at the end wasn't found" << endl;
+    ++errors;
+  }
+  ID3_FreeString(title);
+  if (tag.GetFileSize() != size)
+  {
+    cout << "file: the size is " << tag.GetFileSize() << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = checkReaders();
+  errors += checkFile();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "sizes past 4 GiB are kept" << endl;
+  return 0;
+}
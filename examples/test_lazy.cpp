@@ -0,0 +1,276 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <string.h>
+#include <iostream>
+#include <id3/tag.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static BString render(const ID3_Tag& tag)
+{
+  BString data;
+  io::BStringWriter writer(data);
+  tag.Render(writer);
+  return data;
+}
+
+static bool parse(ID3_Tag& tag, const BString& data, bool lazy)
+{
+  tag.SetLazyParsing(lazy);
+  io::BStringReader reader(data);
+  return tag.Parse(reader);
+}
+
+static bool sameField(const ID3_Field* lhs, const ID3_Field* rhs)
+{
+  if (lhs->GetID() != rhs->GetID() || lhs->GetType() != rhs->GetType() ||
+      lhs->Size() != rhs->Size() || lhs->GetEncoding() != rhs->GetEncoding())
+  {
+    return false;
+  }
+  switch (lhs->GetType())
+  {
+    case ID3FTY_INTEGER:
+      return lhs->Get() == rhs->Get();
+    case ID3FTY_BINARY:
+      return lhs->GetBinary() == rhs->GetBinary();
+    default:
+      if (lhs->GetRawText() != NULL)
+      {
+        return rhs->GetRawText() != NULL &&
+          memcmp(lhs->GetRawText(), rhs->GetRawText(), lhs->Size()) == 0;
+      }
+      return lhs->GetRawUnicodeText() != NULL && rhs->GetRawUnicodeText() != NULL &&
+        memcmp(lhs->GetRawUnicodeText(), rhs->GetRawUnicodeText(), lhs->Size()) == 0;
+  }
+}
+
+// Whether the frames of both tags decode to the same fields
+static bool sameFrames(const ID3_Tag& eager, const ID3_Tag& lazy)
+{
+  if (eager.NumFrames() != lazy.NumFrames())
+  {
+    return false;
+  }
+  bool same = true;
+  ID3_Tag::ConstIterator* ei = eager.CreateIterator();
+  ID3_Tag::ConstIterator* li = lazy.CreateIterator();
+  const ID3_Frame* ef = NULL;
+  while (same && NULL != (ef = ei->GetNext()))
+  {
+    const ID3_Frame* lf = li->GetNext();
+    same = lf != NULL && ef->GetID() == lf->GetID() &&
+      ef->NumFields() == lf->NumFields();
+    ID3_Frame::ConstIterator* efi = ef->CreateIterator();
+    ID3_Frame::ConstIterator* lfi = lf->CreateIterator();
+    const ID3_Field* fld = NULL;
+    while (same && NULL != (fld = efi->GetNext()))
+    {
+      same = sameField(fld, lfi->GetNext());
+    }
+    delete efi;
+    delete lfi;
+  }
+  delete ei;
+  delete li;
+  return same;
+}
+
+static void addFrames(ID3_Tag& tag)
+{
+  ID3_Frame* frame = new ID3_Frame(ID3FID_TITLE);
+  frame->GetField(ID3FN_TEXT)->Set("The title");
+  tag.AttachFrame(frame);
+
+  frame = new ID3_Frame(ID3FID_LEADARTIST);
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+  const unicode_t artist[] = { 'A', 'r', 't', 0x00FF, 0x20AC, 0 };
+  frame->GetField(ID3FN_TEXT)->Set(artist);
+  tag.AttachFrame(frame);
+
+  frame = new ID3_Frame(ID3FID_COMMENT);
+  frame->GetField(ID3FN_DESCRIPTION)->Set("compressed");
+  frame->GetField(ID3FN_LANGUAGE)->Set("eng");
+  frame->GetField(ID3FN_TEXT)->Set(String(2000, 'x').c_str());
+  frame->SetCompression(true);
+  tag.AttachFrame(frame);
+
+  frame = new ID3_Frame(ID3FID_UNIQUEFILEID);
+  frame->GetField(ID3FN_OWNER)->Set("http://www.id3.org");
+  frame->GetField(ID3FN_DATA)->Set(reinterpret_cast<const uchar*>("\xFF\x00\xFF\xE0"), 4);
+  tag.AttachFrame(frame);
+
+  // a picture full of bytes that need unsynchronization
+  BString picture;
+  for (size_t i = 0; i < 100000; ++i)
+  {
+    picture += static_cast<uchar>(i % 3 ? 0xFF : i);
+  }
+  frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+  frame->GetField(ID3FN_PICTURETYPE)->Set(3);
+  frame->GetField(ID3FN_DESCRIPTION)->Set("cover");
+  frame->GetField(ID3FN_DATA)->Set(picture.data(), picture.size());
+  tag.AttachFrame(frame);
+}
+
+static size_t check(ID3_V2Spec spec, bool unsync)
+{
+  size_t errors = 0;
+  ID3_Tag orig;
+  orig.SetSpec(spec);
+  orig.SetUnsync(unsync);
+  orig.SetPadding(false);
+  addFrames(orig);
+  const BString data = render(orig);
+
+  ID3_Tag eager, lazy;
+  eager.SetPadding(false);
+  lazy.SetPadding(false);
+  if (!parse(eager, data, false) || !parse(lazy, data, true))
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": parse failed" << endl;
+    return 1;
+  }
+
+  // untouched frames come back verbatim
+  if (render(lazy) != data)
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": lazy tag not rendered verbatim" << endl;
+    ++errors;
+  }
+  if (!sameFrames(eager, lazy))
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": lazy frames differ" << endl;
+    ++errors;
+  }
+
+  // decoded but unchanged frames too
+  if (render(lazy) != data)
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": decoded tag not rendered verbatim" << endl;
+    ++errors;
+  }
+
+  // and changed ones are rendered from their fields
+  eager.Find(ID3FID_TITLE)->GetField(ID3FN_TEXT)->Set("Another title");
+  lazy.Find(ID3FID_TITLE)->GetField(ID3FN_TEXT)->Set("Another title");
+  if (render(lazy) != render(eager))
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": changed tag differs" << endl;
+    ++errors;
+  }
+
+  // and the raw data stays around for as long as a frame needs it
+  ID3_Tag fresh;
+  fresh.SetPadding(false);
+  fresh.SetLazyParsing(true);
+  {
+    ID3_Tag other;
+    parse(other, data, true);
+    ID3_Frame* picture = other.RemoveFrame(other.Find(ID3FID_PICTURE));
+    fresh.AttachFrame(picture);
+  }
+  if (fresh.Find(ID3FID_PICTURE)->GetField(ID3FN_DATA)->Size() != 100000)
+  {
+    cout << "spec " << spec << ", unsync " << unsync << ": detached frame lost its data" << endl;
+    ++errors;
+  }
+
+  return errors;
+}
+
+// A frame flag that id3lib doesn't render survives when the frame is
+// rendered verbatim
+static size_t checkVerbatim()
+{
+  static const uchar tag[] =
+  {
+    'I', 'D', '3', 3, 0, 0, 0, 0, 0, 17,
+    'T', 'I', 'T', '2', 0, 0, 0, 7, 0x20, 0x00, // read only
+    0, 'T', 'i', 't', 'l', 'e', '!'
+  };
+  const BString data(tag, sizeof(tag));
+  ID3_Tag lazy;
+  lazy.SetPadding(false);
+  parse(lazy, data, true);
+  if (render(lazy) != data)
+  {
+    cout << "read only flag was lost" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Compares lazily and eagerly parsed tags of the given files
+static size_t checkFile(const char* name)
+{
+  ID3_Tag eager, lazy;
+  lazy.SetLazyParsing(true);
+  eager.Link(name, ID3TT_ID3V2);
+  lazy.Link(name, ID3TT_ID3V2);
+  if (!sameFrames(eager, lazy))
+  {
+    cout << name << ": lazy frames differ" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    errors += checkFile(argv[i]);
+  }
+  if (argc < 2)
+  {
+    errors += check(ID3V2_3_0, false);
+    errors += check(ID3V2_3_0, true);
+    errors += check(ID3V2_4_0, false);
+    errors += check(ID3V2_4_0, true);
+    errors += checkVerbatim();
+  }
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "lazy parsing matches eager parsing" << endl;
+  return 0;
+}
@@ -0,0 +1,157 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#include "test_files.h"
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-padding.mp3";
+static const size_t AUDIO_SIZE = 100000;
+static const size_t UPDATES = 20;
+static const size_t GROWTH = 300;
+
+static void makeFile()
+{
+  ID3_Tag tag;
+  tag.SetPadding(false);
+  ID3_AddTitle(&tag, "The title");
+  BString data;
+  io::BStringWriter writer(data);
+  tag.Render(writer);
+  writeFile(TEMPFILE, data + audio(AUDIO_SIZE));
+}
+
+// Lets the title grow by GROWTH bytes with each update, checks that the file
+// stays intact and that the padding is what the policy asks for, and returns
+// how often the tag was written in place
+static size_t check(ID3_PaddingPolicy policy, size_t amount, size_t& errors)
+{
+  makeFile();
+  ID3_Tag tag(TEMPFILE);
+  tag.SetPaddingPolicy(policy, amount);
+  for (size_t i = 1; i <= UPDATES; ++i)
+  {
+    ID3_AddTitle(&tag, String(i * GROWTH, 't').c_str(), true);
+    if ((tag.Update(ID3TT_ID3V2) & ID3TT_ID3V2) == 0)
+    {
+      cout << "policy " << policy << ": update " << i << " failed" << endl;
+      ++errors;
+      break;
+    }
+
+    ID3_TagInfo info;
+    ID3_Tag::Probe(TEMPFILE, info);
+    const BString data = readFile(TEMPFILE);
+    if (info.v2size != tag.GetPrependedBytes() || info.audiosize != AUDIO_SIZE ||
+        data.compare(info.audiooffset, AUDIO_SIZE, audio(AUDIO_SIZE)) != 0)
+    {
+      cout << "policy " << policy << ": file broken by update " << i << endl;
+      ++errors;
+      break;
+    }
+    ID3_UpdateStats stats;
+    tag.GetUpdateStats(stats);
+    const size_t frames = info.v2size - 10 - info.v2padding; // less the header
+    bool ok = true;
+    switch (policy)
+    {
+      case ID3PP_FIXED:
+        ok = stats.last == ID3UM_INPLACE || info.v2padding >= amount;
+        break;
+      case ID3PP_PERCENT:
+        ok = stats.last == ID3UM_INPLACE || info.v2padding >= frames * amount / 100;
+        break;
+      case ID3PP_BLOCK:
+        ok = info.v2size % amount == 0;
+        break;
+      default:
+        break;
+    }
+    if (!ok)
+    {
+      cout << "policy " << policy << ": " << info.v2padding << " bytes of padding for " <<
+        frames << " bytes of frames after update " << i << endl;
+      ++errors;
+    }
+  }
+
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (stats.inplace + stats.inserted + stats.rewritten != UPDATES)
+  {
+    cout << "policy " << policy << ": " << stats.inplace << " + " << stats.inserted <<
+      " + " << stats.rewritten << " updates counted" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return stats.inplace;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  check(ID3PP_DEFAULT, 0, errors);
+  check(ID3PP_PERCENT, 50, errors);
+  check(ID3PP_BLOCK, 4096, errors);
+
+  // room for 10 updates at a time
+  size_t inplace = check(ID3PP_FIXED, 10 * GROWTH + 100, errors);
+  if (inplace < UPDATES - UPDATES / 10 - 1)
+  {
+    cout << "fixed padding: only " << inplace << " updates in place" << endl;
+    ++errors;
+  }
+
+  // the room doubles each time it runs out, so the tag is only laid out anew
+  // a few times
+  inplace = check(ID3PP_ADAPTIVE, 0, errors);
+  if (inplace < UPDATES - 5)
+  {
+    cout << "adaptive padding: only " << inplace << " updates in place" << endl;
+    ++errors;
+  }
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "padding follows the policy" << endl;
+  return 0;
+}
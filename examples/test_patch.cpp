@@ -0,0 +1,305 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#include "test_files.h"
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-patch.mp3";
+static const char* const OTHERFILE = "test-patch-other.mp3";
+static const char* const TITLE = "The old title";
+static const char* const OTHER = "The new title";
+static const char* const LONGER = "A title that is longer";
+
+// Writes a file with an id3v2 tag of the given spec, holding a title, a play
+// counter and a comment which may be compressed
+static void makeFile(ID3_V2Spec spec, bool unsync, bool compress)
+{
+  writeFile(TEMPFILE, BString(20000, 0x55));
+  ID3_Tag tag(TEMPFILE);
+  tag.SetSpec(spec);
+  tag.SetUnsync(unsync);
+  ID3_AddTitle(&tag, TITLE);
+  ID3_Frame* counter = new ID3_Frame(ID3FID_PLAYCOUNTER);
+  counter->GetField(ID3FN_COUNTER)->Set(5);
+  tag.AttachFrame(counter);
+  // a tag is only unsynchronized if it has false syncs in it
+  const String text = String(unsync ? "\xff\xe0" : "") + String(1000, 'c');
+  ID3_Frame* comment = ID3_AddComment(&tag, text.c_str(), "");
+  if (comment != NULL)
+  {
+    comment->SetCompression(compress);
+  }
+  tag.Update(ID3TT_ID3V2);
+}
+
+static uint32 getCount(const ID3_Tag& tag)
+{
+  ID3_Frame* frame = tag.Find(ID3FID_PLAYCOUNTER);
+  return frame ? frame->GetField(ID3FN_COUNTER)->Get() : 0;
+}
+
+static void replace(BString& data, const BString& from, const BString& to)
+{
+  size_t pos = data.find(from);
+  if (pos != BString::npos)
+  {
+    data.replace(pos, from.size(), to);
+  }
+}
+
+static BString bytes(const char* text)
+{
+  return BString(reinterpret_cast<const uchar*>(text), strlen(text));
+}
+
+struct Case
+{
+  const char* name;
+  ID3_V2Spec spec;      // the spec the file is written with
+  bool unsync;
+  bool compress;
+  bool lazy;            // parse the file lazily?
+  bool keepSpec;        // update the tag with the spec it was read with?
+  const char* title;    // the new title, NULL to count a play instead
+  ID3_UpdateMode mode;  // how the update should be written
+};
+
+// Changes the title or play count of the file and checks how it was written,
+// and, when it was patched, that nothing else in the file changed
+static size_t check(const Case& c)
+{
+  makeFile(c.spec, c.unsync, c.compress);
+  BString expected = readFile(TEMPFILE);
+
+  ID3_Tag tag;
+  tag.SetLazyParsing(c.lazy);
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+  const uint32 count = getCount(tag);
+  if (c.keepSpec)
+  {
+    tag.SetSpec(tag.GetSpec());
+  }
+  if (c.title != NULL)
+  {
+    ID3_Frame* frame = tag.Find(ID3FID_TITLE);
+    frame->GetField(ID3FN_TEXT)->Set(c.title);
+    replace(expected, bytes(TITLE), bytes(c.title));
+  }
+  else
+  {
+    tag.Find(ID3FID_PLAYCOUNTER)->GetField(ID3FN_COUNTER)->Set(count + 1);
+    // the counter is 4 bytes, and the count is less than 256
+    const uchar old[] = { 'P', 'C', 'N', 'T', 0, 0, 0, 4, 0, 0, 0, 0, 0, (uchar)count };
+    BString now(old, sizeof(old));
+    now[sizeof(old) - 1] = (uchar)(count + 1);
+    replace(expected, BString(old, sizeof(old)), now);
+  }
+  tag.Update(ID3TT_ID3V2);
+
+  size_t errors = 0;
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (stats.last != c.mode)
+  {
+    cout << c.name << ": mode " << stats.last << ", expected " << c.mode << endl;
+    ++errors;
+  }
+  if (c.mode == ID3UM_PATCHED && readFile(TEMPFILE) != expected)
+  {
+    cout << c.name << ": the file changed outside the frame" << endl;
+    ++errors;
+  }
+
+  ID3_Tag reread(TEMPFILE);
+  char* title = ID3_GetTitle(&reread);
+  const String want = c.title ? c.title : TITLE;
+  if (title == NULL || want != title)
+  {
+    cout << c.name << ": title \"" << (title ? title : "") << "\" read back" << endl;
+    ++errors;
+  }
+  ID3_FreeString(title);
+  if (getCount(reread) != count + (c.title ? 0 : 1))
+  {
+    cout << c.name << ": count " << getCount(reread) << " read back" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+// A compressed frame that changes is never patched, as it might compress to
+// a different size
+static size_t checkCompressed()
+{
+  makeFile(ID3V2_4_0, false, true);
+  ID3_Tag tag(TEMPFILE);
+  tag.Find(ID3FID_COMMENT)->GetField(ID3FN_TEXT)->Set(String(1000, 'd').c_str());
+  tag.Update(ID3TT_ID3V2);
+
+  size_t errors = 0;
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (stats.last != ID3UM_INPLACE)
+  {
+    cout << "compressed comment: mode " << stats.last << ", expected " <<
+      ID3UM_INPLACE << endl;
+    ++errors;
+  }
+  ID3_Tag reread(TEMPFILE);
+  char* comment = ID3_GetComment(&reread);
+  if (comment == NULL || String(1000, 'd') != comment)
+  {
+    cout << "compressed comment: wrong comment read back" << endl;
+    ++errors;
+  }
+  ID3_FreeString(comment);
+  remove(TEMPFILE);
+  return errors;
+}
+
+// Patches the same file over and over
+static size_t checkRepeated()
+{
+  makeFile(ID3V2_4_0, false, false);
+  ID3_Tag tag(TEMPFILE);
+  for (uint32 i = 0; i < 3; ++i)
+  {
+    tag.Find(ID3FID_PLAYCOUNTER)->GetField(ID3FN_COUNTER)->Set(10 + i);
+    tag.Update(ID3TT_ID3V2);
+  }
+  // a longer title needs the tag to be rendered, and the frames move
+  ID3_AddTitle(&tag, LONGER, true);
+  tag.Update(ID3TT_ID3V2);
+  tag.Find(ID3FID_PLAYCOUNTER)->GetField(ID3FN_COUNTER)->Set(20);
+  tag.Update(ID3TT_ID3V2);
+
+  size_t errors = 0;
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (stats.patched != 3 || stats.inplace != 2)
+  {
+    cout << "repeated: " << stats.patched << " patched, " << stats.inplace <<
+      " in place, expected 3, 2" << endl;
+    ++errors;
+  }
+  ID3_Tag reread(TEMPFILE);
+  if (getCount(reread) != 20)
+  {
+    cout << "repeated: count " << getCount(reread) << " read back" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+// A frame removed and another attached leave as many frames as were parsed,
+// but the tag has to be rendered.  The attached frame comes unchanged from a
+// file laid out like this one, so it seems to be in its place already.
+static size_t checkReplaced()
+{
+  makeFile(ID3V2_4_0, false, false);
+  {
+    BString data = readFile(TEMPFILE);
+    replace(data, BString(1000, 'c'), BString(1000, 'e'));
+    writeFile(OTHERFILE, data);
+  }
+  ID3_Tag tag(TEMPFILE);
+  ID3_Tag other(OTHERFILE);
+  delete tag.RemoveFrame(tag.Find(ID3FID_COMMENT));
+  tag.AttachFrame(other.RemoveFrame(other.Find(ID3FID_COMMENT)));
+  tag.Update(ID3TT_ID3V2);
+
+  size_t errors = 0;
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (stats.last == ID3UM_PATCHED || stats.last == ID3UM_SKIPPED)
+  {
+    cout << "replaced: mode " << stats.last << endl;
+    ++errors;
+  }
+  ID3_Tag reread(TEMPFILE);
+  char* comment = ID3_GetComment(&reread);
+  if (comment == NULL || String(1000, 'e') != comment)
+  {
+    cout << "replaced: the old comment was read back" << endl;
+    ++errors;
+  }
+  ID3_FreeString(comment);
+  remove(TEMPFILE);
+  remove(OTHERFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  const Case cases[] =
+  {
+    // name          spec       unsync compress lazy   keep   title   mode
+    { "title",       ID3V2_4_0, false, false,   false, false, OTHER,  ID3UM_PATCHED },
+    { "counter",     ID3V2_4_0, false, false,   false, false, NULL,   ID3UM_PATCHED },
+    { "lazy",        ID3V2_4_0, false, false,   true,  false, OTHER,  ID3UM_PATCHED },
+    { "v2.3",        ID3V2_3_0, false, false,   false, true,  OTHER,  ID3UM_PATCHED },
+    { "lazy v2.3",   ID3V2_3_0, false, false,   true,  true,  NULL,   ID3UM_PATCHED },
+    { "compressed",  ID3V2_4_0, false, true,    false, false, OTHER,  ID3UM_PATCHED },
+    // the tag has to be rendered
+    { "longer",      ID3V2_4_0, false, false,   false, false, LONGER, ID3UM_INPLACE },
+    { "converted",   ID3V2_3_0, false, false,   false, false, OTHER,  ID3UM_INPLACE },
+    { "unsync",      ID3V2_4_0, true,  false,   false, false, OTHER,  ID3UM_INPLACE },
+    { "lazy unsync", ID3V2_4_0, true,  false,   true,  false, NULL,   ID3UM_INPLACE },
+  };
+
+  size_t errors = 0;
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+  {
+    errors += check(cases[i]);
+  }
+  errors += checkCompressed();
+  errors += checkRepeated();
+  errors += checkReplaced();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "changed frames are patched in place" << endl;
+  return 0;
+}
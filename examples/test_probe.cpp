@@ -0,0 +1,304 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-probe.mp3";
+
+static const flags_t TAG_TYPES[] =
+{
+  ID3TT_ID3V1, ID3TT_ID3V2, ID3TT_LYRICS3, ID3TT_LYRICS3V2, ID3TT_MUSICMATCH
+};
+
+static BString text(const char* str)
+{
+  return BString(reinterpret_cast<const uchar*>(str), strlen(str));
+}
+
+static BString le32(uint32 val)
+{
+  BString data;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    data += static_cast<uchar>((val >> (8 * i)) & 0xFF);
+  }
+  return data;
+}
+
+static BString v2Tag(ID3_V2Spec spec, bool unsync, bool padding)
+{
+  ID3_Tag tag;
+  tag.SetSpec(spec);
+  tag.SetUnsync(unsync);
+  tag.SetPadding(padding);
+  ID3_AddTitle(&tag, "The title");
+  ID3_AddArtist(&tag, "The artist");
+  BString data;
+  io::BStringWriter writer(data);
+  tag.Render(writer);
+  return data;
+}
+
+static BString audio()
+{
+  return text("\xFF\xFB\x90\x00") + BString(2000, 0x55);
+}
+
+// A tag with a lot of padding, much more than Render() ever adds
+static BString v2PaddedTag(ID3_V2Spec spec, size_t padding)
+{
+  BString data = v2Tag(spec, false, false) + BString(padding, '\0');
+  uint32 size = data.size() - 10;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    data[9 - i] = static_cast<uchar>((size >> (7 * i)) & 0x7F);
+  }
+  return data;
+}
+
+// Counts the bytes read through it
+class CountingReader : public ID3_Reader
+{
+  ID3_Reader& _reader;
+  size_type _read;
+public:
+  CountingReader(ID3_Reader& reader) : _reader(reader), _read(0) { ; }
+  size_type getRead() const { return _read; }
+  void close() { _reader.close(); }
+  pos_type getBeg() { return _reader.getBeg(); }
+  pos_type getEnd() { return _reader.getEnd(); }
+  pos_type getCur() { return _reader.getCur(); }
+  pos_type setCur(pos_type pos) { return _reader.setCur(pos); }
+  int_type peekChar() { return _reader.peekChar(); }
+  size_type readChars(char_type buf[], size_type len)
+  {
+    size_type size = _reader.readChars(buf, len);
+    _read += size;
+    return size;
+  }
+  size_type readChars(char buf[], size_type len)
+  {
+    return this->readChars(reinterpret_cast<char_type*>(buf), len);
+  }
+};
+
+// Counting the padding doesn't read through it
+static size_t checkPaddingReads(ID3_V2Spec spec, size_t padding)
+{
+  const BString v2 = v2PaddedTag(spec, padding);
+  const BString data = v2 + audio();
+  io::BStringReader reader(data);
+  CountingReader counter(reader);
+  ID3_TagInfo info;
+  ID3_Tag::Probe(counter, info);
+  if (info.v2padding != padding || counter.getRead() > 16 * 1024)
+  {
+    cout << "padding " << info.v2padding << " of " << padding << ", read " <<
+      counter.getRead() << " bytes" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+static BString v1Tag()
+{
+  return text("TAG") + BString(125, '\0');
+}
+
+static BString lyrics3v1()
+{
+  return text("LYRICSBEGIN") + text("Some lyrics") + text("LYRICSEND");
+}
+
+static BString lyrics3v2()
+{
+  BString data = text("LYRICSBEGIN") + text("IND0000200") + text("LYR00005hello");
+  char size[7];
+  sprintf(size, "%06lu", static_cast<unsigned long>(data.size()));
+  return data + text(size) + text("LYRICS200");
+}
+
+static BString musicMatch()
+{
+  BString header = text("18273645") + BString(248, ' ');
+  BString sections = text("jpg ") + le32(0) + le32(0) + le32(0);
+  BString metadata;
+  metadata += static_cast<uchar>(8);
+  metadata += static_cast<uchar>(0);
+  metadata += text("MM title");
+  metadata += BString(7868 - metadata.size(), '\0');
+  BString offsets;
+  for (uint32 i = 0; i < 5; ++i)
+  {
+    offsets += le32(1000 + 4 * i);
+  }
+  BString footer = text("Brava Software Inc.             ") + text("3.00") +
+    BString(12, ' ');
+  return header + sections + metadata + offsets + footer;
+}
+
+static BString ape()
+{
+  // a footer without any items
+  return text("APETAGEX") + le32(2000) + le32(32) + le32(0) + le32(0) +
+    BString(8, '\0');
+}
+
+static void writeFile(const BString& data)
+{
+  ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+  file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// Compares what Probe() and Link() find out about a file
+static size_t compare(const char* name, const ID3_TagInfo& info, bool ape)
+{
+  size_t errors = 0;
+  ID3_Tag tag;
+  tag.Link(name, ID3TT_ALL);
+  for (size_t i = 0; i < sizeof(TAG_TYPES) / sizeof(TAG_TYPES[0]); ++i)
+  {
+    bool found = (info.tags & TAG_TYPES[i]) != 0;
+    if (found != tag.HasTagType(static_cast<ID3_TagType>(TAG_TYPES[i])))
+    {
+      cout << name << ": tag type " << TAG_TYPES[i] << " differs" << endl;
+      ++errors;
+    }
+  }
+  if (info.audiooffset != tag.GetPrependedBytes())
+  {
+    cout << name << ": audio offset " << info.audiooffset << " != " <<
+      tag.GetPrependedBytes() << endl;
+    ++errors;
+  }
+  // Link() doesn't know about APE tags
+  if (!ape && info.audiooffset + info.audiosize != tag.GetFileSize() - tag.GetAppendedBytes())
+  {
+    cout << name << ": audio end " << info.audiooffset + info.audiosize <<
+      " != " << tag.GetFileSize() - tag.GetAppendedBytes() << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+static size_t check(const BString& v2, size_t padding, const BString& trailer,
+                    bool ape)
+{
+  writeFile(v2 + audio() + trailer);
+
+  size_t errors = 0;
+  ID3_TagInfo info;
+  if (!ID3_Tag::Probe(TEMPFILE, info))
+  {
+    cout << "couldn't probe " << TEMPFILE << endl;
+    return 1;
+  }
+  if (info.v2size != v2.size() || info.v2padding != padding ||
+      info.audiooffset != v2.size() || info.audiosize != audio().size() ||
+      info.ape != ape)
+  {
+    cout << "v2 size " << info.v2size << ", padding " << info.v2padding <<
+      ", audio " << info.audiooffset << "+" << info.audiosize << ", ape " <<
+      info.ape << ": expected " << v2.size() << ", " << padding << ", " <<
+      v2.size() << "+" << audio().size() << ", " << ape << endl;
+    ++errors;
+  }
+  errors += compare(TEMPFILE, info, ape);
+
+  // Probe() leaves the tags alone, so Link() still finds what's in them
+  ID3_Tag tag(TEMPFILE);
+  if (((info.tags & ID3TT_MUSICMATCH) && tag.Find(ID3FID_TITLE) == NULL) ||
+      ((info.tags & ID3TT_LYRICS) && tag.Find(ID3FID_UNSYNCEDLYRICS) == NULL))
+  {
+    cout << "tags weren't parsed" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+static size_t checkV2(const BString& v2, size_t padding)
+{
+  size_t errors = 0;
+  errors += check(v2, padding, BString(), false);
+  errors += check(v2, padding, v1Tag(), false);
+  errors += check(v2, padding, lyrics3v1() + v1Tag(), false);
+  errors += check(v2, padding, lyrics3v2() + v1Tag(), false);
+  errors += check(v2, padding, musicMatch(), false);
+  errors += check(v2, padding, musicMatch() + v1Tag(), false);
+  errors += check(v2, padding, musicMatch() + lyrics3v2() + v1Tag(), false);
+  errors += check(v2, padding, ape(), true);
+  errors += check(v2, padding, ape() + v1Tag(), true);
+  return errors;
+}
+
+int main(int argc, char* argv[])
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    ID3_TagInfo info;
+    ID3_Tag::Probe(argv[i], info);
+    errors += compare(argv[i], info, info.ape);
+  }
+  if (argc < 2)
+  {
+    errors += checkV2(BString(), 0);
+    BString padded = v2Tag(ID3V2_3_0, false, true);
+    errors += checkV2(padded, padded.size() - v2Tag(ID3V2_3_0, false, false).size());
+    errors += checkV2(v2Tag(ID3V2_4_0, true, false), 0);
+    const size_t PADDINGS[] = { 100, 4000, 5000, 1024 * 1024 };
+    for (size_t i = 0; i < sizeof(PADDINGS) / sizeof(PADDINGS[0]); ++i)
+    {
+      errors += checkV2(v2PaddedTag(ID3V2_3_0, PADDINGS[i]), PADDINGS[i]);
+      errors += checkPaddingReads(ID3V2_3_0, PADDINGS[i]);
+      errors += checkPaddingReads(ID3V2_2_0, PADDINGS[i]);
+    }
+  }
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "probing matches linking" << endl;
+  return 0;
+}
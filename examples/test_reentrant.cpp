@@ -0,0 +1,326 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Reads one parsed tag from many threads at once through its const methods.
+// Every thread must see the same tag as one parsed on its own; built with
+// -fsanitize=thread, the test also shows that none of the reads races with
+// another.  The tag is read as written, and with its text frames in UTF-16
+// and an ID3v1 tag holding the album, which parsing makes a frame of.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  include <pthread.h>
+#  define ID3_TEST_WITH_THREADS
+#endif
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-reentrant.mp3";
+static const size_t NUM_COMMENTS = 6;
+static const size_t NUM_THREADS = 8;
+static const size_t NUM_ROUNDS = 200;
+
+static String description(size_t i)
+{
+  char desc[32];
+  sprintf(desc, "comment %lu", (unsigned long) i);
+  return desc;
+}
+
+static void toUnicode(ID3_Frame* frame)
+{
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+}
+
+static void writeFile(bool unicode)
+{
+  {
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    BString audio(10000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  ID3_Tag tag(TEMPFILE);
+  ID3_AddTitle(&tag, "A shared title");
+  ID3_AddArtist(&tag, "Some artist");
+  ID3_AddAlbum(&tag, "Some album");
+  if (unicode)
+  {
+    // the album is only in the ID3v1 tag
+    tag.Update(ID3TT_ID3V1);
+    ID3_RemoveAlbums(&tag);
+    toUnicode(tag.Find(ID3FID_TITLE));
+    toUnicode(tag.Find(ID3FID_LEADARTIST));
+  }
+  for (size_t i = 0; i < NUM_COMMENTS; ++i)
+  {
+    ID3_AddComment(&tag, (String("the text of ") + description(i)).c_str(),
+                   description(i).c_str());
+  }
+  ID3_Frame* counter = new ID3_Frame(ID3FID_PLAYCOUNTER);
+  counter->GetField(ID3FN_COUNTER)->Set(7);
+  tag.AttachFrame(counter);
+  ID3_Frame* picture = new ID3_Frame(ID3FID_PICTURE);
+  BString data(3000, 0xaa);
+  picture->GetField(ID3FN_MIMETYPE)->Set("image/jpeg");
+  picture->GetField(ID3FN_DATA)->Set(data.data(), data.size());
+  tag.AttachFrame(picture);
+  tag.Update(ID3TT_ID3V2);
+}
+
+static BString render(const ID3_Tag& tag, ID3_TagType type)
+{
+  BString bytes(tag.Size() + ID3_V1_LEN, 0);
+  bytes.resize(tag.Render(&bytes[0], type));
+  return bytes;
+}
+
+// What each reader checks the tag against, taken from the same file parsed
+// into a tag of its own, so that the shared one isn't touched before the
+// readers start
+struct Shared
+{
+  const ID3_Tag* tag;
+  bool           changed;
+  size_t         size;
+  size_t         frames;
+  BString        v2;
+  BString        v1;
+};
+
+static bool sameString(char* text, const char* expected)
+{
+  bool same = text != NULL && String(text) == expected;
+  ID3_FreeString(text);
+  return same;
+}
+
+// Reads the whole tag, and returns how many things weren't as expected
+static size_t readTag(const Shared& shared)
+{
+  const ID3_Tag& tag = *shared.tag;
+  size_t errors = 0;
+
+  // the text is given in ISO-8859-1, whatever it is held in
+  if (!sameString(ID3_GetTitle(&tag), "A shared title") ||
+      !sameString(ID3_GetArtist(&tag), "Some artist") ||
+      !sameString(ID3_GetAlbum(&tag), "Some album"))
+  {
+    ++errors;
+  }
+  if (tag.FindFirst(ID3FID_PLAYCOUNTER, ID3FN_COUNTER, 7) == NULL ||
+      tag.FindFirst(ID3FID_PLAYCOUNTER, ID3FN_COUNTER, 8) != NULL)
+  {
+    ++errors;
+  }
+
+  // each comment in turn, then no more
+  ID3_Tag::Cursor cursor;
+  size_t found = 0;
+  while (ID3_Frame* comment = tag.Find(cursor, ID3FID_COMMENT))
+  {
+    const ID3_Field* desc = comment->GetField(ID3FN_DESCRIPTION);
+    if (desc == NULL || description(found) != desc->GetRawText())
+    {
+      ++errors;
+    }
+    ++found;
+  }
+  const String last = description(NUM_COMMENTS - 1);
+  cursor.Reset();
+  if (found != NUM_COMMENTS ||
+      tag.Find(cursor, ID3FID_COMMENT, ID3FN_DESCRIPTION, last.c_str()) == NULL ||
+      tag.Find(cursor, ID3FID_COMMENT, ID3FN_DESCRIPTION, last.c_str()) != NULL)
+  {
+    ++errors;
+  }
+
+  ID3_Frame* comments[NUM_COMMENTS];
+  if (tag.FindAll(ID3FID_COMMENT, comments, 2) != NUM_COMMENTS ||
+      tag.FindAll(ID3FID_COMMENT, comments, NUM_COMMENTS) != NUM_COMMENTS ||
+      comments[2] != tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION,
+                                   description(2).c_str()))
+  {
+    ++errors;
+  }
+
+  ID3_Frame* picture = tag.FindFirst(ID3FID_PICTURE);
+  if (picture == NULL || picture->GetField(ID3FN_DATA)->Size() != 3000 ||
+      picture->GetField(ID3FN_DATA)->GetRawBinary()[2999] != 0xaa)
+  {
+    ++errors;
+  }
+
+  size_t frames = 0;
+  ID3_Tag::ConstIterator* iter = tag.CreateIterator();
+  while (const ID3_Frame* frame = iter->GetNext())
+  {
+    ID3_Frame::ConstIterator* fields = frame->CreateIterator();
+    while (const ID3_Field* field = fields->GetNext())
+    {
+      field->Size();
+    }
+    delete fields;
+    ++frames;
+  }
+  delete iter;
+  if (frames != tag.NumFrames() || frames != shared.frames)
+  {
+    ++errors;
+  }
+
+  if (tag.HasChanged() != shared.changed || !tag.HasV2Tag() || tag.Size() != shared.size ||
+      render(tag, ID3TT_ID3V2) != shared.v2 || render(tag, ID3TT_ID3V1) != shared.v1)
+  {
+    ++errors;
+  }
+  return errors;
+}
+
+struct Reader
+{
+  const Shared* shared;
+  size_t        errors;
+};
+
+static void* readRounds(void* arg)
+{
+  Reader* reader = static_cast<Reader*>(arg);
+  for (size_t i = 0; i < NUM_ROUNDS; ++i)
+  {
+    reader->errors += readTag(*reader->shared);
+  }
+  return NULL;
+}
+
+// Reads the tag from all the threads at once
+static size_t check(const char* name, const ID3_Tag& tag, flags_t types)
+{
+  Shared shared;
+  shared.tag = &tag;
+  {
+    ID3_Tag expected(TEMPFILE, types);
+    shared.changed = expected.HasChanged();
+    shared.size = expected.Size();
+    shared.frames = expected.NumFrames();
+    shared.v2 = render(expected, ID3TT_ID3V2);
+    shared.v1 = render(expected, ID3TT_ID3V1);
+  }
+  if (shared.frames != NUM_COMMENTS + 5)
+  {
+    cout << name << ": " << shared.frames << " frames parsed" << endl;
+    return 1;
+  }
+
+  vector<Reader> readers(NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    readers[i].shared = &shared;
+    readers[i].errors = 0;
+  }
+#if defined ID3_TEST_WITH_THREADS
+  vector<pthread_t> threads(NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_create(&threads[i], NULL, readRounds, &readers[i]);
+  }
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+#else
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    readRounds(&readers[i]);
+  }
+#endif
+
+  size_t errors = 0;
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    errors += readers[i].errors;
+  }
+  if (errors > 0)
+  {
+    cout << name << ": " << errors << " wrong reads" << endl;
+  }
+  return errors;
+}
+
+static size_t checkFile(const String& how, flags_t types)
+{
+  size_t errors = 0;
+  {
+    ID3_Tag tag;
+    tag.Link(TEMPFILE, types);
+    errors += check((how + "parsed").c_str(), tag, types);
+  }
+  {
+    // a lazily parsed tag is read through once before it is shared
+    ID3_Tag tag;
+    tag.SetLazyParsing(true);
+    tag.Link(TEMPFILE, types);
+    ID3_Tag::ConstIterator* iter = static_cast<const ID3_Tag&>(tag).CreateIterator();
+    while (const ID3_Frame* frame = iter->GetNext())
+    {
+      frame->NumFields();
+    }
+    delete iter;
+    errors += check((how + "lazy").c_str(), tag, types);
+  }
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  writeFile(false);
+  errors += checkFile("", ID3TT_ID3V2);
+  writeFile(true);
+  errors += checkFile("unicode ", ID3TT_ALL);
+  remove(TEMPFILE);
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "a parsed tag can be read from many threads" << endl;
+  return 0;
+}
@@ -0,0 +1,164 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#include "test_files.h"
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-rewrite.mp3";
+
+static size_t tagSize(size_t commentSize)
+{
+  ID3_Tag tag;
+  tag.SetPadding(false);
+  ID3_AddTitle(&tag, "The title");
+  if (commentSize > 0)
+  {
+    ID3_AddComment(&tag, String(commentSize, 'x').c_str(), "", "eng");
+  }
+  return tag.Size();
+}
+
+// Grows the tag of a file by more than fits in its padding, so Update()
+// has to rewrite the file or insert blocks at its start, and checks that the
+// audio data came through
+static size_t check(size_t audioSize, size_t commentSize, bool padding = false)
+{
+  const BString data = audio(audioSize);
+  {
+    ID3_Tag tag;
+    tag.SetPadding(false);
+    ID3_AddTitle(&tag, "The title");
+    BString rendered;
+    io::BStringWriter writer(rendered);
+    tag.Render(writer);
+    writeFile(TEMPFILE, rendered + data);
+  }
+
+  ID3_Tag tag(TEMPFILE);
+  tag.SetPadding(padding);
+  ID3_AddComment(&tag, String(commentSize, 'x').c_str(), "", "eng");
+  const size_t oldSize = tag.GetPrependedBytes();
+  if ((tag.Update(ID3TT_ID3V2) & ID3TT_ID3V2) == 0)
+  {
+    cout << "couldn't update" << endl;
+    return 1;
+  }
+
+  size_t errors = 0;
+  const BString result = readFile(TEMPFILE);
+  const size_t newSize = tag.GetPrependedBytes();
+  if (newSize <= oldSize || result.size() != newSize + data.size() ||
+      result.compare(newSize, data.size(), data) != 0)
+  {
+    cout << "audio of " << audioSize << " bytes wasn't kept when the tag grew from " <<
+      oldSize << " to " << newSize << " bytes" << endl;
+    ++errors;
+  }
+  ID3_Tag reread(TEMPFILE);
+  if (reread.NumFrames() != 2 || reread.GetPrependedBytes() != newSize)
+  {
+    cout << "rewritten tag has " << reread.NumFrames() << " frames in " <<
+      reread.GetPrependedBytes() << " bytes" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+// Strips a tag of the given size, which can be cut off the start of the file
+// where the file system allows it if it takes up whole blocks
+static size_t checkStrip(size_t audioSize, size_t commentSize)
+{
+  const BString data = audio(audioSize);
+  {
+    ID3_Tag tag;
+    tag.SetPadding(false);
+    ID3_AddTitle(&tag, "The title");
+    ID3_AddComment(&tag, String(commentSize, 'x').c_str(), "", "eng");
+    BString rendered;
+    io::BStringWriter writer(rendered);
+    tag.Render(writer);
+    writeFile(TEMPFILE, rendered + data);
+  }
+
+  size_t errors = 0;
+  ID3_Tag tag(TEMPFILE);
+  if ((tag.Strip(ID3TT_ID3V2) & ID3TT_ID3V2) == 0 || readFile(TEMPFILE) != data)
+  {
+    cout << "audio of " << audioSize << " bytes wasn't kept when stripping a " <<
+      tagSize(commentSize) << " byte tag" << endl;
+    ++errors;
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = 0;
+  errors += check(0, 100);
+  errors += check(1000, 100);
+  errors += check(3 * 1024 * 1024 + 17, 100);
+  errors += check(3 * 1024 * 1024 + 17, 5000);
+
+  // a tag that grows by whole blocks, so blocks can be shared where the
+  // file system supports it
+  size_t commentSize = 4096;
+  commentSize += 4096 - (tagSize(commentSize) - tagSize(0)) % 4096;
+  errors += check(3 * 1024 * 1024 + 17, commentSize);
+
+  // padded tags are padded out to whole blocks instead
+  errors += check(3 * 1024 * 1024 + 17, 100, true);
+  errors += check(3 * 1024 * 1024 + 17, 10000, true);
+  errors += check(1000, 5000, true);
+
+  errors += checkStrip(3 * 1024 * 1024 + 17, 100);
+  commentSize = 8192;
+  commentSize += 4096 - tagSize(commentSize) % 4096;
+  errors += checkStrip(3 * 1024 * 1024 + 17, commentSize);
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "rewriting the file keeps the audio" << endl;
+  return 0;
+}
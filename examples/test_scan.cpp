@@ -0,0 +1,286 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <id3.h>
+#include <id3/scan.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const char* const TOP = "test-scan";
+static const size_t NUM_DIRS = 12;
+static const size_t FILES_PER_DIR = 15;
+
+// The files, and how often each was scanned
+typedef map<String, size_t> Files;
+
+static String dirName(size_t i)
+{
+  // the directories are nested three deep, and some are left empty
+  char name[64];
+  sprintf(name, "%s/d%lu", TOP, (unsigned long) (i % 3));
+  String dir = name;
+  if (i >= 3)
+  {
+    sprintf(name, "/e%lu", (unsigned long) i);
+    dir += name;
+  }
+  return dir;
+}
+
+static void writeFile(const String& name, const char* title)
+{
+  {
+    ofstream file(name.c_str(), ios::out | ios::binary | ios::trunc);
+    BString audio(2000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  if (title != NULL)
+  {
+    ID3_Tag tag(name.c_str());
+    ID3_AddTitle(&tag, title);
+    tag.Update(ID3TT_ID3V2);
+  }
+}
+
+static void makeTree(Files& files)
+{
+  mkdir(TOP, 0755);
+  for (size_t i = 0; i < NUM_DIRS; ++i)
+  {
+    mkdir(dirName(i).c_str(), 0755);
+    if (i % 4 == 3)
+    {
+      continue;
+    }
+    for (size_t j = 0; j < FILES_PER_DIR; ++j)
+    {
+      char name[64];
+      sprintf(name, "/%lu.mp3", (unsigned long) j);
+      const String file = dirName(i) + name;
+      // leave some without a tag
+      writeFile(file, j % 5 == 0 ? NULL : file.c_str());
+      files[file] = 0;
+    }
+  }
+  // a title which has to be escaped
+  const String odd = String(TOP) + "/odd \"name\".mp3";
+  writeFile(odd, "Caf\xe9 \"du\\nord\"\n");
+  files[odd] = 0;
+  // names in utf-8, and in latin-1, which isn't valid utf-8
+  const String utf8 = String(TOP) + "/\xc3\xa9t\xc3\xa9.mp3";
+  writeFile(utf8, NULL);
+  files[utf8] = 0;
+  const String latin1 = String(TOP) + "/caf\xe9.mp3";
+  writeFile(latin1, NULL);
+  files[latin1] = 0;
+  // a link to a file is followed, but one to a directory isn't
+  const String link = String(TOP) + "/link.mp3";
+  symlink("odd \"name\".mp3", link.c_str());
+  files[link] = 0;
+  symlink("d0", (String(TOP) + "/loop").c_str());
+}
+
+static void removeTree(const Files& files)
+{
+  for (Files::const_iterator f = files.begin(); f != files.end(); ++f)
+  {
+    remove(f->first.c_str());
+  }
+  remove((String(TOP) + "/loop").c_str());
+  for (size_t i = NUM_DIRS; i > 0; --i)
+  {
+    rmdir(dirName(i - 1).c_str());
+  }
+  rmdir(TOP);
+}
+
+// Each file is counted in a slot of its own, so the workers needn't lock
+static void count(const char* fileName, const ID3_Tag& tag, ID3_Err err, void* data)
+{
+  Files& files = *static_cast<Files*>(data);
+  Files::iterator f = files.find(fileName);
+  if (f == files.end())
+  {
+    cout << "scanned a stray file: " << fileName << endl;
+    return;
+  }
+  // the files with a tag are titled with their names
+  ID3_Frame* frame = tag.Find(ID3FID_TITLE);
+  const char* title = frame ? frame->GetField(ID3FN_TEXT)->GetRawText() : NULL;
+  if (err != ID3E_NoError ||
+      (title != NULL && strstr(fileName, "/d") != NULL && String(title) != fileName))
+  {
+    cout << fileName << ": error " << err << ", title " << (title ? title : "") << endl;
+    ++f->second;
+  }
+  ++f->second;
+}
+
+static void CCONV countC(const char* fileName, const ID3Tag* tag, ID3_Err err, void* data)
+{
+  count(fileName, *reinterpret_cast<const ID3_Tag*>(tag), err, data);
+}
+
+static size_t checkCounts(Files& files, size_t scanned, const char* how)
+{
+  size_t errors = 0;
+  if (scanned != files.size())
+  {
+    cout << how << ": " << scanned << " files scanned, expected " << files.size() << endl;
+    ++errors;
+  }
+  for (Files::iterator f = files.begin(); f != files.end(); ++f)
+  {
+    if (f->second != 1)
+    {
+      cout << how << ": " << f->first << " reported " << f->second << " times" << endl;
+      ++errors;
+    }
+    f->second = 0;
+  }
+  return errors;
+}
+
+static size_t checkJSON(const Files& files)
+{
+  ID3_Scanner scanner(3);
+  scanner.SetTagTypes(ID3TT_ID3V2);
+  ostringstream out;
+  const size_t scanned = scanner.ScanToJSON(TOP, out);
+
+  vector<String> lines;
+  istringstream in(out.str());
+  for (String line; getline(in, line); )
+  {
+    lines.push_back(line);
+  }
+  size_t errors = 0;
+  if (scanned != files.size() || lines.size() != files.size())
+  {
+    cout << "json: " << lines.size() << " lines for " << scanned << " files" << endl;
+    ++errors;
+  }
+  sort(lines.begin(), lines.end());
+  const char* const expected[] =
+  {
+    "{\"file\":\"test-scan/d0/0.mp3\",\"error\":0,\"size\":2000,\"v1\":false,"
+    "\"v2\":false,\"frames\":[]}",
+    "{\"file\":\"test-scan/link.mp3\",\"error\":0,\"size\":6096,\"v1\":false,"
+    "\"v2\":true,\"frames\":[{\"id\":\"TIT2\",\"text\":"
+    "\"Caf\\u00e9 \\\"du\\\\nord\\\"\\n\"}]}",
+    "{\"file\":\"test-scan/odd \\\"name\\\".mp3\",\"error\":0,\"size\":6096,"
+    "\"v1\":false,\"v2\":true,\"frames\":[{\"id\":\"TIT2\",\"text\":"
+    "\"Caf\\u00e9 \\\"du\\\\nord\\\"\\n\"}]}",
+    "{\"file\":\"test-scan/\xc3\xa9t\xc3\xa9.mp3\",\"error\":0,\"size\":2000,"
+    "\"v1\":false,\"v2\":false,\"frames\":[]}",
+    "{\"file\":\"test-scan/caf\\u00e9.mp3\",\"error\":0,\"size\":2000,"
+    "\"v1\":false,\"v2\":false,\"frames\":[]}",
+  };
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i)
+  {
+    if (!binary_search(lines.begin(), lines.end(), String(expected[i])))
+    {
+      cout << "json: no line " << expected[i] << endl;
+      ++errors;
+    }
+  }
+  if (errors > 0)
+  {
+    cout << out.str();
+  }
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  Files files;
+  removeTree(files);
+  makeTree(files);
+
+  size_t errors = 0;
+  {
+    ID3_Scanner scanner(4);
+    errors += checkCounts(files, scanner.Scan(TOP, count, &files), "scan");
+    // the workers and their tags are used again
+    scanner.SetLazyParsing(true);
+    errors += checkCounts(files, scanner.Scan(TOP, count, &files), "lazy scan");
+  }
+  {
+    ID3_Scanner scanner(1);
+    errors += checkCounts(files, scanner.Scan(TOP, count, &files), "one worker");
+  }
+  {
+    ID3Scanner* scanner = ID3Scanner_New(0);
+    ID3Scanner_SetTagTypes(scanner, ID3TT_ID3V2);
+    errors += checkCounts(files, ID3Scanner_Scan(scanner, TOP, countC, &files), "C scan");
+    ID3Scanner_Delete(scanner);
+  }
+  errors += checkJSON(files);
+
+  // a single file, or one that is missing
+  {
+    ID3_Scanner scanner;
+    Files one;
+    one["test-scan/d1/1.mp3"] = 0;
+    errors += checkCounts(one, scanner.Scan("test-scan/d1/1.mp3", count, &one), "file");
+    ostringstream out;
+    if (scanner.ScanToJSON("test-scan/missing.mp3", out) != 1 ||
+        out.str().find("\"error\":5,\"size\":0,\"v1\":false,\"v2\":false,\"frames\":[]") == String::npos)
+    {
+      cout << "missing: " << out.str();
+      ++errors;
+    }
+  }
+
+  removeTree(files);
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "scans report every file once" << endl;
+  return 0;
+}
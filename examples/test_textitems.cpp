@@ -0,0 +1,230 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Builds a long text list, reads its items by number and with an iterator,
+// changes its encoding, and writes and reads it back, checking that each
+// item stays as it was.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-textitems.mp3";
+static const size_t NUM_ITEMS = 300;
+
+static String item(size_t i)
+{
+  char text[32];
+  sprintf(text, "Performer %lu", (unsigned long) i);
+  return text;
+}
+
+// The item as big endian UTF-16, as unicode text is held
+static String unicodeItem(size_t i)
+{
+  String text = item(i), unicode;
+  for (size_t j = 0; j < text.size(); ++j)
+  {
+    unicode += '\0';
+    unicode += text[j];
+  }
+  return unicode;
+}
+
+static bool sameUnicode(const unicode_t* text, const String& unicode)
+{
+  return text != NULL &&
+    ::memcmp(text, unicode.data(), unicode.size()) == 0 &&
+    text[unicode.size() / 2] == 0;
+}
+
+// Each item of the field is one it should be, by number and by iterator
+static size_t checkItems(const ID3_Field* fld, const char* how, bool unicode)
+{
+  size_t errors = 0;
+  if (fld->GetNumTextItems() != NUM_ITEMS)
+  {
+    cout << how << ": there are " << fld->GetNumTextItems() << " items" << endl;
+    return 1;
+  }
+  ID3_Field::ItemIterator* iter = fld->CreateItemIterator();
+  for (size_t i = 0; i < NUM_ITEMS; ++i)
+  {
+    bool same = false;
+    if (unicode)
+    {
+      const unicode_t* raw = fld->GetRawUnicodeTextItem(i);
+      same = sameUnicode(raw, unicodeItem(i)) && iter->GetNextUnicode() == raw;
+    }
+    else
+    {
+      const char* raw = fld->GetRawTextItem(i);
+      same = raw != NULL && item(i) == raw && iter->GetNext() == raw;
+    }
+    if (!same)
+    {
+      cout << how << ": item " << i << " is wrong" << endl;
+      ++errors;
+      break;
+    }
+  }
+  if ((unicode ? (const void*) iter->GetNextUnicode()
+               : (const void*) iter->GetNext()) != NULL)
+  {
+    cout << how << ": the iterator went past the last item" << endl;
+    ++errors;
+  }
+  delete iter;
+  return errors;
+}
+
+// Items added one by one, and the same items after a change of encoding
+static size_t checkList(ID3_Frame& frame)
+{
+  ID3_Field* fld = frame.GetField(ID3FN_TEXT);
+  for (size_t i = 0; i < NUM_ITEMS; ++i)
+  {
+    fld->Add(item(i).c_str());
+  }
+  size_t errors = checkItems(fld, "added", false);
+
+  frame.GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  fld->SetEncoding(ID3TE_UTF16);
+  errors += checkItems(fld, "utf-16", true);
+  fld->SetEncoding(ID3TE_ISO8859_1);
+  frame.GetField(ID3FN_TEXTENC)->Set(ID3TE_ISO8859_1);
+  errors += checkItems(fld, "iso-8859-1", false);
+
+  ID3_Frame copy(frame);
+  errors += checkItems(copy.GetField(ID3FN_TEXT), "copy", false);
+  return errors;
+}
+
+static BString render(const ID3_Tag& tag)
+{
+  BString bytes;
+  io::BStringWriter writer(bytes);
+  tag.Render(writer, ID3TT_ID3V2);
+  return bytes;
+}
+
+// A list read from a file has its items, however the tag holds its text,
+// and renders as it was
+static size_t checkFile()
+{
+  size_t errors = 0;
+  {
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    BString audio(4000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  BString expected;
+  {
+    ID3_Tag tag(TEMPFILE);
+    ID3_Frame* frame = new ID3_Frame(ID3FID_LEADARTIST);
+    errors += checkList(*frame);
+    tag.AttachFrame(frame);
+
+    // a text list may end with a '\0', which doesn't start another item
+    frame = new ID3_Frame(ID3FID_CONTENTTYPE);
+    frame->GetField(ID3FN_TEXT)->Add("Rock");
+    frame->GetField(ID3FN_TEXT)->Add("Pop");
+    frame->GetField(ID3FN_TEXT)->Add("");
+    tag.AttachFrame(frame);
+
+    frame = new ID3_Frame(ID3FID_COMPOSER);
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+    {
+      frame->GetField(ID3FN_TEXT)->Add(item(i).c_str());
+    }
+    frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+    frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+    tag.AttachFrame(frame);
+    tag.Update(ID3TT_ID3V2);
+    expected = render(tag);
+  }
+
+  for (size_t utf8 = 0; utf8 < 2; ++utf8)
+  {
+    ID3_Tag tag;
+    tag.SetUtf8Text(utf8 != 0);
+    tag.Link(TEMPFILE, ID3TT_ID3V2);
+    const ID3_Frame* artist = tag.Find(ID3FID_LEADARTIST);
+    const ID3_Frame* genre = tag.Find(ID3FID_CONTENTTYPE);
+    const ID3_Frame* composer = tag.Find(ID3FID_COMPOSER);
+    if (artist == NULL || genre == NULL || composer == NULL)
+    {
+      cout << "file: the frames weren't read back" << endl;
+      ++errors;
+      continue;
+    }
+    errors += checkItems(artist->GetField(ID3FN_TEXT), "file", false);
+    errors += checkItems(composer->GetField(ID3FN_TEXT), "file, utf-16", true);
+    if (utf8 != 0)
+    {
+      errors += checkItems(composer->GetField(ID3FN_TEXT), "file, utf-8", false);
+    }
+    const ID3_Field* fld = genre->GetField(ID3FN_TEXT);
+    if (fld->GetNumTextItems() != 2 || String(fld->GetRawTextItem(1)) != "Pop")
+    {
+      cout << "file: the genres are wrong" << endl;
+      ++errors;
+    }
+    if (render(tag) != expected)
+    {
+      cout << "file: the tag renders differently" << endl;
+      ++errors;
+    }
+  }
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = checkFile();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "the items of text lists are kept" << endl;
+  return 0;
+}
@@ -0,0 +1,323 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Converts every character there is between each pair of encodings, and
+// checks the text against what iconv makes of it, and that it converts back.
+// Then gives convert() text that is malformed, or that can't be converted,
+// from several threads at once, to see that it comes back.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+#include <id3/globals.h>
+#include <id3/utils.h>
+#if defined HAVE_ICONV_H && defined ID3_ICONV_FORMAT_UTF16BE && \
+    defined ID3_ICONV_FORMAT_UTF8 && defined ID3_ICONV_FORMAT_ASCII
+#  include <iconv.h>
+#  define ID3_TEST_WITH_ICONV
+#endif
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  include <pthread.h>
+#  define ID3_TEST_WITH_THREADS
+#endif
+
+using namespace dami;
+using namespace std;
+
+static const uint32 MAX_CODE_POINT = 0x10FFFF;
+static const uint32 CHUNK_SIZE = 0x1000;
+static const size_t NUM_THREADS = 4;
+static const size_t NUM_ROUNDS = 500;
+
+static const char* name(ID3_TextEnc enc)
+{
+  switch (enc)
+  {
+    case ID3TE_ISO8859_1: return "ISO-8859-1";
+    case ID3TE_UTF16:     return "UTF-16";
+    case ID3TE_UTF16BE:   return "UTF-16BE";
+    case ID3TE_UTF8:      return "UTF-8";
+    default:              return "?";
+  }
+}
+
+// The characters from first up to last, leaving out the surrogates, as
+// UTF-16BE and as UTF-8, which are worked out here by hand
+static void encode(uint32 first, uint32 last, String& utf16, String& utf8)
+{
+  utf16.clear();
+  utf8.clear();
+  for (uint32 ch = first; ch <= last; ++ch)
+  {
+    if (0xD800 <= ch && ch <= 0xDFFF)
+    {
+      continue;
+    }
+    if (ch < 0x10000)
+    {
+      utf16 += static_cast<char>(ch >> 8);
+      utf16 += static_cast<char>(ch & 0xFF);
+    }
+    else
+    {
+      uint32 high = 0xD800 + ((ch - 0x10000) >> 10);
+      uint32 low = 0xDC00 + ((ch - 0x10000) & 0x3FF);
+      utf16 += static_cast<char>(high >> 8);
+      utf16 += static_cast<char>(high & 0xFF);
+      utf16 += static_cast<char>(low >> 8);
+      utf16 += static_cast<char>(low & 0xFF);
+    }
+
+    if (ch < 0x80)
+    {
+      utf8 += static_cast<char>(ch);
+    }
+    else if (ch < 0x800)
+    {
+      utf8 += static_cast<char>(0xC0 | (ch >> 6));
+      utf8 += static_cast<char>(0x80 | (ch & 0x3F));
+    }
+    else if (ch < 0x10000)
+    {
+      utf8 += static_cast<char>(0xE0 | (ch >> 12));
+      utf8 += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+      utf8 += static_cast<char>(0x80 | (ch & 0x3F));
+    }
+    else
+    {
+      utf8 += static_cast<char>(0xF0 | (ch >> 18));
+      utf8 += static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+      utf8 += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+      utf8 += static_cast<char>(0x80 | (ch & 0x3F));
+    }
+  }
+}
+
+#if defined ID3_TEST_WITH_ICONV
+static const char* iconvFormat(ID3_TextEnc enc)
+{
+  switch (enc)
+  {
+    case ID3TE_ISO8859_1: return ID3_ICONV_FORMAT_ASCII;
+    case ID3TE_UTF8:      return ID3_ICONV_FORMAT_UTF8;
+    default:              return ID3_ICONV_FORMAT_UTF16BE;
+  }
+}
+
+// What iconv itself makes of text, or "" if it can't convert it all
+static String iconvConvert(const String& text, ID3_TextEnc sourceEnc,
+                           ID3_TextEnc targetEnc)
+{
+  iconv_t cd = iconv_open(iconvFormat(targetEnc), iconvFormat(sourceEnc));
+  if (cd == (iconv_t) -1)
+  {
+    return "";
+  }
+  vector<char> in(text.begin(), text.end());
+  vector<char> out(text.size() * 2 + 4);
+  char* source = in.empty() ? NULL : &in[0];
+  size_t sourceSize = in.size();
+  char* target = &out[0];
+  size_t targetSize = out.size();
+#if defined(ID3LIB_ICONV_OLDSTYLE)
+  size_t nconv = iconv(cd, const_cast<const char**>(&source), &sourceSize,
+                       &target, &targetSize);
+#else
+  size_t nconv = iconv(cd, &source, &sourceSize, &target, &targetSize);
+#endif
+  iconv_close(cd);
+  if (nconv == (size_t) -1 || sourceSize > 0)
+  {
+    return "";
+  }
+  return String(&out[0], out.size() - targetSize);
+}
+#endif
+
+// Converts text from one encoding to the other, checks it against what it
+// should become, and that it converts back
+static size_t checkPair(const String& source, ID3_TextEnc sourceEnc,
+                        const String& expected, ID3_TextEnc targetEnc,
+                        uint32 first)
+{
+  size_t errors = 0;
+  String target = convert(source, sourceEnc, targetEnc);
+  if (target != expected)
+  {
+    cout << "from U+" << hex << first << dec << ": " << name(sourceEnc) <<
+      " to " << name(targetEnc) << " is wrong" << endl;
+    ++errors;
+  }
+  else if (convert(target, targetEnc, sourceEnc) != source)
+  {
+    cout << "from U+" << hex << first << dec << ": " << name(targetEnc) <<
+      " back to " << name(sourceEnc) << " is wrong" << endl;
+    ++errors;
+  }
+#if defined ID3_TEST_WITH_ICONV
+  if (iconvConvert(source, sourceEnc, targetEnc) != target)
+  {
+    cout << "from U+" << hex << first << dec << ": " << name(sourceEnc) <<
+      " to " << name(targetEnc) << " isn't what iconv makes of it" << endl;
+    ++errors;
+  }
+#endif
+  return errors;
+}
+
+// Every character, a chunk at a time, between each pair of encodings
+static size_t checkAll()
+{
+  size_t errors = 0;
+  for (uint32 first = 0; first <= MAX_CODE_POINT; first += CHUNK_SIZE)
+  {
+    String utf16, utf8;
+    encode(first, first + CHUNK_SIZE - 1, utf16, utf8);
+    errors += checkPair(utf16, ID3TE_UTF16BE, utf8, ID3TE_UTF8, first);
+    errors += checkPair(utf16, ID3TE_UTF16, utf8, ID3TE_UTF8, first);
+    if (convert(utf16, ID3TE_UTF16, ID3TE_UTF16BE) != utf16 ||
+        convert(utf16, ID3TE_UTF16BE, ID3TE_UTF16) != utf16)
+    {
+      // both are held in big endian order, without a byte order mark
+      cout << "from U+" << hex << first << dec <<
+        ": UTF-16 and UTF-16BE text differ" << endl;
+      ++errors;
+    }
+  }
+
+  String latin1;
+  for (uint32 ch = 0; ch <= 0xFF; ++ch)
+  {
+    latin1 += static_cast<char>(ch);
+  }
+  String utf16, utf8;
+  encode(0, 0xFF, utf16, utf8);
+  errors += checkPair(latin1, ID3TE_ISO8859_1, utf16, ID3TE_UTF16BE, 0);
+  errors += checkPair(latin1, ID3TE_ISO8859_1, utf16, ID3TE_UTF16, 0);
+  errors += checkPair(latin1, ID3TE_ISO8859_1, utf8, ID3TE_UTF8, 0);
+  errors += checkPair(utf8, ID3TE_UTF8, latin1, ID3TE_ISO8859_1, 0);
+  errors += checkPair(utf16, ID3TE_UTF16, latin1, ID3TE_ISO8859_1, 0);
+  return errors;
+}
+
+// Text that is malformed, or has characters ISO-8859-1 can't hold, comes back
+// in some shape, and with no more than it should have
+static size_t checkBadText()
+{
+  size_t errors = 0;
+  const String oddUtf16("\0a\0b\0", 5);
+  const String loneSurrogate("\0a\xd8\x01\0b", 6);
+  const String badUtf8("a\xc3(b\xed\xa0\x80\xf4\x90\x80\x80\xc0\xaf", 14);
+  const String cut("ab\xe2\x82", 4);
+  const String smiley("\0a\x26\x3a\0b", 6);
+
+  if (convert(oddUtf16, ID3TE_UTF16, ID3TE_UTF8).size() > 2 ||
+      convert(loneSurrogate, ID3TE_UTF16BE, ID3TE_UTF8).size() > 6 ||
+      convert(badUtf8, ID3TE_UTF8, ID3TE_UTF16).size() > 2 * badUtf8.size() ||
+      convert(cut, ID3TE_UTF8, ID3TE_ISO8859_1).size() > cut.size())
+  {
+    cout << "bad text: malformed text grew" << endl;
+    ++errors;
+  }
+  if (convert(smiley, ID3TE_UTF16, ID3TE_ISO8859_1).size() != 3 ||
+      convert("a\xe2\x98\xba" "b", ID3TE_UTF8, ID3TE_ISO8859_1).size() > 5)
+  {
+    cout << "bad text: text ISO-8859-1 can't hold came back wrong" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// Good and bad text from each thread, so that each uses iconv with its own
+// descriptors
+static void* convertRounds(void* arg)
+{
+  size_t& errors = *static_cast<size_t*>(arg);
+  const String bad("\0a\xdc\x00\0b", 6);
+  const String good("\0a\x26\x3a\0b", 6);
+  for (size_t i = 0; i < NUM_ROUNDS; ++i)
+  {
+    convert(bad, ID3TE_UTF16, ID3TE_UTF8);
+    convert(bad, ID3TE_UTF16BE, ID3TE_ISO8859_1);
+    if (convert(good, ID3TE_UTF16, ID3TE_UTF8) != "a\xe2\x98\xba" "b")
+    {
+      ++errors;
+    }
+  }
+  return NULL;
+}
+
+static size_t checkThreads()
+{
+  vector<size_t> errors(NUM_THREADS, 0);
+#if defined ID3_TEST_WITH_THREADS
+  vector<pthread_t> threads(NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_create(&threads[i], NULL, convertRounds, &errors[i]);
+  }
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+#else
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    convertRounds(&errors[i]);
+  }
+#endif
+  size_t total = 0;
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    total += errors[i];
+  }
+  if (total > 0)
+  {
+    cout << "threads: " << total << " conversions were wrong" << endl;
+  }
+  return total;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = checkAll();
+  errors += checkBadText();
+  errors += checkThreads();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "every character converts between every pair of encodings" << endl;
+  return 0;
+}
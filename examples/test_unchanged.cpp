@@ -0,0 +1,121 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#include "test_files.h"
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-unchanged.mp3";
+static const char* const TITLE = "The title, which has more than thirty characters";
+
+static void makeFile()
+{
+  writeFile(TEMPFILE, BString(20000, 0x55));
+  ID3_Tag tag(TEMPFILE);
+  ID3_AddTitle(&tag, TITLE);
+  ID3_AddArtist(&tag, "The artist");
+  tag.Update(ID3TT_ID3);
+}
+
+// Sets the title and artist, updates the file and checks what Update()
+// returned and whether the file changed
+static size_t check(bool skip, const char* title, flags_t expected,
+                    ID3_UpdateMode mode)
+{
+  makeFile();
+  const BString before = readFile(TEMPFILE);
+
+  ID3_Tag tag(TEMPFILE);
+  tag.SetSkipUnchangedWrites(skip);
+  ID3_AddTitle(&tag, title, true);
+  ID3_AddArtist(&tag, "The artist", true);
+  flags_t tags = tag.Update(ID3TT_ID3);
+
+  size_t errors = 0;
+  ID3_UpdateStats stats;
+  tag.GetUpdateStats(stats);
+  if (tags != expected || stats.last != mode)
+  {
+    cout << "title \"" << title << "\", skip " << skip << ": returned " << tags <<
+      ", mode " << stats.last << ", expected " << expected << ", " << mode << endl;
+    ++errors;
+  }
+  if (mode == ID3UM_SKIPPED && readFile(TEMPFILE) != before)
+  {
+    cout << "title \"" << title << "\": skipped tags changed the file" << endl;
+    ++errors;
+  }
+  if (tag.HasTagType(ID3TT_UNCHANGED))
+  {
+    cout << "ID3TT_UNCHANGED recorded as a tag type" << endl;
+    ++errors;
+  }
+  ID3_Tag reread(TEMPFILE);
+  char* found = ID3_GetTitle(&reread);
+  if (found == NULL || String(found) != title)
+  {
+    cout << "title \"" << (found ? found : "") << "\" read back" << endl;
+    ++errors;
+  }
+  ID3_FreeString(found);
+  remove(TEMPFILE);
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  const flags_t both = ID3TT_ID3V1 | ID3TT_ID3V2;
+  size_t errors = 0;
+  // the same values: nothing to write
+  errors += check(true, TITLE, both | ID3TT_UNCHANGED, ID3UM_SKIPPED);
+  errors += check(false, TITLE, both, ID3UM_INPLACE);
+  // a new title changes both tags
+  errors += check(true, "Another title", both, ID3UM_INPLACE);
+  // the id3v1 tag only holds the first 30 characters, which are the same
+  errors += check(true, "The title, which has more than thirty letters",
+                  both | ID3TT_UNCHANGED, ID3UM_INPLACE);
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "unchanged tags aren't written" << endl;
+  return 0;
+}
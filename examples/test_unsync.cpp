@@ -0,0 +1,211 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <id3/tag.h>
+#include <id3/io_decorators.h>
+#include <id3/io_helpers.h>
+#include <id3/io_strings.h>
+
+using namespace dami;
+using namespace std;
+
+// Data with plenty of the byte sequences that need unsynchronization:
+// 0xFF followed by 0x00, by 0xE0 and up, and by another 0xFF
+static BString makeData(size_t size, unsigned int seed)
+{
+  static const uchar pool[] = { 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0xE0, 0xF3, 0x41 };
+  BString data;
+  srand(seed);
+  for (size_t i = 0; i < size; ++i)
+  {
+    data += pool[rand() % sizeof(pool)];
+  }
+  return data;
+}
+
+static BString unsync(const BString& data)
+{
+  BString unsynced;
+  io::BStringWriter sw(unsynced);
+  io::UnsyncedWriter uw(sw);
+  uw.writeChars(data.data(), data.size());
+  uw.flush();
+  return unsynced;
+}
+
+// unsync a character at a time, the way UnsyncedWriter always used to
+static BString unsyncByChar(const BString& data, size_t& numSyncs)
+{
+  BString unsynced;
+  io::BStringWriter sw(unsynced);
+  io::UnsyncedWriter uw(sw);
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    uw.writeChar(data[i]);
+  }
+  uw.flush();
+  numSyncs = uw.getNumSyncs();
+  return unsynced;
+}
+
+// unsync in blocks of the given size
+static BString unsyncByBlock(const BString& data, size_t block, size_t& numSyncs)
+{
+  BString unsynced;
+  io::BStringWriter sw(unsynced);
+  io::UnsyncedWriter uw(sw);
+  for (size_t i = 0; i < data.size(); i += block)
+  {
+    uw.writeChars(data.data() + i, min(block, data.size() - i));
+  }
+  uw.flush();
+  numSyncs = uw.getNumSyncs();
+  return unsynced;
+}
+
+// resync a character at a time, the way UnsyncedReader always used to
+static BString resyncByChar(const BString& unsynced)
+{
+  BString synced;
+  io::BStringReader sr(unsynced);
+  io::UnsyncedReader ur(sr);
+  while (!ur.atEnd())
+  {
+    synced += static_cast<uchar>(ur.readChar());
+  }
+  return synced;
+}
+
+static BString resyncByBlock(const BString& unsynced, size_t block)
+{
+  BString synced;
+  io::BStringReader sr(unsynced);
+  io::UnsyncedReader ur(sr);
+  uchar* buf = new uchar[block];
+  while (!ur.atEnd())
+  {
+    size_t numRead = ur.readChars(buf, block);
+    synced.append(buf, numRead);
+  }
+  delete [] buf;
+  return synced;
+}
+
+static BString resyncInPlace(const BString& unsynced)
+{
+  BString synced = unsynced;
+  if (!synced.empty())
+  {
+    synced.resize(io::resync(&synced[0], synced.size()));
+  }
+  return synced;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  int errors = 0;
+
+  static const size_t sizes[] = { 0, 1, 2, 3, 17, 1024, 1025, 70000 };
+  static const size_t blocks[] = { 1, 2, 3, 7, 1024 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); ++i)
+  {
+    BString orig = makeData(sizes[i], i + 1);
+    BString unsynced = unsync(orig);
+    if (resyncByChar(unsynced) != orig)
+    {
+      cout << "size " << sizes[i] << ": readChar resync differs" << endl;
+      ++errors;
+    }
+    if (resyncInPlace(unsynced) != orig)
+    {
+      cout << "size " << sizes[i] << ": in place resync differs" << endl;
+      ++errors;
+    }
+    size_t numSyncs = 0;
+    if (unsyncByChar(orig, numSyncs) != unsynced ||
+        numSyncs != unsynced.size() - orig.size())
+    {
+      cout << "size " << sizes[i] << ": writeChar unsync differs" << endl;
+      ++errors;
+    }
+    for (size_t j = 0; j < sizeof(blocks) / sizeof(size_t); ++j)
+    {
+      if (resyncByBlock(unsynced, blocks[j]) != orig)
+      {
+        cout << "size " << sizes[i] << ", block " << blocks[j]
+             << ": readChars resync differs" << endl;
+        ++errors;
+      }
+      if (unsyncByBlock(orig, blocks[j], numSyncs) != unsynced ||
+          numSyncs != unsynced.size() - orig.size())
+      {
+        cout << "size " << sizes[i] << ", block " << blocks[j]
+             << ": writeChars unsync differs" << endl;
+        ++errors;
+      }
+    }
+  }
+
+  // an unsynced tag has to survive a render/parse round trip
+  BString picture = makeData(100000, 42);
+  ID3_Tag tag;
+  ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/jpeg");
+  frame->GetField(ID3FN_DATA)->Set(picture.data(), picture.size());
+  tag.AttachFrame(frame);
+  tag.SetUnsync(true);
+  tag.SetPadding(false);
+
+  uchar* buffer = new uchar[tag.Size()];
+  size_t size = tag.Render(buffer, ID3TT_ID3V2);
+
+  ID3_Tag parsed;
+  parsed.Parse(buffer, size);
+  delete [] buffer;
+
+  const ID3_Frame* found = parsed.Find(ID3FID_PICTURE);
+  const ID3_Field* data = found ? found->GetField(ID3FN_DATA) : NULL;
+  if (!parsed.GetUnsync() || data == NULL ||
+      BString(data->GetRawBinary(), data->Size()) != picture)
+  {
+    cout << "unsynced tag round trip failed" << endl;
+    ++errors;
+  }
+
+  if (errors == 0)
+  {
+    cout << "all unsync tests passed" << endl;
+  }
+  return errors == 0 ? 0 : 1;
+}
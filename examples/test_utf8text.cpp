@@ -0,0 +1,393 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Reads a tag with UTF-16 and ISO-8859-1 text, holding the text as UTF-8, and
+// checks that the text reads as UTF-8, that the unicode accessors and
+// searches still work, and that the tag renders just as it does when read
+// the usual way.  The UTF-16 copy of the text is asked for from several
+// threads at once, and text held as UTF-8 goes in an ID3v1 tag as ISO-8859-1.
+// A tag that doesn't hold its text as UTF-8 still gives the text of a UTF-8
+// frame in ISO-8859-1.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+#include <id3/io_strings.h>
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  include <pthread.h>
+#  define ID3_TEST_WITH_THREADS
+#endif
+
+using namespace dami;
+using namespace std;
+
+static const char* const TEMPFILE = "test-utf8text.mp3";
+static const char* const UTF8FILE = "test-utf8frame.mp3";
+static const size_t NUM_THREADS = 4;
+
+// "a", a smiley, "b", in big endian order as parsed UTF-16 text is held
+static const uchar TITLE_BYTES[] = { 0x00, 'a', 0x26, 0x3a, 0x00, 'b', 0, 0 };
+static const char* const TITLE_UTF8 = "a\xe2\x98\xba" "b";
+static const char* const ARTIST_LATIN1 = "Caf\xe9";
+static const char* const ARTIST_UTF8 = "Caf\xc3\xa9";
+
+static const unicode_t* title()
+{
+  return reinterpret_cast<const unicode_t*>(TITLE_BYTES);
+}
+
+static void writeFile()
+{
+  {
+    ofstream file(TEMPFILE, ios::out | ios::binary | ios::trunc);
+    BString audio(4000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  ID3_Tag tag(TEMPFILE);
+  ID3_Frame* frame = new ID3_Frame(ID3FID_TITLE);
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->Set(title());
+  tag.AttachFrame(frame);
+  ID3_AddArtist(&tag, ARTIST_LATIN1);
+  frame = new ID3_Frame(ID3FID_COMMENT);
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_DESCRIPTION)->SetEncoding(ID3TE_UTF16);
+  frame->GetField(ID3FN_DESCRIPTION)->Set(title());
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->Set(title());
+  frame->GetField(ID3FN_LANGUAGE)->Set("eng");
+  tag.AttachFrame(frame);
+  tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+}
+
+static BString render(const ID3_Tag& tag)
+{
+  BString bytes;
+  io::BStringWriter writer(bytes);
+  tag.Render(writer, ID3TT_ID3V2);
+  return bytes;
+}
+
+static String text(const ID3_Frame* frame, ID3_FieldID fld)
+{
+  const char* raw = (frame != NULL) ? frame->GetField(fld)->GetRawText() : NULL;
+  return (raw != NULL) ? raw : "";
+}
+
+static bool sameUnicode(const ID3_Frame* frame, ID3_FieldID fld)
+{
+  const unicode_t* raw =
+    (frame != NULL) ? frame->GetField(fld)->GetRawUnicodeText() : NULL;
+  return raw != NULL && ::memcmp(raw, TITLE_BYTES, sizeof(TITLE_BYTES)) == 0;
+}
+
+// The text reads as UTF-8 or UTF-16, can be found either way, and the tag
+// renders to the same bytes as one read the usual way
+static size_t checkTag(bool lazy, const BString& expected)
+{
+  size_t errors = 0;
+  const char* how = lazy ? "lazy: " : "full: ";
+  ID3_Tag tag;
+  tag.SetLazyParsing(lazy);
+  tag.SetUtf8Text(true);
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+
+  char* artist = ID3_GetArtist(&tag);
+  const ID3_Frame* frame = tag.Find(ID3FID_TITLE);
+  if (text(frame, ID3FN_TEXT) != TITLE_UTF8 || artist == NULL ||
+      String(artist) != ARTIST_UTF8)
+  {
+    cout << how << "the text isn't UTF-8" << endl;
+    ++errors;
+  }
+  ID3_FreeString(artist);
+  if (!sameUnicode(frame, ID3FN_TEXT) ||
+      frame->GetField(ID3FN_TEXT)->GetRawUnicodeText() !=
+      frame->GetField(ID3FN_TEXT)->GetRawUnicodeText())
+  {
+    cout << how << "the UTF-16 text is wrong, or isn't kept" << endl;
+    ++errors;
+  }
+  if (tag.Find(ID3FID_TITLE, ID3FN_TEXT, title()) != frame ||
+      tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, title()) == NULL ||
+      tag.Find(ID3FID_LEADARTIST, ID3FN_TEXT, ARTIST_UTF8) == NULL)
+  {
+    cout << how << "the frames weren't found" << endl;
+    ++errors;
+  }
+  if (render(tag) != expected)
+  {
+    cout << how << "the tag renders differently" << endl;
+    ++errors;
+  }
+
+  ID3_Frame copy(*frame);
+  if (text(&copy, ID3FN_TEXT) != TITLE_UTF8 || !sameUnicode(&copy, ID3FN_TEXT))
+  {
+    cout << how << "the copy of the frame is wrong" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// Text set on a frame of the tag is held as UTF-8 too, and renders as it
+// would otherwise
+static size_t checkSet()
+{
+  size_t errors = 0;
+  BString expected;
+  for (size_t utf8 = 0; utf8 < 2; ++utf8)
+  {
+    ID3_Tag tag;
+    tag.SetUtf8Text(utf8 != 0);
+    tag.Link(TEMPFILE, ID3TT_ID3V2);
+    ID3_Frame* frame = tag.Find(ID3FID_LEADARTIST);
+    ID3_Field* fld = (frame != NULL) ? frame->GetField(ID3FN_TEXT) : NULL;
+    if (fld == NULL)
+    {
+      cout << "set: there's no artist" << endl;
+      return 1;
+    }
+    frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+    fld->SetEncoding(ID3TE_UTF16);
+    fld->Set(title());
+    if (!sameUnicode(frame, ID3FN_TEXT) ||
+        (utf8 != 0 && text(frame, ID3FN_TEXT) != TITLE_UTF8))
+    {
+      cout << "set: the text set is wrong" << endl;
+      ++errors;
+    }
+    if (utf8 == 0)
+    {
+      expected = render(tag);
+    }
+    else if (render(tag) != expected)
+    {
+      cout << "set: the tag renders differently" << endl;
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+struct Reader
+{
+  const ID3_Field* fld;
+  const unicode_t* raw;
+};
+
+static void* readUnicode(void* arg)
+{
+  Reader& reader = *static_cast<Reader*>(arg);
+  reader.raw = reader.fld->GetRawUnicodeText();
+  return NULL;
+}
+
+// The UTF-16 copy is made once, whichever thread asks for it first
+static size_t checkThreads()
+{
+  ID3_Tag tag;
+  tag.SetUtf8Text(true);
+  tag.Link(TEMPFILE, ID3TT_ID3V2);
+  const ID3_Frame* frame = tag.Find(ID3FID_COMMENT);
+  if (frame == NULL)
+  {
+    cout << "threads: there's no comment" << endl;
+    return 1;
+  }
+  vector<Reader> readers(NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    readers[i].fld = frame->GetField(ID3FN_TEXT);
+    readers[i].raw = NULL;
+  }
+#if defined ID3_TEST_WITH_THREADS
+  vector<pthread_t> threads(NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_create(&threads[i], NULL, readUnicode, &readers[i]);
+  }
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+#else
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    readUnicode(&readers[i]);
+  }
+#endif
+  size_t errors = 0;
+  for (size_t i = 0; i < NUM_THREADS; ++i)
+  {
+    if (readers[i].raw != readers[0].raw || !sameUnicode(frame, ID3FN_TEXT))
+    {
+      cout << "threads: thread " << i << " read other text" << endl;
+      ++errors;
+    }
+  }
+  return errors;
+}
+
+// An ID3v2.4 frame in UTF-8 reads in ISO-8859-1 from a tag read the usual
+// way, as it did before tags could hold their text as UTF-8
+static size_t checkUtf8Frame()
+{
+  {
+    ofstream file(UTF8FILE, ios::out | ios::binary | ios::trunc);
+    BString audio(4000, 0x55);
+    file.write(reinterpret_cast<const char*>(audio.data()), audio.size());
+  }
+  {
+    ID3_Tag tag(UTF8FILE);
+    tag.SetSpec(ID3V2_4_0);
+    ID3_Frame* frame = new ID3_Frame(ID3FID_TITLE);
+    frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF8);
+    frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF8);
+    frame->GetField(ID3FN_TEXT)->Set(ARTIST_UTF8);
+    tag.AttachFrame(frame);
+    tag.Update(ID3TT_ID3V2);
+  }
+  size_t errors = 0;
+  ID3_Tag tag(UTF8FILE, ID3TT_ID3V2);
+  const ID3_Frame* frame = tag.FindFirst(ID3FID_TITLE);
+  char* title = ID3_GetTitle(&tag);
+  if (frame == NULL || frame->GetField(ID3FN_TEXT)->GetEncoding() != ID3TE_UTF8 ||
+      text(frame, ID3FN_TEXT) != ARTIST_UTF8)
+  {
+    cout << "utf-8 frame: the frame wasn't written in UTF-8" << endl;
+    ++errors;
+  }
+  else if (title == NULL || String(title) != ARTIST_LATIN1)
+  {
+    cout << "utf-8 frame: the title isn't ISO-8859-1" << endl;
+    ++errors;
+  }
+  ID3_FreeString(title);
+  remove(UTF8FILE);
+  return errors;
+}
+
+// The title of the ID3v1 tag of the file, as it is in the file
+static String v1Title()
+{
+  ifstream file(TEMPFILE, ios::in | ios::binary);
+  file.seekg(-ID3_V1_LEN, ios::end);
+  char tag[ID3_V1_LEN];
+  file.read(tag, ID3_V1_LEN);
+  String title(tag + ID3_V1_LEN_ID, ID3_V1_LEN_TITLE);
+  return title.substr(0, title.find_first_of(String(" \0", 2)));
+}
+
+// Text held as UTF-8 is written to the ID3v1 tag in ISO-8859-1, and reads
+// back as it was set
+static size_t checkV1()
+{
+  size_t errors = 0;
+  {
+    ID3_Tag tag;
+    tag.SetUtf8Text(true);
+    tag.Link(TEMPFILE, ID3TT_ID3V1);
+    ID3_Frame* frame = tag.Find(ID3FID_TITLE);
+    if (frame == NULL)
+    {
+      cout << "v1: there's no title" << endl;
+      return 1;
+    }
+    frame->GetField(ID3FN_TEXT)->Set(ARTIST_UTF8);
+    tag.Update(ID3TT_ID3V1);
+  }
+  if (v1Title() != ARTIST_LATIN1)
+  {
+    cout << "v1: the title was written as \"" << v1Title() << "\"" << endl;
+    ++errors;
+  }
+  for (size_t utf8 = 0; utf8 < 2; ++utf8)
+  {
+    ID3_Tag tag;
+    tag.SetUtf8Text(utf8 != 0);
+    tag.Link(TEMPFILE, ID3TT_ID3V1);
+    char* title = ID3_GetTitle(&tag);
+    if (title == NULL || String(title) != (utf8 ? ARTIST_UTF8 : ARTIST_LATIN1))
+    {
+      cout << "v1: the title didn't read back" << (utf8 ? " as UTF-8" : "") <<
+        endl;
+      ++errors;
+    }
+    ID3_FreeString(title);
+  }
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  writeFile();
+  BString expected;
+  {
+    ID3_Tag tag(TEMPFILE, ID3TT_ID3V2);
+    expected = render(tag);
+  }
+
+  size_t errors = checkTag(false, expected);
+  errors += checkTag(true, expected);
+  errors += checkSet();
+  errors += checkThreads();
+  errors += checkUtf8Frame();
+
+  {
+    ID3_Tag tag;
+    tag.SetUtf8Text(true);
+    tag.Link(TEMPFILE, ID3TT_ID3V1);
+    char* artist = ID3_GetArtist(&tag);
+    if (artist == NULL || String(artist) != ARTIST_UTF8)
+    {
+      cout << "v1: the artist isn't UTF-8" << endl;
+      ++errors;
+    }
+    ID3_FreeString(artist);
+  }
+  errors += checkV1();
+  remove(TEMPFILE);
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "text held as UTF-8 reads and renders as it should" << endl;
+  return 0;
+}
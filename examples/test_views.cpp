@@ -0,0 +1,166 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+// Looks at the text and data of fields through views, which must point into
+// the fields themselves, and hands frames to a tag without copying them.
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <id3/tag.h>
+#include <id3/misc_support.h>
+
+using namespace dami;
+using namespace std;
+
+static const char* const LONG_TEXT =
+  "A title much too long to be kept in the field itself";
+static const size_t PICTURE_SIZE = 5000;
+
+// A text view is the text of the field, where the field keeps it
+static size_t checkText()
+{
+  size_t errors = 0;
+  ID3_Frame frame(ID3FID_TITLE);
+  ID3_Field* fld = frame.GetField(ID3FN_TEXT);
+  const String title(LONG_TEXT);
+  fld->SetText(title);
+  StringView view = fld->GetTextView();
+  if (view.data() != fld->GetRawText() || view.size() != title.size() ||
+      view.str() != title || view.empty())
+  {
+    cout << "text: the view isn't of the field's text" << endl;
+    ++errors;
+  }
+
+  ID3_Frame copy(frame);
+  if (copy.GetField(ID3FN_TEXT)->GetTextView().data() != view.data())
+  {
+    cout << "text: the copy doesn't share the text" << endl;
+    ++errors;
+  }
+  copy.GetField(ID3FN_TEXT)->SetText("Another title");
+  if (fld->GetTextView().str() != title ||
+      copy.GetField(ID3FN_TEXT)->GetTextView().str() != "Another title")
+  {
+    cout << "text: a change showed through to the other copy" << endl;
+    ++errors;
+  }
+
+  if (!frame.GetField(ID3FN_TEXTENC)->GetTextView().empty() ||
+      !fld->GetBinaryView().empty())
+  {
+    cout << "text: there's a view of the wrong kind of field" << endl;
+    ++errors;
+  }
+#if __cplusplus >= 201703L
+  std::string_view std_view = fld->GetTextView();
+  if (std_view != LONG_TEXT)
+  {
+    cout << "text: the string_view is wrong" << endl;
+    ++errors;
+  }
+#endif
+  return errors;
+}
+
+// A binary view is the data of the field, where the field keeps it
+static size_t checkBinary()
+{
+  size_t errors = 0;
+  ID3_Frame frame(ID3FID_PICTURE);
+  ID3_Field* fld = frame.GetField(ID3FN_DATA);
+  const BString picture(PICTURE_SIZE, 0xaa);
+  fld->SetBinary(picture);
+  BStringView view = fld->GetBinaryView();
+  if (view.data() != fld->GetRawBinary() || view.size() != PICTURE_SIZE ||
+      view[PICTURE_SIZE - 1] != 0xaa || view.str() != picture)
+  {
+    cout << "binary: the view isn't of the field's data" << endl;
+    ++errors;
+  }
+  size_t sum = 0;
+  for (BStringView::const_iterator it = view.begin(); it != view.end(); ++it)
+  {
+    sum += *it;
+  }
+  if (sum != PICTURE_SIZE * 0xaa)
+  {
+    cout << "binary: the view's bytes are wrong" << endl;
+    ++errors;
+  }
+  return errors;
+}
+
+// A frame handed over in a unique_ptr is the one the tag keeps, and one the
+// tag won't have is deleted
+static size_t checkAttach()
+{
+  size_t errors = 0;
+#if __cplusplus >= 201103L
+  ID3_Tag tag;
+  std::unique_ptr<ID3_Frame> frame(new ID3_Frame(ID3FID_TITLE));
+  frame->GetField(ID3FN_TEXT)->SetText(LONG_TEXT);
+  const ID3_Frame* title = frame.get();
+  if (!tag.AttachFrame(std::move(frame)) || frame.get() != NULL ||
+      tag.Find(ID3FID_TITLE) != title)
+  {
+    cout << "attach: the frame isn't the tag's" << endl;
+    ++errors;
+  }
+
+  // a copyright notice must have more than a year to it
+  std::unique_ptr<ID3_Frame> copyright(new ID3_Frame(ID3FID_COPYRIGHT));
+  copyright->GetField(ID3FN_TEXT)->SetText("1999");
+  if (tag.AttachFrame(std::move(copyright)) || tag.NumFrames() != 1)
+  {
+    cout << "attach: the tag took a frame it shouldn't have" << endl;
+    ++errors;
+  }
+#endif
+  return errors;
+}
+
+int main()
+{
+  ID3D_INIT_DOUT();
+  ID3D_INIT_WARNING();
+  ID3D_INIT_NOTICE();
+
+  size_t errors = checkText();
+  errors += checkBinary();
+  errors += checkAttach();
+
+  if (errors > 0)
+  {
+    cout << errors << " errors" << endl;
+    return 1;
+  }
+  cout << "views look into the fields, and frames are handed over" << endl;
+  return 0;
+}
@@ -42,6 +42,11 @@ extern "C"
   typedef struct { char _dummy; } ID3Frame;
   typedef struct { char _dummy; } ID3Field;
   typedef struct { char _dummy; } ID3FrameInfo;
+  typedef struct { char _dummy; } ID3BatchUpdater;
+  typedef struct { char _dummy; } ID3Scanner;
+
+  typedef bool (CCONV *ID3BatchEdit)(ID3Tag *tag, const char *fileName, void *data);
+  typedef void (CCONV *ID3ScanResult)(const char *fileName, const ID3Tag *tag, ID3_Err err, void *data);
 
   /* tag wrappers */
   ID3_C_EXPORT ID3Tag*              CCONV ID3Tag_New                  (void);
@@ -116,6 +121,26 @@ extern "C"
   ID3_C_EXPORT size_t               CCONV ID3FrameInfo_FieldSize      (ID3_FrameID frameid, int fieldnum);
   ID3_C_EXPORT flags_t              CCONV ID3FrameInfo_FieldFlags     (ID3_FrameID frameid, int fieldnum);
 
+  /* batch updater wrappers */
+  ID3_C_EXPORT ID3BatchUpdater*     CCONV ID3BatchUpdater_New         (size_t workers);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_Delete      (ID3BatchUpdater *batch);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_SetQueueSize(ID3BatchUpdater *batch, size_t size);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_SetTagTypes (ID3BatchUpdater *batch, flags_t link, flags_t update);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_SetLazyParsing(ID3BatchUpdater *batch, bool lazy);
+  ID3_C_EXPORT size_t               CCONV ID3BatchUpdater_Add         (ID3BatchUpdater *batch, const char *fileName, ID3BatchEdit edit, void *data);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_Wait        (ID3BatchUpdater *batch);
+  ID3_C_EXPORT size_t               CCONV ID3BatchUpdater_NumJobs     (const ID3BatchUpdater *batch);
+  ID3_C_EXPORT ID3_Err              CCONV ID3BatchUpdater_GetResult   (const ID3BatchUpdater *batch, size_t job);
+  ID3_C_EXPORT flags_t              CCONV ID3BatchUpdater_GetUpdatedTags(const ID3BatchUpdater *batch, size_t job);
+  ID3_C_EXPORT void                 CCONV ID3BatchUpdater_Clear       (ID3BatchUpdater *batch);
+
+  /* scanner wrappers */
+  ID3_C_EXPORT ID3Scanner*          CCONV ID3Scanner_New              (size_t workers);
+  ID3_C_EXPORT void                 CCONV ID3Scanner_Delete           (ID3Scanner *scanner);
+  ID3_C_EXPORT void                 CCONV ID3Scanner_SetTagTypes      (ID3Scanner *scanner, flags_t types);
+  ID3_C_EXPORT void                 CCONV ID3Scanner_SetLazyParsing   (ID3Scanner *scanner, bool lazy);
+  ID3_C_EXPORT size_t               CCONV ID3Scanner_Scan             (ID3Scanner *scanner, const char *path, ID3ScanResult result, void *data);
+
   /* Deprecated */
   ID3_C_EXPORT void                 CCONV ID3Tag_SetCompression       (ID3Tag *tag, bool comp);
 
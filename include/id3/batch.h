@@ -0,0 +1,65 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_BATCH_H_
+#define _ID3LIB_BATCH_H_
+
+#include <id3/tag.h>
+
+class ID3_BatchUpdaterImpl;
+
+class ID3_CPP_EXPORT ID3_BatchUpdater
+{
+  ID3_BatchUpdaterImpl* _impl;
+public:
+  /** The edit made to each file's tag between Link() and Update().  Returns
+   ** false to leave the file alone.
+   **/
+  typedef bool (*EditFunc)(ID3_Tag& tag, const char* fileName, void* data);
+
+  ID3_BatchUpdater(size_t workers = 0);
+  ~ID3_BatchUpdater();
+
+  size_t     GetNumWorkers() const;
+  void       SetQueueSize(size_t);
+  size_t     GetQueueSize() const;
+  void       SetTagTypes(flags_t link, flags_t update);
+  void       SetLazyParsing(bool);
+
+  size_t     Add(const char* fileName, EditFunc edit, void* data = NULL);
+  void       Wait();
+
+  size_t     NumJobs() const;
+  ID3_Err    GetResult(size_t job) const;
+  flags_t    GetUpdatedTags(size_t job) const;
+  void       Clear();
+
+private:
+  ID3_BatchUpdater(const ID3_BatchUpdater&);
+  ID3_BatchUpdater& operator=(const ID3_BatchUpdater&);
+};
+
+#endif /* _ID3LIB_BATCH_H_ */
@@ -48,6 +48,19 @@ class ID3_Writer;
 class ID3_CPP_EXPORT ID3_Field
 {
 public:
+  /** Steps through the items of a text list, giving each in place, as
+   ** GetRawTextItem() or GetRawUnicodeTextItem() would, without copying it.
+   ** Gives NULL after the last item, or for a field whose text can't be had
+   ** the way it is asked for.
+   **/
+  class ItemIterator
+  {
+  public:
+    virtual const char*      GetNext()        = 0;
+    virtual const unicode_t* GetNextUnicode() = 0;
+    virtual ~ItemIterator() {};
+  };
+
   virtual void Clear() = 0;
 
   virtual size_t Size() const = 0;
@@ -69,7 +82,8 @@ public:
   virtual size_t        Add(const char*) = 0;
 
   virtual dami::String  GetText() const = 0;
-  virtual size_t        SetText(dami::String) = 0;
+  virtual size_t        SetText(const dami::String&) = 0;
+  virtual dami::StringView GetTextView() const = 0;
 
   // Unicode string field functions
   virtual ID3_Field&    operator= (const unicode_t* s) = 0;
@@ -80,13 +94,17 @@ public:
   virtual const unicode_t* GetRawUnicodeTextItem(size_t) const = 0;
   virtual size_t        Add(const unicode_t*) = 0;
 
+  virtual ItemIterator* CreateItemIterator() const = 0;
+
   // binary field functions
   virtual size_t        Set(const uchar*, size_t) = 0;
   virtual size_t        Get(uchar*, size_t) const = 0;
   virtual const uchar*  GetRawBinary() const = 0;
   virtual void          FromFile(const char*) = 0;
   virtual void          ToFile(const char *sInfo) const = 0;
+  virtual size_t        SetBinary(const dami::BString&) = 0;
   virtual dami::BString GetBinary() const = 0;
+  virtual dami::BStringView GetBinaryView() const = 0;
 
   // miscelaneous functions
   virtual ID3_Field&    operator=( const ID3_Field & ) = 0;
@@ -207,6 +207,9 @@ ID3_ENUM(ID3_TagType)
   ID3TT_LYRICS3    = 1 << 2,   /**< Represents a Lyrics3 tag */
   ID3TT_LYRICS3V2  = 1 << 3,   /**< Represents a Lyrics3 v2.00 tag */
   ID3TT_MUSICMATCH = 1 << 4,   /**< Represents a MusicMatch tag */
+  /** Only returned by ID3_Tag::Update(), along with the tags that weren't
+   ** written because the file already held them as they would be written */
+  ID3TT_UNCHANGED  = 1 << 15,
    /**< Represents a Lyrics3 tag (for backwards compatibility) */
   ID3TT_LYRICS     = ID3TT_LYRICS3,
   /** Represents both id3 tags: id3v1 and id3v2 */
@@ -433,7 +436,9 @@ ID3_ENUM(ID3_Err)
 //  ID3E_FieldNotFound,           /**< Requested field not found */
 //  ID3E_TagAlreadyAttached,      /**< Tag is already attached to a file */
 //  ID3E_InvalidTagVersion,       /**< Invalid tag version */
-  ID3E_zlibError                /**< Error in compression/uncompression */
+  ID3E_zlibError,               /**< Error in compression/uncompression */
+  ID3E_FramesSkipped,           /**< Frames were skipped while parsing */
+  ID3E_EditFailed               /**< The edit of a batch update threw an exception */
 // We use these errors in a hack in RenderV2ToFile; for this, it is important to keep
 // the errors which can be returned from createFile(), openWritableFile and ID3E_NoFile and ID3E_ReadOnly
 // below the minimum tag size ( which is 10 bytes for the header, + 7 bytes for a minimal (2.2) frame
@@ -481,6 +486,31 @@ ID3_ENUM(ID3_TimeStampFormat)
   ID3TSF_MS
 };
 
+/** How much padding is left in an id3v2 tag for it to grow into, so later
+ ** changes can be written without moving the audio data.
+ ** \sa ID3_Tag::SetPaddingPolicy()
+ **/
+ID3_ENUM(ID3_PaddingPolicy)
+{
+  ID3PP_DEFAULT = 0, /**< Rounds the whole file up to the next 2K */
+  ID3PP_FIXED,       /**< A fixed number of bytes */
+  ID3PP_PERCENT,     /**< A percentage of the size of the frames */
+  ID3PP_BLOCK,       /**< Rounds the tag up to a multiple of a block size */
+  ID3PP_ADAPTIVE     /**< Twice the growth since the tag was last laid out */
+};
+
+/** How Update() wrote an id3v2 tag.
+ **/
+ID3_ENUM(ID3_UpdateMode)
+{
+  ID3UM_NONE = 0,    /**< No id3v2 tag was written */
+  ID3UM_INPLACE,     /**< The tag was written over the old one */
+  ID3UM_INSERTED,    /**< Room was made by inserting blocks at the start of the file */
+  ID3UM_REWRITTEN,   /**< The whole file was rewritten */
+  ID3UM_SKIPPED,     /**< The file already held the tag, so it wasn't written */
+  ID3UM_PATCHED      /**< Only the changed frames were written over themselves */
+};
+
 #define ID3_NR_OF_V1_GENRES 148
 
 static const char* ID3_v1_genre_description[ID3_NR_OF_V1_GENRES] =
@@ -755,6 +785,35 @@ ID3_STRUCT(Mp3_Headerinfo)
   bool original;
 };
 
+/**
+ ** What ID3_Tag::Probe() found out about the tags of a file.
+ **/
+ID3_STRUCT(ID3_TagInfo)
+{
+  flags_t tags;                 // ID3_TagType flags of the tags found
+  ID3_V2Spec v2spec;            // version of the first id3v2 tag
+  uchar v2flags;                // header flags of the first id3v2 tag
+  uint32 v2size;                // size of the id3v2 tags, headers included
+  uint32 v2padding;             // padding at the end of the id3v2 tags
+  bool ape;                     // is there an APE tag at the end?
+  uint64 audiooffset;           // where the data after the prepended tags begins
+  uint64 audiosize;             // size of the data between the tags
+};
+
+/**
+ ** How the updates of an ID3_Tag's file have been written.
+ ** \sa ID3_Tag::GetUpdateStats()
+ **/
+ID3_STRUCT(ID3_UpdateStats)
+{
+  ID3_UpdateMode last;          // how the last id3v2 tag was written
+  uint32 inplace;               // number of tags written over the old one
+  uint32 inserted;              // number of tags that had blocks inserted
+  uint32 rewritten;             // number of tags for which the file was rewritten
+  uint32 skipped;               // number of tags the file already held
+  uint32 patched;               // number of tags that had frames written over
+};
+
 #define MASK(bits) ((1 << (bits)) - 1)
 #define MASK1 MASK(1)
 #define MASK2 MASK(2)
@@ -48,6 +48,7 @@ class ID3_Writer;
 
 class ID3_CPP_EXPORT ID3_Frame
 {
+  friend class ID3_FrameImpl;
   ID3_FrameImpl* _impl;
 public:
 
@@ -110,6 +111,9 @@ public:
   // Deprecated
   ID3_Field&  Field(ID3_FieldID name) const;
   //ID3_Field*  GetFieldNum(size_t) const;
+
+private:
+  ID3_Frame(ID3_FrameImpl*);
 };
 
 #endif /* _ID3LIB_FRAME_H_ */
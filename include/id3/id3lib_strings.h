@@ -41,6 +41,9 @@
 
 #include <string>
 #include <cstring>
+#if __cplusplus >= 201703L
+#  include <string_view>
+#endif
 
 
 #if (defined(__GNUC__) && (__GNUC__ >= 3) || (defined(_MSC_VER) && _MSC_VER > 1000))
@@ -138,6 +141,49 @@ namespace dami
   typedef std::basic_string<char>           String;
   typedef std::basic_string<unsigned char> BString;
   typedef std::basic_string<wchar_t>       WString;
+
+  /** Characters or bytes held by something else, such as the text or data of
+   ** a field: where they start, and how many there are.  A view copies
+   ** nothing, and is only good for as long as what it looks at is left as it
+   ** is.
+   **/
+  template <typename charT>
+  class BasicView
+  {
+  public:
+    typedef charT           value_type;
+    typedef const charT*    const_iterator;
+
+    BasicView() : _data(NULL), _size(0) { }
+    BasicView(const charT* data, size_t size) : _data(data), _size(size) { }
+
+    const charT*    data() const { return _data; }
+    size_t          size() const { return _size; }
+    bool            empty() const { return _size == 0; }
+    const_iterator  begin() const { return _data; }
+    const_iterator  end() const { return _data + _size; }
+    charT           operator[](size_t index) const { return _data[index]; }
+
+    /** A copy of what the view looks at. **/
+    std::basic_string<charT> str() const
+    {
+      return (_size > 0) ? std::basic_string<charT>(_data, _size)
+                         : std::basic_string<charT>();
+    }
+#if __cplusplus >= 201703L
+    operator std::basic_string_view<charT>() const
+    {
+      return std::basic_string_view<charT>(_data, _size);
+    }
+#endif
+
+  private:
+    const charT*    _data;
+    size_t          _size;
+  };
+
+  typedef BasicView<char>          StringView;
+  typedef BasicView<unsigned char> BStringView;
 };
 
 #endif /* _ID3LIB_STRINGS_H_ */
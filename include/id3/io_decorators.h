@@ -150,6 +150,17 @@ namespace dami
      public:
       UnsyncedReader(ID3_Reader& reader) : SUPER(reader) { }
       int_type readChar();
+
+      /**
+       * Read \c len resynced characters into the array \c buf.  The
+       * characters are read from the underlying reader a block at a time and
+       * resynced in place, rather than one at a time.
+       */
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      {
+        return this->readChars((char_type*) buf, len);
+      }
     };
 
     class ID3_CPP_EXPORT CompressedReader : public ID3_MemoryReader
@@ -178,9 +189,10 @@ namespace dami
       void flush();
 
       /**
-       * Write \c len characters into the array \c buf.  Since the stream needs
-       * might have been unsynced, this function copies the characters one at a
-       * time.
+       * Write the \c len characters in the array \c buf, inserting a sync
+       * byte after every 0xFF that would otherwise form a false sync.  Runs
+       * of characters without false syncs are passed to the wrapped writer
+       * in one go.
        */
       size_type writeChars(const char_type[], size_type len);
       size_type writeChars(const char buf[], size_type len)
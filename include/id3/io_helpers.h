@@ -79,6 +79,12 @@ namespace dami
     ID3_C_EXPORT String      readTrailingSpaces(ID3_Reader&, size_t);
     ID3_C_EXPORT uint32      readUInt28(ID3_Reader&);
 
+    /** Remove the unsynchronization from the \c size bytes at \c data in
+     ** place, dropping each 0x00 that follows a 0xFF.  Returns the resynced
+     ** size.
+     **/
+    ID3_C_EXPORT size_t      resync(uchar* data, size_t size);
+
     ID3_C_EXPORT size_t      writeString(ID3_Writer&, String);
     ID3_C_EXPORT size_t      writeText(ID3_Writer&, String);
     ID3_C_EXPORT size_t      writeUnicodeString(ID3_Writer&, String, bool = true);
@@ -44,10 +44,14 @@
 class ID3_CPP_EXPORT ID3_Reader
 {
  public:
-  typedef uint32 size_type;
+  /** Positions and sizes are 64 bits wide, so that files larger than 4 GiB
+   ** can be read.  Code that still stores them in 32-bit variables keeps
+   ** compiling, but is limited to the first 4 GiB of a file.
+   **/
+  typedef uint64 size_type;
   typedef uint8  char_type;
-  typedef uint32 pos_type;
-  typedef  int32 off_type;
+  typedef uint64 pos_type;
+  typedef  int64 off_type;
   typedef  int16 int_type;
   static const int_type END_OF_READER;
 
@@ -168,5 +168,35 @@ class ID3_CPP_EXPORT ID3_MemoryReader : public ID3_Reader
   }
 };
 
+/** A reader over the contents of a file mapped into memory.  Once the file is
+ ** mapped, all positioning and reading is plain pointer arithmetic, which is
+ ** much cheaper than the seeks and tells an ID3_IFStreamReader performs.  If
+ ** the file can't be mapped (the platform has no mmap, the file is empty or
+ ** too large), isMapped() returns false and the caller should fall back on an
+ ** ID3_IFStreamReader.
+ **/
+class ID3_CPP_EXPORT ID3_MappedFileReader : public ID3_MemoryReader
+{
+  void*  _map;
+  size_t _map_size;
+  // not copyable
+  ID3_MappedFileReader(const ID3_MappedFileReader&);
+  ID3_MappedFileReader& operator=(const ID3_MappedFileReader&);
+ public:
+  ID3_MappedFileReader() : _map(NULL), _map_size(0) { ; }
+  ID3_MappedFileReader(const char* name) : _map(NULL), _map_size(0)
+  {
+    this->open(name);
+  }
+  virtual ~ID3_MappedFileReader() { this->close(); }
+
+  /** Map the file \c name read-only.  Returns true on success. **/
+  bool open(const char* name);
+  /** Unmap the file, if it is mapped. **/
+  virtual void close();
+
+  bool isMapped() const { return _map != NULL; }
+};
+
 #endif /* _ID3LIB_READERS_H_ */
 
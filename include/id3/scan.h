@@ -0,0 +1,61 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+
+#ifndef _ID3LIB_SCAN_H_
+#define _ID3LIB_SCAN_H_
+
+#include <id3/tag.h>
+#include <id3/id3lib_streams.h>
+
+class ID3_ScannerImpl;
+
+class ID3_CPP_EXPORT ID3_Scanner
+{
+  ID3_ScannerImpl* _impl;
+public:
+  /** Called with the tag of each file scanned.  The tag belongs to the
+   ** scanner, and is only valid until the function returns.
+   **/
+  typedef void (*ResultFunc)(const char* fileName, const ID3_Tag& tag,
+                             ID3_Err err, void* data);
+
+  ID3_Scanner(size_t workers = 0);
+  ~ID3_Scanner();
+
+  size_t     GetNumWorkers() const;
+  void       SetTagTypes(flags_t);
+  void       SetLazyParsing(bool);
+
+  size_t     Scan(const char* path, ResultFunc result, void* data = NULL);
+  size_t     ScanToJSON(const char* path, ostream& out);
+
+private:
+  ID3_Scanner(const ID3_Scanner&);
+  ID3_Scanner& operator=(const ID3_Scanner&);
+};
+
+#endif /* _ID3LIB_SCAN_H_ */
@@ -93,5 +93,23 @@ typedef short            int32;
 #error This machine has no 32-bit type; report compiler, and the contents of your limits.h to the persons in the AUTHORS file
 #endif /* UINT_MAX == 0xfffffffful */
 
+/* Define 64-bit types */
+#if defined(_MSC_VER) || defined(__BORLANDC__)
+
+typedef unsigned __int64 uint64;
+typedef __int64           int64;
+
+#elif ULONG_MAX > 0xfffffffful
+
+typedef unsigned long   uint64;
+typedef long             int64;
+
+#else
+
+typedef unsigned long long uint64;
+typedef long long           int64;
+
+#endif /* defined(_MSC_VER) || defined(__BORLANDC__) */
+
 #endif /* _SIZED_TYPES_H_ */
 
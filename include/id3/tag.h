@@ -41,6 +41,9 @@
 
 #include <id3/id3lib_frame.h>
 #include <id3/field.h>
+#if __cplusplus >= 201103L
+#  include <memory>
+#endif
 
 class ID3_Reader;
 class ID3_Writer;
@@ -66,6 +69,19 @@ public:
     virtual ~ConstIterator() {};
   };
 
+  /** Where a search with Find(Cursor&, ...) resumes.  Each reader keeps its
+   ** own, so that a tag can be searched by many at once.
+   **/
+  class ID3_CPP_EXPORT Cursor
+  {
+  public:
+    Cursor() : _next(0) { ; }
+    void Reset() { _next = 0; }
+  private:
+    friend class ID3_TagImpl;
+    uint32 _next;
+  };
+
 public:
 
   ID3_Tag(const char *name = NULL, flags_t = (flags_t) ID3TT_ALL);
@@ -85,10 +101,38 @@ public:
   bool       GetExperimental() const;
 
   bool       SetPadding(bool);
+  void       SetPaddingPolicy(ID3_PaddingPolicy, size_t amount = 0);
+  ID3_PaddingPolicy GetPaddingPolicy() const;
+
+  bool       SetLazyParsing(bool);
+  bool       GetLazyParsing() const;
+
+  bool       SetUtf8Text(bool);
+  bool       GetUtf8Text() const;
+
+  bool       SetArenaAllocation(bool);
+  bool       GetArenaAllocation() const;
+  size_t     GetMemoryFootprint() const;
+
+  bool       SetSkipUnchangedWrites(bool);
+  bool       GetSkipUnchangedWrites() const;
+
+  void       SetFileBufferSize(size_t);
+  size_t     GetFileBufferSize() const;
+
+  void       SetFrameFilter(const ID3_FrameID*, size_t, bool keep = false);
+  size_t     NumSkippedFrames() const;
 
   void       AddFrame(const ID3_Frame&);
   void       AddFrame(const ID3_Frame*);
   bool       AttachFrame(ID3_Frame*);
+#if __cplusplus >= 201103L
+  // defined here, so that it doesn't matter which standard the library was
+  // built with
+  bool       AttachFrame(std::unique_ptr<ID3_Frame> frame)
+  { return this->AttachFrame(frame.release()); }
+#endif
+  size_t     AttachFrames(ID3_Frame* const*, size_t);
   ID3_Frame* RemoveFrame(const ID3_Frame *);
 
   size_t     Parse(const uchar*, size_t);
@@ -102,17 +146,28 @@ public:
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
-  size_t     GetPrependedBytes() const;
-  size_t     GetAppendedBytes() const;
-  size_t     GetFileSize() const;
+  uint64     GetPrependedBytes() const;
+  uint64     GetAppendedBytes() const;
+  uint64     GetFileSize() const;
   const char* GetFileName() const;
   ID3_Err    GetLastError();
+  void       GetUpdateStats(ID3_UpdateStats&) const;
 
   ID3_Frame* Find(ID3_FrameID) const;
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, uint32) const;
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, const char*) const;
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, const unicode_t*) const;
 
+  ID3_Frame* FindFirst(ID3_FrameID) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, uint32) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, const char*) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, const unicode_t*) const;
+  ID3_Frame* Find(Cursor&, ID3_FrameID) const;
+  ID3_Frame* Find(Cursor&, ID3_FrameID, ID3_FieldID, uint32) const;
+  ID3_Frame* Find(Cursor&, ID3_FrameID, ID3_FieldID, const char*) const;
+  ID3_Frame* Find(Cursor&, ID3_FrameID, ID3_FieldID, const unicode_t*) const;
+  size_t     FindAll(ID3_FrameID, ID3_Frame* frames[], size_t maxFrames) const;
+
   size_t     NumFrames() const;
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const;
@@ -128,6 +183,8 @@ public:
 
   static size_t IsV2Tag(const uchar*);
   static size_t IsV2Tag(ID3_Reader&);
+  static bool   Probe(const char*, ID3_TagInfo&);
+  static bool   Probe(ID3_Reader&, ID3_TagInfo&);
 
   /* Deprecated! */
   void       AddNewFrame(ID3_Frame* f);
@@ -100,15 +100,17 @@ namespace dami
   String ID3_C_EXPORT convert(String data, ID3_TextEnc, ID3_TextEnc);
 
   // file utils
-  size_t ID3_C_EXPORT getFileSize(fstream&);
-  size_t ID3_C_EXPORT getFileSize(ifstream&);
-  size_t ID3_C_EXPORT getFileSize(ofstream&);
+  uint64 ID3_C_EXPORT getFileSize(fstream&);
+  uint64 ID3_C_EXPORT getFileSize(ifstream&);
+  uint64 ID3_C_EXPORT getFileSize(ofstream&);
   ID3_Err ID3_C_EXPORT createFile(String, fstream&);
   ID3_Err ID3_C_EXPORT openWritableFile(String, fstream&);
   ID3_Err ID3_C_EXPORT openWritableFile(String, ofstream&);
   ID3_Err ID3_C_EXPORT openReadableFile(String, fstream&);
   ID3_Err ID3_C_EXPORT openReadableFile(String, ifstream&);
 
+  size_t ID3_C_EXPORT numProcessors();
+
 };
 
 #endif /* _ID3LIB_UTILS_H_ */
@@ -87,6 +87,14 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\src\arena.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\src\batch.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\c_wrapper.cpp
 # End Source File
 # Begin Source File
@@ -111,6 +119,10 @@ SOURCE=..\src\field_string_unicode.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\field_storage.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\frame.cpp
 # End Source File
 # Begin Source File
@@ -171,6 +183,10 @@ SOURCE=..\src\readers.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\scan.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\spec.cpp
 # End Source File
 # Begin Source File
@@ -211,6 +227,10 @@ SOURCE=..\src\tag_render.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\transcode.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\utils.cpp
 # End Source File
 # Begin Source File
@@ -231,6 +251,10 @@ SOURCE=..\include\id3\field.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\arena.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\field_def.h
 # End Source File
 # Begin Source File
@@ -239,6 +263,10 @@ SOURCE=..\src\field_impl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\field_storage.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\flags.h
 # End Source File
 # Begin Source File
@@ -331,6 +359,14 @@ SOURCE=..\src\tag_impl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\threads.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\src\transcode.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\include\id3\utils.h
 # End Source File
 # Begin Source File
@@ -28,8 +28,17 @@ dnl
 dnl #define ID3D_INIT_DOUT()    Debug( libcw_do.on() )
 dnl #define ID3D_INIT_WARNING() Debug( dc::warning.on() )
 dnl #define ID3D_INIT_NOTICE()  Debug( dc::notice.on() )
-dnl #define ID3D_NOTICE(x)      Dout( dc::notice, x )
-dnl #define ID3D_WARNING(x)     Dout( dc::warning, x )
+dnl /* the batch updater and the scanner write from several threads */
+dnl #if defined (HAVE_PTHREAD_H) && defined (HAVE_LIBPTHREAD)
+dnl #include <pthread.h>
+dnl extern pthread_mutex_t id3d_lock;
+dnl #define ID3D_OUT(c, x)      do { pthread_mutex_lock(&id3d_lock); Dout( c, x ); pthread_mutex_unlock(&id3d_lock); } while (0)
+dnl #else
+dnl #define ID3D_OUT(c, x)      Dout( c, x )
+dnl #endif
+dnl 
+dnl #define ID3D_NOTICE(x)      ID3D_OUT( dc::notice, x )
+dnl #define ID3D_WARNING(x)     ID3D_OUT( dc::warning, x )
 dnl 
 dnl #else
 dnl 
@@ -47,11 +47,11 @@
 /* #undef HAVE_ZLIB */
 /* #undef HAVE_GETOPT_LONG */
 #define _ID3LIB_NAME "id3lib"
-#define _ID3LIB_VERSION "3.9.0"
-#define _ID3LIB_FULLNAME "id3lib-3.9.0-devel"
+#define _ID3LIB_VERSION "3.9.1"
+#define _ID3LIB_FULLNAME "id3lib-3.9.1-devel"
 #define _ID3LIB_MAJOR_VERSION 3
 #define _ID3LIB_MINOR_VERSION 9 
-#define _ID3LIB_PATCH_VERSION 0
+#define _ID3LIB_PATCH_VERSION 1
 #define _ID3LIB_INTERFACE_AGE 0
 #define _ID3LIB_BINARY_AGE 0
 /* #undef ID3_COMPILED_WITH_DEBUGGING */
@@ -127,7 +127,7 @@
 #define PACKAGE "id3lib"
 
 /* Version number of package */
-#define VERSION "3.9.0"
+#define VERSION "3.9.1"
 
 /* This is the bottom section */
 
@@ -168,8 +168,17 @@
 #define ID3D_INIT_DOUT()    Debug( libcw_do.on() )
 #define ID3D_INIT_WARNING() Debug( dc::warning.on() )
 #define ID3D_INIT_NOTICE()  Debug( dc::notice.on() )
-#define ID3D_NOTICE(x)      Dout( dc::notice, x )
-#define ID3D_WARNING(x)     Dout( dc::warning, x )
+/* the batch updater and the scanner write from several threads */
+#if defined (HAVE_PTHREAD_H) && defined (HAVE_LIBPTHREAD)
+#include <pthread.h>
+extern pthread_mutex_t id3d_lock;
+#define ID3D_OUT(c, x)      do { pthread_mutex_lock(&id3d_lock); Dout( c, x ); pthread_mutex_unlock(&id3d_lock); } while (0)
+#else
+#define ID3D_OUT(c, x)      Dout( c, x )
+#endif
+
+#define ID3D_NOTICE(x)      ID3D_OUT( dc::notice, x )
+#define ID3D_WARNING(x)     ID3D_OUT( dc::warning, x )
 
 #else
 
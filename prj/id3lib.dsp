@@ -95,6 +95,14 @@ LINK32=link.exe
 # PROP Default_Filter "c;cpp"
 # Begin Source File
 
+SOURCE=..\src\arena.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=..\src\batch.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\c_wrapper.cpp
 # End Source File
 # Begin Source File
@@ -119,6 +127,10 @@ SOURCE=..\src\field_string_unicode.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\field_storage.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\frame.cpp
 # End Source File
 # Begin Source File
@@ -179,6 +191,10 @@ SOURCE=..\src\readers.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\scan.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\spec.cpp
 # End Source File
 # Begin Source File
@@ -219,6 +235,10 @@ SOURCE=..\src\tag_render.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\transcode.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\utils.cpp
 # End Source File
 # Begin Source File
@@ -235,6 +255,10 @@ SOURCE=..\include\id3\field.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\arena.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\field_def.h
 # End Source File
 # Begin Source File
@@ -243,6 +267,10 @@ SOURCE=..\src\field_impl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\field_storage.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\src\flags.h
 # End Source File
 # Begin Source File
@@ -335,6 +363,14 @@ SOURCE=..\src\tag_impl.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\src\threads.h
+# End Source File
+# Begin Source File
+
+SOURCE=..\src\transcode.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\include\id3\utils.h
 # End Source File
 # Begin Source File
@@ -0,0 +1,208 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <algorithm>
+#include "arena.h"
+
+namespace
+{
+  // every object is aligned as malloc would align it
+  const size_t ALIGNMENT  = 2 * sizeof(void*);
+  // the first chunk suits a small tag, and each one after that is twice the
+  // size of the one before, up to the largest
+  const size_t FIRST_CHUNK = 4 * 1024;
+  const size_t LARGEST_CHUNK = 64 * 1024;
+
+  size_t align(size_t size)
+  {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  }
+
+  // the chunks are kept in order of where they start
+  struct ChunkBefore
+  {
+    template <typename C>
+    bool operator()(const char* p, const C& chunk) const { return p < chunk.beg; }
+  };
+};
+
+ID3_Arena::ID3_Arena()
+  : _chunks(),
+    _fill(NULL),
+    _cur(NULL),
+    _end(NULL),
+    _used(0),
+    _num_allocs(0),
+    _enabled(false)
+{
+  std::fill(_free, _free + NUM_FREE_LISTS, static_cast<void*>(NULL));
+}
+
+ID3_Arena::~ID3_Arena()
+{
+  for (Chunks::iterator ci = _chunks.begin(); ci != _chunks.end(); ++ci)
+  {
+    ::operator delete(ci->beg);
+  }
+}
+
+/** Returns size bytes of memory, which remain valid until they are given
+ ** back with Deallocate(), or until Release().
+ **/
+void* ID3_Arena::Allocate(size_t size)
+{
+  size = align(size == 0 ? 1 : size);
+  ++_num_allocs;
+  _used += size;
+  const size_t list = size / ALIGNMENT - 1;
+  if (list < NUM_FREE_LISTS && _free[list] != NULL)
+  {
+    // a block of this size that was given back, which holds the next one
+    void* p = _free[list];
+    _free[list] = *static_cast<void**>(p);
+    return p;
+  }
+  if (static_cast<size_t>(_end - _cur) >= size)
+  {
+    void* p = _cur;
+    _cur += size;
+    return p;
+  }
+  return this->_NewChunk(size);
+}
+
+/** Gives back size bytes at p, which Allocate() handed out.  A small block is
+ ** handed out again for the next object of its size; a larger one is only
+ ** reclaimed by Release().
+ **/
+void ID3_Arena::Deallocate(void* p, size_t size)
+{
+  size = align(size == 0 ? 1 : size);
+  --_num_allocs;
+  _used -= size;
+  const size_t list = size / ALIGNMENT - 1;
+  if (list < NUM_FREE_LISTS)
+  {
+    *static_cast<void**>(p) = _free[list];
+    _free[list] = p;
+  }
+}
+
+/** Allocates a new chunk for an object that doesn't fit in the current one,
+ ** and returns the object's memory.  An object too large to share a chunk
+ ** gets one of its own, leaving the current chunk to be filled.
+ **/
+void* ID3_Arena::_NewChunk(size_t size)
+{
+  const size_t last = (_fill == NULL) ? 0 : _end - _fill;
+  size_t chunkSize = (last == 0) ? FIRST_CHUNK : last * 2;
+  if (chunkSize > LARGEST_CHUNK)
+  {
+    chunkSize = LARGEST_CHUNK;
+  }
+
+  Chunk chunk;
+  if (size > chunkSize / 4)
+  {
+    chunk.size = size;
+    chunk.beg = static_cast<char*>(::operator new(chunk.size));
+    this->_AddChunk(chunk);
+    return chunk.beg;
+  }
+  chunk.size = chunkSize;
+  chunk.beg = static_cast<char*>(::operator new(chunk.size));
+  this->_AddChunk(chunk);
+  _fill = chunk.beg;
+  _cur = chunk.beg + size;
+  _end = chunk.beg + chunk.size;
+  return chunk.beg;
+}
+
+void ID3_Arena::_AddChunk(const Chunk& chunk)
+{
+  _chunks.insert(std::upper_bound(_chunks.begin(), _chunks.end(), chunk.beg,
+                                  ChunkBefore()), chunk);
+}
+
+/** Whether p was handed out by the arena: a binary search of its chunks.
+ **/
+bool ID3_Arena::Owns(const void* p) const
+{
+  const char* cp = static_cast<const char*>(p);
+  Chunks::const_iterator ci =
+    std::upper_bound(_chunks.begin(), _chunks.end(), cp, ChunkBefore());
+  if (ci == _chunks.begin())
+  {
+    return false;
+  }
+  --ci;
+  return cp < ci->beg + ci->size;
+}
+
+/** Takes back all the memory handed out by the arena.  The objects in it
+ ** must have been destroyed already.  The chunk being filled, which is the
+ ** largest of the regular ones, is kept for what comes next.
+ **/
+void ID3_Arena::Release()
+{
+  std::fill(_free, _free + NUM_FREE_LISTS, static_cast<void*>(NULL));
+  _used = 0;
+  _num_allocs = 0;
+  if (_chunks.empty())
+  {
+    return;
+  }
+  Chunk keep = { NULL, 0 };
+  for (Chunks::iterator ci = _chunks.begin(); ci != _chunks.end(); ++ci)
+  {
+    if (ci->beg == _fill)
+    {
+      keep = *ci;
+    }
+    else
+    {
+      ::operator delete(ci->beg);
+    }
+  }
+  _chunks.clear();
+  if (keep.beg != NULL)
+  {
+    _chunks.push_back(keep);
+  }
+  _cur = keep.beg;
+  _end = keep.beg + keep.size;
+}
+
+/** The bytes the arena holds from the heap, used or not.
+ **/
+size_t ID3_Arena::BytesReserved() const
+{
+  size_t size = 0;
+  for (Chunks::const_iterator ci = _chunks.begin(); ci != _chunks.end(); ++ci)
+  {
+    size += ci->size;
+  }
+  return size;
+}
@@ -0,0 +1,205 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_ARENA_H_
+#define _ID3LIB_ARENA_H_
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/** A monotonic buffer that hands out memory for the objects of one tag.
+ **
+ ** Memory is taken from large chunks by bumping a pointer.  A small block
+ ** that is given back, such as a frame or the list entry of a frame the
+ ** application removed, goes on a free list for the next object of its size;
+ ** larger ones are only reclaimed, all at once, by Release().  The largest
+ ** chunk is kept for the next tag, so a tag that is cleared and parsed over
+ ** and over soon stops calling malloc at all.
+ **
+ ** Whether memory should come from the arena is a matter for its owner, which
+ ** says so with SetEnabled().  The containers that may hold memory of either
+ ** kind ask IsEnabled() when they allocate, and Owns() when they deallocate.
+ **/
+class ID3_Arena
+{
+public:
+  ID3_Arena();
+  ~ID3_Arena();
+
+  void*  Allocate(size_t);
+  void   Deallocate(void*, size_t);
+  bool   Owns(const void*) const;
+  void   Release();
+
+  void   SetEnabled(bool b) { _enabled = b; }
+  bool   IsEnabled() const { return _enabled; }
+
+  size_t NumAllocations() const { return _num_allocs; }
+  size_t BytesUsed() const { return _used; }
+  size_t BytesReserved() const;
+
+private:
+  struct Chunk
+  {
+    char*  beg;
+    size_t size;
+  };
+  typedef std::vector<Chunk> Chunks;
+  // blocks of up to this many alignment units are kept on free lists
+  enum { NUM_FREE_LISTS = 16 };
+
+  void*  _NewChunk(size_t);
+  void   _AddChunk(const Chunk&);
+
+  Chunks _chunks;     // in order of address, for Owns()
+  char*  _fill;       // the chunk being filled
+  char*  _cur;        // and its free part
+  char*  _end;
+  void*  _free[NUM_FREE_LISTS]; // blocks given back, by size
+  size_t _used;       // bytes handed out and not given back
+  size_t _num_allocs; // and the number of objects they went to
+  bool   _enabled;    // should new objects be put in the arena?
+
+  ID3_Arena(const ID3_Arena&);
+  ID3_Arena& operator=(const ID3_Arena&);
+};
+
+/** Constructs an object in an arena: new (arena) T(...).  A NULL arena puts
+ ** the object on the heap, and it is then deleted as usual.
+ **/
+inline void* operator new(size_t size, ID3_Arena* arena)
+{
+  return (arena != NULL) ? arena->Allocate(size) : ::operator new(size);
+}
+
+// only called if a constructor throws
+inline void operator delete(void* p, ID3_Arena* arena)
+{
+  if (arena == NULL)
+  {
+    ::operator delete(p);
+  }
+}
+
+/** The arena new objects should be put in: the given one while it is enabled,
+ ** NULL (the heap) otherwise.
+ **/
+inline ID3_Arena* activeArena(ID3_Arena* arena)
+{
+  return (arena != NULL && arena->IsEnabled()) ? arena : NULL;
+}
+
+/** The bytes an object of the given size takes from the heap: none if it is
+ ** in the arena, whose memory is counted as a whole.
+ **/
+inline size_t heapSize(const ID3_Arena* arena, const void* p, size_t size)
+{
+  return (arena != NULL && arena->Owns(p)) ? 0 : size;
+}
+
+/** Destroys an object made with new (arena) T(...).  The object is deleted
+ ** unless the arena owns it, in which case it is destroyed and its memory
+ ** given back to the arena.
+ **/
+template <typename T>
+void arenaDelete(T* p, ID3_Arena* arena)
+{
+  if (arena != NULL && p != NULL && arena->Owns(p))
+  {
+    p->~T();
+    arena->Deallocate(p, sizeof(T));
+  }
+  else
+  {
+    delete p;
+  }
+}
+
+/** A standard allocator which takes its memory from an arena while the arena
+ ** is enabled, and from the heap otherwise (or when it has no arena).
+ **/
+template <typename T>
+class ID3_ArenaAllocator
+{
+public:
+  typedef T              value_type;
+  typedef T*             pointer;
+  typedef const T*       const_pointer;
+  typedef T&             reference;
+  typedef const T&       const_reference;
+  typedef size_t         size_type;
+  typedef ptrdiff_t      difference_type;
+  template <typename U> struct rebind { typedef ID3_ArenaAllocator<U> other; };
+
+  ID3_ArenaAllocator(ID3_Arena* arena = NULL) : _arena(arena) { ; }
+  template <typename U>
+  ID3_ArenaAllocator(const ID3_ArenaAllocator<U>& rhs) : _arena(rhs.arena()) { ; }
+
+  pointer allocate(size_type n, const void* = 0)
+  {
+    const size_t size = n * sizeof(T);
+    return static_cast<pointer>((_arena != NULL && _arena->IsEnabled())
+                                ? _arena->Allocate(size)
+                                : ::operator new(size));
+  }
+  void deallocate(pointer p, size_type n)
+  {
+    if (_arena == NULL || !_arena->Owns(p))
+    {
+      ::operator delete(p);
+    }
+    else
+    {
+      _arena->Deallocate(p, n * sizeof(T));
+    }
+  }
+
+  void construct(pointer p, const T& val) { new (static_cast<void*>(p)) T(val); }
+  void destroy(pointer p) { p->~T(); }
+  pointer address(reference r) const { return &r; }
+  const_pointer address(const_reference r) const { return &r; }
+  size_type max_size() const { return size_t(-1) / sizeof(T); }
+
+  ID3_Arena* arena() const { return _arena; }
+
+private:
+  ID3_Arena* _arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ID3_ArenaAllocator<T>& lhs, const ID3_ArenaAllocator<U>& rhs)
+{
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ID3_ArenaAllocator<T>& lhs, const ID3_ArenaAllocator<U>& rhs)
+{
+  return lhs.arena() != rhs.arena();
+}
+
+#endif /* _ID3LIB_ARENA_H_ */
@@ -0,0 +1,428 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <deque>
+#include <vector>
+#include "threads.h" // has "id3/utils.h" and <pthread.h> where there are threads
+#include "batch.h"
+
+using namespace dami;
+
+namespace
+{
+  struct Job
+  {
+    String     fileName;
+    ID3_BatchUpdater::EditFunc edit;
+    void*      data;
+    size_t     index;          // where the result goes
+    flags_t    link;           // the tags to link to
+    flags_t    update;         // the tags to update
+    bool       lazy;           // parse the tags lazily?
+  };
+
+  struct Result
+  {
+    ID3_Err    err;
+    flags_t    tags;           // what Update() returned
+  };
+
+  // Links the job's file, edits its tag and updates the file
+  Result run(const Job& job)
+  {
+    Result result = { ID3E_NoError, ID3TT_NONE };
+    try
+    {
+      ID3_Tag tag;
+      tag.SetLazyParsing(job.lazy);
+      tag.Link(job.fileName.c_str(), job.link);
+      result.err = tag.GetLastError();
+      if (result.err == ID3E_NoError &&
+          job.edit(tag, job.fileName.c_str(), job.data))
+      {
+        result.tags = tag.Update(job.update);
+        result.err = tag.GetLastError();
+      }
+    }
+    catch (...)
+    {
+      result.err = ID3E_EditFailed;
+    }
+    return result;
+  }
+};
+
+class ID3_BatchUpdaterImpl
+{
+public:
+  ID3_BatchUpdaterImpl(size_t workers);
+  ~ID3_BatchUpdaterImpl();
+
+  size_t     GetNumWorkers() const { return _num_workers; }
+  void       SetQueueSize(size_t size) { _queue_size = size > 0 ? size : 1; }
+  size_t     GetQueueSize() const { return _queue_size; }
+  void       SetTagTypes(flags_t link, flags_t update)
+  { _link_tags = link; _update_tags = update; }
+  void       SetLazyParsing(bool lazy) { _is_lazy = lazy; }
+
+  size_t     Add(const char* fileName, ID3_BatchUpdater::EditFunc, void*);
+  void       Wait();
+
+  size_t     NumJobs() const;
+  Result     GetResult(size_t job) const;
+  void       Clear();
+
+  void       Work();
+
+private:
+  void       _Start();
+
+  size_t     _num_workers;
+  size_t     _queue_size;      // jobs waiting for a worker, at most
+  flags_t    _link_tags;
+  flags_t    _update_tags;
+  bool       _is_lazy;
+  std::vector<Result> _results;
+#if defined ID3_WITH_THREADS
+  std::deque<Job> _queue;
+  std::vector<pthread_t> _threads;
+  bool       _closing;         // are the workers to finish once the queue is empty?
+  mutable pthread_mutex_t _lock; // guards all of the above
+  pthread_cond_t _queued;      // a job was queued, or the workers are to finish
+  pthread_cond_t _taken;       // a job was taken off the queue
+#endif
+};
+
+#if defined ID3_WITH_THREADS
+namespace
+{
+  void* work(void* impl)
+  {
+    static_cast<ID3_BatchUpdaterImpl*>(impl)->Work();
+    return NULL;
+  }
+};
+#endif
+
+ID3_BatchUpdaterImpl::ID3_BatchUpdaterImpl(size_t workers)
+  : _num_workers(workers > 0 ? workers : defaultWorkers()),
+    _queue_size(2 * _num_workers),
+    _link_tags(ID3TT_ALL),
+    _update_tags(ID3TT_ALL),
+    _is_lazy(false),
+    _results()
+{
+#if defined ID3_WITH_THREADS
+  _closing = false;
+  pthread_mutex_init(&_lock, NULL);
+  pthread_cond_init(&_queued, NULL);
+  pthread_cond_init(&_taken, NULL);
+#endif
+}
+
+ID3_BatchUpdaterImpl::~ID3_BatchUpdaterImpl()
+{
+  this->Wait();
+#if defined ID3_WITH_THREADS
+  pthread_cond_destroy(&_taken);
+  pthread_cond_destroy(&_queued);
+  pthread_mutex_destroy(&_lock);
+#endif
+}
+
+size_t ID3_BatchUpdaterImpl::Add(const char* fileName,
+                                 ID3_BatchUpdater::EditFunc edit, void* data)
+{
+  Job job;
+  job.fileName = fileName ? fileName : "";
+  job.edit = edit;
+  job.data = data;
+  job.link = _link_tags;
+  job.update = _update_tags;
+  job.lazy = _is_lazy;
+  const Result pending = { ID3E_NoError, ID3TT_NONE };
+#if defined ID3_WITH_THREADS
+  {
+    Locker locker(_lock);
+    job.index = _results.size();
+    _results.push_back(pending);
+    if (_threads.empty())
+    {
+      this->_Start();
+    }
+    if (!_threads.empty())
+    {
+      while (_queue.size() >= _queue_size)
+      {
+        pthread_cond_wait(&_taken, &_lock);
+      }
+      _queue.push_back(job);
+      pthread_cond_signal(&_queued);
+      return job.index;
+    }
+  }
+  // no worker could be started, so the job is done right away
+  const Result result = run(job);
+  Locker locker(_lock);
+  _results[job.index] = result;
+#else
+  job.index = _results.size();
+  _results.push_back(pending);
+  _results[job.index] = run(job);
+#endif
+  return job.index;
+}
+
+#if defined ID3_WITH_THREADS
+void ID3_BatchUpdaterImpl::_Start()
+{
+  _closing = false;
+  for (size_t i = 0; i < _num_workers; ++i)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, work, this) != 0)
+    {
+      ID3D_WARNING( "ID3_BatchUpdaterImpl::_Start(): started only " << i <<
+                    " workers" );
+      break;
+    }
+    _threads.push_back(thread);
+  }
+}
+
+void ID3_BatchUpdaterImpl::Work()
+{
+  Locker locker(_lock);
+  for (;;)
+  {
+    while (_queue.empty() && !_closing)
+    {
+      pthread_cond_wait(&_queued, &_lock);
+    }
+    if (_queue.empty())
+    {
+      break;
+    }
+    const Job job = _queue.front();
+    _queue.pop_front();
+    pthread_cond_signal(&_taken);
+
+    pthread_mutex_unlock(&_lock);
+    const Result result = run(job);
+    pthread_mutex_lock(&_lock);
+    _results[job.index] = result;
+  }
+}
+#endif
+
+void ID3_BatchUpdaterImpl::Wait()
+{
+#if defined ID3_WITH_THREADS
+  std::vector<pthread_t> threads;
+  {
+    Locker locker(_lock);
+    _closing = true;
+    pthread_cond_broadcast(&_queued);
+    threads.swap(_threads);
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+#endif
+}
+
+size_t ID3_BatchUpdaterImpl::NumJobs() const
+{
+#if defined ID3_WITH_THREADS
+  Locker locker(_lock);
+#endif
+  return _results.size();
+}
+
+Result ID3_BatchUpdaterImpl::GetResult(size_t job) const
+{
+#if defined ID3_WITH_THREADS
+  Locker locker(_lock);
+#endif
+  const Result none = { ID3E_NoData, ID3TT_NONE };
+  return job < _results.size() ? _results[job] : none;
+}
+
+void ID3_BatchUpdaterImpl::Clear()
+{
+  this->Wait();
+  _results.clear();
+}
+
+/** \class ID3_BatchUpdater batch.h id3/batch.h
+ ** \brief Links, edits and updates many files at once.
+ **
+ ** Each job added to the updater links an ID3_Tag to a file, hands the tag to
+ ** an edit function and updates the file, unless the edit function returns
+ ** false.  The jobs are run by a pool of worker threads, each with a tag of
+ ** its own, so the edit function must only use what is shared between jobs
+ ** in a thread-safe way.  id3lib has no state shared between tags that
+ ** isn't safe to use from several threads; in a debugging build, the
+ ** output of the threads is serialized.
+ **
+ ** Add() blocks while the queue of jobs waiting for a worker is full, so
+ ** no more than GetQueueSize() jobs wait and GetNumWorkers() tags are held
+ ** at any time, however many files are added.  The result of each job is
+ ** kept until Clear() is called.
+ **
+ ** \code
+ **   bool countPlay(ID3_Tag& tag, const char* fileName, void* data)
+ **   {
+ **     ID3_Frame* frame = tag.Find(ID3FID_PLAYCOUNTER);
+ **     if (frame == NULL)
+ **     {
+ **       return false;
+ **     }
+ **     ID3_Field* count = frame->GetField(ID3FN_COUNTER);
+ **     count->Set(count->Get() + 1);
+ **     return true;
+ **   }
+ **
+ **   ID3_BatchUpdater updater;
+ **   updater.SetTagTypes(ID3TT_ID3V2, ID3TT_ID3V2);
+ **   for (size_t i = 0; i < numFiles; ++i)
+ **   {
+ **     updater.Add(fileNames[i], countPlay);
+ **   }
+ **   updater.Wait();
+ **   for (size_t job = 0; job < updater.NumJobs(); ++job)
+ **   {
+ **     if (updater.GetResult(job) != ID3E_NoError)
+ **     {
+ **       // ...
+ **     }
+ **   }
+ ** \endcode
+ **
+ ** Where threads are not available, each job is run by Add() itself.
+ **/
+
+/** Creates an updater with the given number of worker threads.  By default
+ ** there are twice as many as there are processors, so that the disk is kept
+ ** busy while tags are being parsed and rendered.
+ **/
+ID3_BatchUpdater::ID3_BatchUpdater(size_t workers)
+  : _impl(new ID3_BatchUpdaterImpl(workers))
+{
+}
+
+/** Waits for the jobs that are still running. */
+ID3_BatchUpdater::~ID3_BatchUpdater()
+{
+  delete _impl;
+}
+
+size_t ID3_BatchUpdater::GetNumWorkers() const
+{
+  return _impl->GetNumWorkers();
+}
+
+/** Sets how many jobs may wait for a worker before Add() blocks.  By default,
+ ** twice as many as there are workers.
+ **/
+void ID3_BatchUpdater::SetQueueSize(size_t size)
+{
+  _impl->SetQueueSize(size);
+}
+
+size_t ID3_BatchUpdater::GetQueueSize() const
+{
+  return _impl->GetQueueSize();
+}
+
+/** Sets the tag types that the jobs added from now on link to and update.  By
+ ** default, they link to and update all types.
+ **
+ ** \param link The tag types passed to ID3_Tag::Link().
+ ** \param update The tag types passed to ID3_Tag::Update().
+ **/
+void ID3_BatchUpdater::SetTagTypes(flags_t link, flags_t update)
+{
+  _impl->SetTagTypes(link, update);
+}
+
+/** Sets whether the jobs added from now on parse their tags lazily.
+ ** \sa ID3_Tag::SetLazyParsing()
+ **/
+void ID3_BatchUpdater::SetLazyParsing(bool lazy)
+{
+  _impl->SetLazyParsing(lazy);
+}
+
+/** Queues a job for the file, and returns its number, by which its result is
+ ** told.  Once the file is linked, \c edit is called with the tag, the file
+ ** name and \c data, and the file is updated if it returns true.
+ **
+ ** \param fileName The file to update.
+ ** \param edit The function which edits the tag.
+ ** \param data Passed on to \c edit.
+ **/
+size_t ID3_BatchUpdater::Add(const char* fileName, EditFunc edit, void* data)
+{
+  return _impl->Add(fileName, edit, data);
+}
+
+/** Waits for all the jobs added so far to be done.  Jobs can be added
+ ** afterwards, which starts the workers anew.
+ **/
+void ID3_BatchUpdater::Wait()
+{
+  _impl->Wait();
+}
+
+size_t ID3_BatchUpdater::NumJobs() const
+{
+  return _impl->NumJobs();
+}
+
+/** Returns the error of the job: the last error of the tag after Link(), or
+ ** after Update() if the file was updated, or ID3E_EditFailed if the edit
+ ** threw an exception.  ID3E_NoError is returned for jobs which haven't been
+ ** done yet, and ID3E_NoData for jobs which don't exist.
+ **/
+ID3_Err ID3_BatchUpdater::GetResult(size_t job) const
+{
+  return _impl->GetResult(job).err;
+}
+
+/** Returns what ID3_Tag::Update() returned for the job, or ID3TT_NONE if the
+ ** file wasn't updated.
+ **/
+flags_t ID3_BatchUpdater::GetUpdatedTags(size_t job) const
+{
+  return _impl->GetResult(job).tags;
+}
+
+/** Waits for the jobs, and forgets their results. */
+void ID3_BatchUpdater::Clear()
+{
+  _impl->Clear();
+}
@@ -26,14 +26,55 @@
 // http://download.sourceforge.net/id3lib/
 
 //#include <string.h>
+#include <deque>
 #include "id3.h"
 #include "tag.h"
 #include "field.h"
+#include "batch.h"
+#include "scan.h"
 
 #if defined HAVE_CONFIG_H
 #include <config.h>
 #endif
 
+namespace
+{
+  // An edit given through the C interface, called by the C++ one
+  struct CEdit
+  {
+    ID3BatchEdit edit;
+    void* data;
+  };
+
+  bool editWithC(ID3_Tag& tag, const char* fileName, void* data)
+  {
+    const CEdit* edit = static_cast<const CEdit*>(data);
+    return edit->edit(reinterpret_cast<ID3Tag*>(&tag), fileName, edit->data);
+  }
+
+  // A result function given through the C interface, called by the C++ one
+  struct CResult
+  {
+    ID3ScanResult result;
+    void* data;
+  };
+
+  void resultToC(const char* fileName, const ID3_Tag& tag, ID3_Err err, void* data)
+  {
+    const CResult* result = static_cast<const CResult*>(data);
+    result->result(fileName, reinterpret_cast<const ID3Tag*>(&tag), err, result->data);
+  }
+
+  // Keeps the edits for as long as the jobs may call them
+  class CBatchUpdater : public ID3_BatchUpdater
+  {
+  public:
+    CBatchUpdater(size_t workers) : ID3_BatchUpdater(workers) { }
+    ~CBatchUpdater() { this->Wait(); }
+    std::deque<CEdit> edits;
+  };
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -656,6 +697,169 @@ extern "C"
     }
   }
 
+  // batch updater wrappers
+
+  ID3_C_EXPORT ID3BatchUpdater* CCONV
+  ID3BatchUpdater_New(size_t workers)
+  {
+    CBatchUpdater* batch = NULL;
+    ID3_CATCH(batch = new CBatchUpdater(workers));
+    return reinterpret_cast<ID3BatchUpdater*>(batch);
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_Delete(ID3BatchUpdater *batch)
+  {
+    if (batch)
+    {
+      ID3_CATCH(delete reinterpret_cast<CBatchUpdater*>(batch));
+    }
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_SetQueueSize(ID3BatchUpdater *batch, size_t size)
+  {
+    if (batch)
+    {
+      ID3_CATCH(reinterpret_cast<CBatchUpdater*>(batch)->SetQueueSize(size));
+    }
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_SetTagTypes(ID3BatchUpdater *batch, flags_t link, flags_t update)
+  {
+    if (batch)
+    {
+      ID3_CATCH(reinterpret_cast<CBatchUpdater*>(batch)->SetTagTypes(link, update));
+    }
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_SetLazyParsing(ID3BatchUpdater *batch, bool lazy)
+  {
+    if (batch)
+    {
+      ID3_CATCH(reinterpret_cast<CBatchUpdater*>(batch)->SetLazyParsing(lazy));
+    }
+  }
+
+  ID3_C_EXPORT size_t CCONV
+  ID3BatchUpdater_Add(ID3BatchUpdater *batch, const char *fileName,
+                      ID3BatchEdit edit, void *data)
+  {
+    size_t job = 0;
+    if (batch && edit)
+    {
+      CBatchUpdater* updater = reinterpret_cast<CBatchUpdater*>(batch);
+      CEdit cedit = { edit, data };
+      ID3_CATCH(updater->edits.push_back(cedit);
+                job = updater->Add(fileName, editWithC, &updater->edits.back()));
+    }
+    return job;
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_Wait(ID3BatchUpdater *batch)
+  {
+    if (batch)
+    {
+      ID3_CATCH(reinterpret_cast<CBatchUpdater*>(batch)->Wait());
+    }
+  }
+
+  ID3_C_EXPORT size_t CCONV
+  ID3BatchUpdater_NumJobs(const ID3BatchUpdater *batch)
+  {
+    size_t num = 0;
+    if (batch)
+    {
+      ID3_CATCH(num = reinterpret_cast<const CBatchUpdater*>(batch)->NumJobs());
+    }
+    return num;
+  }
+
+  ID3_C_EXPORT ID3_Err CCONV
+  ID3BatchUpdater_GetResult(const ID3BatchUpdater *batch, size_t job)
+  {
+    ID3_Err err = ID3E_NoData;
+    if (batch)
+    {
+      ID3_CATCH(err = reinterpret_cast<const CBatchUpdater*>(batch)->GetResult(job));
+    }
+    return err;
+  }
+
+  ID3_C_EXPORT flags_t CCONV
+  ID3BatchUpdater_GetUpdatedTags(const ID3BatchUpdater *batch, size_t job)
+  {
+    flags_t tags = ID3TT_NONE;
+    if (batch)
+    {
+      ID3_CATCH(tags = reinterpret_cast<const CBatchUpdater*>(batch)->GetUpdatedTags(job));
+    }
+    return tags;
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3BatchUpdater_Clear(ID3BatchUpdater *batch)
+  {
+    if (batch)
+    {
+      CBatchUpdater* updater = reinterpret_cast<CBatchUpdater*>(batch);
+      ID3_CATCH(updater->Clear(); updater->edits.clear());
+    }
+  }
+
+  // scanner wrappers
+
+  ID3_C_EXPORT ID3Scanner* CCONV
+  ID3Scanner_New(size_t workers)
+  {
+    ID3_Scanner* scanner = NULL;
+    ID3_CATCH(scanner = new ID3_Scanner(workers));
+    return reinterpret_cast<ID3Scanner*>(scanner);
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3Scanner_Delete(ID3Scanner *scanner)
+  {
+    if (scanner)
+    {
+      ID3_CATCH(delete reinterpret_cast<ID3_Scanner*>(scanner));
+    }
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3Scanner_SetTagTypes(ID3Scanner *scanner, flags_t types)
+  {
+    if (scanner)
+    {
+      ID3_CATCH(reinterpret_cast<ID3_Scanner*>(scanner)->SetTagTypes(types));
+    }
+  }
+
+  ID3_C_EXPORT void CCONV
+  ID3Scanner_SetLazyParsing(ID3Scanner *scanner, bool lazy)
+  {
+    if (scanner)
+    {
+      ID3_CATCH(reinterpret_cast<ID3_Scanner*>(scanner)->SetLazyParsing(lazy));
+    }
+  }
+
+  ID3_C_EXPORT size_t CCONV
+  ID3Scanner_Scan(ID3Scanner *scanner, const char *path, ID3ScanResult result,
+                  void *data)
+  {
+    size_t scanned = 0;
+    if (scanner && result)
+    {
+      CResult cresult = { result, data };
+      ID3_CATCH(scanned = reinterpret_cast<ID3_Scanner*>(scanner)->Scan(path, resultToC, &cresult));
+    }
+    return scanned;
+  }
+
   // field-info wrappers
 
   ID3_C_EXPORT char * CCONV
@@ -26,6 +26,7 @@
 // http://download.sourceforge.net/id3lib/
 
 
+#include <vector>
 #include "field_impl.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 #include "field_def.h"
@@ -1000,7 +1001,8 @@ static ID3_FieldDef ID3FD_CDM[] =
     ID3V2_2_1,                          // ENDING SPEC
     ID3FF_NONE,                         // FLAGS
     ID3FN_NOFIELD                       // LINKED FIELD
-  }
+  },
+  { ID3FN_NOFIELD }
 };
 
 static ID3_FieldDef ID3FD_SyncLyrics[] =
@@ -1477,44 +1479,44 @@ static  ID3_FrameDef ID3_FrameDefs[] =
  **/
 
 ID3_FieldImpl::ID3_FieldImpl()
-  : _id(ID3FN_NOFIELD),
-    _type(ID3FTY_INTEGER),
-    _spec_begin(ID3V2_EARLIEST),
-    _spec_end(ID3V2_LATEST),
-    _flags(0),
-    _linked_field(ID3FN_NOFIELD),
-    _changed(false),
-    _fixed_size(0),
+  : _def(ID3_FieldDef::DEFAULT),
+    _data(),
+    _fixed_size(_def->_fixed_size),
     _num_items(0),
-    _enc(ID3TE_NONE)
+    _items(NULL),
+    _enc(ID3TE_NONE),
+    _changed(false),
+    _utf8(false),
+    _unicode(NULL)
 {
   this->Clear();
 }
 
 ID3_FieldImpl::ID3_FieldImpl(const ID3_FieldDef& def)
-  : _id(def._id),
-    _type(def._type),
-    _spec_begin(def._spec_begin),
-    _spec_end(def._spec_end),
-    _flags(def._flags),
-    _linked_field(def._linked_field),
-    _changed(false),
+  : _def(&def),
+    _data(),
     _fixed_size(def._fixed_size),
     _num_items(0),
-    _enc((_type == ID3FTY_TEXTSTRING) ? ID3TE_ISO8859_1 : ID3TE_NONE)
+    _items(NULL),
+    _enc((def._type == ID3FTY_TEXTSTRING) ? ID3TE_ISO8859_1 : ID3TE_NONE),
+    _changed(false),
+    _utf8(false),
+    _unicode(NULL)
 {
   this->Clear();
 }
 
 ID3_FieldImpl::~ID3_FieldImpl()
 {
+  delete _unicode;
+  delete _items;
 }
 
 // returns whether field should be parsed, set's it's brand new fixed size
 bool ID3_FieldImpl::SetLinkedSize(size_t newfixedsize)
 {
   // check whether it has a fixed size flag and a _linked_field
-  if (this->HasFlag(ID3FF_HASLINKEDSIZE) && _linked_field != ID3FN_NOFIELD)
+  if (this->HasFlag(ID3FF_HASLINKEDSIZE) && this->GetLinkedField() != ID3FN_NOFIELD)
   {
     // check whether it has a fixed size flag and a _linked_field
     if (newfixedsize != 0)
@@ -1539,34 +1541,36 @@ bool ID3_FieldImpl::SetLinkedSize(size_t newfixedsize)
  **/
 void ID3_FieldImpl::Clear()
 {
-  switch (_type)
+  switch (this->GetType())
   {
     case ID3FTY_INTEGER:
     {
-      _integer = 0;
+      _data.SetInteger(0);
       break;
     }
     case ID3FTY_BINARY:
     {
-      _binary.erase();
+      _data.Erase();
       if (_fixed_size > 0)
       {
-        _binary.assign(_fixed_size, '\0');
+        _data.Assign(_fixed_size, '\0');
       }
       break;
     }
     case ID3FTY_TEXTSTRING:
     {
-      _text.erase();
+      _data.Erase();
+      this->ClearUnicodeText_i();
+      this->ClearTextItems_i();
       if (_fixed_size > 0)
       {
-        if (ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
+        if (ID3TE_IS_DOUBLE_BYTE_ENC(this->GetHeldEncoding()))
         {
-          _text.assign(_fixed_size * 2, '\0');
+          _data.Assign(_fixed_size * 2, '\0');
         }
-        else if (ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()))
+        else if (ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()))
         {
-          _text.assign(_fixed_size, '\0');
+          _data.Assign(_fixed_size, '\0');
         }
       }
       break;
@@ -1587,6 +1591,31 @@ ID3_FieldImpl::HasChanged() const
   return _changed;
 }
 
+/** The bytes of memory the field takes up, its value included.
+ **/
+size_t ID3_FieldImpl::GetMemoryFootprint() const
+{
+  return sizeof(*this) + this->HeapSize_i();
+}
+
+/** The bytes of heap the value of the field takes up: its data, the table of
+ ** its text items, and any UTF-16 copy of its text.
+ **/
+size_t ID3_FieldImpl::HeapSize_i() const
+{
+  size_t size = _data.HeapSize();
+  if (_items != NULL)
+  {
+    size += sizeof(*_items) + _items->capacity() * sizeof(uint32);
+  }
+  if (_unicode != NULL)
+  {
+    size += sizeof(*_unicode) + _unicode->text.HeapSize() +
+      _unicode->items.capacity() * sizeof(uint32);
+  }
+  return size;
+}
+
 /** \fn size_t ID3_Field::Size() const
  ** \brief Returns the size of a field.
  **
@@ -1607,20 +1636,45 @@ ID3_FieldImpl::HasChanged() const
  **/
 
 size_t ID3_FieldImpl::BinSize() const
+{
+  return this->BinSize_i(this->GetEncoding());
+}
+
+/** The encoding the field is rendered in when its frame's text encoding is
+ ** enc: enc itself if the field is encodable, as SetEncoding() would take it,
+ ** or the field's own encoding otherwise.
+ **/
+ID3_TextEnc ID3_FieldImpl::GetRenderEncoding_i(ID3_TextEnc enc) const
+{
+  if (this->IsEncodable() && ID3TE_NONE < enc && enc < ID3TE_NUMENCODINGS)
+  {
+    return enc;
+  }
+  return this->GetEncoding();
+}
+
+/** The size of the field when it is rendered with its text in enc, which
+ ** the field is left alone by.
+ **/
+size_t ID3_FieldImpl::BinSize_i(ID3_TextEnc enc) const
 {
   if (_fixed_size > 0)
   {
     return _fixed_size;
   }
   size_t size = this->Size();
-  if (_type == ID3FTY_TEXTSTRING)
+  if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    ID3_TextEnc enc = this->GetEncoding();
+    if (enc != this->GetHeldEncoding())
+    {
+      // the text is converted to the encoding it is rendered in
+      size = this->GetEncodedText_i(enc).size();
+    }
     if (ID3TE_IS_DOUBLE_BYTE_ENC(enc) && size > 0)
     {
       size++;
     }
-    if (_flags & ID3FF_CSTR)
+    if (this->HasFlag(ID3FF_CSTR))
     {
       size++;
     }
@@ -1641,17 +1695,13 @@ size_t ID3_FieldImpl::Size() const
   {
     size = _fixed_size;
   }
-  else if (_type == ID3FTY_INTEGER)
+  else if (this->GetType() == ID3FTY_INTEGER)
   {
     size = sizeof(uint32);
   }
-  else if (_type == ID3FTY_TEXTSTRING)
-  {
-    size = _text.size();
-  }
   else
   {
-    size = _binary.size();
+    size = _data.Size();
   }
 
   return size;
@@ -1689,43 +1739,229 @@ bool ID3_FieldImpl::Parse(ID3_Reader& reader)
   return success;
 }
 
-ID3_FrameDef* ID3_FindFrameDef(ID3_FrameID id)
+namespace
 {
-  ID3_FrameDef  *info   = NULL;
+  // Frame definitions are looked up for every frame that is parsed or
+  // created, so rather than scanning ID3_FrameDefs, the lookups go through
+  // two tables that are built from it the first time they are needed:
+  //
+  //  - a table indexed directly by ID3_FrameID, and
+  //  - a perfect hash over the 3 and 4 character text ids, packed into a
+  //    uint32.  The keys are spread over buckets, and each bucket gets a
+  //    displacement that sends all of its keys to free slots, so a lookup
+  //    hashes twice and compares a single slot ("hash and displace").
+  //
+  // The cost of a lookup therefore doesn't depend on the size of the table.
+  class FrameDefIndex
+  {
+   public:
+    FrameDefIndex();
+
+    ID3_FrameDef* find(ID3_FrameID id) const
+    {
+      return (id > ID3FID_NOFRAME && id < ID3FID_LASTFRAMEID) ? _by_id[id] : NULL;
+    }
+    ID3_FrameDef* find(const char* textID) const;
+
+   private:
+    enum
+    {
+      NUM_SLOTS   = 512,       // a power of two, well over twice the ids
+      NUM_BUCKETS = 128,
+      MAX_DISPLACEMENT = 0xFFFF
+    };
+
+    static uint32 pack(const char* textID);
+    static uint32 hash(uint32 key, uint32 seed)
+    {
+      key ^= seed * 0x9E3779B9u;
+      key ^= key >> 16;
+      key *= 0x85EBCA6Bu;
+      key ^= key >> 13;
+      key *= 0xC2B2AE35u;
+      key ^= key >> 16;
+      return key;
+    }
+    static size_t bucket(uint32 key) { return hash(key, 0) % NUM_BUCKETS; }
+    static size_t slot(uint32 key, uint32 displacement)
+    {
+      return hash(key, displacement + 1) & (NUM_SLOTS - 1);
+    }
+
+    bool place(const uint32 keys[], ID3_FrameDef* const defs[], size_t num);
+
+    ID3_FrameDef* _by_id[ID3FID_LASTFRAMEID];
+    uint32        _displacements[NUM_BUCKETS];
+    uint32        _keys[NUM_SLOTS];
+    ID3_FrameDef* _defs[NUM_SLOTS];
+  };
 
-  for (size_t cur = 0; ID3_FrameDefs[cur].eID != ID3FID_NOFRAME; cur++)
+  // Pack a 3 or 4 character text id into a uint32.  Frame ids never contain
+  // a '\0', so 3 and 4 character ids can't collide.  Returns 0 for anything
+  // else.
+  uint32 FrameDefIndex::pack(const char* textID)
   {
-    if (ID3_FrameDefs[cur].eID == id)
+    if (NULL == textID)
     {
-      info = &ID3_FrameDefs[cur];
-      break;
+      return 0;
     }
+    uint32 key = 0;
+    size_t len = 0;
+    for (; len < 5 && textID[len] != '\0'; ++len)
+    {
+      key = (key << 8) | static_cast<uchar>(textID[len]);
+    }
+    return (len == 3 || len == 4) ? key : 0;
   }
 
-  return info;
-}
+  FrameDefIndex::FrameDefIndex()
+  {
+    size_t i;
+    for (i = 0; i < ID3FID_LASTFRAMEID; ++i)
+    {
+      _by_id[i] = NULL;
+    }
+    for (i = 0; i < NUM_SLOTS; ++i)
+    {
+      _keys[i] = 0;
+      _defs[i] = NULL;
+    }
 
-ID3_FrameID
-ID3_FindFrameID(const char *id)
-{
-  ID3_FrameID fid = ID3FID_NOFRAME;
+    // gather the keys for each bucket.  The first definition for a given id
+    // wins, as it did with the linear search.
+    std::vector<uint32> keys[NUM_BUCKETS];
+    std::vector<ID3_FrameDef*> defs[NUM_BUCKETS];
+    for (ID3_FrameDef* def = ID3_FrameDefs; def->eID != ID3FID_NOFRAME; ++def)
+    {
+      if (_by_id[def->eID] == NULL)
+      {
+        _by_id[def->eID] = def;
+      }
+      const char* textIDs[] = { def->sShortTextID, def->sLongTextID };
+      for (size_t t = 0; t < 2; ++t)
+      {
+        uint32 key = pack(textIDs[t]);
+        if (key == 0)
+        {
+          continue;
+        }
+        size_t b = bucket(key);
+        bool seen = false;
+        for (size_t k = 0; k < keys[b].size() && !seen; ++k)
+        {
+          seen = (keys[b][k] == key);
+        }
+        if (!seen)
+        {
+          keys[b].push_back(key);
+          defs[b].push_back(def);
+        }
+      }
+    }
+
+    // place the buckets with the most keys first, while there's the most room
+    size_t maxSize = 0;
+    for (i = 0; i < NUM_BUCKETS; ++i)
+    {
+      _displacements[i] = 0;
+      maxSize = max(maxSize, keys[i].size());
+    }
+    for (size_t size = maxSize; size > 0; --size)
+    {
+      for (i = 0; i < NUM_BUCKETS; ++i)
+      {
+        if (keys[i].size() != size)
+        {
+          continue;
+        }
+        uint32 d = 0;
+        for (; d < MAX_DISPLACEMENT; ++d)
+        {
+          _displacements[i] = d;
+          if (this->place(&keys[i][0], &defs[i][0], size))
+          {
+            break;
+          }
+        }
+        if (d == MAX_DISPLACEMENT)
+        {
+          ID3D_WARNING( "FrameDefIndex: couldn't place bucket " << i );
+        }
+      }
+    }
+  }
 
-  for (size_t cur = 0; ID3_FrameDefs[cur].eID != ID3FID_NOFRAME; cur++)
+  // Try to put the keys of a bucket in free slots with the bucket's current
+  // displacement.  Nothing is changed if that isn't possible.
+  bool FrameDefIndex::place(const uint32 keys[], ID3_FrameDef* const defs[],
+                            size_t num)
   {
-    if (((strcmp(ID3_FrameDefs[cur].sShortTextID, id) == 0) &&
-         strlen(id) == 3) ||
-        ((strcmp(ID3_FrameDefs[cur].sLongTextID,  id) == 0) &&
-         strlen(id) == 4))
+    const uint32 d = _displacements[bucket(keys[0])];
+    size_t k;
+    for (k = 0; k < num; ++k)
     {
-      fid = ID3_FrameDefs[cur].eID;
-      break;
+      size_t s = slot(keys[k], d);
+      if (_keys[s] != 0)
+      {
+        return false;
+      }
+      for (size_t j = 0; j < k; ++j)
+      {
+        if (slot(keys[j], d) == s)
+        {
+          return false;
+        }
+      }
     }
+    for (k = 0; k < num; ++k)
+    {
+      size_t s = slot(keys[k], d);
+      _keys[s] = keys[k];
+      _defs[s] = defs[k];
+    }
+    return true;
   }
 
-  return fid;
+  ID3_FrameDef* FrameDefIndex::find(const char* textID) const
+  {
+    uint32 key = pack(textID);
+    if (key == 0)
+    {
+      return NULL;
+    }
+    size_t s = slot(key, _displacements[bucket(key)]);
+    return (_keys[s] == key) ? _defs[s] : NULL;
+  }
+
+  // Built by the first thread to look a frame definition up; the compiler
+  // has any others wait for it, so threads needn't build it before they start
+  const FrameDefIndex& frameDefIndex()
+  {
+    static const FrameDefIndex index;
+    return index;
+  }
+}
+
+ID3_FrameDef* ID3_FindFrameDef(ID3_FrameID id)
+{
+  return frameDefIndex().find(id);
+}
+
+ID3_FrameID
+ID3_FindFrameID(const char *id)
+{
+  const ID3_FrameDef* info = frameDefIndex().find(id);
+  return (info != NULL) ? info->eID : ID3FID_NOFRAME;
 }
 
 ID3_Err ID3_FieldImpl::Render(ID3_Writer& writer) const
+{
+  return this->Render_i(writer, this->GetEncoding());
+}
+
+/** Renders the field with its text in enc, which the field is left alone by.
+ **/
+ID3_Err ID3_FieldImpl::Render_i(ID3_Writer& writer, ID3_TextEnc enc) const
 {
   switch (this->GetType())
   {
@@ -1743,7 +1979,7 @@ ID3_Err ID3_FieldImpl::Render(ID3_Writer& writer) const
 
     case ID3FTY_TEXTSTRING:
     {
-      RenderText(writer);
+      RenderText(writer, enc);
       break;
     }
 
@@ -1772,12 +2008,40 @@ ID3_FieldImpl::operator=( const ID3_Field &rhs )
       case ID3FTY_TEXTSTRING:
       {
         this->SetEncoding(fld->GetEncoding());
-        this->SetText(fld->GetText());
+        // the copy shares the text, held the same way, until one of them
+        // changes it
+        if (_fixed_size == fld->_fixed_size && _enc == fld->_enc)
+        {
+          this->ClearUnicodeText_i();
+          _utf8 = fld->_utf8;
+          _data.Share(fld->_data);
+          _num_items = fld->_num_items;
+          this->ClearTextItems_i();
+          if (fld->_items != NULL)
+          {
+            _items = LEAKTESTNEW(ID3_TextItems(*fld->_items));
+          }
+          _changed = true;
+        }
+        else
+        {
+          const StringView text = fld->GetTextView();
+          this->SetText_i(text.data(), text.size());
+        }
         break;
       }
       case ID3FTY_BINARY:
       {
-        this->SetBinary(fld->GetBinary());
+        if (_fixed_size == fld->_fixed_size)
+        {
+          _data.Share(fld->_data);
+          _changed = true;
+        }
+        else
+        {
+          const BStringView data = fld->GetBinaryView();
+          this->SetBinary_i(data.data(), data.size());
+        }
         break;
       }
       default:
@@ -1795,13 +2059,51 @@ bool ID3_FieldImpl::SetEncoding(ID3_TextEnc enc)
     (ID3TE_NONE < enc && enc < ID3TE_NUMENCODINGS);
   if (changed)
   {
-    _text = convert(_text, _enc, enc);
+    // text held as UTF-8 stays that way, and is only converted when rendered
+    if (!_utf8)
+    {
+      this->ConvertText_i(_enc, enc);
+    }
     _enc = enc;
     _changed = true;
   }
   return changed;
 }
 
+/** Makes an encodable text field hold its text as UTF-8, whichever encoding
+ ** it is rendered in, or hold it in that encoding again.
+ **
+ ** While the text is held as UTF-8, SetEncoding() only changes the encoding
+ ** the text is rendered in.  GetRawText() and the other ASCII accessors give
+ ** the text as UTF-8, and Size() counts its bytes; the unicode accessors give
+ ** a UTF-16 copy of it, made the first time one of them is called.  Text the
+ ** field's encoding can't hold is lost when the field is rendered, so give a
+ ** frame with such text a unicode encoding.
+ **
+ ** This doesn't change the field as far as its rendering goes.
+ **/
+void ID3_FieldImpl::SetUtf8Text(bool utf8)
+{
+  if (this->GetType() != ID3FTY_TEXTSTRING || !this->IsEncodable() ||
+      utf8 == _utf8)
+  {
+    return;
+  }
+  if (_enc != ID3TE_UTF8)
+  {
+    if (utf8)
+    {
+      this->ConvertText_i(_enc, ID3TE_UTF8);
+    }
+    else
+    {
+      this->ConvertText_i(ID3TE_UTF8, _enc);
+    }
+  }
+  this->ClearUnicodeText_i();
+  _utf8 = utf8;
+}
+
 /** \class ID3_FrameInfo field.h id3/field.h
  ** \brief Provides information about the frame and field types supported by id3lib
  **
@@ -1864,7 +2166,7 @@ bool ID3_FieldImpl::SetEncoding(ID3_TextEnc enc)
 char *ID3_FrameInfo::ShortName(ID3_FrameID frameid)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID)
-    return ID3_FrameDefs[frameid-1].sShortTextID;
+    return ID3_FindFrameDef(frameid)->sShortTextID;
   else
     return NULL;
 }
@@ -1872,7 +2174,7 @@ char *ID3_FrameInfo::ShortName(ID3_FrameID frameid)
 char *ID3_FrameInfo::LongName(ID3_FrameID frameid)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID)
-    return ID3_FrameDefs[frameid-1].sLongTextID;
+    return ID3_FindFrameDef(frameid)->sLongTextID;
   else
     return NULL;
 }
@@ -1880,7 +2182,7 @@ char *ID3_FrameInfo::LongName(ID3_FrameID frameid)
 const char *ID3_FrameInfo::Description(ID3_FrameID frameid)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID)
-    return ID3_FrameDefs[frameid-1].sDescription;
+    return ID3_FindFrameDef(frameid)->sDescription;
   else
     return NULL;
 }
@@ -1895,7 +2197,7 @@ int ID3_FrameInfo::NumFields(ID3_FrameID frameid)
   int fieldnum=0;
 
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID)
-	while (ID3_FrameDefs[frameid-1].aeFieldDefs[fieldnum]._id != ID3FN_NOFIELD)
+	while (ID3_FindFrameDef(frameid)->aeFieldDefs[fieldnum]._id != ID3FN_NOFIELD)
 	{
 		fieldnum++;
 	}
@@ -1907,7 +2209,7 @@ ID3_FieldID ID3_FrameInfo::FieldID(ID3_FrameID frameid, int fieldnum)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID &&
      fieldnum < NumFields(frameid))
-  	return (ID3_FrameDefs[frameid-1].aeFieldDefs[fieldnum]._id);
+  	return (ID3_FindFrameDef(frameid)->aeFieldDefs[fieldnum]._id);
 
   return ID3FN_NOFIELD;
 }
@@ -1916,7 +2218,7 @@ ID3_FieldType ID3_FrameInfo::FieldType(ID3_FrameID frameid, int fieldnum)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID &&
      fieldnum < NumFields(frameid))
-  	return (ID3_FrameDefs[frameid-1].aeFieldDefs[fieldnum]._type);
+  	return (ID3_FindFrameDef(frameid)->aeFieldDefs[fieldnum]._type);
 
   return ID3FTY_NONE;
 }
@@ -1925,7 +2227,7 @@ size_t ID3_FrameInfo::FieldSize(ID3_FrameID frameid, int fieldnum)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID &&
      fieldnum < NumFields(frameid))
-  	return (ID3_FrameDefs[frameid-1].aeFieldDefs[fieldnum]._fixed_size);
+  	return (ID3_FindFrameDef(frameid)->aeFieldDefs[fieldnum]._fixed_size);
 
   return 0;
 }
@@ -1934,7 +2236,7 @@ flags_t ID3_FrameInfo::FieldFlags(ID3_FrameID frameid, int fieldnum)
 {
   if(frameid > ID3FID_NOFRAME && frameid < ID3FID_LASTFRAMEID &&
      fieldnum < NumFields(frameid))
-  	return (ID3_FrameDefs[frameid-1].aeFieldDefs[fieldnum]._flags);
+  	return (ID3_FindFrameDef(frameid)->aeFieldDefs[fieldnum]._flags);
 
   return ID3FF_NONE;
 }
@@ -42,8 +42,7 @@ size_t ID3_FieldImpl::Set(const uchar* data, size_t len)
   size_t size = 0;
   if (this->GetType() == ID3FTY_BINARY)
   {
-    BString str(data, len);
-    size = min(len, this->SetBinary(str));
+    size = min(len, this->SetBinary_i(data, len));
   }
   return size;
 }
@@ -53,30 +52,35 @@ size_t ID3_FieldImpl::Set(const uchar* data, size_t len)
  ** Again, like the string types, the binary Set() function copies the data
  ** so you may dispose of the source data after a call to this method.
  **/
-size_t ID3_FieldImpl::SetBinary(BString data) //< data to assign to this field.
+size_t ID3_FieldImpl::SetBinary(const BString& data) //< data to assign to this field.
 {
   size_t size = 0;
   if (this->GetType() == ID3FTY_BINARY)
   {
-    this->Clear();
-    size_t fixed = _fixed_size;
-    size = data.size();
-    if (fixed == 0)
-    {
-      _binary = data;
-    }
-    else
+    size = this->SetBinary_i(data.data(), data.size());
+  }
+  return size;
+}
+
+size_t ID3_FieldImpl::SetBinary_i(const uchar* data, size_t size)
+{
+  this->Clear();
+  const char* bytes = reinterpret_cast<const char*>(data);
+  size_t fixed = _fixed_size;
+  if (fixed == 0)
+  {
+    _data.Assign(bytes, size);
+  }
+  else
+  {
+    _data.Assign(bytes, min(size, fixed));
+    if (size < fixed)
     {
-      _binary.assign(data, 0, min(size, fixed));
-      if (size < fixed)
-      {
-        _binary.append(fixed - size, '\0');
-      }
+      _data.Append(fixed - size, '\0');
     }
-    size = _binary.size();
-    _changed = true;
   }
-  return size;
+  _changed = true;
+  return _data.Size();
 }
 
 BString ID3_FieldImpl::GetBinary() const
@@ -84,18 +88,30 @@ BString ID3_FieldImpl::GetBinary() const
   BString data;
   if (this->GetType() == ID3FTY_BINARY)
   {
-    data = _binary;
+    data.assign(this->GetRawBinary(), _data.Size());
   }
   return data;
 }
 
+/** Returns a view of the data of a binary field, without copying it.  The
+ ** view is only good until the data changes.
+ **/
+BStringView ID3_FieldImpl::GetBinaryView() const
+{
+  BStringView data;
+  if (this->GetType() == ID3FTY_BINARY)
+  {
+    data = BStringView(this->GetRawBinary(), _data.Size());
+  }
+  return data;
+}
 
 const uchar* ID3_FieldImpl::GetRawBinary() const
 {
   const uchar* data = NULL;
   if (this->GetType() == ID3FTY_BINARY)
   {
-    data = _binary.data();
+    data = reinterpret_cast<const uchar*>(_data.Data());
   }
   return data;
 }
@@ -121,7 +137,7 @@ size_t ID3_FieldImpl::Get(uchar *buffer,    //< Destination of retrieved string
     bytes = min(max_bytes, this->Size());
     if (NULL != buffer && bytes > 0)
     {
-      ::memcpy(buffer, _binary.data(), bytes);
+      ::memcpy(buffer, _data.Data(), bytes);
     }
   }
   return bytes;
@@ -184,7 +200,7 @@ void ID3_FieldImpl::ToFile(const char *info //< Destination filename
     FILE* temp_file = ::fopen(info, "wb");
     if (temp_file != NULL)
     {
-      ::fwrite(_binary.data(), 1, size, temp_file);
+      ::fwrite(_data.Data(), 1, size, temp_file);
       ::fclose(temp_file);
     }
   }
@@ -196,8 +212,18 @@ void ID3_FieldImpl::ToFile(const char *info //< Destination filename
 bool ID3_FieldImpl::ParseBinary(ID3_Reader& reader)
 {
   // copy the remaining bytes, unless we're fixed length, in which case copy
-  // the minimum of the remaining bytes vs. the fixed length
-  _binary = io::readAllBinary(reader);
+  // the minimum of the remaining bytes vs. the fixed length.  The bytes are
+  // read straight into the field.
+  const size_t size = reader.remainingBytes();
+  _data.Erase();
+  char* data = _data.Resize(size);
+  size_t numRead = 0;
+  while (numRead < size && !reader.atEnd())
+  {
+    numRead += reader.readChars(data + numRead, size - numRead);
+  }
+  _data.Resize(numRead);
+  _changed = false;
   return true;
 }
 
@@ -29,12 +29,28 @@
 #ifndef _ID3LIB_FIELD_IMPL_H_
 #define _ID3LIB_FIELD_IMPL_H_
 
+#include <vector>
 #include "field.h"
 #include "id3lib_frame.h"
+#include "field_def.h"
+#include "field_storage.h"
 
 struct ID3_FieldDef;
 struct ID3_FrameDef;
 
+/** Where each item of a text list after the first starts, in bytes from the
+ ** start of the text.
+ **/
+typedef std::vector<uint32> ID3_TextItems;
+
+/** The UTF-16 copy of text held as UTF-8, and where its items start.
+ **/
+struct ID3_UnicodeText
+{
+  ID3_FieldStorage text;
+  ID3_TextItems    items;
+};
+
 class ID3_FieldImpl : public ID3_Field
 {
   friend class ID3_FrameImpl;
@@ -66,8 +82,9 @@ public:
 
   dami::String  GetText() const;
   dami::String  GetTextItem(size_t) const;
-  size_t        SetText(dami::String);
-  size_t        AddText(dami::String);
+  size_t        SetText(const dami::String&);
+  size_t        AddText(const dami::String&);
+  dami::StringView GetTextView() const;
 
   // Unicode string field functions
   ID3_Field&    operator= (const unicode_t* s) { this->Set(s); return *this; }
@@ -78,6 +95,8 @@ public:
   const unicode_t* GetRawUnicodeText() const;
   const unicode_t* GetRawUnicodeTextItem(size_t) const;
 
+  ID3_Field::ItemIterator* CreateItemIterator() const;
+
   // binary field functions
   size_t        Set(const uchar* buf, size_t size);
   size_t        Set(const char* buf, size_t size)
@@ -89,56 +108,77 @@ public:
   void          FromFile(const char*);
   void          ToFile(const char *sInfo) const;
 
-  size_t        SetBinary(dami::BString);
+  size_t        SetBinary(const dami::BString&);
   dami::BString GetBinary() const;
+  dami::BStringView GetBinaryView() const;
 
   // miscelaneous functions
   ID3_Field&    operator=( const ID3_Field & );
   bool          InScope(ID3_V2Spec spec) const
-  { return _spec_begin <= spec && spec <= _spec_end; }
+  { return _def->_spec_begin <= spec && spec <= _def->_spec_end; }
 
-  ID3_FieldID   GetID() const { return _id; }
-  ID3_FieldID   GetLinkedField() const { return _linked_field; }
-  ID3_FieldType GetType() const { return _type; }
+  ID3_FieldID   GetID() const { return _def->_id; }
+  ID3_FieldID   GetLinkedField() const { return _def->_linked_field; }
+  ID3_FieldType GetType() const { return _def->_type; }
   bool          SetEncoding(ID3_TextEnc enc);
   bool          SetLinkedSize(size_t newfixedsize);
   bool          HasFixedSize() { return _fixed_size != 0; };
   ID3_TextEnc   GetEncoding() const { return _enc; }
 
-  bool          HasFlag(const flags_t flag) const { return (_flags & flag) == flag; }
+  bool          HasFlag(const flags_t flag) const { return (_def->_flags & flag) == flag; }
   bool          IsEncodable() const { return this->HasFlag(ID3FF_ENCODABLE); }
 
   ID3_Err       Render(ID3_Writer&) const;
   bool          Parse(ID3_Reader&);
   bool          HasChanged() const;
 
+  size_t        GetMemoryFootprint() const;
+
+  void          SetUtf8Text(bool);
+  bool          GetUtf8Text() const { return _utf8; }
+  ID3_TextEnc   GetHeldEncoding() const { return _utf8 ? ID3TE_UTF8 : _enc; }
+
 private:
-  size_t        SetText_i(dami::String);
-  size_t        AddText_i(dami::String);
+  size_t        SetText_i(const char*, size_t);
+  size_t        AddText_i(const char*, size_t);
+  size_t        SetBinary_i(const uchar*, size_t);
+  dami::String  GetEncodedText_i(ID3_TextEnc) const;
+  ID3_TextEnc   GetRenderEncoding_i(ID3_TextEnc) const;
+  size_t        BinSize_i(ID3_TextEnc) const;
+  ID3_Err       Render_i(ID3_Writer&, ID3_TextEnc) const;
+  const ID3_FieldStorage* GetUnicodeText_i(const ID3_TextItems** = NULL) const;
+  void          ClearUnicodeText_i();
+  void          ClearTextItems_i();
+  void          IndexTextItems_i();
+  void          ConvertText_i(ID3_TextEnc, ID3_TextEnc);
+  size_t        HeapSize_i() const;
+
+  static size_t ItemStart(const ID3_TextItems* items, size_t index)
+  { return (index == 0) ? 0 : (*items)[index - 1]; }
+  static void   ConvertItems(const ID3_FieldStorage&, const ID3_TextItems*,
+                             ID3_TextEnc, ID3_TextEnc,
+                             dami::String&, ID3_TextItems&);
 
 private:
   // To prevent public instantiation, the constructor is made private
   ID3_FieldImpl();
   ID3_FieldImpl(const ID3_FieldDef&);
 
-  const ID3_FieldID   _id;          // the ID of this field
-  const ID3_FieldType _type;        // what type is this field or should be
-  const ID3_V2Spec    _spec_begin;  // spec end
-  const ID3_V2Spec    _spec_end;    // spec begin
-  const flags_t       _flags;       // special field flags
-  const ID3_FieldID   _linked_field;    // the ID of field where fixed size comes from
-  mutable bool        _changed;     // field changed since last parse/render?
-
-  dami::BString       _binary;      // for binary strings
-  dami::String        _text;        // for ascii strings
-  uint32              _integer;     // for numbers
+  const ID3_FieldDef* _def;         // the ID, type, spec and flags of the field
+  ID3_FieldStorage    _data;        // the number, text or binary data
 
-  size_t              _fixed_size;  // for fixed length fields (0 if not)
-  size_t              _num_items;   // the number of items in the text string
+  uint32              _fixed_size;  // for fixed length fields (0 if not)
+  uint32              _num_items;   // the number of items in the text string
+  ID3_TextItems*      _items;       // where items after the first start, or
+                                    // NULL when there are fewer than two
   ID3_TextEnc         _enc;         // encoding for text fields
+  bool                _changed;     // field changed since last parse/update?
+  bool                _utf8;        // text held as UTF-8, whatever _enc is?
+  mutable ID3_UnicodeText* _unicode; // UTF-16 copy of UTF-8 text, made
+                                    // when first asked for
 protected:
   void RenderInteger(ID3_Writer&) const;
-  void RenderText(ID3_Writer&) const;
+  void RenderText(ID3_Writer&, ID3_TextEnc) const;
   void RenderBinary(ID3_Writer&) const;
 
   bool ParseInteger(ID3_Reader&);
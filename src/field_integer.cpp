@@ -56,7 +56,7 @@ void ID3_FieldImpl::SetInteger(uint32 val)
   {
     this->Clear();
 
-    _integer = val;
+    _data.SetInteger(val);
     _changed = true;
   }
 }
@@ -80,7 +80,7 @@ uint32 ID3_FieldImpl::GetInteger() const
   uint32 val = 0;
   if (this->GetType() == ID3FTY_INTEGER)
   {
-    val = _integer;
+    val = _data.GetInteger();
   }
   return val;
 }
@@ -105,6 +105,6 @@ bool ID3_FieldImpl::ParseInteger(ID3_Reader& reader)
 
 void ID3_FieldImpl::RenderInteger(ID3_Writer& writer) const
 {
-  io::writeBENumber(writer, _integer, this->Size());
+  io::writeBENumber(writer, _data.GetInteger(), this->Size());
 }
 
@@ -0,0 +1,268 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <string.h>
+#include <new>
+#include "field_storage.h"
+
+#if !defined(__GNUC__) && defined(WIN32)
+#  include <windows.h>
+#endif
+
+namespace
+{
+  // the '\0's after the bytes of a value
+  const size_t NUM_NULS = 2;
+
+  // A payload is shared by the copies of a value, and copies are made by
+  // readers of a frame, so its count may change from several threads at once
+  long incrementRefs(volatile long& refs)
+  {
+#if defined(__GNUC__)
+    return __sync_add_and_fetch(&refs, 1);
+#elif defined(WIN32)
+    return InterlockedIncrement(&refs);
+#else
+    return ++refs;
+#endif
+  }
+
+  long decrementRefs(volatile long& refs)
+  {
+#if defined(__GNUC__)
+    return __sync_sub_and_fetch(&refs, 1);
+#elif defined(WIN32)
+    return InterlockedDecrement(&refs);
+#else
+    return --refs;
+#endif
+  }
+
+  void terminate(char* data, size_t size)
+  {
+    data[size] = '\0';
+    data[size + 1] = '\0';
+  }
+};
+
+struct ID3_FieldStorage::Payload
+{
+  volatile long refs;
+  size_t        capacity;
+
+  static Payload* New(size_t capacity)
+  {
+    void* mem = ::operator new(sizeof(Payload) + capacity + NUM_NULS);
+    Payload* payload = static_cast<Payload*>(mem);
+    payload->refs = 1;
+    payload->capacity = capacity;
+    return payload;
+  }
+
+  // the bytes follow the header
+  char* Data() { return reinterpret_cast<char*>(this + 1); }
+  bool  IsShared() const { return refs > 1; }
+  void  Acquire() { incrementRefs(refs); }
+  void  Release()
+  {
+    if (decrementRefs(refs) == 0)
+    {
+      ::operator delete(this);
+    }
+  }
+};
+
+ID3_FieldStorage::ID3_FieldStorage()
+  : _size(0),
+    _inline(true)
+{
+  ::memset(&_u, 0, sizeof(_u));
+}
+
+ID3_FieldStorage::~ID3_FieldStorage()
+{
+  this->_Release();
+}
+
+void ID3_FieldStorage::SetInteger(uint32 val)
+{
+  this->_Release();
+  _size = 0;
+  _u.integer = val;
+}
+
+/** The bytes of the value, followed by two '\0's.
+ **/
+const char* ID3_FieldStorage::Data() const
+{
+  return _inline ? _u.text : _u.payload->Data();
+}
+
+void ID3_FieldStorage::Assign(const char* data, size_t size)
+{
+  char* dest = this->_Reserve(size, false);
+  ::memcpy(dest, data, size);
+  _size = size;
+  terminate(dest, size);
+}
+
+void ID3_FieldStorage::Assign(size_t size, char ch)
+{
+  char* dest = this->_Reserve(size, false);
+  ::memset(dest, ch, size);
+  _size = size;
+  terminate(dest, size);
+}
+
+void ID3_FieldStorage::Append(const char* data, size_t size)
+{
+  const size_t oldSize = _size;
+  char* dest = this->_Reserve(oldSize + size, true);
+  ::memcpy(dest + oldSize, data, size);
+  _size = oldSize + size;
+  terminate(dest, _size);
+}
+
+void ID3_FieldStorage::Append(size_t size, char ch)
+{
+  const size_t oldSize = _size;
+  char* dest = this->_Reserve(oldSize + size, true);
+  ::memset(dest + oldSize, ch, size);
+  _size = oldSize + size;
+  terminate(dest, _size);
+}
+
+/** Changes the number of bytes in the value, keeping those that remain and
+ ** zeroing any new ones, and returns the bytes to be written to.
+ **/
+char* ID3_FieldStorage::Resize(size_t size)
+{
+  const size_t oldSize = _size;
+  char* dest = this->_Reserve(size, true);
+  if (size > oldSize)
+  {
+    ::memset(dest + oldSize, '\0', size - oldSize);
+  }
+  _size = size;
+  terminate(dest, size);
+  return dest;
+}
+
+void ID3_FieldStorage::Erase()
+{
+  this->_Release();
+  _size = 0;
+  terminate(_u.text, 0);
+}
+
+/** Gives this value the value of rhs.  A payload isn't copied but shared, up
+ ** to the moment one of the values sharing it is changed.
+ **/
+void ID3_FieldStorage::Share(const ID3_FieldStorage& rhs)
+{
+  if (this == &rhs)
+  {
+    return;
+  }
+  if (rhs._inline)
+  {
+    this->_Release();
+    ::memcpy(&_u, &rhs._u, sizeof(_u));
+  }
+  else
+  {
+    rhs._u.payload->Acquire();
+    this->_Release();
+    _u.payload = rhs._u.payload;
+    _inline = false;
+  }
+  _size = rhs._size;
+}
+
+/** The bytes the value holds on the heap.  A payload is counted in full by
+ ** each of the values which share it.
+ **/
+size_t ID3_FieldStorage::HeapSize() const
+{
+  return _inline ? 0 : sizeof(Payload) + _u.payload->capacity + NUM_NULS;
+}
+
+/** Makes room for size bytes which belong to this value alone, and returns
+ ** where they go.  The bytes already there are kept, as far as they fit, if
+ ** keep is set.  A payload is only made when the bytes don't fit inline, and
+ ** one that isn't shared is reused when it is large enough.  A value that
+ ** grows while keeping its bytes, as a text list does with each item, at
+ ** least doubles its capacity, so that building it takes linear time.
+ **/
+char* ID3_FieldStorage::_Reserve(size_t size, bool keep)
+{
+  const size_t kept = keep ? ((size < _size) ? size : _size) : 0;
+  const size_t capacity =
+    _inline ? static_cast<size_t>(INLINE_CAPACITY) : _u.payload->capacity;
+  size_t newCapacity = size;
+  if (keep && size > _size && 2 * capacity > size)
+  {
+    newCapacity = 2 * capacity;
+  }
+  if (_inline)
+  {
+    if (size <= INLINE_CAPACITY)
+    {
+      return _u.text;
+    }
+    Payload* payload = Payload::New(newCapacity);
+    ::memcpy(payload->Data(), _u.text, kept);
+    _u.payload = payload;
+    _inline = false;
+    return payload->Data();
+  }
+
+  Payload* old = _u.payload;
+  if (!old->IsShared() && size <= old->capacity)
+  {
+    return old->Data();
+  }
+  if (size <= INLINE_CAPACITY)
+  {
+    ::memcpy(_u.text, old->Data(), kept);
+    _inline = true;
+    old->Release();
+    return _u.text;
+  }
+  Payload* payload = Payload::New(newCapacity);
+  ::memcpy(payload->Data(), old->Data(), kept);
+  old->Release();
+  _u.payload = payload;
+  return payload->Data();
+}
+
+void ID3_FieldStorage::_Release()
+{
+  if (!_inline)
+  {
+    _u.payload->Release();
+    _inline = true;
+  }
+}
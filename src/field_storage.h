@@ -0,0 +1,88 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_FIELD_STORAGE_H_
+#define _ID3LIB_FIELD_STORAGE_H_
+
+#include <stddef.h>
+#include "id3/globals.h" //has <stdlib.h> "id3/sized_types.h"
+
+/** The value of a field: a number, or the bytes of a text or binary field.
+ **
+ ** A field only ever holds one kind of value, so the kinds share their
+ ** memory.  A number, or up to INLINE_CAPACITY bytes, is kept in the object
+ ** itself, which covers the text of most text frames.  Anything longer goes
+ ** in a payload on the heap, which copies of the value share until one of
+ ** them changes.
+ **
+ ** The bytes are always followed by two '\0's, so that single and double
+ ** byte text can be read straight out of Data() as a terminated string.
+ **/
+class ID3_FieldStorage
+{
+public:
+  enum { INLINE_CAPACITY = 22 };
+
+  ID3_FieldStorage();
+  ~ID3_FieldStorage();
+
+  uint32      GetInteger() const { return _u.integer; }
+  void        SetInteger(uint32);
+
+  const char* Data() const;
+  size_t      Size() const { return _size; }
+
+  void        Assign(const char*, size_t);
+  void        Assign(size_t, char);
+  void        Append(const char*, size_t);
+  void        Append(size_t, char);
+  char*       Resize(size_t);
+  void        Erase();
+  void        Share(const ID3_FieldStorage&);
+
+  size_t      HeapSize() const;
+
+private:
+  struct Payload;
+
+  char*       _Reserve(size_t size, bool keep);
+  void        _Release();
+
+  enum { INLINE_SIZE = INLINE_CAPACITY + 2 };
+  union
+  {
+    uint32    integer;
+    Payload*  payload;
+    char      text[INLINE_SIZE];
+  } _u;
+  uint32      _size;           // the number of bytes in the value
+  bool        _inline;         // are they in _u.text, or in _u.payload?
+
+  ID3_FieldStorage(const ID3_FieldStorage&);
+  ID3_FieldStorage& operator=(const ID3_FieldStorage&);
+};
+
+#endif /* _ID3LIB_FIELD_STORAGE_H_ */
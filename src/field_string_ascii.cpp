@@ -48,8 +48,7 @@ size_t ID3_FieldImpl::Set(const char* data)
   size_t len = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    String str(data);
-    len = this->SetText_i(str);
+    len = this->SetText_i(data, ::strlen(data));
   }
   return len;
 }
@@ -89,10 +88,10 @@ size_t ID3_FieldImpl::Get(char* buffer, size_t maxLength) const
 {
   size_t size = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()) &&
+      ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()) &&
       buffer != NULL && maxLength > 0)
   {
-    String data = this->GetText();
+    const StringView data = this->GetTextView();
     size = min(maxLength, data.size());
     ::memcpy(buffer, data.data(), size);
     if (size < maxLength)
@@ -108,12 +107,12 @@ size_t ID3_FieldImpl::Get(char* buf, size_t maxLen, size_t index) const
 {
   size_t size = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()) &&
+      ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()) &&
       buf != NULL && maxLen > 0)
   {
-    String data = this->GetTextItem(index);
-    size = min(maxLen, data.size());
-    ::memcpy(buf, data.data(), size);
+    const char* data = this->GetRawTextItem(index);
+    size = (NULL == data) ? 0 : min(maxLen, ::strlen(data));
+    ::memcpy(buf, data, size);
     if (size < maxLen)
     {
       buf[size] = '\0';
@@ -127,7 +126,25 @@ String ID3_FieldImpl::GetText() const
   String data;
   if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    data = _text;
+    data.assign(_data.Data(), _data.Size());
+  }
+  return data;
+}
+
+/** Returns a view of the text of the field, as it is held, without copying
+ ** it.  The view is only good until the text changes.
+ **
+ ** \code
+ **   dami::StringView title = myFrame.GetField(ID3FN_TEXT)->GetTextView();
+ **   cout.write(title.data(), title.size());
+ ** \endcode
+ **/
+StringView ID3_FieldImpl::GetTextView() const
+{
+  StringView data;
+  if (this->GetType() == ID3FTY_TEXTSTRING)
+  {
+    data = StringView(_data.Data(), _data.Size());
   }
   return data;
 }
@@ -136,7 +153,7 @@ String ID3_FieldImpl::GetTextItem(size_t index) const
 {
   String data;
   if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()))
+      ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()))
   {
     const char* raw = this->GetRawTextItem(index);
     if (raw != NULL)
@@ -147,35 +164,25 @@ String ID3_FieldImpl::GetTextItem(size_t index) const
   return data;
 }
 
-namespace
-{
-  String getFixed(String data, size_t size)
-  {
-    String text(data, 0, size);
-    if (text.size() < size)
-    {
-      text.append(size - text.size(), '\0');
-    }
-    return text;
-  }
-}
-
-
-size_t ID3_FieldImpl::SetText_i(String data)
+size_t ID3_FieldImpl::SetText_i(const char* data, size_t size)
 {
   this->Clear();
   if (_fixed_size > 0)
   {
-    _text = getFixed(data, _fixed_size);
+    _data.Assign(data, min(size, static_cast<size_t>(_fixed_size)));
+    if (size < _fixed_size)
+    {
+      _data.Append(_fixed_size - size, '\0');
+    }
   }
   else
   {
-    _text = data;
+    _data.Assign(data, size);
   }
-  ID3D_NOTICE( "SetText_i: text = \"" << _text << "\"" );
+  ID3D_NOTICE( "SetText_i: text = \"" << _data.Data() << "\"" );
   _changed = true;
 
-  if (_text.size() == 0)
+  if (_data.Size() == 0)
   {
     _num_items = 0;
   }
@@ -184,15 +191,15 @@ size_t ID3_FieldImpl::SetText_i(String data)
     _num_items = 1;
   }
 
-  return _text.size();
+  return _data.Size();
 }
 
-size_t ID3_FieldImpl::SetText(String data)
+size_t ID3_FieldImpl::SetText(const String& data)
 {
   size_t len = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    len = this->SetText_i(data);
+    len = this->SetText_i(data.data(), data.size());
   }
   return len;
 }
@@ -211,39 +218,42 @@ size_t ID3_FieldImpl::SetText(String data)
  **
  ** \param string The string to add to the field
  **/
-size_t ID3_FieldImpl::AddText_i(String data)
+size_t ID3_FieldImpl::AddText_i(const char* data, size_t size)
 {
   size_t len = 0;  // how much of str we copied into this field (max is strLen)
-  ID3D_NOTICE ("ID3_FieldImpl::AddText_i: Adding \"" << data << "\"" );
+  ID3D_NOTICE ("ID3_FieldImpl::AddText_i: Adding \"" << String(data, size) << "\"" );
   if (this->GetNumTextItems() == 0)
   {
     // there aren't any text items in the field so just assign the string to
     // the field
-    len = this->SetText_i(data);
+    len = this->SetText_i(data, size);
   }
   else
   {
 
     // ASSERT(_fixed_size == 0)
-    _text += '\0';
-    if (ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
+    const size_t sep = ID3TE_IS_DOUBLE_BYTE_ENC(this->GetHeldEncoding()) ? 2 : 1;
+    if (NULL == _items)
     {
-      _text += '\0';
+      _items = LEAKTESTNEW(ID3_TextItems);
     }
-    _text.append(data);
-    len = data.size();
+    _items->push_back(_data.Size() + sep);
+    _data.Append(sep, '\0');
+    _data.Append(data, size);
+    this->ClearUnicodeText_i();
+    len = size;
     _num_items++;
   }
 
   return len;
 }
 
-size_t ID3_FieldImpl::AddText(String data)
+size_t ID3_FieldImpl::AddText(const String& data)
 {
   size_t len = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    len = this->AddText_i(data);
+    len = this->AddText_i(data.data(), data.size());
   }
   return len;
 }
@@ -253,8 +263,7 @@ size_t ID3_FieldImpl::Add(const char* data)
   size_t len = 0;
   if (this->GetType() == ID3FTY_TEXTSTRING)
   {
-    String str(data);
-    len = this->AddText_i(str);
+    len = this->AddText_i(data, ::strlen(data));
   }
   return len;
 }
@@ -263,9 +272,9 @@ const char* ID3_FieldImpl::GetRawText() const
 {
   const char* text = NULL;
   if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()))
+      ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()))
   {
-    text = _text.c_str();
+    text = _data.Data();
   }
   return text;
 }
@@ -274,16 +283,153 @@ const char* ID3_FieldImpl::GetRawTextItem(size_t index) const
 {
   const char* text = NULL;
   if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_SINGLE_BYTE_ENC(this->GetEncoding()) &&
+      ID3TE_IS_SINGLE_BYTE_ENC(this->GetHeldEncoding()) &&
       index < this->GetNumTextItems())
   {
-    text = _text.c_str();
-    for (size_t i = 0; i < index; ++i)
+    text = _data.Data() + ItemStart(_items, index);
+  }
+  return text;
+}
+
+namespace
+{
+  class ItemIteratorImpl : public ID3_Field::ItemIterator
+  {
+    const ID3_Field& _field;
+    size_t           _cur;
+  public:
+    ItemIteratorImpl(const ID3_Field& field) : _field(field), _cur(0) { }
+
+    const char* GetNext()
+    {
+      const char* next = NULL;
+      if (_cur < _field.GetNumTextItems())
+      {
+        next = _field.GetRawTextItem(_cur++);
+      }
+      return next;
+    }
+
+    const unicode_t* GetNextUnicode()
+    {
+      const unicode_t* next = NULL;
+      if (_cur < _field.GetNumTextItems())
+      {
+        next = _field.GetRawUnicodeTextItem(_cur++);
+      }
+      return next;
+    }
+  };
+}
+
+/** Returns an iterator over the items of a text list, which gives each item
+ ** where it is in the field.  The items stay where they are until the text
+ ** changes, so don't change it while stepping through them.  Delete the
+ ** iterator when done with it.
+ **
+ ** \code
+ **   ID3_Field::ItemIterator* iter = myFrame.GetField(ID3FN_TEXT)->CreateItemIterator();
+ **   const char* item = NULL;
+ **   while (NULL != (item = iter->GetNext()))
+ **   {
+ **     // use item
+ **   }
+ **   delete iter;
+ ** \endcode
+ **/
+ID3_Field::ItemIterator* ID3_FieldImpl::CreateItemIterator() const
+{
+  return new ItemIteratorImpl(*this);
+}
+
+/** Forgets where the items of the text start, for text which has changed.
+ **/
+void ID3_FieldImpl::ClearTextItems_i()
+{
+  delete _items;
+  _items = NULL;
+}
+
+/** Finds the items of text read from a frame, which are separated by a
+ ** '\0' in the encoding the text is held in.  A '\0' which ends the text
+ ** only ends the last item.
+ **/
+void ID3_FieldImpl::IndexTextItems_i()
+{
+  this->ClearTextItems_i();
+  _num_items = (_data.Size() > 0) ? 1 : 0;
+  const bool wide = ID3TE_IS_DOUBLE_BYTE_ENC(this->GetHeldEncoding());
+  const size_t sep = wide ? 2 : 1;
+  const char* text = _data.Data();
+  const size_t size = _data.Size();
+  for (size_t i = 0; i + sep < size; i += sep)
+  {
+    if (text[i] == '\0' && (!wide || text[i + 1] == '\0'))
     {
-      text += strlen(text) + 1;
+      if (NULL == _items)
+      {
+        _items = LEAKTESTNEW(ID3_TextItems);
+      }
+      _items->push_back(i + sep);
+      _num_items++;
     }
   }
-  return text;
+}
+
+/** Converts text from one encoding to another an item at a time, so that
+ ** each item keeps to itself whatever becomes of the others, and works out
+ ** where the items start in the converted text.
+ **/
+void ID3_FieldImpl::ConvertItems(const ID3_FieldStorage& data,
+                                 const ID3_TextItems* items,
+                                 ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc,
+                                 String& text, ID3_TextItems& starts)
+{
+  text.erase();
+  starts.clear();
+  const size_t numItems = (NULL == items) ? 1 : items->size() + 1;
+  const size_t sourceSep = ID3TE_IS_DOUBLE_BYTE_ENC(sourceEnc) ? 2 : 1;
+  const size_t targetSep = ID3TE_IS_DOUBLE_BYTE_ENC(targetEnc) ? 2 : 1;
+  for (size_t i = 0; i < numItems; ++i)
+  {
+    const size_t beg = ItemStart(items, i);
+    const size_t end = (i + 1 < numItems) ? ItemStart(items, i + 1) - sourceSep
+                                          : data.Size();
+    const String item(data.Data() + beg, end - beg);
+    if (i > 0)
+    {
+      text.append(targetSep, '\0');
+      starts.push_back(text.size());
+    }
+    if (sourceEnc == targetEnc || item.empty())
+    {
+      text += item;
+    }
+    else
+    {
+      text += convert(item, sourceEnc, targetEnc);
+    }
+  }
+}
+
+/** Converts the text the field holds from one encoding to another, keeping
+ ** its items apart.
+ **/
+void ID3_FieldImpl::ConvertText_i(ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc)
+{
+  if (_data.Size() == 0)
+  {
+    return;
+  }
+  String text;
+  ID3_TextItems starts;
+  ConvertItems(_data, _items, sourceEnc, targetEnc, text, starts);
+  _data.Assign(text.data(), text.size());
+  if (_items != NULL)
+  {
+    _items->swap(starts);
+  }
+  this->ClearUnicodeText_i();
 }
 
 namespace
@@ -325,6 +471,16 @@ namespace
     else
       return io::writeUnicodeString(writer, data, true);
   }
+
+  // text read in enc, converted to UTF-8 for a field which holds it so
+  String heldText(const String& text, ID3_TextEnc enc, bool utf8)
+  {
+    if (!utf8 || enc == ID3TE_UTF8 || text.empty())
+    {
+      return text;
+    }
+    return convert(text, enc, ID3TE_UTF8);
+  }
 }
 
 bool ID3_FieldImpl::ParseText(ID3_Reader& reader)
@@ -359,19 +515,21 @@ bool ID3_FieldImpl::ParseText(ID3_Reader& reader)
 //      ID3D_NOTICE( "ID3_Field::ParseText(): adding string = " << text );
 //    }
 //  }
-  else if (_flags & ID3FF_CSTR)
+  else if (this->HasFlag(ID3FF_CSTR))
   {
     ID3D_NOTICE( "ID3_Field::ParseText(): null terminated string" );
-    String text = readEncodedString(reader, enc);
+    String text = heldText(readEncodedString(reader, enc), enc, _utf8);
     this->SetText(text);
     ID3D_NOTICE( "ID3_Field::ParseText(): null terminated string = " << text );
   }
   else
   {
     ID3D_NOTICE( "ID3_Field::ParseText(): last field string" );
-    String text = readEncodedText(reader, reader.remainingBytes(), enc);
+    String text = heldText(readEncodedText(reader, reader.remainingBytes(), enc),
+                           enc, _utf8);
     // not null terminated.
     this->AddText(text);
+    this->IndexTextItems_i();
     ID3D_NOTICE( "ID3_Field::ParseText(): last field string = " << text );
   }
 
@@ -379,21 +537,32 @@ bool ID3_FieldImpl::ParseText(ID3_Reader& reader)
   return true;
 }
 
-void ID3_FieldImpl::RenderText(ID3_Writer& writer) const
+void ID3_FieldImpl::RenderText(ID3_Writer& writer, ID3_TextEnc enc) const
 {
-  ID3_TextEnc enc = this->GetEncoding();
-
-  if (_flags & ID3FF_CSTR)
+  String text = this->GetEncodedText_i(enc);
+  if (this->HasFlag(ID3FF_CSTR))
   {
-    writeEncodedString(writer, _text, enc);
+    writeEncodedString(writer, text, enc);
   }
   else
   {
-    writeEncodedText(writer, _text, enc);
+    writeEncodedText(writer, text, enc);
   }
-  _changed = false;
 };
 
+/** The text in the encoding it is rendered in, which text held in another
+ ** encoding, or as UTF-8, is converted to.
+ **/
+String ID3_FieldImpl::GetEncodedText_i(ID3_TextEnc enc) const
+{
+  String text(_data.Data(), _data.Size());
+  if (enc != this->GetHeldEncoding() && !text.empty())
+  {
+    text = convert(text, this->GetHeldEncoding(), enc);
+  }
+  return text;
+}
+
 /** Returns the number of items in a text list.
  **
  ** \code
@@ -29,8 +29,100 @@
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 #include "io_helpers.h"
 
+#if !defined(__GNUC__) && defined(WIN32)
+#  include <windows.h>
+#endif
+
 using namespace dami;
 
+namespace
+{
+  // The UTF-16 copy of text held as UTF-8 is made by readers of a frame,
+  // several of which may ask for it at once.  Each reads the copy through
+  // getCopy(), and one that finds none makes its own and offers it with
+  // putCopy(): the first copy to be put is kept, and the others are deleted.
+  ID3_UnicodeText* getCopy(ID3_UnicodeText** copy)
+  {
+#if defined(__GNUC__)
+    return __sync_val_compare_and_swap(copy, (ID3_UnicodeText*) NULL,
+                                       (ID3_UnicodeText*) NULL);
+#elif defined(WIN32)
+    return static_cast<ID3_UnicodeText*>(InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(copy), NULL, NULL));
+#else
+    return *copy;
+#endif
+  }
+
+  bool putCopy(ID3_UnicodeText** copy, ID3_UnicodeText* mine)
+  {
+#if defined(__GNUC__)
+    return __sync_bool_compare_and_swap(copy, (ID3_UnicodeText*) NULL, mine);
+#elif defined(WIN32)
+    return NULL == InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(copy), mine, NULL);
+#else
+    *copy = mine;
+    return true;
+#endif
+  }
+};
+
+/** The text as the unicode accessors give it: big endian UTF-16, followed by
+ ** a unicode '\0'.  That is the text itself when the field holds UTF-16, and
+ ** a copy of it when the field holds UTF-8.  NULL for any other field.
+ ** Where the items of the text start is put in items, if asked for.
+ **/
+const ID3_FieldStorage* ID3_FieldImpl::GetUnicodeText_i(const ID3_TextItems** items) const
+{
+  if (this->GetType() != ID3FTY_TEXTSTRING)
+  {
+    return NULL;
+  }
+  if (!_utf8)
+  {
+    if (items != NULL)
+    {
+      *items = _items;
+    }
+    return ID3TE_IS_DOUBLE_BYTE_ENC(_enc) ? &_data : NULL;
+  }
+  ID3_UnicodeText* copy = getCopy(&_unicode);
+  if (NULL == copy)
+  {
+    String text;
+    ID3_UnicodeText* mine = LEAKTESTNEW(ID3_UnicodeText);
+    if (_data.Size() > 0)
+    {
+      ConvertItems(_data, _items, ID3TE_UTF8, ID3TE_UTF16BE, text, mine->items);
+    }
+    mine->text.Assign(text.data(), text.size());
+    if (putCopy(&_unicode, mine))
+    {
+      copy = mine;
+    }
+    else
+    {
+      delete mine;
+      copy = getCopy(&_unicode);
+    }
+  }
+  if (items != NULL)
+  {
+    *items = copy->items.empty() ? NULL : &copy->items;
+  }
+  return &copy->text;
+}
+
+/** Drops the UTF-16 copy of the text, which is made again when next asked
+ ** for.  Called whenever the text changes.
+ **/
+void ID3_FieldImpl::ClearUnicodeText_i()
+{
+  delete _unicode;
+  _unicode = NULL;
+}
+
 /** \fn ID3_Field& ID3_Field::operator=(const unicode_t*)
  ** \brief Shortcut for the Set operator.
  ** Performs similarly as operator=(const char*), taking a unicode_t
@@ -50,11 +142,16 @@ using namespace dami;
 size_t ID3_FieldImpl::Set(const unicode_t* data)
 {
   size_t size = 0;
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
+  if (this->GetType() == ID3FTY_TEXTSTRING && _utf8)
+  {
+    const String text = convert(String((const char*) data, ucslen(data) * 2),
+                                ID3TE_UTF16BE, ID3TE_UTF8);
+    size = this->SetText_i(text.data(), text.size());
+  }
+  else if (this->GetType() == ID3FTY_TEXTSTRING &&
       ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
   {
-    String text((const char*) data, ucslen(data) * 2);
-    size = this->SetText_i(text);
+    size = this->SetText_i((const char*) data, ucslen(data) * 2);
   }
   return size;
 }
@@ -62,11 +159,16 @@ size_t ID3_FieldImpl::Set(const unicode_t* data)
 size_t ID3_FieldImpl::Add(const unicode_t* data)
 {
   size_t size = 0;
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
+  if (this->GetType() == ID3FTY_TEXTSTRING && _utf8)
+  {
+    const String text = convert(String((const char*) data, ucslen(data) * 2),
+                                ID3TE_UTF16BE, ID3TE_UTF8);
+    size = this->AddText_i(text.data(), text.size());
+  }
+  else if (this->GetType() == ID3FTY_TEXTSTRING &&
       ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
   {
-    String text((const char*) data, ucslen(data) * 2);
-    size = this->AddText_i(text);
+    size = this->AddText_i((const char*) data, ucslen(data) * 2);
   }
   return size;
 }
@@ -94,13 +196,13 @@ size_t ID3_FieldImpl::Add(const unicode_t* data)
 size_t ID3_FieldImpl::Get(unicode_t *buffer, size_t maxLength) const
 {
   size_t length = 0;
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
-    ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) &&
-    buffer != NULL && maxLength > 0)
+  const ID3_FieldStorage* text = this->GetUnicodeText_i();
+  if (text != NULL && buffer != NULL && maxLength > 0)
   {
-    size_t size = this->Size();
+    // the text is held as bytes, two to a character
+    size_t size = text->Size() / 2;
     length = min(maxLength, size);
-    ::memcpy((void *)buffer, (void *)_text.data(), length * 2);
+    ::memcpy((void *)buffer, (const void *)text->Data(), length * 2);
     if (length < maxLength)
     {
       buffer[length] = NULL_UNICODE;
@@ -112,10 +214,10 @@ size_t ID3_FieldImpl::Get(unicode_t *buffer, size_t maxLength) const
 const unicode_t* ID3_FieldImpl::GetRawUnicodeText() const
 {
   const unicode_t* text = NULL;
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
+  const ID3_FieldStorage* unicode = this->GetUnicodeText_i();
+  if (unicode != NULL)
   {
-    text = (unicode_t *)_text.data();
+    text = (const unicode_t *)unicode->Data();
   }
   return text;
 }
@@ -123,16 +225,12 @@ const unicode_t* ID3_FieldImpl::GetRawUnicodeText() const
 const unicode_t* ID3_FieldImpl::GetRawUnicodeTextItem(size_t index) const
 {
   const unicode_t* text = NULL;
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) &&
-      index < this->GetNumTextItems())
+  const ID3_TextItems* items = NULL;
+  const ID3_FieldStorage* unicode = this->GetUnicodeText_i(&items);
+  if (unicode != NULL && index < this->GetNumTextItems())
   {
-    String unicode = _text + '\0' + '\0';
-    text = (unicode_t *) unicode.data();
-    for (size_t i = 0; i < index; ++i)
-    {
-      text += ucslen(text) + 1;
-    }
+    // the text is followed by a unicode '\0', which ends the last item
+    text = (const unicode_t *)(unicode->Data() + ItemStart(items, index));
   }
   return text;
 }
@@ -141,8 +239,7 @@ size_t ID3_FieldImpl::Get(unicode_t *buffer, size_t maxLength, size_t itemNum) c
 {
   size_t length = 0;
   size_t total_items = this->GetNumTextItems();
-  if (this->GetType() == ID3FTY_TEXTSTRING &&
-      ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) &&
+  if (this->GetUnicodeText_i() != NULL &&
       buffer != NULL && maxLength > 0 && itemNum < total_items)
   {
     const unicode_t* text = this->GetRawUnicodeTextItem(itemNum);
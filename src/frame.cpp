@@ -69,9 +69,15 @@ ID3_Frame::ID3_Frame(const ID3_Frame& frame)
 {
 }
 
+// the frames a tag parses into its arena
+ID3_Frame::ID3_Frame(ID3_FrameImpl* impl)
+  : _impl(impl)
+{
+}
+
 ID3_Frame::~ID3_Frame()
 {
-  delete _impl;
+  ID3_FrameImpl::Delete(_impl);
 }
 
 /** Clears the frame of all data and resets the frame such that it can take
@@ -36,12 +36,24 @@
 #include "frame_def.h"
 #include "field_def.h"
 
-ID3_FrameImpl::ID3_FrameImpl(ID3_FrameID id)
+ID3_FrameImpl::ID3_FrameImpl(ID3_FrameID id, ID3_Arena* arena)
   : _changed(false),
     _bitset(),
-    _fields(),
+    _fields(Fields::allocator_type(arena)),
     _encryption_id('\0'),
-    _grouping_id('\0')
+    _grouping_id('\0'),
+    _index_flag(NULL),
+    _arena(arena),
+    _raw(NULL),
+    _raw_beg(0),
+    _raw_fields(0),
+    _raw_end(0),
+    _raw_orig_size(0),
+    _raw_spec(ID3V2_UNKNOWN),
+    _lazy(false),
+    _utf8_text(false),
+    _file_offset(0),
+    _file_size(0)
 {
   this->SetSpec(ID3V2_LATEST);
   this->SetID(id);
@@ -53,7 +65,19 @@ ID3_FrameImpl::ID3_FrameImpl(const ID3_FrameHeader &hdr)
     _fields(),
     _hdr(hdr),
     _encryption_id('\0'),
-    _grouping_id('\0')
+    _grouping_id('\0'),
+    _index_flag(NULL),
+    _arena(NULL),
+    _raw(NULL),
+    _raw_beg(0),
+    _raw_fields(0),
+    _raw_end(0),
+    _raw_orig_size(0),
+    _raw_spec(ID3V2_UNKNOWN),
+    _lazy(false),
+    _utf8_text(false),
+    _file_offset(0),
+    _file_size(0)
 {
   this->_InitFields();
 }
@@ -63,7 +87,19 @@ ID3_FrameImpl::ID3_FrameImpl(const ID3_Frame& frame)
     _bitset(),
     _fields(),
     _encryption_id('\0'),
-    _grouping_id('\0')
+    _grouping_id('\0'),
+    _index_flag(NULL),
+    _arena(NULL),
+    _raw(NULL),
+    _raw_beg(0),
+    _raw_fields(0),
+    _raw_end(0),
+    _raw_orig_size(0),
+    _raw_spec(ID3V2_UNKNOWN),
+    _lazy(false),
+    _utf8_text(false),
+    _file_offset(0),
+    _file_size(0)
 {
   *this = frame;
 }
@@ -73,11 +109,47 @@ ID3_FrameImpl::~ID3_FrameImpl()
   Clear();
 }
 
+/** Makes a frame for a tag to parse into.  While the tag's arena is enabled,
+ ** the frame's implementation and fields are put in it; the ID3_Frame itself
+ ** stays on the heap, so that the frame can still be deleted as usual.
+ **/
+ID3_Frame* ID3_FrameImpl::NewFrame(ID3_Arena* arena)
+{
+  arena = activeArena(arena);
+  if (NULL == arena)
+  {
+    return LEAKTESTNEW(ID3_Frame);
+  }
+  return LEAKTESTNEW(ID3_Frame(new (arena) ID3_FrameImpl(ID3FID_NOFRAME, arena)));
+}
+
+/** Moves a frame which is leaving its tag out of the tag's arena, so that it
+ ** outlives the arena.
+ **/
+void ID3_FrameImpl::Detach(ID3_Frame& frame)
+{
+  if (NULL == frame._impl->_arena || !frame._impl->_arena->Owns(frame._impl))
+  {
+    return;
+  }
+  ID3_FrameImpl* impl = LEAKTESTNEW(ID3_FrameImpl(frame));
+  Delete(frame._impl);
+  frame._impl = impl;
+}
+
+void ID3_FrameImpl::Delete(ID3_FrameImpl* impl)
+{
+  if (impl != NULL)
+  {
+    arenaDelete(impl, impl->_arena);
+  }
+}
+
 bool ID3_FrameImpl::_ClearFields()
 {
   for (iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
   {
-    delete (ID3_FieldImpl*) *fi;
+    arenaDelete((ID3_FieldImpl*) *fi, _arena);
   }
 
   _fields.clear();
@@ -89,8 +161,11 @@ bool ID3_FrameImpl::_ClearFields()
 
 void ID3_FrameImpl::Clear()
 {
+  _lazy = false;
+  this->_ReleaseRaw();
   this->_ClearFields();
   _hdr.Clear();
+  this->_IDChanged();
   _encryption_id   = '\0';
   _grouping_id     = '\0';
 }
@@ -98,19 +173,26 @@ void ID3_FrameImpl::Clear()
 void ID3_FrameImpl::_InitFields()
 {
   const ID3_FrameDef* info = _hdr.GetFrameDef();
+  ID3_Arena* arena = activeArena(_arena);
   if (NULL == info)
   {
     // log this
-    ID3_Field* fld = LEAKTESTNEW( ID3_FieldImpl(ID3_FieldDef::DEFAULT[0]));
+    ID3_Field* fld = new (arena) ID3_FieldImpl(ID3_FieldDef::DEFAULT[0]);
     _fields.push_back(fld);
     _bitset.set(fld->GetID());
   }
   else
   {
-
-    for (size_t i = 0; info->aeFieldDefs[i]._id != ID3FN_NOFIELD; ++i)
+    size_t numFields = 0;
+    while (info->aeFieldDefs[numFields]._id != ID3FN_NOFIELD)
     {
-      ID3_Field* fld = LEAKTESTNEW(ID3_FieldImpl(info->aeFieldDefs[i]));
+      ++numFields;
+    }
+    _fields.reserve(numFields);
+    for (size_t i = 0; i < numFields; ++i)
+    {
+      ID3_FieldImpl* fld = new (arena) ID3_FieldImpl(info->aeFieldDefs[i]);
+      fld->SetUtf8Text(_utf8_text);
       _fields.push_back(fld);
       _bitset.set(fld->GetID());
     }
@@ -132,9 +214,12 @@ bool ID3_FrameImpl::SetID(ID3_FrameID id)
 
 bool ID3_FrameImpl::_SetID(ID3_FrameID id)
 {
+  _lazy = false;
+  this->_ReleaseRaw();
   bool changed = this->_ClearFields();
   changed = _hdr.SetFrameID(id) || changed;
   this->_InitFields();
+  this->_IDChanged();
   return changed;
 }
 
@@ -148,8 +233,71 @@ ID3_V2Spec ID3_FrameImpl::GetSpec() const
   return _hdr.GetSpec();
 }
 
+/** Makes the encodable text fields of the frame hold their text as UTF-8,
+ ** or hold it in the frame's encoding again (see
+ ** ID3_FieldImpl::SetUtf8Text()).  The fields of a lazily parsed frame are
+ ** decoded that way when they are first needed.
+ **/
+void ID3_FrameImpl::SetUtf8Text(bool utf8)
+{
+  _utf8_text = utf8;
+  if (_lazy)
+  {
+    return;
+  }
+  for (iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  {
+    static_cast<ID3_FieldImpl*>(*fi)->SetUtf8Text(utf8);
+  }
+}
+
+/** Sets the encodable fields of the frame to the encoding in its text
+ ** encoding field, which is what they are rendered in.  A frame put together
+ ** field by field can have text in other encodings; once synced, the frame
+ ** renders without anything being converted.  A lazily parsed frame's fields
+ ** are in its encoding already, and are left alone.
+ **/
+void ID3_FrameImpl::SyncEncoding()
+{
+  if (_lazy)
+  {
+    return;
+  }
+  ID3_TextEnc enc = ID3TE_ISO8859_1;
+  for (iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  {
+    ID3_Field* fld = *fi;
+    if (fld->GetID() == ID3FN_TEXTENC)
+    {
+      enc = static_cast<ID3_TextEnc>(fld->Get());
+    }
+    else
+    {
+      fld->SetEncoding(enc);
+    }
+  }
+}
+
+/** Marks the frame and its fields as they are in the file, once the tag has
+ ** been written.  Rendering the frame leaves this to the writer, since a
+ ** tag that many threads read mustn't be written to.
+ **/
+void ID3_FrameImpl::SetUnchanged()
+{
+  _changed = false;
+  if (_lazy)
+  {
+    return;
+  }
+  for (iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  {
+    static_cast<ID3_FieldImpl*>(*fi)->_changed = false;
+  }
+}
+
 ID3_Field* ID3_FrameImpl::GetField(ID3_FieldID fieldName) const
 {
+  this->_Decode();
   ID3_Field* field = NULL;
   if (this->Contains(fieldName))
   {
@@ -167,12 +315,29 @@ ID3_Field* ID3_FrameImpl::GetField(ID3_FieldID fieldName) const
 
 size_t ID3_FrameImpl::NumFields() const
 {
+  this->_Decode();
   return _fields.size();
 }
 
 size_t ID3_FrameImpl::Size()
 {
-  size_t bytesUsed = _hdr.Size();
+  return this->Size(this->GetSpec());
+}
+
+/** The size of the frame when it is rendered in a tag of the given spec.
+ ** The frame is left alone: each field is measured as it would be rendered
+ ** in the frame's text encoding, rather than being set to it.
+ **/
+size_t ID3_FrameImpl::Size(ID3_V2Spec spec) const
+{
+  if (this->_IsVerbatim())
+  {
+    return _raw_end - _raw_beg;
+  }
+  this->_Decode();
+  ID3_FrameHeader hdr;
+  hdr.SetSpec(spec);
+  size_t bytesUsed = hdr.Size();
 
   if (this->GetEncryptionID())
   {
@@ -185,19 +350,16 @@ size_t ID3_FrameImpl::Size()
   }
 
   ID3_TextEnc enc = ID3TE_ISO8859_1;
-  for (iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  for (const_iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
   {
-    if (*fi && (*fi)->InScope(this->GetSpec()))
+    const ID3_FieldImpl* fld = static_cast<const ID3_FieldImpl*>(*fi);
+    if (fld && fld->InScope(spec))
     {
-      if ((*fi)->GetID() == ID3FN_TEXTENC)
+      if (fld->GetID() == ID3FN_TEXTENC)
       {
-        enc = (ID3_TextEnc) (*fi)->Get();
+        enc = (ID3_TextEnc) fld->Get();
       }
-      else
-      {
-        (*fi)->SetEncoding(enc);
-      }
-      bytesUsed += (*fi)->BinSize();
+      bytesUsed += fld->BinSize_i(fld->GetRenderEncoding_i(enc));
     }
   }
 
@@ -208,8 +370,13 @@ size_t ID3_FrameImpl::Size()
 bool ID3_FrameImpl::HasChanged() const
 {
   bool changed = _changed;
+  if (_lazy)
+  {
+    // fields that were never decoded can't have changed
+    return changed;
+  }
 
-  for (const_iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  for (const_iterator fi = _fields.begin(); fi != _fields.end() && !changed; ++fi)
   {
     if (*fi && (*fi)->InScope(this->GetSpec()))
     {
@@ -220,9 +387,34 @@ bool ID3_FrameImpl::HasChanged() const
   return changed;
 }
 
+/** The bytes of heap the frame takes up, its fields included.  What is in
+ ** the arena of the frame's tag, and the raw data of a lazily parsed frame,
+ ** is left for the tag to count.
+ **/
+size_t ID3_FrameImpl::GetMemoryFootprint() const
+{
+  size_t size = heapSize(_arena, this, sizeof(*this));
+  if (_fields.capacity() > 0)
+  {
+    size += heapSize(_arena, &_fields[0], _fields.capacity() * sizeof(ID3_Field*));
+  }
+  for (const_iterator fi = _fields.begin(); fi != _fields.end(); ++fi)
+  {
+    const ID3_FieldImpl* fld = static_cast<const ID3_FieldImpl*>(*fi);
+    if (fld != NULL)
+    {
+      size += heapSize(_arena, fld, sizeof(*fld)) + fld->HeapSize_i();
+    }
+  }
+  return size;
+}
+
 ID3_FrameImpl &
 ID3_FrameImpl::operator=( const ID3_Frame &rFrame )
 {
+  _lazy = false;
+  this->_ReleaseRaw();
+  _utf8_text = ID3_FrameImpl::Get(rFrame)._utf8_text;
   ID3_FrameID eID = rFrame.GetID();
   this->SetID(eID);
   ID3_Frame::ConstIterator* ri = rFrame.CreateIterator();
@@ -241,6 +433,7 @@ ID3_FrameImpl::operator=( const ID3_Frame &rFrame )
   this->SetGroupingID(rFrame.GetGroupingID());
   this->SetCompression(rFrame.GetCompression());
   this->SetSpec(rFrame.GetSpec());
+  this->SetFileRange(0, 0);
   _changed = false;
 
   return *this;
@@ -266,3 +459,24 @@ const char* ID3_FrameImpl::GetDescription() const
   return NULL;
 }
 
+/** Stops referring to the raw data the frame was lazily parsed from,
+ ** decoding its fields first if they haven't been already.  Called before
+ ** anything that stops the frame from being rendered verbatim.
+ **/
+void ID3_FrameImpl::_ReleaseRaw()
+{
+  this->_Decode();
+  if (_raw)
+  {
+    _raw->Release();
+    _raw = NULL;
+  }
+}
+
+/** A lazily parsed frame is rendered verbatim from its raw data until it
+ ** changes.  ID3v2.2 frames have shorter headers and are always re-rendered.
+ **/
+bool ID3_FrameImpl::_IsVerbatim() const
+{
+  return _raw != NULL && _raw_spec >= ID3V2_3_0 && !this->HasChanged();
+}
@@ -46,23 +46,55 @@
 #include <bitset>
 #endif
 #include "id3/id3lib_frame.h"
+#include "id3/id3lib_strings.h"
 #include "header_frame.h"
+#include "arena.h"
+
+/** The raw bytes of a tag, from which the frames of a lazily parsed tag
+ ** decode their fields.  It is shared by those frames, and it goes away with
+ ** the last of them.
+ **/
+class ID3_RawData
+{
+public:
+  ID3_RawData() : _refs(1) { ; }
+
+  void Acquire() { ++_refs; }
+  void Release() { if (--_refs == 0) delete this; }
+
+  dami::BString& data() { return _data; }
+  const dami::BString& data() const { return _data; }
+
+private:
+  ~ID3_RawData() { ; }
+  ID3_RawData(const ID3_RawData&);
+  ID3_RawData& operator=(const ID3_RawData&);
+
+  dami::BString _data;
+  size_t        _refs;
+};
 
 class ID3_FrameImpl
 {
   typedef std::bitset<ID3FN_LASTFIELDID> Bitset;
-  typedef std::vector<ID3_Field *> Fields;
+  typedef std::vector<ID3_Field *, ID3_ArenaAllocator<ID3_Field *> > Fields;
 public:
   typedef Fields::iterator iterator;
   typedef Fields::const_iterator const_iterator;
 public:
-  ID3_FrameImpl(ID3_FrameID id = ID3FID_NOFRAME);
+  ID3_FrameImpl(ID3_FrameID id = ID3FID_NOFRAME, ID3_Arena* arena = NULL);
   ID3_FrameImpl(const ID3_FrameHeader&);
   ID3_FrameImpl(const ID3_Frame&);
 
   /// Destructor.
   virtual ~ID3_FrameImpl();
 
+  static ID3_FrameImpl& Get(ID3_Frame& frame) { return *frame._impl; }
+  static const ID3_FrameImpl& Get(const ID3_Frame& frame) { return *frame._impl; }
+  static ID3_Frame* NewFrame(ID3_Arena*);
+  static void Detach(ID3_Frame&);
+  static void Delete(ID3_FrameImpl*);
+
   void        Clear();
 
   bool        SetID(ID3_FrameID id);
@@ -81,18 +113,27 @@ public:
   bool        HasChanged() const;
   bool        Parse(ID3_Reader&);
   ID3_Err     Render(ID3_Writer&) const;
+  ID3_Err     Render(ID3_Writer&, ID3_V2Spec) const;
   size_t      Size();
+  size_t      Size(ID3_V2Spec) const;
+  bool        ParseLazily(ID3_Reader&, ID3_RawData*);
+  size_t      GetMemoryFootprint() const;
+  const ID3_RawData* GetRawData() const { return _raw; }
   bool        Contains(ID3_FieldID fld) const
-  { return _bitset.test(fld); }
+  { this->_Decode(); return _bitset.test(fld); }
   bool        SetSpec(ID3_V2Spec);
   ID3_V2Spec  GetSpec() const;
+  void        SetUtf8Text(bool);
+  bool        GetUtf8Text() const { return _utf8_text; }
+  void        SyncEncoding();
+  void        SetUnchanged();
 
   /** Sets the compression flag within the frame.  When the compression flag is
    ** is set, compression will be attempted.  However, the frame might not
    ** actually be compressed after it is rendered if the "compressed" data is
    ** no smaller than the "uncompressed" data.
    **/
-  bool        SetCompression(bool b)  { return _hdr.SetCompression(b); }
+  bool        SetCompression(bool b)  { this->_ReleaseRaw(); return _hdr.SetCompression(b); }
   /** Returns whether or not the compression flag is set.  After parsing a tag,
    ** this will indicate whether or not the frame was compressed.  After
    ** rendering a tag, however, it does not actually indicate if the frame is
@@ -106,6 +147,7 @@ public:
 
   bool SetEncryptionID(uchar id)
   {
+    this->_ReleaseRaw();
     bool changed = id != _encryption_id;
     _encryption_id = id;
     _changed = _changed || changed;
@@ -115,6 +157,7 @@ public:
   uchar GetEncryptionID() const { return _encryption_id; }
   bool SetGroupingID(uchar id)
   {
+    this->_ReleaseRaw();
     bool changed = id != _grouping_id;
     _grouping_id = id;
     _changed = _changed || changed;
@@ -123,10 +166,30 @@ public:
   }
   uchar GetGroupingID() const { return _grouping_id; }
 
-  iterator         begin()       { return _fields.begin(); }
-  iterator         end()         { return _fields.end(); }
-  const_iterator   begin() const { return _fields.begin(); }
-  const_iterator   end()   const { return _fields.end(); }
+  iterator         begin()       { this->_Decode(); return _fields.begin(); }
+  iterator         end()         { this->_Decode(); return _fields.end(); }
+  const_iterator   begin() const { this->_Decode(); return _fields.begin(); }
+  const_iterator   end()   const { this->_Decode(); return _fields.end(); }
+
+  /** Whether the fields of the frame are yet to be decoded from the raw data
+   ** it was lazily parsed from.
+   **/
+  bool        IsLazy() const { return _lazy; }
+
+  /** Sets the flag to raise whenever the id of this frame changes, so that
+   ** the tag the frame is attached to knows to re-index it.  Pass NULL when
+   ** the frame is detached from its tag.
+   **/
+  void        SetIndexFlag(bool* flag) { _index_flag = flag; }
+
+  /** Remembers where the frame was parsed from in its file, so that it can be
+   ** written back over itself when its rendering is the same size.  A size of
+   ** 0 means the frame isn't known to be anywhere in the file.
+   **/
+  void        SetFileRange(size_t offset, size_t size)
+  { _file_offset = offset; _file_size = size; }
+  size_t      GetFileOffset() const { return _file_offset; }
+  size_t      GetFileSize() const { return _file_size; }
 
 protected:
   bool        _SetID(ID3_FrameID);
@@ -134,14 +197,38 @@ protected:
   void        _InitFields();
   void        _InitFieldBits();
   void        _UpdateFieldDeps();
+  void        _IDChanged() { if (_index_flag) *_index_flag = true; }
+  bool        _Parse(ID3_Reader&, ID3_RawData*);
+  void        _Decode() const { if (_lazy) this->_DecodeRaw(); }
+  void        _DecodeRaw() const;
+  void        _ReleaseRaw();
+  bool        _IsVerbatim() const;
+  ID3_Err     _RenderFields(ID3_Writer&, ID3_V2Spec) const;
 
 private:
-  mutable bool        _changed;    // frame changed since last parse/render?
+  mutable bool        _changed;    // frame changed since last parse/update?
   Bitset      _bitset;             // which fields are present?
   Fields      _fields;
   ID3_FrameHeader _hdr;            //
   uchar       _encryption_id;      // encryption id
   uchar       _grouping_id;        // grouping id
+  bool*       _index_flag;         // raised when the id changes
+  ID3_Arena*  _arena;              // where the frame and its fields live, if
+                                   // not on the heap
+
+  // the bytes the frame was lazily parsed from, which it is rendered from
+  // verbatim for as long as it doesn't change
+  ID3_RawData* _raw;               // NULL unless lazily parsed
+  size_t      _raw_beg;            // where the frame header starts
+  size_t      _raw_fields;         // where the fields start
+  size_t      _raw_end;            // where the frame ends
+  size_t      _raw_orig_size;      // uncompressed size of the fields
+  ID3_V2Spec  _raw_spec;           // spec the frame was parsed with
+  mutable bool _lazy;              // fields not decoded yet?
+  bool        _utf8_text;          // text fields hold their text as UTF-8?
+
+  size_t      _file_offset;        // where the frame was parsed from
+  size_t      _file_size;          // and how big it was there
 }
 ;
 
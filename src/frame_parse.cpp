@@ -155,6 +155,20 @@ namespace
 };
 
 bool ID3_FrameImpl::Parse(ID3_Reader& reader)
+{
+  return this->_Parse(reader, NULL);
+}
+
+/** Parses the header of a frame, but leaves its fields to be decoded from
+ ** the raw data the first time they are needed.  The reader must read raw,
+ ** from its start.
+ **/
+bool ID3_FrameImpl::ParseLazily(ID3_Reader& reader, ID3_RawData* raw)
+{
+  return this->_Parse(reader, raw);
+}
+
+bool ID3_FrameImpl::_Parse(ID3_Reader& reader, ID3_RawData* raw)
 {
   io::ExitTrigger et(reader);
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): reader.getBeg() = " << reader.getBeg() );
@@ -162,6 +176,9 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): reader.getEnd() = " << reader.getEnd() );
   ID3_Reader::pos_type beg = reader.getCur();
 
+  _lazy = false;
+  this->_ReleaseRaw();
+  this->_IDChanged();
   if (!_hdr.Parse(reader) || reader.getCur() == beg)
   {
     ID3D_WARNING( "ID3_FrameImpl::Parse(): no header to parse" );
@@ -204,6 +221,24 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
     ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, grouping_id = " << (int) ch );
   }
 
+  if (raw != NULL)
+  {
+    // remember where the fields are and skip them
+    this->_ClearFields();
+    raw->Acquire();
+    _raw = raw;
+    _raw_beg = beg;
+    _raw_fields = wr.getCur();
+    _raw_end = wr.getEnd();
+    _raw_orig_size = origSize;
+    _raw_spec = this->GetSpec();
+    _lazy = true;
+    wr.setCur(wr.getEnd());
+    et.setExitPos(wr.getCur());
+    _changed = false;
+    return true;
+  }
+
   // set the type of frame based on the parsed header
   this->_ClearFields();
   this->_InitFields();
@@ -225,3 +260,25 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
   return true;
 }
 
+void ID3_FrameImpl::_DecodeRaw() const
+{
+  // decoding doesn't change the frame as far as its users can tell
+  ID3_FrameImpl& self = const_cast<ID3_FrameImpl&>(*this);
+  _lazy = false;
+
+  const ID3_V2Spec spec = self.GetSpec();
+  self._hdr.SetSpec(_raw_spec);
+  self._InitFields();
+  ID3_MemoryReader mr(_raw->data().data() + _raw_fields, _raw_end - _raw_fields);
+  if (!_hdr.GetCompression())
+  {
+    parseFields(mr, self);
+  }
+  else
+  {
+    io::CompressedReader csr(mr, _raw_orig_size);
+    parseFields(csr, self);
+  }
+  self._hdr.SetSpec(spec);
+  _changed = false;
+}
@@ -37,43 +37,53 @@
 
 #include "tag.h"
 #include "frame_impl.h"
+#include "field_impl.h"
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_strings.h"
 #include "io_helpers.h"
 
 using namespace dami;
 
-namespace
+ID3_Err ID3_FrameImpl::_RenderFields(ID3_Writer& writer, ID3_V2Spec spec) const
 {
-  ID3_Err renderFields(ID3_Writer& writer, const ID3_FrameImpl& frame)
+  ID3_Err err;
+  ID3_TextEnc enc = ID3TE_ISO8859_1;
+  for (const_iterator fi = this->begin(); fi != this->end(); ++fi)
   {
-    ID3_Err err;
-    ID3_TextEnc enc = ID3TE_ISO8859_1;
-    for (ID3_FrameImpl::const_iterator fi = frame.begin(); fi != frame.end(); ++fi)
+    const ID3_FieldImpl* fld = static_cast<const ID3_FieldImpl*>(*fi);
+    if (fld != NULL && fld->InScope(spec))
     {
-      ID3_Field* fld = *fi;
-      if (fld != NULL && fld->InScope(frame.GetSpec()))
+      if (fld->GetID() == ID3FN_TEXTENC)
       {
-        if (fld->GetID() == ID3FN_TEXTENC)
-        {
-          enc = static_cast<ID3_TextEnc>(fld->Get());
-          ID3D_NOTICE( "id3::v2::renderFields(): found encoding = " << enc );
-        }
-        else
-        {
-          fld->SetEncoding(enc);
-        }
-        err = fld->Render(writer);
-        if (err != ID3E_NoError)
-          return err;
+        enc = static_cast<ID3_TextEnc>(fld->Get());
+        ID3D_NOTICE( "ID3_FrameImpl::_RenderFields(): found encoding = " << enc );
       }
+      // the field is rendered in the frame's encoding, but left in its own
+      err = fld->Render_i(writer, fld->GetRenderEncoding_i(enc));
+      if (err != ID3E_NoError)
+        return err;
     }
-    return ID3E_NoError;
   }
+  return ID3E_NoError;
 }
 
 ID3_Err ID3_FrameImpl::Render(ID3_Writer& writer) const
 {
+  return this->Render(writer, this->GetSpec());
+}
+
+/** Renders the frame as it goes in a tag of the given spec, without setting
+ ** the frame or its fields to that spec or to the frame's text encoding.
+ **/
+ID3_Err ID3_FrameImpl::Render(ID3_Writer& writer, ID3_V2Spec spec) const
+{
+  if (this->_IsVerbatim())
+  {
+    const BString& raw = _raw->data();
+    writer.writeChars(raw.data() + _raw_beg, _raw_end - _raw_beg);
+    return ID3E_NoError;
+  }
+
   // Return immediately if we have no fields, which (usually) means we're
   // trying to render a frame which has been Cleared or hasn't been initialized
   if (!this->NumFields())
@@ -92,14 +102,14 @@ ID3_Err ID3_FrameImpl::Render(ID3_Writer& writer) const
   size_t origSize = 0;
   if (!this->GetCompression())
   {
-    renderFields(fldWriter, *this);
+    this->_RenderFields(fldWriter, spec);
     origSize = flds.size();
     ID3D_NOTICE ( "ID3_FrameImpl::Render(): uncompressed fields" );
   }
   else
   {
     io::CompressedWriter cr(fldWriter);
-    renderFields(cr, *this);
+    this->_RenderFields(cr, spec);
     cr.flush();
     origSize = cr.getOrigSize();
     ID3D_NOTICE ( "ID3_FrameImpl::Render(): compressed fields, orig size = " <<
@@ -162,7 +172,6 @@ ID3_Err ID3_FrameImpl::Render(ID3_Writer& writer) const
     // Write the field data
     writer.writeChars(flds.data(), fldSize);
   }
-  _changed = false;
   return ID3E_NoError;
 }
 
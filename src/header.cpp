@@ -44,20 +44,19 @@ bool ID3_Header::SetSpec(ID3_V2Spec spec)
     {  4,     4,     2,     false, 6,   false }  // ID3V2_4_0
   };
   
-  bool changed = false;
   if (spec < ID3V2_EARLIEST || spec > ID3V2_LATEST)
   {
-    changed = _spec != ID3V2_UNKNOWN;
-    _spec = ID3V2_UNKNOWN;
-    _info = NULL;
+    spec = ID3V2_UNKNOWN;
   }
-  else
+  // the spec is set again on every Size() and Render() of a const tag, so
+  // leave the header alone unless it really changes
+  if (_spec == spec)
   {
-    changed = _spec != spec;
-    _spec = spec;
-    _info = &_spec_info[_spec - ID3V2_EARLIEST];
+    return false;
   }
-  _changed = _changed || changed;
-  return changed;
+  _spec = spec;
+  _info = (ID3V2_UNKNOWN == spec) ? NULL : &_spec_info[_spec - ID3V2_EARLIEST];
+  _changed = true;
+  return true;
 }
 
@@ -37,10 +37,30 @@
 #include <ctype.h>
 
 #include "helpers.h"
+#include "field_impl.h"
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
 
 using namespace dami;
 
+namespace
+{
+  // the field's text in ISO-8859-1, converted from a copy without the field
+  // being changed, so that a shared tag can be read from many threads at
+  // once.  The copy is converted from the encoding the text is held in, so
+  // text held as UTF-8 goes into an ID3v1 tag as ISO-8859-1 too.
+  String getLatin1Text(const ID3_Field* fp)
+  {
+    const ID3_FieldImpl* fld = static_cast<const ID3_FieldImpl*>(fp);
+    String text = fld->GetText();
+    ID3_TextEnc enc = fld->GetHeldEncoding();
+    if (enc != ID3TE_ISO8859_1 && !text.empty())
+    {
+      text = convert(text, enc, ID3TE_ISO8859_1);
+    }
+    return text;
+  }
+}
+
 String id3::v2::getString(const ID3_Frame* frame, ID3_FieldID fldName)
 {
   if (!frame)
@@ -48,17 +68,11 @@ String id3::v2::getString(const ID3_Frame* frame, ID3_FieldID fldName)
     return "";
   }
   ID3_Field* fp = frame->GetField(fldName);
-  if (!fp)
+  if (!fp || fp->GetType() != ID3FTY_TEXTSTRING)
   {
     return "";
   }
-  ID3_TextEnc enc = fp->GetEncoding();
-  fp->SetEncoding(ID3TE_ISO8859_1);
-
-  String text(fp->GetRawText(), fp->Size());
-
-  fp->SetEncoding(enc);
-  return text;
+  return getLatin1Text(fp);
 }
 
 String id3::v2::getStringAtIndex(const ID3_Frame* frame, ID3_FieldID fldName,
@@ -70,14 +84,23 @@ String id3::v2::getStringAtIndex(const ID3_Frame* frame, ID3_FieldID fldName,
   }
   String text;
   ID3_Field* fp = frame->GetField(fldName);
-  if (fp && fp->GetNumTextItems() < nIndex)
+  if (fp && fp->GetType() == ID3FTY_TEXTSTRING && nIndex < fp->GetNumTextItems())
   {
-    ID3_TextEnc enc = fp->GetEncoding();
-    fp->SetEncoding(ID3TE_ISO8859_1);
-
-    text = fp->GetRawTextItem(nIndex);
-
-    fp->SetEncoding(enc);
+    // the items are separated by nulls, which converting keeps
+    String items = getLatin1Text(fp);
+    size_t beg = 0;
+    for (size_t i = 0; i < nIndex && beg != String::npos; ++i)
+    {
+      beg = items.find('\0', beg);
+      if (beg != String::npos)
+      {
+        ++beg;
+      }
+    }
+    if (beg != String::npos)
+    {
+      text = items.substr(beg, items.find('\0', beg) - beg);
+    }
   }
   return text;
 }
@@ -99,11 +122,12 @@ size_t id3::v2::removeFrames(ID3_TagImpl& tag, ID3_FrameID id)
 
 String id3::v2::getFrameText(const ID3_TagImpl& tag, ID3_FrameID id)
 {
-  ID3_Frame* frame = tag.Find(id);
+  ID3_Frame* frame = tag.FindFirst(id);
   return getString(frame, ID3FN_TEXT);
 }
 
-ID3_Frame* id3::v2::setFrameText(ID3_TagImpl& tag, ID3_FrameID id, String text)
+ID3_Frame* id3::v2::setFrameText(ID3_TagImpl& tag, ID3_FrameID id,
+                                 const String& text)
 {
   ID3_Frame* frame = tag.Find(id);
   if (!frame)
@@ -121,10 +145,10 @@ ID3_Frame* id3::v2::setFrameText(ID3_TagImpl& tag, ID3_FrameID id, String text)
 ID3_Frame* id3::v2::hasArtist(const ID3_TagImpl& tag)
 {
   ID3_Frame* fp = NULL;
-  (fp = tag.Find(ID3FID_LEADARTIST)) ||
-  (fp = tag.Find(ID3FID_BAND))       ||
-  (fp = tag.Find(ID3FID_CONDUCTOR))  ||
-  (fp = tag.Find(ID3FID_COMPOSER));
+  (fp = tag.FindFirst(ID3FID_LEADARTIST)) ||
+  (fp = tag.FindFirst(ID3FID_BAND))       ||
+  (fp = tag.FindFirst(ID3FID_CONDUCTOR))  ||
+  (fp = tag.FindFirst(ID3FID_COMPOSER));
   return fp;
 }
 
@@ -134,7 +158,7 @@ String id3::v2::getArtist(const ID3_TagImpl& tag)
   return getString(frame, ID3FN_TEXT);
 }
 
-ID3_Frame* id3::v2::setArtist(ID3_TagImpl& tag, String text)
+ID3_Frame* id3::v2::setArtist(ID3_TagImpl& tag, const String& text)
 {
   removeArtists(tag);
   return setFrameText(tag, ID3FID_LEADARTIST, text);
@@ -159,7 +183,7 @@ size_t id3::v2::removeArtists(ID3_TagImpl& tag)
 
 ID3_Frame* id3::v2::hasAlbum(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_ALBUM);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_ALBUM);
   return(frame);
 }
 
@@ -168,7 +192,7 @@ String id3::v2::getAlbum(const ID3_TagImpl& tag)
   return getFrameText(tag, ID3FID_ALBUM);
 }
 
-ID3_Frame* id3::v2::setAlbum(ID3_TagImpl& tag, String text)
+ID3_Frame* id3::v2::setAlbum(ID3_TagImpl& tag, const String& text)
 {
   return setFrameText(tag, ID3FID_ALBUM, text);
 }
@@ -182,7 +206,7 @@ size_t id3::v2::removeAlbums(ID3_TagImpl& tag)
 
 ID3_Frame* id3::v2::hasTitle(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_TITLE);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_TITLE);
   return(frame);
 }
 
@@ -191,7 +215,7 @@ String id3::v2::getTitle(const ID3_TagImpl& tag)
   return getFrameText(tag, ID3FID_TITLE);
 }
 
-ID3_Frame* id3::v2::setTitle(ID3_TagImpl& tag, String text)
+ID3_Frame* id3::v2::setTitle(ID3_TagImpl& tag, const String& text)
 {
   return setFrameText(tag, ID3FID_TITLE, text);
 }
@@ -205,7 +229,7 @@ size_t id3::v2::removeTitles(ID3_TagImpl& tag)
 
 ID3_Frame* id3::v2::hasYear(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_YEAR);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_YEAR);
   return(frame);
 }
 
@@ -214,7 +238,7 @@ String id3::v2::getYear(const ID3_TagImpl& tag)
   return getFrameText(tag, ID3FID_YEAR);
 }
 
-ID3_Frame* id3::v2::setYear(ID3_TagImpl& tag, String text)
+ID3_Frame* id3::v2::setYear(ID3_TagImpl& tag, const String& text)
 {
   return setFrameText(tag, ID3FID_YEAR, text);
 }
@@ -229,35 +253,35 @@ size_t id3::v2::removeYears(ID3_TagImpl& tag)
 ID3_Frame* id3::v2::hasV1Comment(const ID3_TagImpl& tag)
 {
   ID3_Frame* frame = NULL;
-  (frame = tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC)) ||
-  (frame = tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, ""                 )) ||
-  (frame = tag.Find(ID3FID_COMMENT));
+  (frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC)) ||
+  (frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, ""                 )) ||
+  (frame = tag.FindFirst(ID3FID_COMMENT));
   return(frame);
 }
 
 ID3_Frame* id3::v2::hasComment(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_COMMENT);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_COMMENT);
   return(frame);
 }
 
 String id3::v2::getV1Comment(const ID3_TagImpl& tag)
 {
   ID3_Frame* frame;
-  (frame = tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC)) ||
-  (frame = tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, ""                 )) ||
-  (frame = tag.Find(ID3FID_COMMENT));
+  (frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC)) ||
+  (frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, ""                 )) ||
+  (frame = tag.FindFirst(ID3FID_COMMENT));
   return getString(frame, ID3FN_TEXT);
 }
 
-String id3::v2::getComment(const ID3_TagImpl& tag, String desc)
+String id3::v2::getComment(const ID3_TagImpl& tag, const String& desc)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, desc.c_str());
+  ID3_Frame* frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, desc.c_str());
   return getString(frame, ID3FN_TEXT);
 }
 
-ID3_Frame* id3::v2::setComment(ID3_TagImpl& tag, String text, String desc,
-                               String lang)
+ID3_Frame* id3::v2::setComment(ID3_TagImpl& tag, const String& text,
+                               const String& desc, const String& lang)
 {
   ID3D_NOTICE( "id3::v2::setComment: trying to find frame with description = " << desc );
   ID3_Frame* frame = NULL;
@@ -307,7 +331,7 @@ size_t id3::v2::removeAllComments(ID3_TagImpl& tag)
 }
 
 // Remove all comments from the tag with the given description
-size_t id3::v2::removeComments(ID3_TagImpl& tag, String desc)
+size_t id3::v2::removeComments(ID3_TagImpl& tag, const String& desc)
 {
   size_t numRemoved = 0;
 
@@ -339,7 +363,7 @@ size_t id3::v2::removeComments(ID3_TagImpl& tag, String desc)
 
 ID3_Frame* id3::v2::hasTrack(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_TRACKNUM);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_TRACKNUM);
   return(frame);
 }
 
@@ -377,7 +401,7 @@ size_t id3::v2::removeTracks(ID3_TagImpl& tag)
 
 ID3_Frame* id3::v2::hasGenre(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_CONTENTTYPE);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_CONTENTTYPE);
   return(frame);
 }
 
@@ -428,7 +452,7 @@ size_t id3::v2::removeGenres(ID3_TagImpl& tag)
 
 ID3_Frame* id3::v2::hasLyrics(const ID3_TagImpl& tag)
 {
-  ID3_Frame* frame = tag.Find(ID3FID_UNSYNCEDLYRICS);
+  ID3_Frame* frame = tag.FindFirst(ID3FID_UNSYNCEDLYRICS);
   return(frame);
 }
 
@@ -437,8 +461,8 @@ String id3::v2::getLyrics(const ID3_TagImpl& tag)
   return getFrameText(tag, ID3FID_UNSYNCEDLYRICS);
 }
 
-ID3_Frame* id3::v2::setLyrics(ID3_TagImpl& tag, String text, String desc,
-                              String lang)
+ID3_Frame* id3::v2::setLyrics(ID3_TagImpl& tag, const String& text,
+                              const String& desc, const String& lang)
 {
   ID3_Frame* frame = NULL;
   // See if there is already a comment with this description
@@ -481,7 +505,7 @@ String id3::v2::getLyricist(const ID3_TagImpl& tag)
   return getFrameText(tag, ID3FID_LYRICIST);
 }
 
-ID3_Frame* id3::v2::setLyricist(ID3_TagImpl& tag, String text)
+ID3_Frame* id3::v2::setLyricist(ID3_TagImpl& tag, const String& text)
 {
   return setFrameText(tag, ID3FID_LYRICIST, text);
 }
@@ -493,17 +517,18 @@ size_t id3::v2::removeLyricists(ID3_TagImpl& tag)
 
 ////////////////////////////////////////////////////////////
 
-ID3_Frame* id3::v2::hasSyncLyrics(const ID3_TagImpl& tag, String lang, String desc)
+ID3_Frame* id3::v2::hasSyncLyrics(const ID3_TagImpl& tag, const String& lang,
+                                  const String& desc)
 {
   ID3_Frame* frame=NULL;
-  (frame = tag.Find(ID3FID_SYNCEDLYRICS, ID3FN_LANGUAGE, lang)) ||
-  (frame = tag.Find(ID3FID_SYNCEDLYRICS, ID3FN_DESCRIPTION, desc));
+  (frame = tag.FindFirst(ID3FID_SYNCEDLYRICS, ID3FN_LANGUAGE, lang)) ||
+  (frame = tag.FindFirst(ID3FID_SYNCEDLYRICS, ID3FN_DESCRIPTION, desc));
   return(frame);
 }
 
-ID3_Frame* id3::v2::setSyncLyrics(ID3_TagImpl& tag, BString data,
-                                  ID3_TimeStampFormat format, String desc,
-                                  String lang, ID3_ContentType type)
+ID3_Frame* id3::v2::setSyncLyrics(ID3_TagImpl& tag, const BString& data,
+                                  ID3_TimeStampFormat format, const String& desc,
+                                  const String& lang, ID3_ContentType type)
 {
   ID3_Frame* frame = NULL;
 
@@ -525,13 +550,14 @@ ID3_Frame* id3::v2::setSyncLyrics(ID3_TagImpl& tag, BString data,
   return frame;
 }
 
-BString id3::v2::getSyncLyrics(const ID3_TagImpl& tag, String lang, String desc)
+BString id3::v2::getSyncLyrics(const ID3_TagImpl& tag, const String& lang,
+                               const String& desc)
 {
   // check if a SYLT frame of this language or descriptor exists
   ID3_Frame* frame = NULL;
-  (frame = tag.Find(ID3FID_SYNCEDLYRICS, ID3FN_LANGUAGE, lang)) ||
-  (frame = tag.Find(ID3FID_SYNCEDLYRICS, ID3FN_DESCRIPTION, desc)) ||
-  (frame = tag.Find(ID3FID_SYNCEDLYRICS));
+  (frame = tag.FindFirst(ID3FID_SYNCEDLYRICS, ID3FN_LANGUAGE, lang)) ||
+  (frame = tag.FindFirst(ID3FID_SYNCEDLYRICS, ID3FN_DESCRIPTION, desc)) ||
+  (frame = tag.FindFirst(ID3FID_SYNCEDLYRICS));
 
   // get the lyrics size
   ID3_Field* fld = frame->GetField(ID3FN_DATA);
@@ -31,6 +31,7 @@
 
 
 
+#include <string.h> //for memchr
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "zlib.h"
 
@@ -197,6 +198,36 @@ ID3_Reader::int_type io::UnsyncedReader::readChar()
   return ch;
 }
 
+ID3_Reader::size_type io::UnsyncedReader::readChars(char_type buf[], size_type len)
+{
+  if (buf == NULL)
+  {
+    // nowhere to resync in place
+    return SUPER::readChars(buf, len);
+  }
+  size_type numChars = 0;
+  while (numChars < len && !this->atEnd())
+  {
+    size_type numRead = _reader.readChars(buf + numChars, len - numChars);
+    if (numRead == 0)
+    {
+      break;
+    }
+    bool endsInFF = (buf[numChars + numRead - 1] == 0xFF);
+    numChars += resync(buf + numChars, numRead);
+    // a sync byte for the last character might be the first one of the next
+    // block
+    if (endsInFF && _reader.peekChar() == 0x00)
+    {
+      ID3D_NOTICE( "UnsyncedReader::readChars(): found sync at pos " <<
+                   this->getCur() );
+      _reader.readChar();
+    }
+  }
+  ID3D_NOTICE( "UnsyncedReader::readChars(): numChars = " << numChars );
+  return numChars;
+}
+
 io::CompressedReader::CompressedReader(ID3_Reader& reader, size_type newSize)
   : _uncompressed(new char_type[newSize])
 {
@@ -204,11 +235,12 @@ io::CompressedReader::CompressedReader(ID3_Reader& reader, size_type newSize)
 
   BString binary = readBinary(reader, oldSize);
 
+  uLongf destSize = newSize;
   ::uncompress(_uncompressed,
-               reinterpret_cast<luint*>(&newSize),
+               &destSize,
                reinterpret_cast<const uchar*>(binary.data()),
                oldSize);
-  this->setBuffer(_uncompressed, newSize);
+  this->setBuffer(_uncompressed, destSize);
 }
 
 io::CompressedReader::~CompressedReader()
@@ -242,16 +274,36 @@ io::UnsyncedWriter::writeChars(const char_type buf[], size_type len)
 {
   pos_type beg = this->getCur();
   ID3D_NOTICE( "UnsyncedWriter::writeChars(): len = " << len );
-  for (size_t i = 0; i < len; ++i)
+  // Only a 0xFF can start a false sync, so find them with memchr (which the C
+  // library vectorizes) and write everything up to and including each one to
+  // the wrapped writer in one go.  A sync byte is inserted in front of the
+  // next character when needed, exactly as writeChar() would.
+  const char_type* cur = buf;
+  const char_type* end = buf + len;
+  while (cur < end && !this->atEnd())
   {
-    if (this->atEnd())
+    if (_last == 0xFF && (*cur == 0x00 || *cur >= 0xE0))
+    {
+      _writer.writeChar('\0');
+      _numSyncs++;
+    }
+    const char_type* ff =
+      static_cast<const char_type*>(::memchr(cur, 0xFF, end - cur));
+    size_type runSize = ((ff == NULL) ? end : ff + 1) - cur;
+    size_type numWritten = _writer.writeChars(cur, runSize);
+    if (numWritten == 0)
+    {
+      break;
+    }
+    _last = cur[numWritten - 1];
+    cur += numWritten;
+    if (numWritten < runSize)
     {
       break;
     }
-    this->writeChar(buf[i]);
   }
   size_type numChars = this->getCur() - beg;
-  ID3D_NOTICE( "CharWriter::writeChars(): numChars = " << numChars );
+  ID3D_NOTICE( "UnsyncedWriter::writeChars(): numChars = " << numChars );
   return numChars;
 }
 
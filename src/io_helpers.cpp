@@ -29,6 +29,7 @@
 #include <config.h>
 #endif
 
+#include <string.h> //for memchr
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 
 using namespace dami;
@@ -284,6 +285,34 @@ uint32 io::readUInt28(ID3_Reader& reader)
   return min(val, MAXVAL);
 }
 
+size_t io::resync(uchar* data, size_t size)
+{
+  // Scan for 0xFF bytes with memchr, which is vectorized by most C libraries,
+  // rather than looking at every byte.  Nothing has to move until the first
+  // sync (0xFF 0x00) is found; after that each run up to and including the
+  // next 0xFF is moved down over the removed 0x00 bytes.
+  const uchar* src = data;
+  const uchar* end = data + size;
+  uchar* dst = data;
+  while (src < end)
+  {
+    const uchar* ff = static_cast<const uchar*>(::memchr(src, 0xFF, end - src));
+    const uchar* next = (ff == NULL) ? end : ff + 1;
+    if (dst != src)
+    {
+      ::memmove(dst, src, next - src);
+    }
+    dst += next - src;
+    src = next;
+    if (ff != NULL && src < end && *src == 0x00)
+    {
+      // skip the sync byte
+      ++src;
+    }
+  }
+  return dst - data;
+}
+
 size_t io::writeBENumber(ID3_Writer& writer, uint32 val, size_t len)
 {
   ID3_Writer::char_type bytes[sizeof(uint32)];
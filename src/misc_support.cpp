@@ -29,7 +29,9 @@
 #include <stdio.h>
 
 #include "misc_support.h"
+#include "helpers.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "field_impl.h"
 
 int ID3_strncasecmp (const char *s1, const char *s2, int n);
 //using namespace dami;
@@ -42,12 +44,23 @@ char *ID3_GetString(const ID3_Frame *frame, ID3_FieldID fldName)
   if (NULL != frame && NULL != (fld = frame->GetField(fldName)))
   {
 //    ID3_Field* fld = frame->GetField(fldName);
-    ID3_TextEnc enc = fld->GetEncoding();
-    fld->SetEncoding(ID3TE_ISO8859_1);
-    size_t nText = fld->Size();
-    text = LEAKTESTNEW(char[nText + 1]);
-    fld->Get(text, nText + 1);
-    fld->SetEncoding(enc);
+    // text held in ISO-8859-1, or as UTF-8 because the tag holds its text
+    // that way, is given as it is held; other text is converted to
+    // ISO-8859-1 from a copy, since the frame may be shared between threads
+    const ID3_FieldImpl* impl = static_cast<const ID3_FieldImpl*>(fld);
+    dami::String str;
+    if (impl->GetType() == ID3FTY_TEXTSTRING &&
+        (impl->GetHeldEncoding() == ID3TE_ISO8859_1 || impl->GetUtf8Text()))
+    {
+      str = impl->GetText();
+    }
+    else
+    {
+      str = dami::id3::v2::getString(frame, fldName);
+    }
+    text = LEAKTESTNEW(char[str.size() + 1]);
+    str.copy(text, str.size());
+    text[str.size()] = '\0';
   }
   return text;
 }
@@ -79,10 +92,10 @@ char *ID3_GetArtist(const ID3_Tag *tag)
   }
 
   ID3_Frame *frame = NULL;
-  if ((frame = tag->Find(ID3FID_LEADARTIST)) ||
-      (frame = tag->Find(ID3FID_BAND))       ||
-      (frame = tag->Find(ID3FID_CONDUCTOR))  ||
-      (frame = tag->Find(ID3FID_COMPOSER)))
+  if ((frame = tag->FindFirst(ID3FID_LEADARTIST)) ||
+      (frame = tag->FindFirst(ID3FID_BAND))       ||
+      (frame = tag->FindFirst(ID3FID_CONDUCTOR))  ||
+      (frame = tag->FindFirst(ID3FID_COMPOSER)))
   {
     sArtist = ID3_GetString(frame, ID3FN_TEXT);
   }
@@ -161,7 +174,7 @@ char *ID3_GetAlbum(const ID3_Tag *tag)
     return sAlbum;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_ALBUM);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_ALBUM);
   if (frame != NULL)
   {
     sAlbum = ID3_GetString(frame, ID3FN_TEXT);
@@ -220,7 +233,7 @@ char *ID3_GetTitle(const ID3_Tag *tag)
     return sTitle;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_TITLE);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_TITLE);
   if (frame != NULL)
   {
     sTitle = ID3_GetString(frame, ID3FN_TEXT);
@@ -279,7 +292,7 @@ char *ID3_GetYear(const ID3_Tag *tag)
     return sYear;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_YEAR);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_YEAR);
   if (frame != NULL)
   {
     sYear = ID3_GetString(frame, ID3FN_TEXT);
@@ -341,13 +354,23 @@ char *ID3_GetComment(const ID3_Tag *tag, const char* desc)
   ID3_Frame* frame = NULL;
   if (desc)
   {
-    frame = tag->Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, desc);
+    frame = tag->FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, desc);
   }
   else
   {
-    frame = tag->Find(ID3FID_COMMENT);
-    if(frame == tag->Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC))
-      frame = tag->Find(ID3FID_COMMENT);
+    // the first comment, or the next one if that's the ID3v1 comment, found
+    // with a cursor of our own so that many threads can get the comment
+    ID3_Tag::Cursor cursor;
+    frame = tag->Find(cursor, ID3FID_COMMENT);
+    if (frame != NULL &&
+        frame == tag->FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, STR_V1_COMMENT_DESC))
+    {
+      ID3_Frame* next = tag->Find(cursor, ID3FID_COMMENT);
+      if (next != NULL)
+      {
+        frame = next;
+      }
+    }
   }
 
   if (frame)
@@ -470,7 +493,7 @@ char *ID3_GetTrack(const ID3_Tag *tag)
     return sTrack;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_TRACKNUM);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_TRACKNUM);
   if (frame != NULL)
   {
     sTrack = ID3_GetString(frame, ID3FN_TEXT);
@@ -534,7 +557,7 @@ int ID3_GetPictureData(const ID3_Tag *tag, const char *TempPicPath)
   else
   {
     ID3_Frame* frame = NULL;
-    frame = tag->Find(ID3FID_PICTURE);
+    frame = tag->FindFirst(ID3FID_PICTURE);
     if (frame != NULL)
     {
       ID3_Field* myField = frame->GetField(ID3FN_DATA);
@@ -557,7 +580,7 @@ char* ID3_GetPictureMimeType(const ID3_Tag *tag)
     return sPicMimetype;
 
   ID3_Frame* frame = NULL;
-  frame = tag->Find(ID3FID_PICTURE);
+  frame = tag->FindFirst(ID3FID_PICTURE);
   if (frame != NULL)
   {
     sPicMimetype = ID3_GetString(frame, ID3FN_MIMETYPE);
@@ -792,7 +815,7 @@ char *ID3_GetGenre(const ID3_Tag *tag)
     return sGenre;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_CONTENTTYPE);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_CONTENTTYPE);
   if (frame != NULL)
   {
     sGenre = ID3_GetString(frame, ID3FN_TEXT);
@@ -1189,7 +1212,7 @@ char *ID3_GetLyrics(const ID3_Tag *tag)
     return sLyrics;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_UNSYNCEDLYRICS);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_UNSYNCEDLYRICS);
   if (frame != NULL)
   {
     sLyrics = ID3_GetString(frame, ID3FN_TEXT);
@@ -1262,7 +1285,7 @@ char *ID3_GetLyricist(const ID3_Tag *tag)
     return sLyricist;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_LYRICIST);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_LYRICIST);
   if (frame != NULL)
   {
     sLyricist = ID3_GetString(frame, ID3FN_TEXT);
@@ -38,7 +38,7 @@ public:
   void Clean();
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const { return _mp3_header_output; };
-  bool Parse(ID3_Reader&, size_t mp3size);
+  bool Parse(ID3_Reader&, ID3_Reader::size_type mp3size);
 
   Mpeg_Layers Layer() const { return _mp3_header_output->layer; };
   Mpeg_Version Version() const { return _mp3_header_output->version; };
@@ -78,7 +78,7 @@ void Mp3Info::Clean()
 
 using namespace dami;
 
-bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
+bool Mp3Info::Parse(ID3_Reader& reader, ID3_Reader::size_type mp3size)
 {
   MP3_BitRates _mp3_bitrates[2][3][16] =
   {
@@ -424,7 +424,10 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
     _mp3_header_output->time = 0;
   }
   //if we got to here it's okay
-  _mp3_header_output->datasize = reader.getEnd() - reader.getBeg();
+  // datasize is 32 bits in the public struct, so it saturates for audio data
+  // of 4 GiB and more
+  ID3_Reader::size_type datasize = reader.getEnd() - reader.getBeg();
+  _mp3_header_output->datasize = (datasize > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32)datasize;
   return true;
 }
 
@@ -28,6 +28,15 @@
 #include "readers.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 
+#if defined HAVE_MMAP && defined HAVE_SYS_MMAN_H && defined HAVE_FCNTL_H && defined HAVE_UNISTD_H
+#  define ID3_USE_MMAP 1
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 using namespace dami;
 
 ID3_Reader::size_type
@@ -39,3 +48,49 @@ ID3_MemoryReader::readChars(char_type buf[], size_type len)
   return size;
 }
 
+
+bool ID3_MappedFileReader::open(const char* name)
+{
+  this->close();
+#if defined ID3_USE_MMAP
+  if (NULL == name)
+  {
+    return false;
+  }
+  int fd = ::open(name, O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat st;
+  // an empty file can't be mapped, and the whole file must fit in the
+  // address space
+  if (::fstat(fd, &st) == 0 && st.st_size > 0 &&
+      (uint64) st.st_size <= (uint64) (size_t) -1)
+  {
+    void* map = ::mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED)
+    {
+      _map = map;
+      _map_size = st.st_size;
+      this->setBuffer(static_cast<const char_type*>(_map), _map_size);
+    }
+  }
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+#endif
+  return this->isMapped();
+}
+
+void ID3_MappedFileReader::close()
+{
+#if defined ID3_USE_MMAP
+  if (_map != NULL)
+  {
+    ::munmap(_map, _map_size);
+  }
+#endif
+  _map = NULL;
+  _map_size = 0;
+  this->setBuffer(NULL, 0);
+}
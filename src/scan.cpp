@@ -0,0 +1,726 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "threads.h" // has "id3/utils.h" and <pthread.h> where there are threads
+#include "scan.h"
+
+#if defined HAVE_DIRENT_H && defined HAVE_SYS_STAT_H
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <dirent.h>
+#  define ID3_SCAN_WITH_DIRS
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // A directory to list, or a file to scan
+  struct Entry
+  {
+    String     path;
+    bool       isDir;
+  };
+
+  // The JSON lines of a worker are written once there are this many bytes
+  const size_t FLUSH_SIZE = 64 * 1024;
+
+  void appendJSON(String& out, unicode_t ch)
+  {
+    const char* hex = "0123456789abcdef";
+    switch (ch)
+    {
+      case '"':  out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n";  break;
+      case '\r': out += "\\r";  break;
+      case '\t': out += "\\t";  break;
+      default:
+        if (ch >= 0x20 && ch < 0x7f)
+        {
+          out += static_cast<char>(ch);
+        }
+        else
+        {
+          out += "\\u";
+          out += hex[(ch >> 12) & 0xf];
+          out += hex[(ch >> 8) & 0xf];
+          out += hex[(ch >> 4) & 0xf];
+          out += hex[ch & 0xf];
+        }
+    }
+  }
+
+  // Returns the length of the well-formed utf-8 sequence of two or more
+  // bytes at text, or 0 if there isn't one
+  size_t utf8Length(const uchar* text, size_t len)
+  {
+    size_t size = 0;
+    uint32 min = 0;
+    uint32 ch = text[0];
+    if      (ch >= 0xc0 && ch < 0xe0) { size = 2; ch &= 0x1f; min = 0x80; }
+    else if (ch >= 0xe0 && ch < 0xf0) { size = 3; ch &= 0x0f; min = 0x800; }
+    else if (ch >= 0xf0 && ch < 0xf5) { size = 4; ch &= 0x07; min = 0x10000; }
+    if (size == 0 || size > len)
+    {
+      return 0;
+    }
+    for (size_t i = 1; i < size; ++i)
+    {
+      if ((text[i] & 0xc0) != 0x80)
+      {
+        return 0;
+      }
+      ch = (ch << 6) | (text[i] & 0x3f);
+    }
+    // overlong forms, surrogates and what lies past unicode aren't utf-8
+    if (ch < min || (ch >= 0xd800 && ch < 0xe000) || ch > 0x10ffff)
+    {
+      return 0;
+    }
+    return size;
+  }
+
+  // Appends utf-8 text as a JSON string.  Bytes that aren't part of a
+  // well-formed sequence, as in a file name in latin-1, are taken for
+  // latin-1 characters, so the line stays valid utf-8.
+  void appendJSON(String& out, const char* text, size_t len)
+  {
+    const uchar* bytes = reinterpret_cast<const uchar*>(text);
+    out += '"';
+    for (size_t i = 0; i < len; )
+    {
+      const size_t size = bytes[i] >= 0x80 ? utf8Length(bytes + i, len - i) : 0;
+      if (size > 0)
+      {
+        out.append(text + i, size);
+        i += size;
+      }
+      else
+      {
+        appendJSON(out, static_cast<unicode_t>(bytes[i]));
+        ++i;
+      }
+    }
+    out += '"';
+  }
+
+  // Appends the text of a field as a JSON string, whatever its encoding
+  void appendJSON(String& out, const ID3_Field& fld)
+  {
+    const ID3_TextEnc enc = fld.GetEncoding();
+    const size_t size = fld.Size();
+    if (enc == ID3TE_UTF8)
+    {
+      appendJSON(out, fld.GetRawText(), size);
+      return;
+    }
+    out += '"';
+    if (ID3TE_IS_DOUBLE_BYTE_ENC(enc))
+    {
+      // the characters are held big-endian
+      const uchar* text = reinterpret_cast<const uchar*>(fld.GetRawUnicodeText());
+      for (size_t i = 0; text != NULL && i + 1 < size; i += 2)
+      {
+        appendJSON(out, static_cast<unicode_t>((text[i] << 8) | text[i + 1]));
+      }
+    }
+    else
+    {
+      // latin-1 characters are the first 256 of unicode
+      const char* text = fld.GetRawText();
+      for (size_t i = 0; text != NULL && i < size; ++i)
+      {
+        appendJSON(out, static_cast<uchar>(text[i]));
+      }
+    }
+    out += '"';
+  }
+
+  // Appends the result of a scan as a line of JSON
+  void appendJSON(String& out, const String& fileName, const ID3_Tag& tag,
+                  ID3_Err err)
+  {
+    char num[32];
+    out += "{\"file\":";
+    appendJSON(out, fileName.data(), fileName.size());
+    sprintf(num, "%d", err);
+    out += ",\"error\":";
+    out += num;
+    sprintf(num, "%llu", (unsigned long long) tag.GetFileSize());
+    out += ",\"size\":";
+    out += num;
+    out += ",\"v1\":";
+    out += tag.HasV1Tag() ? "true" : "false";
+    out += ",\"v2\":";
+    out += tag.HasV2Tag() ? "true" : "false";
+    out += ",\"frames\":[";
+    ID3_Tag::ConstIterator* iter = tag.CreateIterator();
+    const ID3_Frame* frame = NULL;
+    for (size_t i = 0; NULL != (frame = iter->GetNext()); ++i)
+    {
+      if (i > 0)
+      {
+        out += ',';
+      }
+      const char* id = frame->GetTextID();
+      out += "{\"id\":";
+      appendJSON(out, id, id ? strlen(id) : 0);
+      const ID3_Field* text = frame->GetField(ID3FN_TEXT);
+      if (text == NULL)
+      {
+        text = frame->GetField(ID3FN_URL);
+      }
+      if (text != NULL)
+      {
+        out += ",\"text\":";
+        appendJSON(out, *text);
+      }
+      out += '}';
+    }
+    delete iter;
+    out += "]}\n";
+  }
+};
+
+class ID3_ScannerImpl;
+
+namespace
+{
+  struct Worker
+  {
+    ID3_ScannerImpl* scanner;
+    size_t     index;
+    std::deque<Entry> entries; // its own are taken from the back, and others
+                               // steal from the front
+    ID3_Tag    tag;            // linked to each file in turn
+    String     json;           // the lines not yet written out
+    size_t     scanned;
+#if defined ID3_WITH_THREADS
+    pthread_mutex_t lock;      // guards the entries
+    pthread_t  thread;
+#endif
+  };
+};
+
+class ID3_ScannerImpl
+{
+public:
+  ID3_ScannerImpl(size_t workers);
+  ~ID3_ScannerImpl();
+
+  size_t     GetNumWorkers() const { return _num_workers; }
+  void       SetTagTypes(flags_t types) { _tag_types = types; }
+  void       SetLazyParsing(bool lazy) { _is_lazy = lazy; }
+
+  size_t     Scan(const char* path, ID3_Scanner::ResultFunc, void*, ostream*);
+
+  void       Work(Worker&);
+
+private:
+  bool       _Take(Worker&, Entry&);
+  void       _Push(Worker&, std::vector<Entry>&);
+  void       _Done();
+  void       _List(Worker&, const String& dir);
+  void       _Scan(Worker&, const String& file);
+  void       _Report(Worker&, const String& fileName, ID3_Err);
+  void       _Flush(Worker&);
+
+  size_t     _num_workers;
+  flags_t    _tag_types;
+  bool       _is_lazy;
+  std::vector<Worker*> _workers; // kept from one scan to the next
+
+  // the scan going on
+  ID3_Scanner::ResultFunc _result;
+  void*      _data;
+  ostream*   _out;
+#if defined ID3_WITH_THREADS
+  size_t     _pending;         // entries pushed and not yet done
+  size_t     _pushes;          // how often entries were pushed
+  size_t     _idle;            // workers waiting for entries to be pushed
+  pthread_mutex_t _lock;       // guards the above
+  pthread_cond_t _pushed;      // entries were pushed, or all are done
+  pthread_mutex_t _out_lock;   // guards the stream
+#endif
+};
+
+#if defined ID3_WITH_THREADS
+namespace
+{
+  void* work(void* worker)
+  {
+    Worker* w = static_cast<Worker*>(worker);
+    w->scanner->Work(*w);
+    return NULL;
+  }
+};
+#endif
+
+ID3_ScannerImpl::ID3_ScannerImpl(size_t workers)
+  : _num_workers(workers > 0 ? workers : defaultWorkers()),
+    _tag_types(ID3TT_ALL),
+    _is_lazy(false),
+    _workers(),
+    _result(NULL),
+    _data(NULL),
+    _out(NULL)
+{
+#if defined ID3_WITH_THREADS
+  _pending = 0;
+  _pushes = 0;
+  _idle = 0;
+  pthread_mutex_init(&_lock, NULL);
+  pthread_cond_init(&_pushed, NULL);
+  pthread_mutex_init(&_out_lock, NULL);
+#else
+  _num_workers = 1;
+#endif
+}
+
+ID3_ScannerImpl::~ID3_ScannerImpl()
+{
+  for (size_t i = 0; i < _workers.size(); ++i)
+  {
+#if defined ID3_WITH_THREADS
+    pthread_mutex_destroy(&_workers[i]->lock);
+#endif
+    delete _workers[i];
+  }
+#if defined ID3_WITH_THREADS
+  pthread_mutex_destroy(&_out_lock);
+  pthread_cond_destroy(&_pushed);
+  pthread_mutex_destroy(&_lock);
+#endif
+}
+
+size_t ID3_ScannerImpl::Scan(const char* path, ID3_Scanner::ResultFunc result,
+                             void* data, ostream* out)
+{
+  if (NULL == path || (NULL == result && NULL == out))
+  {
+    return 0;
+  }
+  _result = result;
+  _data = data;
+  _out = out;
+  while (_workers.size() < _num_workers)
+  {
+    Worker* worker = new Worker;
+    worker->scanner = this;
+    worker->index = _workers.size();
+#if defined ID3_WITH_THREADS
+    pthread_mutex_init(&worker->lock, NULL);
+#endif
+    _workers.push_back(worker);
+  }
+  for (size_t i = 0; i < _workers.size(); ++i)
+  {
+    _workers[i]->scanned = 0;
+  }
+
+  std::vector<Entry> root(1);
+  root[0].path = path;
+  root[0].isDir = false;
+#if defined ID3_SCAN_WITH_DIRS
+  struct stat st;
+  root[0].isDir = ::stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+  this->_Push(*_workers[0], root);
+
+#if defined ID3_WITH_THREADS
+  std::vector<Worker*> started;
+  for (size_t i = 1; i < _workers.size(); ++i)
+  {
+    if (pthread_create(&_workers[i]->thread, NULL, work, _workers[i]) != 0)
+    {
+      ID3D_WARNING( "ID3_ScannerImpl::Scan(): started only " << i - 1 <<
+                    " workers" );
+      break;
+    }
+    started.push_back(_workers[i]);
+  }
+#endif
+  // the caller's thread is the first worker
+  this->Work(*_workers[0]);
+#if defined ID3_WITH_THREADS
+  for (size_t i = 0; i < started.size(); ++i)
+  {
+    pthread_join(started[i]->thread, NULL);
+  }
+#endif
+
+  size_t scanned = 0;
+  for (size_t i = 0; i < _workers.size(); ++i)
+  {
+    scanned += _workers[i]->scanned;
+  }
+  _result = NULL;
+  _data = NULL;
+  _out = NULL;
+  return scanned;
+}
+
+void ID3_ScannerImpl::Work(Worker& worker)
+{
+#if defined ID3_WITH_THREADS
+  size_t pushes = 0;
+#endif
+  for (;;)
+  {
+    Entry entry;
+    if (this->_Take(worker, entry))
+    {
+      try
+      {
+        if (entry.isDir)
+        {
+          this->_List(worker, entry.path);
+        }
+        else
+        {
+          this->_Scan(worker, entry.path);
+        }
+      }
+      catch (...)
+      {
+        ID3D_WARNING( "ID3_ScannerImpl::Work(): failed to scan " << entry.path );
+      }
+      this->_Done();
+      continue;
+    }
+#if defined ID3_WITH_THREADS
+    // nothing left to take, so wait until entries are pushed anew, unless
+    // they were pushed since the last look
+    Locker locker(_lock);
+    if (_pending == 0)
+    {
+      break;
+    }
+    if (_pushes == pushes)
+    {
+      ++_idle;
+      pthread_cond_wait(&_pushed, &_lock);
+      --_idle;
+    }
+    pushes = _pushes;
+#else
+    break;
+#endif
+  }
+  this->_Flush(worker);
+}
+
+// Takes the last entry of the worker, or steals the first entry of another
+bool ID3_ScannerImpl::_Take(Worker& worker, Entry& entry)
+{
+  {
+#if defined ID3_WITH_THREADS
+    Locker locker(worker.lock);
+#endif
+    if (!worker.entries.empty())
+    {
+      entry = worker.entries.back();
+      worker.entries.pop_back();
+      return true;
+    }
+  }
+#if defined ID3_WITH_THREADS
+  for (size_t i = 1; i < _workers.size(); ++i)
+  {
+    Worker& victim = *_workers[(worker.index + i) % _workers.size()];
+    Locker locker(victim.lock);
+    if (!victim.entries.empty())
+    {
+      // the first entries are the ones nearest the top of the tree, so
+      // likely the biggest share of the work
+      entry = victim.entries.front();
+      victim.entries.pop_front();
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+void ID3_ScannerImpl::_Push(Worker& worker, std::vector<Entry>& entries)
+{
+  if (entries.empty())
+  {
+    return;
+  }
+#if defined ID3_WITH_THREADS
+  // the entries are counted before any can be taken, and so done
+  Locker locker(_lock);
+  Locker entriesLocker(worker.lock);
+#endif
+  worker.entries.insert(worker.entries.end(), entries.begin(), entries.end());
+#if defined ID3_WITH_THREADS
+  _pending += entries.size();
+  ++_pushes;
+  if (_idle > 0)
+  {
+    pthread_cond_broadcast(&_pushed);
+  }
+#endif
+}
+
+void ID3_ScannerImpl::_Done()
+{
+#if defined ID3_WITH_THREADS
+  Locker locker(_lock);
+  if (--_pending == 0)
+  {
+    pthread_cond_broadcast(&_pushed);
+  }
+#endif
+}
+
+// Pushes the files and the directories in the directory.  Links to
+// directories aren't followed, lest the scan go round in circles, and
+// anything but files and directories is passed over.
+void ID3_ScannerImpl::_List(Worker& worker, const String& dir)
+{
+#if defined ID3_SCAN_WITH_DIRS
+  DIR* dp = ::opendir(dir.c_str());
+  if (NULL == dp)
+  {
+    worker.tag.Clear();
+    this->_Report(worker, dir, ID3E_NoFile);
+    return;
+  }
+  String prefix = dir;
+  if (prefix.empty() || prefix[prefix.size() - 1] != '/')
+  {
+    prefix += '/';
+  }
+  std::vector<Entry> entries;
+  for (struct dirent* de = ::readdir(dp); de != NULL; de = ::readdir(dp))
+  {
+    const char* name = de->d_name;
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+      continue;
+    }
+    Entry entry;
+    entry.path = prefix + name;
+    int type = -1;            // unknown
+#if defined DT_DIR
+    if (de->d_type == DT_DIR)
+    {
+      type = 1;
+    }
+    else if (de->d_type == DT_REG)
+    {
+      type = 0;
+    }
+    else if (de->d_type != DT_UNKNOWN && de->d_type != DT_LNK)
+    {
+      continue;
+    }
+#endif
+    if (type < 0)
+    {
+      // only look through a link to see if it's a file
+      struct stat st;
+      if (::lstat(entry.path.c_str(), &st) != 0)
+      {
+        continue;
+      }
+      const bool isLink = S_ISLNK(st.st_mode);
+      if (isLink && ::stat(entry.path.c_str(), &st) != 0)
+      {
+        continue;
+      }
+      if (S_ISREG(st.st_mode))
+      {
+        type = 0;
+      }
+      else if (S_ISDIR(st.st_mode) && !isLink)
+      {
+        type = 1;
+      }
+      else
+      {
+        continue;
+      }
+    }
+    entry.isDir = (type == 1);
+    entries.push_back(entry);
+  }
+  ::closedir(dp);
+  this->_Push(worker, entries);
+#else
+  worker.tag.Clear();
+  this->_Report(worker, dir, ID3E_NoFile);
+#endif
+}
+
+void ID3_ScannerImpl::_Scan(Worker& worker, const String& fileName)
+{
+  // the worker's tag is used over and over, so its frames are the only
+  // things allocated anew for each file
+  worker.tag.Clear();
+  worker.tag.SetLazyParsing(_is_lazy);
+  worker.tag.Link(fileName.c_str(), _tag_types);
+  this->_Report(worker, fileName, worker.tag.GetLastError());
+  ++worker.scanned;
+}
+
+void ID3_ScannerImpl::_Report(Worker& worker, const String& fileName, ID3_Err err)
+{
+  if (_out != NULL)
+  {
+    appendJSON(worker.json, fileName, worker.tag, err);
+    if (worker.json.size() >= FLUSH_SIZE)
+    {
+      this->_Flush(worker);
+    }
+  }
+  else
+  {
+    _result(fileName.c_str(), worker.tag, err, _data);
+  }
+}
+
+void ID3_ScannerImpl::_Flush(Worker& worker)
+{
+  if (_out == NULL || worker.json.empty())
+  {
+    return;
+  }
+  {
+#if defined ID3_WITH_THREADS
+    Locker locker(_out_lock);
+#endif
+    _out->write(worker.json.data(), worker.json.size());
+  }
+  // the buffer keeps its room for the next lines
+  worker.json.erase();
+}
+
+/** \class ID3_Scanner scan.h id3/scan.h
+ ** \brief Reads the tags of all the files in a directory tree.
+ **
+ ** The scanner walks the tree with a pool of worker threads.  Each worker
+ ** lists the directories and scans the files that it takes from a queue of
+ ** its own, and pushes what it finds in a directory onto that queue.  A
+ ** worker whose queue is empty steals from the queues of the others, so that
+ ** the listing of directories, the reading of files and the parsing of tags
+ ** go on at once, on all the processors, however the files are spread
+ ** through the tree.
+ **
+ ** Each worker links a tag of its own to each of its files in turn, so that
+ ** little but the frames is allocated anew for each file.  The result of each
+ ** file is either passed to a function, or written out as a line of JSON.
+ **
+ ** \code
+ **   void printTitle(const char* fileName, const ID3_Tag& tag, ID3_Err err,
+ **                   void* data)
+ **   {
+ **     // called on the workers' threads
+ **   }
+ **
+ **   ID3_Scanner scanner;
+ **   scanner.SetTagTypes(ID3TT_ID3V2);
+ **   size_t numFiles = scanner.Scan("/music", printTitle);
+ ** \endcode
+ **
+ ** Links to files are scanned, but links to directories are passed over, as
+ ** is anything that is neither a file nor a directory.  Where threads are not
+ ** available, Scan() does all the work itself, and where directories can't be
+ ** listed, only a file can be scanned.
+ **/
+
+/** Creates a scanner with the given number of workers.  By default there are
+ ** twice as many as there are processors, so that there is always a file
+ ** being read while others are parsed.
+ **/
+ID3_Scanner::ID3_Scanner(size_t workers)
+  : _impl(new ID3_ScannerImpl(workers))
+{
+}
+
+ID3_Scanner::~ID3_Scanner()
+{
+  delete _impl;
+}
+
+size_t ID3_Scanner::GetNumWorkers() const
+{
+  return _impl->GetNumWorkers();
+}
+
+/** Sets the tag types that the files are linked to.  By default, all types.
+ ** \sa ID3_Tag::Link()
+ **/
+void ID3_Scanner::SetTagTypes(flags_t types)
+{
+  _impl->SetTagTypes(types);
+}
+
+/** Sets whether the files are parsed lazily.
+ ** \sa ID3_Tag::SetLazyParsing()
+ **/
+void ID3_Scanner::SetLazyParsing(bool lazy)
+{
+  _impl->SetLazyParsing(lazy);
+}
+
+/** Scans the file, or all the files in the directory tree, and returns how
+ ** many files were scanned.  \c result is called with the tag of each file,
+ ** the tag's last error and \c data, or with an empty tag and ID3E_NoFile for
+ ** a directory which can't be listed.  It is called on the workers' threads,
+ ** at the same time for different files, so it must be thread-safe.
+ **
+ ** \param path The file or directory to scan.
+ ** \param result The function which is passed the result of each file.
+ ** \param data Passed on to \c result.
+ **/
+size_t ID3_Scanner::Scan(const char* path, ResultFunc result, void* data)
+{
+  return _impl->Scan(path, result, data, NULL);
+}
+
+/** Scans like Scan(), but writes the result of each file to the stream as a
+ ** line of JSON:
+ **
+ ** \code
+ **   {"file":"/music/song.mp3","error":0,"size":4021853,"v1":true,"v2":true,
+ **    "frames":[{"id":"TIT2","text":"Song"},{"id":"APIC"}]}
+ ** \endcode
+ **
+ ** The text of a frame is that of its text or url field.  Each worker writes
+ ** many lines at once, so the lines of different files are never mixed, but
+ ** their order is that in which they were scanned.
+ **/
+size_t ID3_Scanner::ScanToJSON(const char* path, ostream& out)
+{
+  return _impl->Scan(path, NULL, NULL, &out);
+}
@@ -25,7 +25,7 @@
 // id3lib.  These files are distributed with id3lib at
 // http://download.sourceforge.net/id3lib/
 
-//#include "readers.h"
+#include "readers.h"
 #include "writers.h"
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
 
@@ -162,6 +162,16 @@ using namespace dami;
  ** frames.  The Find() method is guaranteed to return all matching frames
  ** before it wraps around to return the first matching frame.
  **
+ ** Because it remembers where the last search left off, Find() changes the
+ ** tag, const or not.  FindFirst(), FindAll() and the Find() which takes an
+ ** ID3_Tag::Cursor of the caller's own leave it alone.  Once a tag has been
+ ** parsed, its const methods, and the const methods of its frames and
+ ** fields, only read it, so any number of threads may share the tag as long
+ ** as none of them changes it and none calls the Find() without a cursor.
+ ** The exception is a tag parsed lazily (see SetLazyParsing()), whose frames
+ ** are decoded the first time they are looked at: such a tag must be read
+ ** through once, by one thread, before it is shared.
+ **
  ** All ID3_Frame objects are comprised of a collection of ID3_Field objects.
  ** These fields can represent text, numbers, or binary data.  As with frames,
  ** fields can be accessed in a variety of manners.  The fields of a frame
@@ -338,8 +348,9 @@ void ID3_Tag::Clear()
 }
 
 
-/** Indicates whether the tag has been altered since the last parse, render,
- ** or update.
+/** Indicates whether the tag has been altered since the last parse or
+ ** update.  Render() leaves this as it is, since a tag that many threads
+ ** read may be rendered from any of them.
  **
  ** If you have a tag linked to a file, you do not need this method since the
  ** Update() method will check for changes before writing the tag.
@@ -476,6 +487,258 @@ bool ID3_Tag::SetPadding(bool pad)
   return _impl->SetPadding(pad);
 }
 
+/** Chooses how much padding is added to ID3v2 tags when padding is switched
+ ** on.
+ **
+ ** Files whose tags are changed again and again, such as play counts or
+ ** ratings, can be written in place more often with more padding than the
+ ** default 2K rounding leaves them.  The policies are:
+ **
+ ** - ID3PP_DEFAULT: the rounding described in SetPadding().
+ ** - ID3PP_FIXED: \c amount bytes of padding.
+ ** - ID3PP_PERCENT: \c amount percent of the size of the frames.
+ ** - ID3PP_BLOCK: rounds the whole tag up to a multiple of \c amount bytes
+ **   (4096 if \c amount is 0), so the audio data starts on a block boundary.
+ ** - ID3PP_ADAPTIVE: twice what the frames have grown since the tag was
+ **   last laid out anew (or read, if it hasn't been), but at least the
+ **   padding it had then, and at least \c amount bytes.  A tag that keeps
+ **   growing doubles its room each time it runs out, so the file is only
+ **   rewritten a few times.  Since the padding is written to the file, it
+ **   carries what was learned over to the next time the file is tagged.
+ **
+ ** With any policy other than ID3PP_DEFAULT, a tag which fits into the old
+ ** one keeps its size as long as that doesn't leave more than twice the
+ ** padding the policy asks for, or 4K, whichever is more.
+ **
+ ** \code
+ **   myTag.SetPaddingPolicy(ID3PP_ADAPTIVE, 1024);
+ ** \endcode
+ **
+ ** \param policy How to size the padding.
+ ** \param amount The parameter of the policy, see above.
+ ** \sa GetUpdateStats()
+ **/
+void ID3_Tag::SetPaddingPolicy(ID3_PaddingPolicy policy, size_t amount)
+{
+  _impl->SetPaddingPolicy(policy, amount);
+}
+
+ID3_PaddingPolicy ID3_Tag::GetPaddingPolicy() const
+{
+  return _impl->GetPaddingPolicy();
+}
+
+/** Turns lazy parsing of ID3v2 frames on or off for subsequent calls to
+ ** Link() and Parse().
+ **
+ ** When lazy parsing is switched on, only the frame headers are parsed when
+ ** the tag is read.  The fields of a frame are decoded the first time they
+ ** are needed, so reading a few frames of a large tag doesn't pay for
+ ** decoding the rest, such as attached pictures.  Frames that are never
+ ** changed are written back verbatim by Update() and Render(), without
+ ** being decoded at all.
+ **
+ ** By default, lazy parsing is switched off.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   myTag.SetLazyParsing(true);
+ **   myTag.Link("song.mp3");
+ ** \endcode
+ **
+ ** \param lazy Whether or not to decode frames only when they are needed.
+ **/
+bool ID3_Tag::SetLazyParsing(bool lazy)
+{
+  return _impl->SetLazyParsing(lazy);
+}
+
+bool ID3_Tag::GetLazyParsing() const
+{
+  return _impl->GetLazyParsing();
+}
+
+/** Makes Link() and Parse() keep the text of the frames they read as UTF-8,
+ ** whichever encoding each frame has in the file.
+ **
+ ** The text of each frame is converted to UTF-8 once, as it is parsed, and
+ ** back to the frame's encoding only when the tag is rendered.  The ASCII
+ ** accessors of a text field, such as GetRawText() and Get(char*, size_t),
+ ** and the helpers built on them, such as ID3_GetTitle(), give the text as
+ ** UTF-8 without converting it, and Size() is its length in bytes.  Text set
+ ** with Set(const char*) and Add(const char*) is taken to be UTF-8.  The
+ ** unicode accessors still work: the first of them to be called on a field
+ ** makes a UTF-16 copy of its text, which the field keeps until the text
+ ** changes.
+ **
+ ** Changing the encoding of such a field with SetEncoding() only changes the
+ ** encoding it is written in.  Text which that encoding can't hold, such as
+ ** UTF-8 text beyond ISO-8859-1 in a frame with an ISO-8859-1 encoding, is
+ ** lost when the tag is written, so set the ID3FN_TEXTENC field of such a
+ ** frame to ID3TE_UTF16 or ID3TE_UTF8.
+ **
+ ** By default, text is kept in the encoding each frame has.  Switching this
+ ** on or off doesn't affect the frames already in the tag, nor the frames the
+ ** application adds to it.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   myTag.SetUtf8Text(true);
+ **   myTag.Link("song.mp3");
+ **   char* title = ID3_GetTitle(&myTag); // UTF-8
+ ** \endcode
+ **
+ ** \param utf8 Whether or not to keep the text of parsed frames as UTF-8.
+ **/
+bool ID3_Tag::SetUtf8Text(bool utf8)
+{
+  return _impl->SetUtf8Text(utf8);
+}
+
+bool ID3_Tag::GetUtf8Text() const
+{
+  return _impl->GetUtf8Text();
+}
+
+/** Makes Link() and Parse() put the frames they read in an arena owned by the
+ ** tag, rather than allocating each frame, field and list entry on its own.
+ **
+ ** The arena hands out memory from a few large blocks, and takes it all back
+ ** at once when the tag is cleared, relinked or destroyed.  The largest block
+ ** is kept for the next file, so a tag that is linked to one file after
+ ** another hardly calls malloc for its frames at all.  Field values too long
+ ** to be kept in the field itself are still allocated on their own.
+ **
+ ** The frames of the tag behave as usual: a frame given back by RemoveFrame()
+ ** is moved out of the arena first, so the caller may keep and delete it as
+ ** before.  Frames added by the application aren't put in the arena, though
+ ** their list entries are; those of frames removed again are reused.
+ **
+ ** By default, the arena is switched off.  Switching it off doesn't affect
+ ** the frames already in it.
+ **
+ ** \param arena Whether or not to put parsed frames in the tag's arena.
+ **/
+bool ID3_Tag::SetArenaAllocation(bool arena)
+{
+  return _impl->SetArenaAllocation(arena);
+}
+
+bool ID3_Tag::GetArenaAllocation() const
+{
+  return _impl->GetArenaAllocation();
+}
+
+/** Returns an estimate of the number of bytes of memory the tag takes up, for
+ ** applications which keep many tags in memory and need to size their caches.
+ **
+ ** The estimate covers the tag, its frames and their fields, the values of
+ ** the fields, the tag's arena (see SetArenaAllocation()) and the file data
+ ** kept by a lazily parsed tag.  It leaves out what the allocator itself
+ ** adds to each block, and a value shared with a copy of its frame is counted
+ ** in full by both.
+ **
+ ** \code
+ **   ID3_Tag myTag("song.mp3");
+ **   cacheBytes += myTag.GetMemoryFootprint();
+ ** \endcode
+ **
+ ** 
+eturn The number of bytes the tag takes up.
+ **/
+size_t ID3_Tag::GetMemoryFootprint() const
+{
+  return _impl->GetMemoryFootprint();
+}
+
+/** Makes Update() compare each tag it is about to write with the bytes that
+ ** are in the file, and leave the file alone if they are the same.
+ **
+ ** A tag is marked as changed as soon as a field is set, even to the value it
+ ** already had, so jobs which set the same values over and over write every
+ ** file they touch.  With this switched on, such a tag costs a read instead
+ ** of a write.  The tags which weren't written are still returned by
+ ** Update(), along with ID3TT_UNCHANGED, and counted as ID3UM_SKIPPED by
+ ** GetUpdateStats().
+ **
+ ** By default, tags are written without comparing them.
+ **
+ ** \param skip Whether or not to skip writing tags the file already holds.
+ **/
+bool ID3_Tag::SetSkipUnchangedWrites(bool skip)
+{
+  return _impl->SetSkipUnchangedWrites(skip);
+}
+
+bool ID3_Tag::GetSkipUnchangedWrites() const
+{
+  return _impl->GetSkipUnchangedWrites();
+}
+
+/** Sets how many bytes Strip() and Update() move at a time when the audio
+ ** data has to be moved within the file or copied to a new one.
+ **
+ ** A larger buffer means fewer system calls for large files.  The buffer is
+ ** only allocated while the file is being rewritten.  Sizes below BUFSIZ
+ ** are raised to BUFSIZ.  The default is 4 MB.  Where id3lib is built with
+ ** threads, the buffer is used as two halves: one is read into while the
+ ** other is written out by a helper thread.
+ **
+ ** \param size The size of the buffer in bytes.
+ **/
+void ID3_Tag::SetFileBufferSize(size_t size)
+{
+  _impl->SetFileBufferSize(size);
+}
+
+size_t ID3_Tag::GetFileBufferSize() const
+{
+  return _impl->GetFileBufferSize();
+}
+
+/** Restricts which ID3v2 frames subsequent calls to Link() and Parse()
+ ** read.
+ **
+ ** With \c keep false, the given frames are skipped and all others are
+ ** parsed; with \c keep true, only the given frames are parsed.  A skipped
+ ** frame is passed over using the size in its header, without its data
+ ** being read or a frame being created for it, so an application which only
+ ** needs a few text frames needn't read the pictures in every file.
+ **
+ ** Since the skipped frames are not part of the tag, Update() refuses to
+ ** write an ID3v2 tag once frames have been skipped, and GetLastError()
+ ** returns ID3E_FramesSkipped.  Clear() the tag and link it without a filter
+ ** to write it.  A tag rendered with Render() does not contain the skipped
+ ** frames either.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   const ID3_FrameID wanted[] = { ID3FID_TITLE, ID3FID_LEADARTIST };
+ **   myTag.SetFrameFilter(wanted, 2, true);
+ **   myTag.Link("song.mp3");
+ ** \endcode
+ **
+ ** Passing no frames with \c keep false turns the filter off.
+ **
+ ** \param ids The frames to skip, or the frames to keep.
+ ** \param numIds The number of frames in \c ids.
+ ** \param keep Whether \c ids are the frames to keep rather than to skip.
+ **/
+void ID3_Tag::SetFrameFilter(const ID3_FrameID* ids, size_t numIds, bool keep)
+{
+  _impl->SetFrameFilter(ids, numIds, keep);
+}
+
+/** Returns the number of frames the frame filter has left out of the tag
+ ** since it was last cleared.
+ **
+ ** \sa SetFrameFilter()
+ **/
+size_t ID3_Tag::NumSkippedFrames() const
+{
+  return _impl->NumSkippedFrames();
+}
+
 bool ID3_Tag::SetExperimental(bool exp)
 {
   return _impl->SetExperimental(exp);
@@ -544,6 +807,29 @@ bool ID3_Tag::AttachFrame(ID3_Frame *frame)
   return _impl->AttachFrame(frame);
 }
 
+/** Attaches an array of frames to the tag; the tag takes responsibility for
+ ** releasing the frames' memory, just as with AttachFrame.
+ **
+ ** The frames are validated as a batch, which is considerably faster than
+ ** attaching them one at a time when there are many of them.  As with
+ ** AttachFrame, a frame that must be unique in a tag (a UFID frame with a
+ ** given owner, for example) replaces any earlier such frame, and invalid
+ ** frames are deleted.
+ **
+ ** \code
+ **   ID3_Frame* frames[2] = { new ID3_Frame(ID3FID_TITLE), new ID3_Frame(ID3FID_ALBUM) };
+ **   myTag.AttachFrames(frames, 2);
+ ** \endcode
+ **
+ ** \param frames An array of pointers to the frames to attach.
+ ** \param numFrames The number of frames in the array.
+ ** \return The number of frames of the array that remain in the tag.
+ **/
+size_t ID3_Tag::AttachFrames(ID3_Frame* const* frames, size_t numFrames)
+{
+  return _impl->AttachFrames(frames, numFrames);
+}
+
 
 /** Removes a frame from the tag.
  **
@@ -676,13 +962,16 @@ size_t ID3_Tag::Render(ID3_Writer& writer, ID3_TagType tt) const
   ID3_Writer::pos_type beg = writer.getCur();
   if (ID3TT_ID3V2 & tt)
   {
-    ID3_Err err = id3::v2::render(writer, *this);
+    // a const render leaves the tag, and its last error, alone
+    ID3_Err err = id3::v2::render(writer, *_impl);
     if (err != ID3E_NoError)
-      _impl->SetLastError(err);
+    {
+      ID3D_WARNING( "ID3_Tag::Render(): error rendering tag = " << err );
+    }
   }
   else if (ID3TT_ID3V1 & tt)
   {
-    id3::v1::render(writer, *this);
+    id3::v1::render(writer, *_impl);
   }
   return writer.getCur() - beg;
 }
@@ -763,6 +1052,26 @@ ID3_Err ID3_Tag::GetLastError()
   return _impl->GetLastError();
 }
 
+/** Tells how Update() has written the ID3v2 tags of this object: how many
+ ** were written over the old tag, how many had room made for them by
+ ** inserting blocks at the start of the file, and how many needed the whole
+ ** file to be rewritten, as well as how the last one was written.
+ **
+ ** When the frames of a linked file are the ones it was parsed with, and the
+ ** ones that changed render to as many bytes as they took up in the file,
+ ** Update() writes just those frames over themselves and counts the tag as
+ ** patched.  This needs the tag to be written with the spec it was read
+ ** with, so call SetSpec() with that spec to allow it for ID3v2.3 tags.  Tags
+ ** that are unsynchronized or have an extended header, and compressed
+ ** frames, are always rendered in full.
+ **
+ ** \sa SetPaddingPolicy()
+ **/
+void ID3_Tag::GetUpdateStats(ID3_UpdateStats& stats) const
+{
+  stats = _impl->GetUpdateStats();
+}
+
 /** Strips the tag(s) from the attached file. The type of tag stripped
  ** can be specified as a parameter.  The default is to strip all tag types.
  **
@@ -774,17 +1083,25 @@ flags_t ID3_Tag::Strip(flags_t flags)
   return _impl->Strip(flags);
 }
 
-size_t ID3_Tag::GetPrependedBytes() const
+/** The number of bytes taken by the tags at the start of the linked file.
+ ** Like GetAppendedBytes() and GetFileSize(), it is a 64-bit count, so that
+ ** it holds for files of over 4 GiB on 32-bit systems too.
+ **/
+uint64 ID3_Tag::GetPrependedBytes() const
 {
   return _impl->GetPrependedBytes();
 }
 
-size_t ID3_Tag::GetAppendedBytes() const
+/** The number of bytes taken by the tags at the end of the linked file.
+ **/
+uint64 ID3_Tag::GetAppendedBytes() const
 {
   return _impl->GetAppendedBytes();
 }
 
-size_t ID3_Tag::GetFileSize() const
+/** The size of the linked file, tags included.
+ **/
+uint64 ID3_Tag::GetFileSize() const
 {
   return _impl->GetFileSize();
 }
@@ -883,6 +1200,114 @@ ID3_Frame* ID3_Tag::Find(ID3_FrameID id, ID3_FieldID fld, const unicode_t* data)
   return _impl->Find(id, fld, str);
 }
 
+/** Returns a pointer to the first ID3_Frame with the given ID3_FrameID, or
+ ** NULL if the tag has none.
+ **
+ ** Unlike Find(), which resumes from where the last search of the tag left
+ ** off, FindFirst() always starts at the beginning and leaves the tag as it
+ ** was.  It is the search to use on a tag which is read by more than one
+ ** thread at once.  The overloads taking a field id and a value find the
+ ** first frame whose field matches, as Find() does.
+ **
+ ** \code
+ **   if (ID3_Frame* title = myTag.FindFirst(ID3FID_TITLE))
+ **   {
+ **     // ...
+ **   }
+ ** \endcode
+ **
+ ** \sa ID3_Tag#Find
+ ** \param id The ID of the frame that is to be located
+ **/
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id) const
+{
+  Cursor cursor;
+  return _impl->Find(cursor, id);
+}
+
+/// Finds the first frame with given frame id, fld id, and integer data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, uint32 data) const
+{
+  Cursor cursor;
+  return _impl->Find(cursor, id, fld, data);
+}
+
+/// Finds the first frame with given frame id, fld id, and ascii data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, const char* data) const
+{
+  Cursor cursor;
+  return _impl->Find(cursor, id, fld, String(data));
+}
+
+/// Finds the first frame with given frame id, fld id, and unicode data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, const unicode_t* data) const
+{
+  Cursor cursor;
+  return _impl->Find(cursor, id, fld, toWString(data, ucslen(data)));
+}
+
+/** Returns a pointer to the next ID3_Frame with the given ID3_FrameID after
+ ** the cursor, and moves the cursor past it; returns NULL, leaving the cursor
+ ** where it was, once there are no more.
+ **
+ ** The search doesn't wrap around, so a loop like the one below visits each
+ ** matching frame once.  The cursor belongs to the caller rather than to the
+ ** tag, so any number of threads may search a tag this way at the same time.
+ **
+ ** \code
+ **   ID3_Tag::Cursor cursor;
+ **   while (ID3_Frame* comment = myTag.Find(cursor, ID3FID_COMMENT))
+ **   {
+ **     // ...
+ **   }
+ ** \endcode
+ **
+ ** \param cursor Where the search starts, and is moved on to
+ ** \param id The ID of the frame that is to be located
+ **/
+ID3_Frame* ID3_Tag::Find(Cursor& cursor, ID3_FrameID id) const
+{
+  return _impl->Find(cursor, id);
+}
+
+/// Finds the next frame after cursor with given frame id, fld id, and integer data
+ID3_Frame* ID3_Tag::Find(Cursor& cursor, ID3_FrameID id, ID3_FieldID fld,
+                         uint32 data) const
+{
+  return _impl->Find(cursor, id, fld, data);
+}
+
+/// Finds the next frame after cursor with given frame id, fld id, and ascii data
+ID3_Frame* ID3_Tag::Find(Cursor& cursor, ID3_FrameID id, ID3_FieldID fld,
+                         const char* data) const
+{
+  return _impl->Find(cursor, id, fld, String(data));
+}
+
+/// Finds the next frame after cursor with given frame id, fld id, and unicode data
+ID3_Frame* ID3_Tag::Find(Cursor& cursor, ID3_FrameID id, ID3_FieldID fld,
+                         const unicode_t* data) const
+{
+  return _impl->Find(cursor, id, fld, toWString(data, ucslen(data)));
+}
+
+/** Copies pointers to the frames with the given ID3_FrameID, in the order
+ ** they appear in the tag, into frames.
+ **
+ ** At most maxFrames are copied, but the number of matching frames is
+ ** returned regardless, so that a caller whose array was too small can tell.
+ ** Like FindFirst(), this leaves the tag as it was.
+ **
+ ** \param id The ID of the frames that are to be located
+ ** \param frames Where the pointers are copied to
+ ** \param maxFrames The number of pointers frames has room for
+ ** \return The number of frames in the tag with the given id
+ **/
+size_t ID3_Tag::FindAll(ID3_FrameID id, ID3_Frame* frames[], size_t maxFrames) const
+{
+  return _impl->FindAll(id, frames, maxFrames);
+}
+
 /** Returns the number of frames present in the tag object.
  **
  ** This includes only those frames that id3lib recognises.  This is used as
@@ -972,7 +1397,8 @@ bool ID3_Tag::SetSpec(ID3_V2Spec spec)
 {
   //a user cannot set a spec lower than ID3V2_3_0, it's obsolete!
   ID3_V2Spec spec2use = spec < ID3V2_3_0 ? ID3V2_LATEST : spec;
-  _impl->UserUpdatedSpec = _impl->GetSpec() != spec2use;
+  // asking for the spec the tag was read with keeps Update() from upgrading it
+  _impl->UserUpdatedSpec = true;
   return _impl->SetSpec(spec2use);
 }
 
@@ -991,6 +1417,62 @@ size_t ID3_Tag::IsV2Tag(ID3_Reader& reader)
   return ID3_TagImpl::IsV2Tag(reader);
 }
 
+/** Finds out which tags a file has and where its audio data is, without
+ ** parsing the tags.
+ **
+ ** Only the headers of the id3v2 tags at the beginning of the file and the
+ ** footers of the tags at its end are read, and no frames are created, so
+ ** this is much cheaper than Link() when all that is needed is an overview
+ ** of many files.  Besides the tag types Link() knows, an APE tag at the end
+ ** of the file is recognized, so that it isn't counted as audio data.
+ **
+ ** \code
+ **   ID3_TagInfo info;
+ **   if (ID3_Tag::Probe("song.mp3", info) && (info.tags & ID3TT_ID3V2))
+ **   {
+ **     cout << "id3v2 tag of " << info.v2size << " bytes, " <<
+ **       info.v2padding << " of them padding" << endl;
+ **   }
+ ** \endcode
+ **
+ ** \param fileName The name of the file to probe.
+ ** \param info Receives what was found.
+ ** \return Whether the file could be read.
+ **/
+bool ID3_Tag::Probe(const char* fileName, ID3_TagInfo& info)
+{
+  if (NULL == fileName)
+  {
+    return false;
+  }
+  // as in ParseFile(), a mapped file spares a seek of the stream for every
+  // peek; the stream is only opened when the file can't be mapped
+  ID3_MappedFileReader mfr(fileName);
+  if (mfr.isMapped())
+  {
+    ID3_TagImpl::Probe(mfr, info);
+    return true;
+  }
+  ifstream file;
+  if (ID3E_NoError != openReadableFile(fileName, file))
+  {
+    return false;
+  }
+  ID3_IFStreamReader ifsr(file);
+  ID3_TagImpl::Probe(ifsr, info);
+  return true;
+}
+
+/** Probes the data from the reader's current position to its end.
+ **
+ ** \sa Probe(const char*, ID3_TagInfo&)
+ **/
+bool ID3_Tag::Probe(ID3_Reader& reader, ID3_TagInfo& info)
+{
+  ID3_TagImpl::Probe(reader, info);
+  return true;
+}
+
 /// Deprecated
 void ID3_Tag::AddNewFrame(ID3_Frame* f)
 {
@@ -27,8 +27,10 @@
 
 #include <stdio.h>  //for BUFSIZ and functions remove & rename
 #include "writers.h"
-#include "io_strings.h"
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "frame_impl.h"
+#include "io_strings.h"
+#include "io_helpers.h"
 
 using namespace dami;
 
@@ -44,9 +46,32 @@ using namespace dami;
 #  include <sys/stat.h>
 #endif
 
+#if defined HAVE_FCNTL_H && defined HAVE_UNISTD_H
+#  include <fcntl.h>
+#  include <errno.h>
+#  define ID3_COPY_WITH_FDS
+#  if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+#    include <sys/sendfile.h>
+#  endif
+#  if defined HAVE_LINUX_FS_H && defined HAVE_SYS_IOCTL_H
+#    include <sys/ioctl.h>
+#    include <linux/fs.h>
+#  endif
+#  if defined HAVE_FALLOCATE && defined HAVE_LINUX_FALLOC_H
+#    include <linux/falloc.h>
+#  endif
+#  if defined HAVE_FALLOCATE && defined FALLOC_FL_INSERT_RANGE && defined FALLOC_FL_COLLAPSE_RANGE
+#    define ID3_SHIFT_WITH_FALLOCATE
+#  endif
+#  if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#    include <pthread.h>
+#    define ID3_COPY_WITH_THREADS
+#  endif
+#endif
+
 #if defined WIN32 && (!defined(WINCE))
 #  include <windows.h>
-static int truncate(const char *path, size_t length)
+static int truncate(const char *path, uint64 length)
 {
   int result = -1;
   HANDLE fh;
@@ -61,7 +86,8 @@ static int truncate(const char *path, size_t length)
 
   if(INVALID_HANDLE_VALUE != fh)
   {
-    SetFilePointer(fh, length, NULL, FILE_BEGIN);
+    LONG high = (LONG)(length >> 32);
+    SetFilePointer(fh, (LONG)(length & 0xFFFFFFFF), &high, FILE_BEGIN);
     SetEndOfFile(fh);
     CloseHandle(fh);
     result = 0;
@@ -79,7 +105,7 @@ static int truncate(const char *path, size_t length)
 // Createfile is apparently to defined to CreateFileW. (Bad Bad Bad), so we
 // work around it by converting path to Unicode
 #  include <windows.h>
-static int truncate(const char *path, size_t length)
+static int truncate(const char *path, uint64 length)
 {
   int result = -1;
   wchar_t wcTempPath[256];
@@ -95,7 +121,8 @@ static int truncate(const char *path, size_t length)
 
   if (INVALID_HANDLE_VALUE != fh)
   {
-    SetFilePointer(fh, length, NULL, FILE_BEGIN);
+    LONG high = (LONG)(length >> 32);
+    SetFilePointer(fh, (LONG)(length & 0xFFFFFFFF), &high, FILE_BEGIN);
     SetEndOfFile(fh);
     CloseHandle(fh);
     result = 0;
@@ -106,7 +133,7 @@ static int truncate(const char *path, size_t length)
 
 #elif defined(macintosh)
 
-static int truncate(const char *path, size_t length)
+static int truncate(const char *path, uint64 length)
 {
    /* not implemented on the Mac */
    return -1;
@@ -114,6 +141,496 @@ static int truncate(const char *path, size_t length)
 
 #endif
 
+#if defined ID3_COPY_WITH_FDS
+
+namespace
+{
+  // the largest amount the copy calls are asked to move at once
+  const uint64 COPY_CHUNK_SIZE = 1 << 30;
+
+  // the smallest block worth handing to another thread to write
+  const size_t OVERLAP_BLOCK_SIZE = 512 * 1024;
+
+  // Reads up to count bytes at off into buffer; returns how many were read,
+  // which is less than count only at the end of the file or on an error
+  size_t readBlock(int fd, char* buffer, size_t count, uint64 off)
+  {
+    size_t done = 0;
+    while (done < count)
+    {
+      ssize_t n = ::pread(fd, buffer + done, count - done, off + done);
+      if (n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (n <= 0)
+      {
+        break;
+      }
+      done += n;
+    }
+    return done;
+  }
+
+  // Writes count bytes from buffer at off; returns how many were written
+  size_t writeBlock(int fd, const char* buffer, size_t count, uint64 off)
+  {
+    size_t done = 0;
+    while (done < count)
+    {
+      ssize_t n = ::pwrite(fd, buffer + done, count - done, off + done);
+      if (n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (n <= 0)
+      {
+        break;
+      }
+      done += n;
+    }
+    return done;
+  }
+
+#if defined ID3_COPY_WITH_THREADS
+  // Writes the blocks handed to it on a thread of its own, one at a time, so
+  // that the next block can be read while the last one is written
+  class BlockWriter
+  {
+  public:
+    BlockWriter(int fd)
+      : _fd(fd), _buffer(NULL), _count(0), _off(0), _written(0),
+        _pending(false), _failed(false), _closing(false), _started(false)
+    {
+      pthread_mutex_init(&_lock, NULL);
+      pthread_cond_init(&_changed, NULL);
+    }
+    ~BlockWriter()
+    {
+      this->Finish();
+      pthread_cond_destroy(&_changed);
+      pthread_mutex_destroy(&_lock);
+    }
+
+    bool Start()
+    {
+      _started = pthread_create(&_thread, NULL, work, this) == 0;
+      return _started;
+    }
+
+    // Waits for the block handed over before, then hands over this one; the
+    // caller mustn't touch buffer until the next call returns.  Returns false
+    // if an earlier block couldn't be written.
+    bool Write(const char* buffer, size_t count, uint64 off)
+    {
+      pthread_mutex_lock(&_lock);
+      while (_pending)
+      {
+        pthread_cond_wait(&_changed, &_lock);
+      }
+      bool ok = !_failed;
+      if (ok)
+      {
+        _buffer = buffer;
+        _count = count;
+        _off = off;
+        _pending = true;
+        pthread_cond_broadcast(&_changed);
+      }
+      pthread_mutex_unlock(&_lock);
+      return ok;
+    }
+
+    // Waits for the last block and ends the thread; returns the number of
+    // bytes written
+    uint64 Finish()
+    {
+      if (_started)
+      {
+        pthread_mutex_lock(&_lock);
+        _closing = true;
+        pthread_cond_broadcast(&_changed);
+        pthread_mutex_unlock(&_lock);
+        pthread_join(_thread, NULL);
+        _started = false;
+      }
+      return _written;
+    }
+
+  private:
+    static void* work(void* writer)
+    {
+      static_cast<BlockWriter*>(writer)->Work();
+      return NULL;
+    }
+
+    void Work()
+    {
+      pthread_mutex_lock(&_lock);
+      for (;;)
+      {
+        while (!_pending && !_closing)
+        {
+          pthread_cond_wait(&_changed, &_lock);
+        }
+        if (!_pending)
+        {
+          break;
+        }
+        const char* buffer = _buffer;
+        size_t count = _count;
+        uint64 off = _off;
+        pthread_mutex_unlock(&_lock);
+        size_t written = writeBlock(_fd, buffer, count, off);
+        pthread_mutex_lock(&_lock);
+        _written += written;
+        _failed = written < count;
+        _pending = false;
+        pthread_cond_broadcast(&_changed);
+      }
+      pthread_mutex_unlock(&_lock);
+    }
+
+    int        _fd;
+    const char* _buffer;       // the block handed over
+    size_t     _count;
+    uint64     _off;
+    uint64     _written;       // bytes written so far
+    bool       _pending;       // is there a block to write?
+    bool       _failed;        // did a block fall short?
+    bool       _closing;       // is the thread to end once idle?
+    bool       _started;
+    pthread_t  _thread;
+    pthread_mutex_t _lock;     // guards all of the above
+    pthread_cond_t _changed;   // a block was handed over or written
+  };
+
+  // Copies as bufferData() does, reading each half of the buffer while the
+  // other half is written.  When dst is src, the block being written always
+  // lies before the one being read, as the data moves towards the start.
+  // Returns false, having copied nothing, if no thread could be started.
+  bool overlapData(int src, uint64 src_off, int dst, uint64 dst_off, uint64 size,
+                   size_t bufferSize, uint64& done)
+  {
+    BlockWriter writer(dst);
+    if (!writer.Start())
+    {
+      return false;
+    }
+    const size_t half = bufferSize / 2;
+    char* buffers[2] = { new char[half], new char[half] };
+    uint64 read = 0;
+    for (size_t i = 0; read < size; i = 1 - i)
+    {
+      size_t count = size - read < half ? size - read : half;
+      size_t n = readBlock(src, buffers[i], count, src_off + read);
+      if (n == 0 || !writer.Write(buffers[i], n, dst_off + read))
+      {
+        break;
+      }
+      read += n;
+      if (n < count)
+      {
+        break;
+      }
+    }
+    done = writer.Finish();
+    delete [] buffers[0];
+    delete [] buffers[1];
+    return true;
+  }
+#endif
+
+  // Copies size bytes from src at src_off to dst at dst_off through a buffer
+  // of bufferSize bytes.  src and dst may be the same file, as long as the
+  // data is moved towards its start.  Returns the number of bytes copied.
+  uint64 bufferData(int src, uint64 src_off, int dst, uint64 dst_off, uint64 size,
+                    size_t bufferSize)
+  {
+    uint64 done = 0;
+#if defined ID3_COPY_WITH_THREADS
+    // with more than one block to move, overlap the reads and the writes,
+    // unless the blocks are so small that handing them over costs more
+    if (size > bufferSize / 2 && bufferSize / 2 >= OVERLAP_BLOCK_SIZE &&
+        overlapData(src, src_off, dst, dst_off, size, bufferSize, done))
+    {
+      return done;
+    }
+#endif
+    char* buffer = new char[bufferSize];
+    while (done < size)
+    {
+      size_t count = size - done < bufferSize ? size - done : bufferSize;
+      size_t n = readBlock(src, buffer, count, src_off + done);
+      if (n == 0)
+      {
+        break;
+      }
+      size_t written = writeBlock(dst, buffer, n, dst_off + done);
+      done += written;
+      if (written < n || n < count)
+      {
+        break;
+      }
+    }
+    delete [] buffer;
+    return done;
+  }
+
+  // Copies size bytes from src at src_off to dst at dst_off, letting the
+  // kernel move the data where it can.  Returns the number of bytes copied.
+  uint64 copyData(int src, uint64 src_off, int dst, uint64 dst_off, uint64 size,
+                  size_t bufferSize)
+  {
+    uint64 done = 0;
+#if defined HAVE_COPY_FILE_RANGE
+    while (done < size)
+    {
+      loff_t in = src_off + done, out = dst_off + done;
+      size_t count = size - done < COPY_CHUNK_SIZE ? size - done : COPY_CHUNK_SIZE;
+      ssize_t n = ::copy_file_range(src, &in, dst, &out, count, 0);
+      if (n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (n <= 0)
+      {
+        // not supported between these files, or an error: try the next way
+        ID3D_NOTICE( "copyData: copy_file_range stopped, errno = " << errno );
+        break;
+      }
+      done += n;
+    }
+#endif
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+    if (done < size && ::lseek(dst, dst_off + done, SEEK_SET) != (off_t) -1)
+    {
+      while (done < size)
+      {
+        off_t in = src_off + done;
+        size_t count = size - done < COPY_CHUNK_SIZE ? size - done : COPY_CHUNK_SIZE;
+        ssize_t n = ::sendfile(dst, src, &in, count);
+        if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        if (n <= 0)
+        {
+          ID3D_NOTICE( "copyData: sendfile stopped, errno = " << errno );
+          break;
+        }
+        done += n;
+      }
+    }
+#endif
+    if (done < size)
+    {
+      // through user space, but in far fewer calls than with BUFSIZ chunks
+      done += bufferData(src, src_off + done, dst, dst_off + done, size - done,
+                         bufferSize);
+    }
+    return done;
+  }
+
+#if defined FICLONERANGE
+  // Makes dst share the blocks of src from src_off to its end, appending them
+  // at dst_off, on file systems that can do so (btrfs, XFS).  Whole blocks
+  // can only be shared at the same offset within a block, so this is only
+  // tried when both offsets agree; the bytes up to the first block boundary
+  // are copied.  Returns the number of bytes dealt with.
+  uint64 cloneData(int src, uint64 src_off, int dst, uint64 dst_off, uint64 size)
+  {
+    struct stat dstStat;
+    if (::fstat(dst, &dstStat) != 0 || dstStat.st_blksize <= 0)
+    {
+      return 0;
+    }
+    const uint64 block = dstStat.st_blksize;
+    if (src_off % block != dst_off % block)
+    {
+      return 0;
+    }
+    const uint64 head = (block - src_off % block) % block;
+    if (head >= size || copyData(src, src_off, dst, dst_off, head, BUFSIZ) < head)
+    {
+      return 0;
+    }
+    struct file_clone_range range;
+    range.src_fd = src;
+    range.src_offset = src_off + head;
+    range.src_length = 0; // up to the end of src
+    range.dest_offset = dst_off + head;
+    if (::ioctl(dst, FICLONERANGE, &range) != 0)
+    {
+      ID3D_NOTICE( "cloneData: FICLONERANGE failed, errno = " << errno );
+      return head;
+    }
+    return size;
+  }
+#endif
+
+  // Appends the contents of the file from, starting at offset, to the file to
+  bool appendFileData(const char* from, uint64 offset, const char* to,
+                      size_t bufferSize)
+  {
+    int src = ::open(from, O_RDONLY);
+    if (src < 0)
+    {
+      return false;
+    }
+    int dst = ::open(to, O_WRONLY);
+    if (dst < 0)
+    {
+      ::close(src);
+      return false;
+    }
+    struct stat srcStat;
+    off_t dst_off = ::lseek(dst, 0, SEEK_END);
+    bool ok = ::fstat(src, &srcStat) == 0 && dst_off != (off_t) -1;
+    uint64 size = 0;
+    if (ok && static_cast<uint64>(srcStat.st_size) > offset)
+    {
+      size = srcStat.st_size - offset;
+    }
+    uint64 done = 0;
+#if defined FICLONERANGE
+    if (ok)
+    {
+      done = cloneData(src, offset, dst, dst_off, size);
+    }
+#endif
+    if (ok && done < size)
+    {
+      done += copyData(src, offset + done, dst, dst_off + done, size - done,
+                       bufferSize);
+    }
+    ok = ok && done == size;
+    ::close(src);
+    if (::close(dst) != 0)
+    {
+      ok = false;
+    }
+    return ok;
+  }
+
+  // Moves size bytes at offset to the start of the file, with positioned
+  // reads and writes rather than seeking back and forth on one stream
+  bool moveFileData(const char* name, uint64 offset, uint64 size,
+                    size_t bufferSize)
+  {
+    int fd = ::open(name, O_RDWR);
+    if (fd < 0)
+    {
+      return false;
+    }
+    bool ok = bufferData(fd, offset, fd, 0, size, bufferSize) == size;
+    if (::close(fd) != 0)
+    {
+      ok = false;
+    }
+    return ok;
+  }
+#if defined ID3_SHIFT_WITH_FALLOCATE
+  // Returns the block size of the file system the file lives on, or 0 if it
+  // can't be found out
+  uint64 blockSize(const char* name)
+  {
+    struct stat fileStat;
+    if (::stat(name, &fileStat) != 0 || fileStat.st_blksize <= 0)
+    {
+      return 0;
+    }
+    return fileStat.st_blksize;
+  }
+
+  // Inserts size bytes at the start of the file, or removes them, moving the
+  // rest of the file by remapping its blocks on file systems that can do so
+  // (ext4, XFS).  size has to be a multiple of the block size.
+  bool shiftFileData(const char* name, uint64 size, bool insert)
+  {
+    int fd = ::open(name, O_WRONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+    int mode = insert ? FALLOC_FL_INSERT_RANGE : FALLOC_FL_COLLAPSE_RANGE;
+    bool ok = ::fallocate(fd, mode, 0, size) == 0;
+    if (!ok)
+    {
+      ID3D_NOTICE( "shiftFileData: fallocate failed, errno = " << errno );
+    }
+    if (::close(fd) != 0)
+    {
+      ok = false;
+    }
+    return ok;
+  }
+
+  // Makes room for the new tag by inserting whole blocks in front of the old
+  // one, padding the tag out to fill them.  The tag can't be padded if the
+  // user switched padding off, or if an extended header or footer would have
+  // to describe the padding, in which case the tag must grow by whole blocks
+  // on its own.  Returns false if the file was left alone.
+  bool growInPlace(const ID3_TagImpl& tag, String& tagString)
+  {
+    const uint64 oldSize = tag.GetPrependedBytes();
+    const uint64 block = blockSize(tag.GetFileName().c_str());
+    if (block == 0 || tagString.size() <= oldSize)
+    {
+      return false;
+    }
+    if (tagString.size() % block == 0 && oldSize % block != 0)
+    {
+      // the padding lines the audio up with the blocks, which inserting
+      // blocks can't do: rewrite the file once, later insertions keep it so
+      return false;
+    }
+    const uint64 growth = tagString.size() - oldSize;
+    const uint64 insert = ((growth + block - 1) / block) * block;
+    if (insert != growth &&
+        (!tag.GetPadding() || tag.GetExtended() || tag.GetFooter()))
+    {
+      return false;
+    }
+    if (!shiftFileData(tag.GetFileName().c_str(), insert, true))
+    {
+      return false;
+    }
+    if (insert != growth)
+    {
+      tagString.append(insert - growth, '\0');
+      String sizeBytes;
+      io::StringWriter writer(sizeBytes);
+      io::writeUInt28(writer, tagString.size() - ID3_TagHeader::SIZE);
+      tagString.replace(ID3_TagHeader::SIZE_OFFSET, sizeBytes.size(), sizeBytes);
+    }
+    return true;
+  }
+#endif /* ID3_SHIFT_WITH_FALLOCATE */
+};
+
+#endif /* ID3_COPY_WITH_FDS */
+
+namespace
+{
+  // Tells whether the file already holds size bytes of data at offset
+  bool fileHolds(fstream& file, streamoff offset, const char* data, size_t size)
+  {
+    file.clear();
+    file.seekg(offset, ios::beg);
+    char buffer[BUFSIZ];
+    bool same = true;
+    for (size_t done = 0; same && done < size; done += sizeof(buffer))
+    {
+      size_t count = size - done < sizeof(buffer) ? size - done : sizeof(buffer);
+      file.read(buffer, count);
+      same = (size_t) file.gcount() == count && memcmp(buffer, data + done, count) == 0;
+    }
+    file.clear();
+    return same;
+  }
+};
+
 size_t ID3_TagImpl::Link(const char *fileInfo, bool parseID3v1, bool parseLyrics3)
 {
   flags_t tt = ID3TT_NONE;
@@ -158,13 +675,18 @@ size_t ID3_TagImpl::Link(ID3_Reader &reader, flags_t tag_types)
   return this->GetPrependedBytes();
 }
 
-size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
+size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file, bool& skipped)
 {
+  skipped = false;
   if (!file)
   {
     return 0;
   }
 
+  String tagString;
+  io::StringWriter writer(tagString);
+  id3::v1::render(writer, tag);
+
   // Heck no, this is stupid.  If we do not read in an initial V1(.1)
   // header then we are constantly appending new V1(.1) headers. Files
   // can get very big that way if we never overwrite the old ones.
@@ -187,6 +709,13 @@ size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
     // so we should set the file cursor so we can overwrite it with a new tag.
     if (memcmp(sID, "TAG", ID3_V1_LEN_ID) == 0)
     {
+      streamoff tagStart = (streamoff) file.tellg() - ID3_V1_LEN_ID;
+      if (tag.GetSkipUnchangedWrites() &&
+          fileHolds(file, tagStart, tagString.data(), tagString.size()))
+      {
+        skipped = true;
+        return ID3_V1_LEN;
+      }
       file.seekp(0-ID3_V1_LEN, ios::end);
     }
     // Otherwise, set the cursor to the end of the file so we can append on
@@ -197,16 +726,19 @@ size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
     }
   }
 
-  ID3_IOStreamWriter out(file);
-
-  id3::v1::render(out, tag);
+  file.write(tagString.data(), tagString.size());
 
   return ID3_V1_LEN;
 }
 
-size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
+// Writes the id3v2 tag to the file, and tells how it was written and how much
+// padding the tag was given
+size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file,
+                      ID3_UpdateMode& mode, size_t& padding)
 {
   ID3_Err err = ID3E_NoError;
+  mode = ID3UM_NONE;
+  padding = 0;
 
   ID3D_NOTICE( "RenderV2ToFile: starting" );
   if (!file)
@@ -217,7 +749,7 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
 
   String tagString;
   io::StringWriter writer(tagString);
-  err = id3::v2::render(writer, tag);
+  err = id3::v2::render(writer, tag, &padding);
   if (err != ID3E_NoError)
   {
     return (size_t)err; //impossible size, will make caller be able to set _last_error
@@ -225,18 +757,42 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
 
   ID3D_NOTICE( "RenderV2ToFile: rendered v2" );
 
+  bool inPlace = (!tag.GetPrependedBytes() && !ID3_GetDataSize(tag)) ||
+                 (tagString.size() == tag.GetPrependedBytes());
+  mode = ID3UM_INPLACE;
+  if (inPlace && tag.GetPrependedBytes() > 0 && tag.GetSkipUnchangedWrites() &&
+      fileHolds(file, 0, tagString.data(), tagString.size()))
+  {
+    ID3D_NOTICE( "RenderV2ToFile: the file already holds the tag" );
+    mode = ID3UM_SKIPPED;
+    return tagString.size();
+  }
+#if defined ID3_SHIFT_WITH_FALLOCATE
+  // rather than rewriting the whole file, make room for a larger tag where
+  // the file system can insert blocks at the start of the file
+  const size_t renderedSize = tagString.size();
+  if (!inPlace && growInPlace(tag, tagString))
+  {
+    ID3D_NOTICE( "RenderV2ToFile: inserted blocks for a tag of " << tagString.size() << " bytes" );
+    padding += tagString.size() - renderedSize;
+    inPlace = true;
+    mode = ID3UM_INSERTED;
+  }
+#endif
+
   const char* tagData = tagString.data();
   size_t tagSize = tagString.size();
   // if the new tag fits perfectly within the old and the old one
-  // actually existed (ie this isn't the first tag this file has had)
-  if ((!tag.GetPrependedBytes() && !ID3_GetDataSize(tag)) ||
-      (tagSize == tag.GetPrependedBytes()))
+  // actually existed (ie this isn't the first tag this file has had),
+  // or room was made for it above
+  if (inPlace)
   {
     file.seekp(0, ios::beg);
     file.write(tagData, tagSize);
   }
   else
   {
+    mode = ID3UM_REWRITTEN;
     String filename = tag.GetFileName();
     String sTmpSuffix = ".XXXXXX";
     if (filename.size() + sTmpSuffix.size() > ID3_PATH_LENGTH)
@@ -261,6 +817,17 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
     }
 
     tmpOut.write(tagData, tagSize);
+#if defined ID3_COPY_WITH_FDS
+    // copy the audio with file descriptors, so the kernel can share or move
+    // the data without it passing through the streams
+    tmpOut.close();
+    if (!tmpOut || !appendFileData(filename.c_str(), tag.GetPrependedBytes(), sTempFile,
+                                   tag.GetFileBufferSize()))
+    {
+      remove(sTempFile);
+      return (size_t)ID3E_NoFile; //impossible size, will make caller be able to set _last_error
+    }
+#else
     file.seekg(tag.GetPrependedBytes(), ios::beg);
     char *tmpBuffer[BUFSIZ];
     while (!file.eof())
@@ -269,6 +836,7 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
       size_t nBytes = file.gcount();
       tmpOut.write((char *)tmpBuffer, nBytes);
     }
+#endif
 
 #else //((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
 
@@ -335,9 +903,76 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
 }
 
 
+/** Brings the file's id3v2 tag up to date by writing the frames that changed
+ ** over themselves, which is all it takes when the tag still has the frames it
+ ** was parsed with, with the same spec, and each changed frame renders to as
+ ** many bytes as it took up before.  Otherwise nothing is written, false is
+ ** returned, and the tag has to be rendered in full.
+ **/
+bool ID3_TagImpl::_PatchFrames(fstream& file, ID3_UpdateMode& mode)
+{
+  if (!_patchable || this->GetSpec() != _patch_spec ||
+      _frames.size() != _patch_frames)
+  {
+    return false;
+  }
+
+  // render all the changed frames before writing any of them, so the file is
+  // left alone if one of them doesn't fit
+  typedef std::pair<size_t, String> Patch;
+  std::vector<Patch> patches;
+  for (const_iterator fi = _frames.begin(); fi != _frames.end(); ++fi)
+  {
+    ID3_FrameImpl& frame = ID3_FrameImpl::Get(**fi);
+    if (!frame.HasChanged())
+    {
+      continue;
+    }
+    if (frame.GetFileSize() == 0 || frame.GetCompression())
+    {
+      return false;
+    }
+    patches.push_back(Patch(frame.GetFileOffset(), String()));
+    io::StringWriter writer(patches.back().second);
+    if (frame.Render(writer) != ID3E_NoError ||
+        patches.back().second.size() != frame.GetFileSize())
+    {
+      ID3D_NOTICE( "ID3_TagImpl::_PatchFrames(): " << frame.GetTextID() <<
+                   " changed size, rendering the tag" );
+      return false;
+    }
+  }
+
+  size_t written = 0;
+  for (size_t i = 0; i < patches.size(); ++i)
+  {
+    const String& data = patches[i].second;
+    if (_skip_unchanged &&
+        fileHolds(file, patches[i].first, data.data(), data.size()))
+    {
+      continue;
+    }
+    file.seekp(patches[i].first, ios::beg);
+    file.write(data.data(), data.size());
+    ++written;
+  }
+  file.flush();
+  if (file.fail())
+  {
+    // the whole tag is written over whatever part of it was patched
+    file.clear();
+    return false;
+  }
+  ID3D_NOTICE( "ID3_TagImpl::_PatchFrames(): wrote " << written << " of " <<
+               patches.size() << " changed frames" );
+  mode = (written == 0 && _skip_unchanged) ? ID3UM_SKIPPED : ID3UM_PATCHED;
+  return true;
+}
+
 flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 {
   flags_t tags = ID3TT_NONE;
+  bool refused = false;
 
   fstream file;
   String filename = this->GetFileName();
@@ -353,7 +988,15 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
     return tags;
   }
 
-  if ((ulTagFlag & ID3TT_ID3V2) && this->HasChanged())
+  if ((ulTagFlag & ID3TT_ID3V2) && this->HasChanged() && _num_skipped > 0)
+  {
+    // writing the tag would silently drop the frames that weren't parsed
+    ID3D_WARNING( "ID3_TagImpl::Update(): " << _num_skipped <<
+                  " frames were skipped while parsing, not writing id3v2 tag" );
+    _last_error = ID3E_FramesSkipped;
+    refused = true;
+  }
+  else if ((ulTagFlag & ID3TT_ID3V2) && this->HasChanged())
   {
     ID3_V2Spec spec2use;
     if (this->UserUpdatedSpec) // if the spec is too old, upgrade anyway. And never use experimental ones
@@ -363,23 +1006,40 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 
     this->SetSpec(spec2use);
     this->checkFrames();
-    _prepended_bytes = RenderV2ToFile(*this, file);
-    if (_prepended_bytes < 17) //17 = minimal tag size, errors should not be higher numbered than 16
+    ID3_UpdateMode mode;
+    size_t padding = 0;
+    if (!this->_PatchFrames(file, mode))
     {
-      //must be an error
-      _last_error = (ID3_Err)_prepended_bytes;
-      _prepended_bytes = 0;
+      _prepended_bytes = RenderV2ToFile(*this, file, mode, padding);
+      if (_prepended_bytes < 17) //17 = minimal tag size, errors should not be higher numbered than 16
+      {
+        //must be an error
+        _last_error = (ID3_Err)_prepended_bytes;
+        _prepended_bytes = 0;
+      }
     }
     if (_prepended_bytes)
     {
+      // the frames are now as they are in the file
+      this->_SetFramesUnchanged();
       tags |= ID3TT_ID3V2;
+      if (mode == ID3UM_SKIPPED)
+      {
+        tags |= ID3TT_UNCHANGED;
+      }
+      this->_Updated(mode, padding);
     }
   }
 
   if ((ulTagFlag & ID3TT_ID3V1) &&
       (!this->HasTagType(ID3TT_ID3V1) || this->HasChanged()))
   {
-    size_t tag_bytes = RenderV1ToFile(*this, file);
+    bool skipped;
+    size_t tag_bytes = RenderV1ToFile(*this, file, skipped);
+    if (skipped)
+    {
+      tags |= ID3TT_UNCHANGED;
+    }
     if (tag_bytes)
     {
       // only add the tag_bytes if there wasn't an id3v1 tag before
@@ -390,8 +1050,9 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
       tags |= ID3TT_ID3V1;
     }
   }
-  _changed = false;
-  _file_tags.add(tags);
+  // the id3v2 tag is still out of date if it was refused
+  _changed = refused;
+  _file_tags.add(tags & ~ID3TT_UNCHANGED);
   _file_size = getFileSize(file);
   file.close();
   return tags;
@@ -400,11 +1061,12 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
 {
   flags_t ulTags = ID3TT_NONE;
-  const size_t data_size = ID3_GetDataSize(*this);
+  const uint64 data_size = ID3_GetDataSize(*this);
 
   // First remove the v2 tag, if requested
   if (ulTagFlag & ID3TT_PREPENDED & _file_tags.get())
   {
+    _patchable = false;
     fstream file;
     _last_error = openWritableFile(this->GetFileName(), file);
     if (ID3E_NoError != _last_error)
@@ -413,65 +1075,87 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
     }
     _file_size = getFileSize(file);
 
-    // We will remove the id3v2 tag in place: since it comes at the beginning
-    // of the file, we'll effectively move all the data that comes after the
-    // tag back n bytes, where n is the size of the id3v2 tag.  Once we've
-    // copied the data, we'll truncate the file.
-    file.seekg(this->GetPrependedBytes(), ios::beg);
-
-    uchar aucBuffer[BUFSIZ];
-
-    // The nBytesRemaining variable indicates how many bytes are to be copied
-    size_t nBytesToCopy = data_size;
-
-    // Here we increase the nBytesToCopy by the size of any tags that appear
-    // at the end of the file if we don't want to strip them
-    if (!(ulTagFlag & ID3TT_APPENDED))
-    {
-      nBytesToCopy += this->GetAppendedBytes();
-    }
-
-    // The nBytesRemaining variable indicates how many bytes are left to be
-    // moved in the actual file.
-    // The nBytesCopied variable keeps track of how many actual bytes were
-    // copied (or moved) so far.
-    size_t
-      nBytesRemaining = nBytesToCopy,
-      nBytesCopied = 0;
-    while (!file.eof())
-    {
-#if (defined(__GNUC__) && __GNUC__ == 2)
-      size_t nBytesToRead = (size_t)dami::min((unsigned int)(nBytesRemaining - nBytesCopied), (unsigned int)BUFSIZ);
+#if defined ID3_SHIFT_WITH_FALLOCATE
+    // A tag that takes up whole blocks can be cut off the start of the file
+    // without moving the data after it.  Any appended tags to be stripped
+    // are truncated below, as usual.
+    const uint64 block = blockSize(this->GetFileName().c_str());
+    bool collapsed = block > 0 && this->GetPrependedBytes() % block == 0 &&
+      shiftFileData(this->GetFileName().c_str(), this->GetPrependedBytes(), false);
 #else
-      size_t nBytesToRead = min((unsigned int)(nBytesRemaining - nBytesCopied), (unsigned int)BUFSIZ);
+    bool collapsed = false;
 #endif
-      file.read((char *)aucBuffer, nBytesToRead);
-      size_t nBytesRead = file.gcount();
+    if (!collapsed)
+    {
+      // We will remove the id3v2 tag in place: since it comes at the beginning
+      // of the file, we'll effectively move all the data that comes after the
+      // tag back n bytes, where n is the size of the id3v2 tag.  Once we've
+      // copied the data, we'll truncate the file.
+
+      // The nBytesToCopy variable indicates how many bytes are to be copied
+      uint64 nBytesToCopy = data_size;
 
-      if (nBytesRead != nBytesToRead)
+      // Here we increase the nBytesToCopy by the size of any tags that appear
+      // at the end of the file if we don't want to strip them
+      if (!(ulTagFlag & ID3TT_APPENDED))
       {
-        // TODO: log this
-        //cerr << "--- attempted to write " << nBytesRead << " bytes, "
-        //     << "only wrote " << nBytesWritten << endl;
+        nBytesToCopy += this->GetAppendedBytes();
       }
-      if (nBytesRead > 0)
+
+#if defined ID3_COPY_WITH_FDS
+      file.close();
+      if (!moveFileData(this->GetFileName().c_str(), this->GetPrependedBytes(),
+                        nBytesToCopy, _buffer_size))
       {
-        long offset = nBytesRead + this->GetPrependedBytes();
-        file.seekp(-offset, ios::cur);
-        file.write((char *)aucBuffer, nBytesRead);
-        file.seekg(this->GetPrependedBytes(), ios::cur);
-        nBytesCopied += nBytesRead;
+        // log this
+        _last_error = ID3E_NoFile;
+        return ulTags;
       }
-
-      if (nBytesCopied == nBytesToCopy || nBytesToRead < BUFSIZ)
+#else
+      file.seekg(this->GetPrependedBytes(), ios::beg);
+
+      uchar aucBuffer[BUFSIZ];
+
+      // The nBytesRemaining variable indicates how many bytes are left to be
+      // moved in the actual file.
+      // The nBytesCopied variable keeps track of how many actual bytes were
+      // copied (or moved) so far.
+      uint64
+        nBytesRemaining = nBytesToCopy,
+        nBytesCopied = 0;
+      while (!file.eof())
       {
-        break;
+        uint64 nBytesLeft = nBytesRemaining - nBytesCopied;
+        size_t nBytesToRead = (size_t)min(nBytesLeft, (uint64)BUFSIZ);
+        file.read((char *)aucBuffer, nBytesToRead);
+        size_t nBytesRead = file.gcount();
+
+        if (nBytesRead != nBytesToRead)
+        {
+          // TODO: log this
+          //cerr << "--- attempted to write " << nBytesRead << " bytes, "
+          //     << "only wrote " << nBytesWritten << endl;
+        }
+        if (nBytesRead > 0)
+        {
+          long offset = nBytesRead + this->GetPrependedBytes();
+          file.seekp(-offset, ios::cur);
+          file.write((char *)aucBuffer, nBytesRead);
+          file.seekg(this->GetPrependedBytes(), ios::cur);
+          nBytesCopied += nBytesRead;
+        }
+
+        if (nBytesCopied == nBytesToCopy || nBytesToRead < BUFSIZ)
+        {
+          break;
+        }
       }
+#endif
     }
     file.close();
   }
 
-  size_t nNewFileSize = data_size;
+  uint64 nNewFileSize = data_size;
 
   if ((_file_tags.get() & ID3TT_APPENDED) && (ulTagFlag & ID3TT_APPENDED))
   {
@@ -25,7 +25,10 @@
 // id3lib.  These files are distributed with id3lib at
 // http://download.sourceforge.net/id3lib/
 
+#include <string.h>
+#include <algorithm>
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "field_impl.h"
 
 using namespace dami;
 
@@ -59,182 +62,213 @@ ID3_TagImpl::iterator ID3_TagImpl::Find(const ID3_Frame *frame)
   return cur;
 }
 
-ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id) const
+namespace
 {
-  ID3_Frame *frame = NULL;
-
-  // reset the cursor if it isn't set
-  if (_frames.end() == _cursor)
+  struct AnyFrame
   {
-    _cursor = _frames.begin();
-  }
+    bool operator()(const ID3_Frame*) const { return true; }
+  };
 
-
-  for (int iCount = 0; iCount < 2 && frame == NULL; iCount++)
+  struct TextMatch
   {
-    // We want to cycle through the list to find the matching frame.  We
-    // should begin from the cursor, search each successive frame, wrapping
-    // if necessary.  The enclosing loop and the assignment statments below
-    // ensure that we first begin at the cursor and search to the end of the
-    // list and, if unsuccessful, start from the beginning of the list and
-    // search to the cursor.
-    const_iterator
-      begin  = (0 == iCount ? _cursor       : _frames.begin()),
-      end    = (0 == iCount ? _frames.end() : _cursor);
-    // search from the cursor to the end
-    for (const_iterator cur = begin; cur != end; ++cur)
+    ID3_FieldID   _fld;
+    const String& _data;
+    TextMatch(ID3_FieldID fld, const String& data) : _fld(fld), _data(data) { ; }
+    bool operator()(const ID3_Frame* frame) const
     {
-      if ((*cur != NULL) && ((*cur)->GetID() == id))
+      if (!frame->Contains(_fld))
+      {
+        return false;
+      }
+      const ID3_Field* fld = frame->GetField(_fld);
+      if (NULL == fld || fld->Size() != _data.size())
       {
-        // We've found a valid frame.  Set the cursor to be the next element
-        frame = *cur;
-        _cursor = ++cur;
-        break;
+        return false;
       }
+      // compare in place rather than copying the field into a String
+      const char* text = fld->GetRawText();
+      return _data.empty() ||
+        (text != NULL && ::memcmp(text, _data.data(), _data.size()) == 0);
     }
-  }
+  };
 
-  return frame;
-}
+  struct UnicodeMatch
+  {
+    ID3_FieldID _fld;
+    String      _unicode;      // the text as the unicode accessors give it
+    String      _utf8;         // and as fields holding UTF-8 hold it
+    UnicodeMatch(ID3_FieldID fld, const WString& data) : _fld(fld)
+    {
+      for (size_t i = 0; i < data.size(); ++i)
+      {
+        unicode_t ch = static_cast<unicode_t>(data[i]);
+        _unicode.append(reinterpret_cast<const char*>(&ch), sizeof(ch));
+      }
+      _utf8 = convert(_unicode, ID3TE_UTF16BE, ID3TE_UTF8);
+    }
+    bool operator()(const ID3_Frame* frame) const
+    {
+      if (!frame->Contains(_fld))
+      {
+        return false;
+      }
+      const ID3_FieldImpl* fld =
+        static_cast<const ID3_FieldImpl*>(frame->GetField(_fld));
+      if (NULL == fld || fld->GetType() != ID3FTY_TEXTSTRING)
+      {
+        return false;
+      }
+      // compare with the text as the field holds it, so that a field holding
+      // UTF-8 needn't make its UTF-16 copy
+      const String& data =
+        (fld->GetHeldEncoding() == ID3TE_UTF8) ? _utf8 : _unicode;
+      if (fld->Size() != data.size())
+      {
+        return false;
+      }
+      if (data.empty())
+      {
+        return true;
+      }
+      const char* text = NULL;
+      if (fld->GetHeldEncoding() == ID3TE_UTF8)
+      {
+        text = fld->GetRawText();
+      }
+      else if (ID3TE_IS_DOUBLE_BYTE_ENC(fld->GetHeldEncoding()))
+      {
+        text = reinterpret_cast<const char*>(fld->GetRawUnicodeText());
+      }
+      return text != NULL && ::memcmp(text, data.data(), data.size()) == 0;
+    }
+  };
 
-ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, String data) const
+  struct IntegerMatch
+  {
+    ID3_FieldID _fld;
+    uint32      _data;
+    IntegerMatch(ID3_FieldID fld, uint32 data) : _fld(fld), _data(data) { ; }
+    bool operator()(const ID3_Frame* frame) const
+    {
+      const ID3_Field* fld = frame->GetField(_fld);
+      return fld != NULL && fld->Get() == _data;
+    }
+  };
+};
+
+/** Finds the first frame with the given id that satisfies match, at or after
+ ** the sequence number next, and sets next past it.
+ **
+ ** Only the frames with the given id are considered, as the index keeps them
+ ** apart, in list order, from the rest of the tag.  When wrap is set and
+ ** nothing matches from next on, the frames before it are searched as well.
+ ** Apart from bringing a stale index up to date, which a parsed tag never
+ ** needs, nothing in the tag is written, so the search is safe to run from
+ ** many threads as long as each passes its own next.
+ **/
+template <typename Match>
+ID3_Frame* ID3_TagImpl::_FindFrom(ID3_FrameID id, const Match& match,
+                                  uint32& next, bool wrap) const
 {
-  ID3_Frame *frame = NULL;
-  ID3D_NOTICE( "Find: looking for comment with data = " << data.c_str() );
-
-  // reset the cursor if it isn't set
-  if (_frames.end() == _cursor)
+  this->_SyncIndex();
+  if (static_cast<size_t>(id) >= _index.size())
   {
-    _cursor = _frames.begin();
-    ID3D_NOTICE( "Find: resetting cursor" );
+    return NULL;
   }
+  const IndexEntries& entries = _index[id];
 
-  for (int iCount = 0; iCount < 2 && frame == NULL; iCount++)
+  IndexEntry key;
+  key.seq = next;
+  const IndexEntries::const_iterator
+    start = std::lower_bound(entries.begin(), entries.end(), key);
+
+  for (int iCount = 0; iCount < (wrap ? 2 : 1); iCount++)
   {
-    ID3D_NOTICE( "Find: iCount = " << iCount );
-    // We want to cycle through the list to find the matching frame.  We
-    // should begin from the cursor, search each successive frame, wrapping
-    // if necessary.  The enclosing loop and the assignment statments below
-    // ensure that we first begin at the cursor and search to the end of the
-    // list and, if unsuccessful, start from the beginning of the list and
-    // search to the cursor.
-    const_iterator
-      begin  = (0 == iCount ? _cursor       : _frames.begin()),
-      end    = (0 == iCount ? _frames.end() : _cursor);
-    // search from the cursor to the end
-    for (const_iterator cur = begin; cur != end; ++cur)
+    IndexEntries::const_iterator
+      begin  = (0 == iCount ? start         : entries.begin()),
+      end    = (0 == iCount ? entries.end() : start);
+    for (IndexEntries::const_iterator cur = begin; cur != end; ++cur)
     {
-      ID3D_NOTICE( "Find: frame = 0x" << hex << (uint32) *cur << dec );
-      if ((*cur != NULL) && ((*cur)->GetID() == id) &&
-          (*cur)->Contains(fldID))
+      if (match(cur->frame))
       {
-        ID3_Field* fld = (*cur)->GetField(fldID);
-        if (NULL == fld)
-        {
-          continue;
-          ID3D_NOTICE( "Find: didn't have the right field" );
-        }
-
-        String text(fld->GetRawText(), fld->Size());
-        ID3D_NOTICE( "Find: text = " << text.c_str() );
-
-        if (text == data)
-        {
-          // We've found a valid frame.  Set cursor to be the next element
-          frame = *cur;
-          _cursor = ++cur;
-          break;
-        }
+        next = cur->seq + 1;
+        return cur->frame;
       }
     }
   }
 
-  return frame;
+  return NULL;
 }
 
-ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, WString data) const
+/** Finds the next frame with the given id that satisfies match.
+ **
+ ** We want to cycle through the frames to find the matching frame.  We begin
+ ** from the tag's cursor, search each successive frame, wrapping if
+ ** necessary: the frames at or after the cursor are searched first and, if
+ ** unsuccessful, the frames before it.
+ **/
+template <typename Match>
+ID3_Frame* ID3_TagImpl::_FindIndexed(ID3_FrameID id, const Match& match) const
 {
-  ID3_Frame *frame = NULL;
+  return this->_FindFrom(id, match, _cursor, true);
+}
 
-  // reset the cursor if it isn't set
-  if (_frames.end() == _cursor)
-  {
-    _cursor = _frames.begin();
-  }
+ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id) const
+{
+  return this->_FindIndexed(id, AnyFrame());
+}
 
-  for (int iCount = 0; iCount < 2 && frame == NULL; iCount++)
-  {
-    // We want to cycle through the list to find the matching frame.  We
-    // should begin from the cursor, search each successive frame, wrapping
-    // if necessary.  The enclosing loop and the assignment statments below
-    // ensure that we first begin at the cursor and search to the end of the
-    // list and, if unsuccessful, start from the beginning of the list and
-    // search to the cursor.
-    const_iterator
-      begin  = (0 == iCount ? _cursor       : _frames.begin()),
-      end    = (0 == iCount ? _frames.end() : _cursor);
-    // search from the cursor to the end
-    for (const_iterator cur = begin; cur != end; ++cur)
-    {
-      if ((*cur != NULL) && ((*cur)->GetID() == id) &&
-          (*cur)->Contains(fldID))
-      {
-        ID3_Field* fld = (*cur)->GetField(fldID);
-        if (NULL == fld)
-        {
-          continue;
-        }
-        WString text = toWString(fld->GetRawUnicodeText(), fld->Size());
-
-        if (text == data)
-        {
-          // We've found a valid frame.  Set cursor to be the next element
-          frame = *cur;
-          _cursor = ++cur;
-          break;
-        }
-      }
-    }
-  }
+ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, String data) const
+{
+  ID3D_NOTICE( "Find: looking for comment with data = " << data.c_str() );
+  return this->_FindIndexed(id, TextMatch(fldID, data));
+}
 
-  return frame;
+ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, WString data) const
+{
+  return this->_FindIndexed(id, UnicodeMatch(fldID, data));
 }
 
 ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, uint32 data) const
 {
-  ID3_Frame *frame = NULL;
+  return this->_FindIndexed(id, IntegerMatch(fldID, data));
+}
 
-  // reset the cursor if it isn't set
-  if (_frames.end() == _cursor)
+ID3_Frame *ID3_TagImpl::Find(ID3_Tag::Cursor& cursor, ID3_FrameID id) const
+{
+  return this->_FindFrom(id, AnyFrame(), cursor._next, false);
+}
+
+ID3_Frame *ID3_TagImpl::Find(ID3_Tag::Cursor& cursor, ID3_FrameID id,
+                             ID3_FieldID fldID, String data) const
+{
+  return this->_FindFrom(id, TextMatch(fldID, data), cursor._next, false);
+}
+
+ID3_Frame *ID3_TagImpl::Find(ID3_Tag::Cursor& cursor, ID3_FrameID id,
+                             ID3_FieldID fldID, WString data) const
+{
+  return this->_FindFrom(id, UnicodeMatch(fldID, data), cursor._next, false);
+}
+
+ID3_Frame *ID3_TagImpl::Find(ID3_Tag::Cursor& cursor, ID3_FrameID id,
+                             ID3_FieldID fldID, uint32 data) const
+{
+  return this->_FindFrom(id, IntegerMatch(fldID, data), cursor._next, false);
+}
+
+size_t ID3_TagImpl::FindAll(ID3_FrameID id, ID3_Frame* frames[],
+                            size_t maxFrames) const
+{
+  this->_SyncIndex();
+  if (static_cast<size_t>(id) >= _index.size())
   {
-    _cursor = _frames.begin();
+    return 0;
   }
-
-  for (int iCount = 0; iCount < 2 && frame == NULL; iCount++)
+  const IndexEntries& entries = _index[id];
+  for (size_t i = 0; i < entries.size() && i < maxFrames; ++i)
   {
-    // We want to cycle through the list to find the matching frame.  We
-    // should begin from the cursor, search each successive frame, wrapping
-    // if necessary.  The enclosing loop and the assignment statments below
-    // ensure that we first begin at the cursor and search to the end of the
-    // list and, if unsuccessful, start from the beginning of the list and
-    // search to the cursor.
-    const_iterator
-      begin  = (0 == iCount ? _cursor       : _frames.begin()),
-      end    = (0 == iCount ? _frames.end() : _cursor);
-    // search from the cursor to the end
-    for (const_iterator cur = begin; cur != end; ++cur)
-    {
-      if ((*cur != NULL) && ((*cur)->GetID() == id) &&
-          ((*cur)->GetField(fldID)->Get() == data))
-      {
-        // We've found a valid frame.  Set the cursor to be the next element
-        frame = *cur;
-        _cursor = ++cur;
-        break;
-      }
-    }
+    frames[i] = entries[i].frame;
   }
-
-  return frame;
+  return entries.size();
 }
-
@@ -29,7 +29,10 @@
 #include <sys/param.h>
 #endif
 
+#include <algorithm>
+#include <set>
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "frame_impl.h"
 //#include "io_helpers.h"
 #include "io_strings.h"
 #include "frame_def.h"
@@ -148,8 +151,26 @@ size_t ID3_TagImpl::IsV2Tag(ID3_Reader& reader)
 }
 
 ID3_TagImpl::ID3_TagImpl(const char *name, flags_t flags)
-  : _frames(),
-    _cursor(_frames.begin()),
+  : _is_lazy(false),
+    _utf8_text(false),
+    _filtered(),
+    _num_skipped(0),
+    _skip_unchanged(false),
+    _buffer_size(ID3_FILE_BUFFER_SIZE),
+    _padding_policy(ID3PP_DEFAULT),
+    _padding_amount(0),
+    _file_frames(0),
+    _file_padding(0),
+    _update_stats(),
+    _patchable(false),
+    _patch_spec(ID3V2_UNKNOWN),
+    _patch_frames(0),
+    _arena(),
+    _frames(Frames::allocator_type(&_arena)),
+    _index(),
+    _next_seq(0),
+    _index_stale(false),
+    _cursor(0),
     _file_name(),
     _file_size(0),
     _prepended_bytes(0),
@@ -170,8 +191,26 @@ ID3_TagImpl::ID3_TagImpl(const char *name, flags_t flags)
 }
 
 ID3_TagImpl::ID3_TagImpl(const ID3_Tag &tag)
-  : _frames(),
-    _cursor(_frames.begin()),
+  : _is_lazy(false),
+    _utf8_text(false),
+    _filtered(),
+    _num_skipped(0),
+    _skip_unchanged(false),
+    _buffer_size(ID3_FILE_BUFFER_SIZE),
+    _padding_policy(ID3PP_DEFAULT),
+    _padding_amount(0),
+    _file_frames(0),
+    _file_padding(0),
+    _update_stats(),
+    _patchable(false),
+    _patch_spec(ID3V2_UNKNOWN),
+    _patch_frames(0),
+    _arena(),
+    _frames(Frames::allocator_type(&_arena)),
+    _index(),
+    _next_seq(0),
+    _index_stale(false),
+    _cursor(0),
     _file_name(),
     _file_size(0),
     _prepended_bytes(0),
@@ -205,8 +244,14 @@ void ID3_TagImpl::Clear()
   UserUpdatedSpec = false;
 
   _frames.clear();
-  _cursor = _frames.begin();
+  this->_ClearIndex();
+  // nothing refers to the arena any more
+  _arena.Release();
+  _num_skipped = 0;
   _is_padded = true;
+  _file_frames = 0;
+  _file_padding = 0;
+  _patchable = false;
 
   _hdr.Clear();
   _hdr.SetSpec(ID3V2_LATEST);
@@ -216,6 +261,10 @@ void ID3_TagImpl::Clear()
     delete _mp3_info; // Also deletes _mp3_header
 
   _file_name = "";
+  _file_size = 0;
+  _prepended_bytes = 0;
+  _appended_bytes = 0;
+  _file_tags.clear();
   _mp3_info = NULL;
   _last_error = ID3E_NoError;
   _changed = true;
@@ -242,7 +291,87 @@ void ID3_TagImpl::AddFrame(const ID3_Frame* frame)
   }
 }
 
+namespace
+{
+  String rawText(const ID3_Field* fld)
+  {
+    const char* text = fld->GetRawText();
+    return text ? String(text, fld->Size()) : String();
+  }
+
+  /** A value that must be unique across the frames of a tag: the owner of a
+   ** UFID, ENCR or GRID frame, or the method/group symbol of an ENCR or GRID
+   ** frame.
+   **/
+  struct UniqueKey
+  {
+    ID3_FrameID id;
+    ID3_FieldID fld;
+    String      text;
+    uint32      num;
+
+    bool operator<(const UniqueKey& rhs) const
+    {
+      if (id != rhs.id)
+        return id < rhs.id;
+      if (fld != rhs.fld)
+        return fld < rhs.fld;
+      if (num != rhs.num)
+        return num < rhs.num;
+      return text < rhs.text;
+    }
+  };
+
+  size_t uniqueKeys(const ID3_Frame& frame, UniqueKey keys[2])
+  {
+    const ID3_FrameID id = frame.GetID();
+    if (id != ID3FID_UNIQUEFILEID && id != ID3FID_CRYPTOREG && id != ID3FID_GROUPINGREG)
+    {
+      return 0;
+    }
+    keys[0].id = id;
+    keys[0].fld = ID3FN_OWNER;
+    keys[0].text = rawText(frame.GetField(ID3FN_OWNER));
+    keys[0].num = 0;
+    if (id == ID3FID_UNIQUEFILEID)
+    {
+      return 1;
+    }
+    keys[1].id = id;
+    keys[1].fld = ID3FN_ID;
+    keys[1].num = frame.GetField(ID3FN_ID)->Get();
+    return 2;
+  }
+};
+
+/** Checks a frame against the restrictions of its frame type, converting it
+ ** first if it is outdated for the spec of the tag.  If it is valid, the
+ ** frames of the tag it replaces, those with the same owner or symbol, are
+ ** removed: the newest frame wins.
+ **/
 bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
+{
+  if (!this->_CheckFrame(frame, testlinkedFrames))
+  {
+    return false;
+  }
+
+  UniqueKey keys[2];
+  const size_t numKeys = uniqueKeys(frame, keys);
+  for (size_t i = 0; i < numKeys; ++i)
+  {
+    ID3_Frame* tmpFrame = (ID3FN_OWNER == keys[i].fld)
+      ? this->Find(keys[i].id, keys[i].fld, keys[i].text)
+      : this->Find(keys[i].id, keys[i].fld, keys[i].num);
+    if (tmpFrame && tmpFrame != &frame)
+    {
+      delete this->RemoveFrame(tmpFrame); //remove old one, there can be only one
+    }
+  }
+  return true;
+}
+
+bool ID3_TagImpl::_CheckFrame(ID3_Frame& frame, bool testlinkedFrames)
 {
   ID3_Frame* testframe = &frame;
   ID3_Field* tmpField;
@@ -280,11 +409,8 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //check for same owner
       tmpField = testframe->GetField(ID3FN_OWNER);
-      if (ValidFrameOwner(tmpField->GetRawText()))
+      if (ValidFrameOwner(rawText(tmpField)))
       {
-        tmpFrame = this->Find(ID3FID_UNIQUEFILEID, ID3FN_OWNER, tmpField->GetRawText());
-        if (tmpFrame && tmpFrame != testframe)
-          this->RemoveFrame(tmpFrame); //remove old one, there can be only one
         return true;
       }
       else
@@ -295,15 +421,8 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //check for same owner
       tmpField = testframe->GetField(ID3FN_OWNER);
-      if (ValidFrameOwner((char *)tmpField->GetRawText()))
+      if (ValidFrameOwner(rawText(tmpField)))
       {
-        tmpFrame = this->Find(ID3FID_CRYPTOREG, ID3FN_OWNER, tmpField->GetRawText());
-        if (tmpFrame && tmpFrame != testframe)
-          this->RemoveFrame(tmpFrame); //remove old one, there can be only one
-        tmpField = testframe->GetField(ID3FN_ID);
-        tmpFrame = this->Find(ID3FID_CRYPTOREG, ID3FN_ID, tmpField->Get());
-        if (tmpFrame && tmpFrame != testframe)
-          this->RemoveFrame(tmpFrame); //remove old one, there can be only one
         return true;
       }
       else
@@ -314,15 +433,8 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //check for same owner
       tmpField = testframe->GetField(ID3FN_OWNER);
-      if (ValidFrameOwner((char *)tmpField->GetRawText()))
+      if (ValidFrameOwner(rawText(tmpField)))
       {
-        tmpFrame = this->Find(ID3FID_GROUPINGREG, ID3FN_OWNER, tmpField->GetRawText());
-        if (tmpFrame && tmpFrame != testframe)
-          this->RemoveFrame(tmpFrame); //remove old one, there can be only one
-        tmpField = testframe->GetField(ID3FN_ID);
-        tmpFrame = this->Find(ID3FID_CRYPTOREG, ID3FN_ID, tmpField->Get());
-        if (tmpFrame && tmpFrame != testframe)
-          this->RemoveFrame(tmpFrame); //remove old one, there can be only one
         return true;
       }
       else
@@ -333,7 +445,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //check for same owner
       tmpField = testframe->GetField(ID3FN_OWNER);
-      if (ValidFrameOwner((char *)tmpField->GetRawText()))
+      if (ValidFrameOwner(rawText(tmpField)))
       {
         // here the id3v2.4 specification is not clear, it states the content of the frame cannot be the same
         // do they mean that the there can be only one frame with the same owner?
@@ -348,7 +460,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year and a space
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 4)
       {
         return true;
@@ -361,7 +473,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year and a space
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 4)
       {
         return true;
@@ -374,7 +486,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year, contains a timestamp yyyy[-MM[-dd[THH[:mm[:ss]]]]] (between brackets [] is optional)
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 3)
       {
         return true;
@@ -387,7 +499,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year, contains a timestamp yyyy[-MM[-dd[THH[:mm[:ss]]]]] (between brackets [] is optional)
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 3)
       {
         return true;
@@ -400,7 +512,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year, contains a timestamp yyyy[-MM[-dd[THH[:mm[:ss]]]]] (between brackets [] is optional)
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 3)
       {
         return true;
@@ -413,7 +525,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year, contains a timestamp yyyy[-MM[-dd[THH[:mm[:ss]]]]] (between brackets [] is optional)
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 3)
       {
         return true;
@@ -426,7 +538,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a year, contains a timestamp yyyy[-MM[-dd[THH[:mm[:ss]]]]] (between brackets [] is optional)
       tmpField = testframe->GetField(ID3FN_TEXT);
-      String tmpText = tmpField->GetText();
+      const StringView tmpText = tmpField->GetTextView();
       if (tmpText.size() > 3)
       {
         return true;
@@ -439,7 +551,7 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
     {
       //should have at least a 4 + 8*x + 8 bytes (x is nr of tracks), with a minimum of 1 track it's 20 bytes, maximum is 804 bytes (99 tracks)
       tmpField = testframe->GetField(ID3FN_DATA);
-      BString tmpText = tmpField->GetBinary();
+      const BStringView tmpText = tmpField->GetBinaryView();
       if (tmpText.size() >= 20 && tmpText.size() <= 804)
       {
         if (testlinkedFrames)
@@ -463,29 +575,94 @@ bool ID3_TagImpl::IsValidFrame(ID3_Frame& frame, bool testlinkedFrames)
   }
 }
 
+/** Validates all the frames of the tag in one pass.  Frames that don't meet
+ ** the restrictions of their frame type are deleted, and so are the frames
+ ** that are replaced by a newer one with the same owner or symbol.
+ **/
 void ID3_TagImpl::checkFrames()
 {
-  bool restart = false;
+  Doomed doomed;
+  for (const_iterator iter = _frames.begin(); iter != _frames.end(); ++iter)
+  {
+    if (!this->_CheckFrame(**iter, true))
+    {
+      doomed.insert(*iter);
+    }
+  }
+  this->_EraseFrames(doomed);
+  this->_RemoveDuplicates();
+}
 
-  for (iterator iter = this->begin(); iter != this->end(); ++iter)
+/** Marks for deletion the frames that a newer frame in the tag replaces.
+ ** The frames are walked from the newest to the oldest, and each claims its
+ ** owner and symbol.  A frame that finds one of them already claimed is
+ ** replaced, but still claims the others, just as if the frames had been
+ ** attached one at a time.
+ **/
+void ID3_TagImpl::_RemoveDuplicates()
+{
+  std::set<UniqueKey> claimed;
+  Doomed doomed;
+  for (Frames::reverse_iterator iter = _frames.rbegin(); iter != _frames.rend(); ++iter)
   {
-    ID3_Frame* frame = *iter;
-    ID3_Frame& testframe = *frame;
+    UniqueKey keys[2];
+    const size_t numKeys = uniqueKeys(**iter, keys);
+    for (size_t i = 0; i < numKeys; ++i)
+    {
+      if (!claimed.insert(keys[i]).second)
+      {
+        doomed.insert(*iter);
+      }
+    }
+  }
+  this->_EraseFrames(doomed);
+}
 
-    if (this->IsValidFrame(testframe, true) == false)
+/** Removes the given frames from the tag and deletes them.
+ **/
+void ID3_TagImpl::_EraseFrames(const Doomed& doomed)
+{
+  if (doomed.empty())
+  {
+    return;
+  }
+  for (iterator iter = _frames.begin(); iter != _frames.end(); )
+  {
+    if (doomed.find(*iter) != doomed.end())
     {
-      _frames.erase(iter);
-      delete frame;
-      restart = true;
-      break;
+      delete *iter;
+      iter = _frames.erase(iter);
+    }
+    else
+    {
+      ++iter;
     }
   }
-  if (restart)
-    this->checkFrames();
+  for (size_t id = 0; id < _index.size(); ++id)
+  {
+    IndexEntries& entries = _index[id];
+    IndexEntries::iterator keep = entries.begin();
+    for (IndexEntries::iterator ei = entries.begin(); ei != entries.end(); ++ei)
+    {
+      if (doomed.find(ei->frame) == doomed.end())
+      {
+        *keep++ = *ei;
+      }
+    }
+    entries.erase(keep, entries.end());
+  }
+  _cursor = 0;
+  _changed = true;
+  // the frames left in the file would be kept with those patched
+  _patchable = false;
 }
 
 bool ID3_TagImpl::AttachFrame(ID3_Frame* frame)
 {
+  if (NULL == frame)
+  {
+    return false;
+  }
   ID3_Frame& testframe = *frame;
 
   bool isvalid = IsValidFrame(testframe, false);
@@ -493,8 +670,11 @@ bool ID3_TagImpl::AttachFrame(ID3_Frame* frame)
   {
     frame = &testframe;
     _frames.push_back(frame);
-    _cursor = _frames.begin();
+    this->_IndexFrame(--_frames.end());
+    _cursor = 0;
     _changed = true;
+    // a frame that isn't in the file can't be patched into it
+    _patchable = false;
     return true;
   }
   else
@@ -506,23 +686,137 @@ bool ID3_TagImpl::AttachFrame(ID3_Frame* frame)
   return false;
 }
 
+/** Attaches a batch of frames to the tag.  Each frame is validated as in
+ ** AttachFrame, but the frames replaced by a newer one, be it in the batch or
+ ** in the tag, are found in one pass rather than with a search per frame.
+ **
+ ** \return The number of frames of the batch that remain in the tag.
+ **/
+size_t ID3_TagImpl::AttachFrames(ID3_Frame* const* frames, size_t numFrames)
+{
+  const uint32 lastSeq = _next_seq;
+  for (size_t i = 0; i < numFrames; ++i)
+  {
+    ID3_Frame* frame = frames[i];
+    if (NULL == frame)
+    {
+      continue;
+    }
+    if (this->_CheckFrame(*frame, false))
+    {
+      _frames.push_back(frame);
+      this->_IndexFrame(--_frames.end());
+      _changed = true;
+      _patchable = false;
+    }
+    else
+    {
+      delete frame;
+    }
+  }
+  _cursor = 0;
+
+  this->_RemoveDuplicates();
+
+  size_t numAttached = 0;
+  for (size_t id = 0; id < _index.size(); ++id)
+  {
+    for (IndexEntries::const_iterator ei = _index[id].begin(); ei != _index[id].end(); ++ei)
+    {
+      if (ei->seq > lastSeq)
+      {
+        ++numAttached;
+      }
+    }
+  }
+  return numAttached;
+}
+
 
 ID3_Frame* ID3_TagImpl::RemoveFrame(const ID3_Frame *frame)
 {
   ID3_Frame *frm = NULL;
+  if (NULL == frame)
+  {
+    return frm;
+  }
 
-  iterator fi = Find(frame);
-  if (fi != _frames.end())
+  this->_SyncIndex();
+  const size_t id = frame->GetID();
+  if (id < _index.size())
   {
-    frm = *fi;
-    _frames.erase(fi);
-    _cursor = _frames.begin();
-    _changed = true;
+    IndexEntries& entries = _index[id];
+    for (IndexEntries::iterator ei = entries.begin(); ei != entries.end(); ++ei)
+    {
+      if (ei->frame == frame)
+      {
+        frm = ei->frame;
+        ID3_FrameImpl::Get(*frm).SetIndexFlag(NULL);
+        // the caller owns the frame now, and it mustn't go with the arena
+        ID3_FrameImpl::Detach(*frm);
+        _frames.erase(ei->pos);
+        entries.erase(ei);
+        _cursor = 0;
+        _changed = true;
+        // the frame would stay in the file with the others patched
+        _patchable = false;
+        break;
+      }
+    }
   }
 
   return frm;
 }
 
+void ID3_TagImpl::_IndexFrame(iterator pos)
+{
+  ID3_Frame* frame = *pos;
+  const size_t id = frame->GetID();
+  if (_index.size() <= id)
+  {
+    _index.resize(ID3FID_LASTFRAMEID + 1,
+                  IndexEntries(IndexEntries::allocator_type(&_arena)));
+  }
+  IndexEntry entry;
+  entry.seq = ++_next_seq;
+  entry.frame = frame;
+  entry.pos = pos;
+  _index[id].push_back(entry);
+  ID3_FrameImpl::Get(*frame).SetIndexFlag(&_index_stale);
+}
+
+void ID3_TagImpl::_ClearIndex()
+{
+  _index.clear();
+  _next_seq = 0;
+  _index_stale = false;
+  _cursor = 0;
+}
+
+void ID3_TagImpl::_SyncIndex() const
+{
+  if (!_index_stale)
+  {
+    return;
+  }
+  // Some frame changed its id after it was attached.  Collect the entries in
+  // list order, keeping their sequence numbers so the cursor stays put, and
+  // file them again under the ids the frames have now.
+  IndexEntries entries;
+  entries.reserve(_frames.size());
+  for (size_t id = 0; id < _index.size(); ++id)
+  {
+    entries.insert(entries.end(), _index[id].begin(), _index[id].end());
+    _index[id].clear();
+  }
+  std::sort(entries.begin(), entries.end());
+  for (IndexEntries::const_iterator ei = entries.begin(); ei != entries.end(); ++ei)
+  {
+    _index[ei->frame->GetID()].push_back(*ei);
+  }
+  _index_stale = false;
+}
+
 
 bool ID3_TagImpl::HasChanged() const
 {
@@ -563,6 +857,7 @@ bool ID3_TagImpl::SetUnsync(bool b)
 {
   bool changed = _hdr.SetUnsync(b);
   _changed = changed || _changed;
+  _patchable = _patchable && !changed;
   return changed;
 }
 
@@ -570,6 +865,7 @@ bool ID3_TagImpl::SetExtended(bool ext)
 {
   bool changed = _hdr.SetExtended(ext);
   _changed = changed || _changed;
+  _patchable = _patchable && !changed;
   return changed;
 }
 
@@ -577,6 +873,7 @@ bool ID3_TagImpl::SetExperimental(bool exp)
 {
   bool changed = _hdr.SetExperimental(exp);
   _changed = changed || _changed;
+  _patchable = _patchable && !changed;
   return changed;
 }
 
@@ -617,10 +914,134 @@ size_t ID3_TagImpl::GetExtendedBytes() const
     return 0;;
 }
 
+bool ID3_TagImpl::SetLazyParsing(bool lazy)
+{
+  bool changed = (_is_lazy != lazy);
+  _is_lazy = lazy;
+  return changed;
+}
+
+bool ID3_TagImpl::SetUtf8Text(bool utf8)
+{
+  bool changed = (_utf8_text != utf8);
+  _utf8_text = utf8;
+  return changed;
+}
+
+/** Makes the frames of the tag hold their text as UTF-8.  Frames parsed from
+ ** an id3v2 tag already do, as they were told to before parsing; this is for
+ ** those made from the other kinds of tags.
+ **/
+void ID3_TagImpl::_HoldTextAsUtf8()
+{
+  for (iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    ID3_FrameImpl& frame = ID3_FrameImpl::Get(**cur);
+    if (!frame.GetUtf8Text())
+    {
+      frame.SetUtf8Text(true);
+    }
+  }
+}
+
+/** Once a file is parsed, gives every frame the tag's spec and its fields
+ ** the frame's text encoding, so that rendering or sizing the tag, which may
+ ** be done from many threads at once, needn't change them.  The frames made
+ ** up from an ID3v1 or Lyrics3 tag are the ones this changes.
+ **/
+void ID3_TagImpl::_SyncFrames()
+{
+  for (iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    ID3_FrameImpl& frame = ID3_FrameImpl::Get(**cur);
+    frame.SetSpec(this->GetSpec());
+    frame.SyncEncoding();
+  }
+}
+
+void ID3_TagImpl::_SetFramesUnchanged()
+{
+  for (iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    ID3_FrameImpl::Get(**cur).SetUnchanged();
+  }
+}
+
+bool ID3_TagImpl::SetArenaAllocation(bool arena)
+{
+  bool changed = (_arena.IsEnabled() != arena);
+  _arena.SetEnabled(arena);
+  return changed;
+}
+
+/** An estimate of the bytes of memory the tag takes up: the tag itself, its
+ ** arena, and the frames and fields it holds, with their values.  A value
+ ** whose payload is shared with a copy of the frame is counted in full.
+ **/
+size_t ID3_TagImpl::GetMemoryFootprint() const
+{
+  // a node of the frame list holds two links and the frame
+  const size_t NODE_SIZE = 3 * sizeof(void*);
+
+  size_t size = sizeof(ID3_Tag) + sizeof(*this) + _arena.BytesReserved();
+  size += _file_name.capacity() + _filtered.capacity() / 8;
+  size += _index.capacity() * sizeof(IndexEntries);
+  for (size_t id = 0; id < _index.size(); ++id)
+  {
+    if (_index[id].capacity() > 0)
+    {
+      size += heapSize(&_arena, &_index[id][0],
+                       _index[id].capacity() * sizeof(IndexEntry));
+    }
+  }
+
+  // the raw data of lazily parsed frames is shared by all of them
+  std::set<const ID3_RawData*> raws;
+  for (const_iterator fi = _frames.begin(); fi != _frames.end(); ++fi)
+  {
+    size += heapSize(&_arena, &*fi, NODE_SIZE) + sizeof(ID3_Frame);
+    const ID3_FrameImpl& frame = ID3_FrameImpl::Get(**fi);
+    size += frame.GetMemoryFootprint();
+    const ID3_RawData* raw = frame.GetRawData();
+    if (raw != NULL && raws.insert(raw).second)
+    {
+      size += sizeof(*raw) + raw->data().capacity();
+    }
+  }
+  return size;
+}
+
+bool ID3_TagImpl::SetSkipUnchangedWrites(bool skip)
+{
+  bool changed = (_skip_unchanged != skip);
+  _skip_unchanged = skip;
+  return changed;
+}
+
+void ID3_TagImpl::SetFrameFilter(const ID3_FrameID* ids, size_t numIds, bool keep)
+{
+  if (!keep && (ids == NULL || numIds == 0))
+  {
+    _filtered.clear();
+    return;
+  }
+  _filtered.assign(ID3FID_LASTFRAMEID + 1, keep);
+  for (size_t i = 0; ids != NULL && i < numIds; ++i)
+  {
+    if (ids[i] <= ID3FID_LASTFRAMEID)
+    {
+      _filtered[ids[i]] = !keep;
+    }
+  }
+  // the frames of an ID3v2.2.1 compressed frame are filtered one by one
+  _filtered[ID3FID_METACOMPRESSION] = false;
+}
+
 bool ID3_TagImpl::SetPadding(bool pad)
 {
   bool changed = (_is_padded != pad);
   _changed = changed || _changed;
+  _patchable = _patchable && !changed;
   if (changed)
   {
     _is_padded = pad;
@@ -630,6 +1051,78 @@ bool ID3_TagImpl::SetPadding(bool pad)
 }
 
 
+void ID3_TagImpl::SetPaddingPolicy(ID3_PaddingPolicy policy, size_t amount)
+{
+  if (policy != _padding_policy || amount != _padding_amount)
+  {
+    _padding_policy = policy;
+    _padding_amount = amount;
+    _changed = true;
+    _patchable = false;
+  }
+}
+
+void ID3_TagImpl::SetFileLayout(size_t frames, size_t padding)
+{
+  _file_frames = frames;
+  _file_padding = padding;
+}
+
+// Keeps track of how the tags are written, and of where the tag was last laid
+// out anew, which the adaptive padding policy measures the growth from
+void ID3_TagImpl::_Updated(ID3_UpdateMode mode, size_t padding)
+{
+  _update_stats.last = mode;
+  // a tag written anew has its frames in other places
+  _patchable = _patchable && mode == ID3UM_PATCHED;
+  switch (mode)
+  {
+    case ID3UM_INPLACE:   ++_update_stats.inplace;   return;
+    case ID3UM_INSERTED:  ++_update_stats.inserted;  break;
+    case ID3UM_REWRITTEN: ++_update_stats.rewritten; break;
+    case ID3UM_SKIPPED:   ++_update_stats.skipped;   return;
+    case ID3UM_PATCHED:   ++_update_stats.patched;   return;
+    default: return;
+  }
+  if (_prepended_bytes >= ID3_TagHeader::SIZE + padding)
+  {
+    this->SetFileLayout(_prepended_bytes - ID3_TagHeader::SIZE - padding, padding);
+  }
+}
+
+// The frames can be patched in place if they are those of the file's only
+// id3v2 tag, each still where it was parsed from, and together they take up
+// the whole tag but for the padding
+void ID3_TagImpl::_LocateFrames(size_t numV2Tags)
+{
+  _patchable = false;
+  if (numV2Tags != 1 || this->GetUnsync() || this->GetExtended())
+  {
+    return;
+  }
+  size_t located = 0;
+  for (const_iterator fi = _frames.begin(); fi != _frames.end(); ++fi)
+  {
+    const size_t size = *fi ? ID3_FrameImpl::Get(**fi).GetFileSize() : 0;
+    if (size == 0)
+    {
+      return;
+    }
+    located += size;
+  }
+  if (located == _file_frames)
+  {
+    _patchable = true;
+    _patch_spec = this->GetSpec();
+    _patch_frames = _frames.size();
+  }
+}
+
+void ID3_TagImpl::SetFileBufferSize(size_t size)
+{
+  _buffer_size = size < BUFSIZ ? BUFSIZ : size;
+}
+
 ID3_TagImpl &
 ID3_TagImpl::operator=( const ID3_Tag &rTag )
 {
@@ -638,6 +1131,8 @@ ID3_TagImpl::operator=( const ID3_Tag &rTag )
   this->SetUnsync(rTag.GetUnsync());
   this->SetExtended(rTag.GetExtendedHeader());
   this->SetExperimental(rTag.GetExperimental());
+  // the copy is missing the same frames
+  _num_skipped = rTag.NumSkippedFrames();
 
   ID3_Tag::ConstIterator* iter = rTag.CreateIterator();
   const ID3_Frame* frame = NULL;
@@ -649,7 +1144,7 @@ ID3_TagImpl::operator=( const ID3_Tag &rTag )
   return *this;
 }
 
-size_t ID3_GetDataSize(const ID3_TagImpl& tag)
+uint64 ID3_GetDataSize(const ID3_TagImpl& tag)
 {
   return tag.GetFileSize() - tag.GetPrependedBytes() - tag.GetAppendedBytes();
 }
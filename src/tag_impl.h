@@ -40,10 +40,16 @@
 #endif
 
 #include <list>
+#include <vector>
+#include <set>
 #include <stdio.h>
 #include "tag.h" // has frame.h, field.h
 #include "header_tag.h"
 #include "mp3_header.h" //has io_decorators.h
+#include "arena.h"
+
+// the default number of bytes moved at a time when rewriting a file
+#define ID3_FILE_BUFFER_SIZE (4 * 1024 * 1024)
 
 class ID3_Reader;
 class ID3_Writer;
@@ -54,35 +60,54 @@ namespace dami
   {
     namespace v1
     {
+      bool find(ID3_Reader&);
       bool parse(ID3_TagImpl&, ID3_Reader&);
       void render(ID3_Writer&, const ID3_TagImpl&);
     };
     namespace v2
     {
       bool parse(ID3_TagImpl& tag, ID3_Reader& rdr);
-      ID3_Err render(ID3_Writer& writer, const ID3_TagImpl& tag);
+      ID3_Err render(ID3_Writer& writer, const ID3_TagImpl& tag,
+                     size_t* padding = NULL);
     };
   };
   namespace lyr3
   {
     namespace v1
     {
+      bool find(ID3_Reader&);
       bool parse(ID3_TagImpl&, ID3_Reader&);
     };
     namespace v2
     {
+      bool find(ID3_Reader&);
       bool parse(ID3_TagImpl&, ID3_Reader&);
     };
   };
   namespace mm
   {
+    bool find(ID3_Reader&);
     bool parse(ID3_TagImpl&, ID3_Reader&);
   };
 };
 
 class ID3_TagImpl
 {
-  typedef std::list<ID3_Frame *> Frames;
+  typedef std::list<ID3_Frame *, ID3_ArenaAllocator<ID3_Frame *> > Frames;
+
+  /** One entry of the frame index.  Frames are only ever appended to the
+   ** frame list, so the sequence number of an entry increases with its
+   ** position in the list, and the cursor can be kept as a sequence number.
+   **/
+  struct IndexEntry
+  {
+    uint32          seq;   // position in attach order
+    ID3_Frame*      frame;
+    Frames::iterator pos;  // where the frame lives in _frames
+    bool operator<(const IndexEntry& rhs) const { return seq < rhs.seq; }
+  };
+  typedef std::vector<IndexEntry, ID3_ArenaAllocator<IndexEntry> > IndexEntries;
+  typedef std::set<const ID3_Frame*> Doomed;
 public:
   typedef Frames::iterator       iterator;
   typedef Frames::const_iterator const_iterator;
@@ -100,17 +125,47 @@ public:
   bool       SetExtended(bool);
   bool       SetExperimental(bool);
   bool       SetPadding(bool);
+  void       SetPaddingPolicy(ID3_PaddingPolicy, size_t);
+  bool       SetLazyParsing(bool);
 
   bool       GetUnsync() const;
   bool       GetExtended() const;
   bool       GetExperimental() const;
   bool       GetFooter() const;
+  bool       GetPadding() const { return _is_padded; }
+  ID3_PaddingPolicy GetPaddingPolicy() const { return _padding_policy; }
+  bool       GetLazyParsing() const { return _is_lazy; }
+
+  bool       SetUtf8Text(bool);
+  bool       GetUtf8Text() const { return _utf8_text; }
+
+  bool       SetArenaAllocation(bool);
+  bool       GetArenaAllocation() const { return _arena.IsEnabled(); }
+  ID3_Arena* GetArena() { return &_arena; }
+  size_t     GetMemoryFootprint() const;
+
+  bool       SetSkipUnchangedWrites(bool);
+  bool       GetSkipUnchangedWrites() const { return _skip_unchanged; }
+
+  void       SetFileBufferSize(size_t);
+  size_t     GetFileBufferSize() const { return _buffer_size; }
+
+  void       SetFileLayout(size_t frames, size_t padding);
+  const ID3_UpdateStats& GetUpdateStats() const { return _update_stats; }
+
+  void       SetFrameFilter(const ID3_FrameID*, size_t, bool);
+  bool       HasFrameFilter() const { return !_filtered.empty(); }
+  bool       IsFrameFiltered(ID3_FrameID id) const
+  { return !_filtered.empty() && _filtered[id]; }
+  void       FrameSkipped() { ++_num_skipped; }
+  size_t     NumSkippedFrames() const { return _num_skipped; }
 
   size_t     GetExtendedBytes() const;
 
   void       AddFrame(const ID3_Frame&);
   void       AddFrame(const ID3_Frame*);
   bool       AttachFrame(ID3_Frame*);
+  size_t     AttachFrames(ID3_Frame* const*, size_t);
   bool       IsValidFrame(ID3_Frame&, bool);
   void       checkFrames();
   ID3_Frame* RemoveFrame(const ID3_Frame *);
@@ -120,9 +175,9 @@ public:
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
-  size_t     GetPrependedBytes() const { return _prepended_bytes; }
-  size_t     GetAppendedBytes() const { return _appended_bytes; }
-  size_t     GetFileSize() const { return _file_size; }
+  uint64     GetPrependedBytes() const { return _prepended_bytes; }
+  uint64     GetAppendedBytes() const { return _appended_bytes; }
+  uint64     GetFileSize() const { return _file_size; }
   dami::String GetFileName() const { return _file_name; }
 
   ID3_Frame* Find(ID3_FrameID id) const;
@@ -130,6 +185,17 @@ public:
   ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, dami::String) const;
   ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, dami::WString) const;
 
+  // the searches which leave the tag's cursor alone
+  ID3_Frame* Find(ID3_Tag::Cursor&, ID3_FrameID id) const;
+  ID3_Frame* Find(ID3_Tag::Cursor&, ID3_FrameID id, ID3_FieldID fld, uint32 data) const;
+  ID3_Frame* Find(ID3_Tag::Cursor&, ID3_FrameID id, ID3_FieldID fld, dami::String) const;
+  ID3_Frame* Find(ID3_Tag::Cursor&, ID3_FrameID id, ID3_FieldID fld, dami::WString) const;
+  ID3_Frame* FindFirst(ID3_FrameID id) const
+  { ID3_Tag::Cursor cursor; return this->Find(cursor, id); }
+  ID3_Frame* FindFirst(ID3_FrameID id, ID3_FieldID fld, dami::String data) const
+  { ID3_Tag::Cursor cursor; return this->Find(cursor, id, fld, data); }
+  size_t     FindAll(ID3_FrameID, ID3_Frame* frames[], size_t maxFrames) const;
+
   size_t     NumFrames() const { return _frames.size(); }
   ID3_TagImpl&   operator=( const ID3_Tag & );
 
@@ -138,6 +204,7 @@ public:
   bool       SetSpec(ID3_V2Spec);
 
   static size_t IsV2Tag(ID3_Reader&);
+  static void   Probe(ID3_Reader&, ID3_TagInfo&);
   ID3_Err    GetLastError();
   void       SetLastError(ID3_Err err) { _last_error = err; }
 
@@ -166,27 +233,71 @@ protected:
   void       ParseFile();
   void       ParseReader(ID3_Reader &reader);
 
+  bool       _CheckFrame(ID3_Frame&, bool);
+  void       _RemoveDuplicates();
+  void       _EraseFrames(const Doomed&);
+
+  void       _IndexFrame(iterator);
+  void       _ClearIndex();
+  void       _SyncIndex() const;
+  template <typename Match>
+  ID3_Frame* _FindIndexed(ID3_FrameID, const Match&) const;
+  template <typename Match>
+  ID3_Frame* _FindFrom(ID3_FrameID, const Match&, uint32& next, bool wrap) const;
+  size_t     _Headroom(size_t) const;
+  void       _Updated(ID3_UpdateMode, size_t padding);
+  void       _LocateFrames(size_t numV2Tags);
+  void       _HoldTextAsUtf8();
+  void       _SyncFrames();
+  void       _SetFramesUnchanged();
+  bool       _PatchFrames(fstream&, ID3_UpdateMode&);
+
 private:
   ID3_TagHeader _hdr;          // information relevant to the tag header
   bool       _is_padded;       // add padding to tags?
+  bool       _is_lazy;         // decode frame fields only when needed?
+  bool       _utf8_text;       // hold the text of parsed frames as UTF-8?
+  std::vector<bool> _filtered; // frame ids not to parse, empty if none
+  size_t     _num_skipped;     // frames left out by the filter since Clear()
+  bool       _skip_unchanged;  // compare tags with the file before writing them?
+  size_t     _buffer_size;     // bytes moved at a time when rewriting the file
+  ID3_PaddingPolicy _padding_policy; // how much room new tags leave to grow
+  size_t     _padding_amount;  // the parameter of the padding policy
+  size_t     _file_frames;     // size of the frames when the file's id3v2 tag
+  size_t     _file_padding;    // and its padding were last laid out or read
+  ID3_UpdateStats _update_stats;
+  bool       _patchable;       // can changed frames be written over themselves?
+  ID3_V2Spec _patch_spec;      // the spec and number of the frames parsed
+  size_t     _patch_frames;    // from the file, when they can
 
+  ID3_Arena  _arena;           // holds the parsed frames when enabled
   Frames     _frames;
 
-  mutable const_iterator   _cursor;  // which frame in list are we at
+  // the frames of each ID3_FrameID, in list order, so that Find needn't walk
+  // the whole list
+  mutable std::vector<IndexEntries> _index;
+  uint32     _next_seq;        // sequence number of the next attached frame
+  mutable bool _index_stale;   // an indexed frame changed its id
+
+  mutable uint32     _cursor;  // sequence number at which Find resumes
   mutable bool       _changed; // has tag changed since last parse or render?
 
   // file-related member variables
   dami::String _file_name;       // name of the file we are linked to
-  size_t     _file_size;       // the size of the file
-  size_t     _prepended_bytes; // number of tag bytes at start of file
-  size_t     _appended_bytes;  // number of tag bytes at end of file
+  uint64     _file_size;       // the size of the file
+  uint64     _prepended_bytes; // number of tag bytes at start of file
+  uint64     _appended_bytes;  // number of tag bytes at end of file
   bool       _is_file_writable;// is the associated file (via Link) writable?
   ID3_Flags  _tags_to_parse;   // which tag types should attempt to be parsed
   ID3_Flags  _file_tags;       // which tag types does the file contain
   Mp3Info*   _mp3_info;   // class used to retrieve _mp3_header
   ID3_Err    _last_error; //storage place for last error
+
+  // the index refers to _frames and is referred to by the frames themselves
+  ID3_TagImpl(const ID3_TagImpl&);
+  ID3_TagImpl& operator=(const ID3_TagImpl&);
 };
 
-size_t     ID3_GetDataSize(const ID3_TagImpl&);
+uint64     ID3_GetDataSize(const ID3_TagImpl&);
 
 #endif /* _ID3LIB_TAG_IMPL_H_ */
@@ -34,6 +34,7 @@
 //#include <memory.h>
 #include <string.h> //for strncmp
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "frame_impl.h"
 //#include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_strings.h"
 
@@ -41,7 +42,115 @@ using namespace dami;
 
 namespace
 {
-  bool parseFrames(ID3_TagImpl& tag, ID3_Reader& rdr)
+  // How much of the end of a tag countPadding() reads
+  const size_t PADDING_WINDOW = 4096;
+
+  // Finds where the frames in [beg, end) stop, hopping from frame header to
+  // frame header as the parser does; returns end if they don't stop short
+  // of it
+  ID3_Reader::pos_type skipFrames(ID3_Reader& rdr, ID3_V2Spec spec,
+                                  ID3_Reader::pos_type beg,
+                                  ID3_Reader::pos_type end)
+  {
+    ID3_FrameHeader hdr;
+    hdr.SetSpec(spec);
+    ID3_Reader::pos_type cur = rdr.setCur(beg);
+    while (cur < end && rdr.peekChar() != '\0')
+    {
+      if (!hdr.Parse(rdr) || rdr.getCur() + hdr.GetDataSize() > end)
+      {
+        return end;
+      }
+      cur = rdr.setCur(rdr.getCur() + hdr.GetDataSize());
+    }
+    return cur < end ? cur : end;
+  }
+
+  // Counts the zero bytes at the end of the tag data in [beg, end).  Only
+  // the last PADDING_WINDOW bytes are read; when all of them are zero, the
+  // frame headers are followed to where the padding begins rather than
+  // reading through the padding
+  size_t countPadding(ID3_Reader& rdr, const ID3_TagHeader& tag,
+                      ID3_Reader::pos_type beg, ID3_Reader::pos_type end)
+  {
+    uchar buf[PADDING_WINDOW];
+    size_t size = end - beg < sizeof(buf) ? end - beg : sizeof(buf);
+    rdr.setCur(end - size);
+    if (rdr.readChars(buf, size) < size)
+    {
+      return 0;
+    }
+    size_t used = size;
+    while (used > 0 && buf[used - 1] == '\0')
+    {
+      --used;
+    }
+    if (used > 0 || size == end - beg || tag.GetUnsync() || tag.GetExtended())
+    {
+      // the frames of an unsynchronized tag, or of one with an extended
+      // header, can't be followed from beg, so its padding is only counted
+      // as far as the window goes
+      return size - used;
+    }
+    return end - skipFrames(rdr, tag.GetSpec(), beg, end);
+  }
+
+  // Leaves the reader at the beginning of the APE tag that ends at its cursor
+  bool findApe(ID3_Reader& rdr)
+  {
+    io::ExitTrigger et(rdr);
+    ID3_Reader::pos_type end = rdr.getCur();
+    if (end < rdr.getBeg() + 32)
+    {
+      return false;
+    }
+    rdr.setCur(end - 32);
+    if (io::readText(rdr, 8) != "APETAGEX")
+    {
+      return false;
+    }
+    rdr.skipChars(4); // version
+    uint32 size = io::readLENumber(rdr, 4);   // items and footer
+    rdr.skipChars(4); // item count
+    uint32 flags = io::readLENumber(rdr, 4);
+    if (flags & (1UL << 31))
+    {
+      size += 32; // header
+    }
+    if (size < 32 || end < rdr.getBeg() + size)
+    {
+      ID3D_WARNING( "findApe: bad tag size = " << size );
+      return false;
+    }
+    et.setExitPos(end - size);
+    return true;
+  }
+
+  // Moves the reader past the frame at its cursor, without reading the
+  // frame's data, if the tag's frame filter leaves the frame out
+  bool skipFrame(ID3_TagImpl& tag, ID3_Reader& rdr)
+  {
+    ID3_Reader::pos_type beg = rdr.getCur();
+    ID3_FrameHeader hdr;
+    hdr.SetSpec(tag.GetSpec());
+    if (!hdr.Parse(rdr) || !tag.IsFrameFiltered(hdr.GetFrameID()))
+    {
+      rdr.setCur(beg);
+      return false;
+    }
+    ID3D_NOTICE( "id3::v2::skipFrame(): skipping " << hdr.GetTextID() <<
+                 ", " << hdr.GetDataSize() << " bytes" );
+    ID3_Reader::pos_type end = rdr.getCur() + hdr.GetDataSize();
+    rdr.setCur(end < rdr.getEnd() ? end : rdr.getEnd());
+    tag.FrameSkipped();
+    return true;
+  }
+
+  // When raw is given, rdr reads it and the frames are parsed lazily from it.
+  // When base is given, a frame at position pos of rdr is at *base + pos in
+  // the file, which the frame remembers so that it can be patched in place.
+  bool parseFrames(ID3_TagImpl& tag, ID3_Reader& rdr, std::vector<ID3_Frame*>& frames,
+                   ID3_RawData* raw, const ID3_Reader::pos_type* base)
   {
     ID3_Reader::pos_type beg = rdr.getCur();
     io::ExitTrigger et(rdr, beg);
@@ -54,9 +163,18 @@ namespace
       ID3D_NOTICE( "id3::v2::parseFrames(): rdr.getCur() = " << rdr.getCur() );
       ID3D_NOTICE( "id3::v2::parseFrames(): rdr.getEnd() = " << rdr.getEnd() );
       last_pos = rdr.getCur();
-      ID3_Frame* f = LEAKTESTNEW(ID3_Frame);
+      if (tag.HasFrameFilter() && skipFrame(tag, rdr))
+      {
+        et.setExitPos(rdr.getCur());
+        continue;
+      }
+      ID3_Frame* f = ID3_FrameImpl::NewFrame(tag.GetArena());
       f->SetSpec(tag.GetSpec());
-      bool goodParse = f->Parse(rdr);
+      // text is converted to UTF-8 as it is parsed, rather than afterwards
+      ID3_FrameImpl::Get(*f).SetUtf8Text(tag.GetUtf8Text());
+      bool goodParse = (raw != NULL)
+        ? ID3_FrameImpl::Get(*f).ParseLazily(rdr, raw)
+        : f->Parse(rdr);
       frameSize = rdr.getCur() - last_pos;
       ID3D_NOTICE( "id3::v2::parseFrames(): frameSize = " << frameSize );
       totalSize += frameSize;
@@ -81,8 +199,12 @@ namespace
       {
         ID3D_NOTICE( "id3::v2::parseFrames(): attaching non-compressed " <<
                      "frame");
+        if (base != NULL)
+        {
+          ID3_FrameImpl::Get(*f).SetFileRange(*base + last_pos, frameSize);
+        }
         // a good, uncompressed frame.  attach away!
-        tag.AttachFrame(f);
+        frames.push_back(f);
       }
       else
       {
@@ -106,7 +228,7 @@ namespace
             uint32 newSize = io::readBENumber(mr, sizeof(uint32));
             size_t oldSize = f->GetDataSize() - sizeof(uint32) - 1;
             io::CompressedReader cr(mr, newSize);
-            parseFrames(tag, cr);
+            parseFrames(tag, cr, frames, NULL, NULL);
             if (!cr.atEnd())
             {
               // hmm.  it didn't parse the entire uncompressed data.  wonder
@@ -164,39 +286,66 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window cur = " << wr.getCur() );
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window end = " << wr.getEnd() );
   tag.SetExtended(hdr.GetExtended());
-  if (!hdr.GetUnsync())
+  // the frames are validated together once they have all been parsed
+  std::vector<ID3_Frame*> frames;
+  ID3_RawData* raw = NULL;
+  // what's left after the frames is taken for padding
+  size_t padding = 0;
+  if (!hdr.GetUnsync() && !tag.GetLazyParsing())
   {
     tag.SetUnsync(false);
-    parseFrames(tag, wr);
+    const ID3_Reader::pos_type base = 0;
+    parseFrames(tag, wr, frames, NULL, &base);
+    padding = wr.getEnd() - wr.getCur();
+  }
+  else if (!hdr.GetUnsync())
+  {
+    // Lazily parsed frames keep referring to the raw tag, so read it in
+    tag.SetUnsync(false);
+    raw = new ID3_RawData;
+    const ID3_Reader::pos_type base = wr.getCur();
+    raw->data() = io::readAllBinary(wr);
+    io::BStringReader sr(raw->data());
+    parseFrames(tag, sr, frames, raw, &base);
+    padding = sr.getEnd() - sr.getCur();
   }
   else
   {
     // The buffer has been unsynced.  It will have to be resynced to be
-    // readable.  This has to be done a character at a time.
+    // readable.
     //
-    // The original reader may be reading in characters from a file.  Doing
-    // this a character at a time is quite slow.  To improve performance, read
-    // in the entire buffer into a string, then create an UnsyncedReader from
-    // the string.
-    //
-    // It might be better to implement a BufferedReader so that the details
-    // of this can be abstracted away behind a class
+    // The original reader may be reading in characters from a file.  Resyncing
+    // through an UnsyncedReader a character at a time is quite slow, so read
+    // in the entire buffer into a string, resync it in one pass in place, and
+    // parse the frames from the string.  This also makes sure the data is
+    // resynced exactly once.
     tag.SetUnsync(true);
-    BString raw = io::readAllBinary(wr);
-    io::BStringReader bsr(raw);
-    io::UnsyncedReader ur(bsr);
-    ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): unsync beg = " << ur.getBeg() );
-    ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): unsync cur = " << ur.getCur() );
-    ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): unsync end = " << ur.getEnd() );
-
-    // Now read the UnsyncedReader into another string, and parse the frames
-    // from the string.  This is done so that 1. the unsynced reader is
-    // unsynced exactly once, removing the possibility of multiple unsyncings
-    // of the same string, and 2) so that calls to readChars aren't done a
-    // character at a time for every call
-    BString synced = io::readAllBinary(ur);
-    io::BStringReader sr(synced);
-    parseFrames(tag, sr);
+    BString synced = io::readAllBinary(wr);
+    if (!synced.empty())
+    {
+      synced.resize(io::resync(&synced[0], synced.size()));
+    }
+    ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): resynced size = " << synced.size() );
+    if (tag.GetLazyParsing())
+    {
+      raw = new ID3_RawData;
+      raw->data().swap(synced);
+    }
+    io::BStringReader sr(raw ? raw->data() : synced);
+    // resynced frames aren't where they were in the file
+    parseFrames(tag, sr, frames, raw, NULL);
+    padding = sr.getEnd() - sr.getCur();
+  }
+  if (!frames.empty())
+  {
+    tag.AttachFrames(&frames[0], frames.size());
+  }
+  padding = min(padding, dataSize);
+  tag.SetFileLayout(dataSize - padding, padding);
+  if (raw)
+  {
+    // the frames hold on to what they need
+    raw->Release();
   }
 
   return true;
@@ -205,27 +354,42 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
 void ID3_TagImpl::ParseFile()
 { //changes in this routine should also be made in the routine for streaming parsing below
   ifstream file;
-  size_t mp3_core_size;
-  size_t bytes_till_sync;
+  ID3_Reader::size_type mp3_core_size;
+  ID3_Reader::size_type bytes_till_sync;
 
+  _patchable = false;
   _last_error = openReadableFile(this->GetFileName(), file);
   if (ID3E_NoError != _last_error)
   {
     // log this...
     return;
   }
+  // prefer a mapped file, so parsing doesn't seek the stream for every peek;
+  // fall back on the stream if the file can't be mapped
+  ID3_MappedFileReader mfr(this->GetFileName().c_str());
   ID3_IFStreamReader ifsr(file);
-  io::WindowedReader wr(ifsr);
+  ID3_Reader* rdr = &ifsr;
+  if (mfr.isMapped())
+  {
+    file.close();
+    rdr = &mfr;
+    _file_size = mfr.getEnd();
+  }
+  else
+  {
+    _file_size = getFileSize(file);
+  }
+  io::WindowedReader wr(*rdr);
   wr.setBeg(wr.getCur());
 
   _file_tags.clear();
-  _file_size = getFileSize(file);
 
   ID3_Reader::pos_type beg  = wr.getBeg();
   ID3_Reader::pos_type cur  = wr.getCur();
   ID3_Reader::pos_type end  = wr.getEnd();
 
   ID3_Reader::pos_type last = cur;
+  size_t numV2Tags = 0;
 
   if (_tags_to_parse.test(ID3TT_ID3V2))
   {
@@ -236,6 +400,7 @@ void ID3_TagImpl::ParseFile()
       if (id3::v2::parse(*this, wr))
       {
         _file_tags.add(ID3TT_ID3V2);
+        ++numV2Tags;
       }
       cur  = wr.getCur();
       wr.setBeg(cur);
@@ -407,16 +572,27 @@ void ID3_TagImpl::ParseFile()
   }
   else
     this->SetPadding(false); //no need to pad an empty file
-  file.close();
+  if (_utf8_text)
+  {
+    this->_HoldTextAsUtf8();
+  }
+  this->_SyncFrames();
+  this->_LocateFrames(numV2Tags);
+  // file frames which changed their ids while parsing under their new ids
+  // now, so that searching the parsed tag writes nothing
+  this->_SyncIndex();
+  rdr->close();
 }
 
 //used for streaming media
 void ID3_TagImpl::ParseReader(ID3_Reader &reader)
 {
 //allthough largely the same, stays a severate routine than ParseFile() above.
-  size_t mp3_core_size;
-  size_t bytes_till_sync;
+  ID3_Reader::size_type mp3_core_size;
+  ID3_Reader::size_type bytes_till_sync;
 
+  // the frames aren't read from the file Update() writes
+  _patchable = false;
   io::WindowedReader wr(reader);
   wr.setBeg(wr.getCur());
 
@@ -591,5 +767,144 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
   }
   else
     this->SetPadding(false); //no need to pad an empty file
+  if (_utf8_text)
+  {
+    this->_HoldTextAsUtf8();
+  }
+  this->_SyncFrames();
+  this->_SyncIndex();
 }
 
+//a cheap version of the routines above, for when only the layout of the
+//file is wanted: it reads the headers and footers of the tags, but doesn't
+//parse them
+void ID3_TagImpl::Probe(ID3_Reader& reader, ID3_TagInfo& info)
+{
+  info.tags = ID3TT_NONE;
+  info.v2spec = ID3V2_UNKNOWN;
+  info.v2flags = 0;
+  info.v2size = 0;
+  info.v2padding = 0;
+  info.ape = false;
+
+  io::WindowedReader wr(reader);
+  wr.setBeg(wr.getCur());
+
+  ID3_Reader::pos_type beg  = wr.getBeg();
+  ID3_Reader::pos_type cur  = wr.getCur();
+  ID3_Reader::pos_type end  = wr.getEnd();
+
+  ID3_Reader::pos_type last = cur;
+
+  do
+  {
+    last = cur;
+    // the id3v2 tags at the beginning of the file
+    ID3_TagHeader hdr;
+    if (!hdr.Parse(wr))
+    {
+      break;
+    }
+    if (!(info.tags & ID3TT_ID3V2))
+    {
+      info.v2spec = hdr.GetSpec();
+      info.v2flags =
+        (hdr.GetUnsync()       ? ID3_TagHeader::HEADER_FLAG_UNSYNC : 0) |
+        (hdr.GetExtended()     ? ID3_TagHeader::HEADER_FLAG_EXTENDED : 0) |
+        (hdr.GetExperimental() ? ID3_TagHeader::HEADER_FLAG_EXPERIMENTAL : 0) |
+        (hdr.GetFooter()       ? ID3_TagHeader::HEADER_FLAG_FOOTER : 0);
+    }
+    info.tags |= ID3TT_ID3V2;
+    ID3_Reader::pos_type data_end = wr.getCur() + hdr.GetDataSize();
+    if (data_end > end)
+    {
+      data_end = end;
+    }
+    if (hdr.GetFooter())
+    {
+      // a tag with a footer has no padding
+      data_end = data_end + ID3_TagHeader::SIZE < end ? data_end + ID3_TagHeader::SIZE : end;
+    }
+    else
+    {
+      info.v2padding += countPadding(wr, hdr, wr.getCur(), data_end);
+    }
+    cur = wr.setCur(data_end);
+    wr.setBeg(cur);
+  } while (!wr.atEnd() && cur > last);
+  info.v2size = cur - beg;
+
+  // silly padding outside the tag, as in ParseFile()
+  if (!wr.atEnd() && wr.peekChar() == '\0')
+  {
+    do
+    {
+      last = cur;
+      cur = wr.getCur() + 1;
+      wr.setBeg(cur);
+      wr.setCur(cur);
+    } while (!wr.atEnd() &&  cur > last && wr.peekChar() == '\0');
+  }
+  if (!wr.atEnd() && end - cur > 4 && wr.peekChar() == 255)
+  {
+    wr.setCur(cur + 1);
+    if (wr.readChar() == '\0' && wr.readChar() == '\0' && wr.peekChar() == '\0')
+    {
+      cur += 3;
+      do
+      {
+        last = cur;
+        cur = wr.getCur() + 1;
+        wr.setBeg(cur);
+        wr.setCur(cur);
+      } while (!wr.atEnd() &&  cur > last && wr.peekChar() == '\0');
+    }
+    else
+      wr.setCur(cur);
+  }
+  info.audiooffset = cur - beg;
+
+  // ...then the tags at the end, in the order ParseFile() looks for them
+  cur = wr.setCur(end);
+  if (end - beg > info.audiooffset)
+  {
+    do
+    {
+      last = cur;
+      if (mm::find(wr))
+      {
+        info.tags |= ID3TT_MUSICMATCH;
+        wr.setEnd(wr.getCur());
+      }
+      if (lyr3::v1::find(wr))
+      {
+        info.tags |= ID3TT_LYRICS3;
+        wr.setEnd(wr.getCur());
+      }
+      if (lyr3::v2::find(wr))
+      {
+        info.tags |= ID3TT_LYRICS3V2;
+        cur = wr.getCur();
+        wr.setCur(wr.getEnd());
+        if (id3::v1::find(wr))
+        {
+          info.tags |= ID3TT_ID3V1;
+        }
+        wr.setCur(cur);
+        wr.setEnd(cur);
+      }
+      if (id3::v1::find(wr))
+      {
+        wr.setEnd(wr.getCur());
+        info.tags |= ID3TT_ID3V1;
+      }
+      if (findApe(wr))
+      {
+        info.ape = true;
+        wr.setEnd(wr.getCur());
+      }
+      cur = wr.getCur();
+    } while (cur != last);
+  }
+  info.audiosize = cur - beg - info.audiooffset;
+}
@@ -168,7 +168,7 @@ namespace
   }
 };
 
-bool lyr3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+bool lyr3::v1::find(ID3_Reader& reader)
 {
   io::ExitTrigger et(reader);
   ID3_Reader::pos_type end = reader.getCur();
@@ -196,8 +196,8 @@ bool lyr3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   }
 
   // reserve enough space for lyrics3 + id3v1 tag
-  size_t window = end - reader.getBeg();
-  size_t lyrDataSize = min<size_t>(window, 11 + 5100 + 9 + 128);
+  ID3_Reader::size_type window = end - reader.getBeg();
+  ID3_Reader::size_type lyrDataSize = min<ID3_Reader::size_type>(window, 11 + 5100 + 9 + 128);
   reader.setCur(end - lyrDataSize);
   io::WindowedReader wr(reader, lyrDataSize - (9 + 128));
 
@@ -208,8 +208,22 @@ bool lyr3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   }
 
   et.setExitPos(wr.getCur());
-  wr.skipChars(11);
-  wr.setBeg(wr.getCur());
+  return true;
+}
+
+bool lyr3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  ID3_Reader::pos_type end = reader.getCur();
+  if (!lyr3::v1::find(reader))
+  {
+    return false;
+  }
+  // the lyrics run from LYRICSBEGIN up to LYRICSEND and the id3v1 tag
+  ID3_Reader::pos_type beg = reader.getCur();
+  io::ExitTrigger et(reader);
+  io::WindowedReader wr(reader);
+  wr.setWindow(beg + 11, end - (9 + 128) - (beg + 11));
+  wr.setCur(wr.getBeg());
 
   io::LineFeedReader lfr(wr);
   String lyrics = io::readText(lfr, wr.remainingBytes());
@@ -218,8 +232,7 @@ bool lyr3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   return true;
 }
 
-//bool parse(TagImpl& tag, ID3_Reader& reader)
-bool lyr3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+bool lyr3::v2::find(ID3_Reader& reader)
 {
   io::ExitTrigger et(reader);
   ID3_Reader::pos_type end = reader.getCur();
@@ -252,19 +265,33 @@ bool lyr3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
     ID3D_WARNING( "lyr3::v2::parse: not enough data to parse tag, lyrSize = " << lyrSize );
     return false;
   }
-  reader.setCur(end - (lyrSize + 6 + 9 + 128));
-
-  io::WindowedReader wr(reader);
-  wr.setWindow(wr.getCur(), lyrSize);
-
-  beg = wr.getCur();
+  beg = reader.setCur(end - (lyrSize + 6 + 9 + 128));
 
-  if (io::readText(wr, 11) != "LYRICSBEGIN")
+  if (io::readText(reader, 11) != "LYRICSBEGIN")
   {
     // not a lyrics v2.00 tag
     ID3D_WARNING( "lyr3::v2::parse: couldn't find LYRICSBEGIN, bailing" );
     return false;
   }
+  et.setExitPos(beg);
+  return true;
+}
+
+//bool parse(TagImpl& tag, ID3_Reader& reader)
+bool lyr3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  ID3_Reader::pos_type end = reader.getCur();
+  if (!lyr3::v2::find(reader))
+  {
+    return false;
+  }
+  // the fields run from LYRICSBEGIN up to the size, LYRICS200 and the id3v1
+  // tag
+  ID3_Reader::pos_type beg = reader.getCur();
+  io::ExitTrigger et(reader);
+  io::WindowedReader wr(reader);
+  wr.setWindow(beg, end - (6 + 9 + 128) - beg);
+  wr.setCur(beg + 11);
 
   bool has_time_stamps = false;
 
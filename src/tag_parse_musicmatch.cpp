@@ -111,161 +111,186 @@ namespace
     }
     return frame;
   }
-};
 
-bool mm::parse(ID3_TagImpl& tag, ID3_Reader& rdr)
-{
-  size_t i;
-  io::ExitTrigger et(rdr);
-  ID3_Reader::pos_type end = rdr.getCur();
-  if (end < rdr.getBeg() + 48)
+  // Finds the sections of the MusicMatch tag that ends at the reader's
+  // cursor.  The exit position of et is set to where the tag begins.
+  bool findSections(ID3_Reader& rdr, io::ExitTrigger& et,
+                    ID3_Reader::pos_type& dataBeg, ID3_Reader::pos_type& dataEnd,
+                    ID3_Reader::pos_type offsets[5])
   {
-    ID3D_NOTICE( "mm::parse: bailing, not enough bytes to parse, pos = " << end );
-    return false;
-  }
+    size_t i;
+    ID3_Reader::pos_type end = rdr.getCur();
+    if (end < rdr.getBeg() + 48)
+    {
+      ID3D_NOTICE( "mm::parse: bailing, not enough bytes to parse, pos = " << end );
+      return false;
+    }
 
-  rdr.setCur(end - 48);
-  String version;
+    rdr.setCur(end - 48);
+    String version;
 
-  {
-    if (io::readText(rdr, 32) != "Brava Software Inc.             ")
     {
-      ID3D_NOTICE( "mm::parse: bailing, couldn't find footer" );
-      return false;
+      if (io::readText(rdr, 32) != "Brava Software Inc.             ")
+      {
+        ID3D_NOTICE( "mm::parse: bailing, couldn't find footer" );
+        return false;
+      }
+
+      version = io::readText(rdr, 4);
+      if (version.size() != 4 ||
+          !isdigit(version[0]) || version[1] != '.' ||
+          !isdigit(version[2]) ||
+          !isdigit(version[3]))
+      {
+        ID3D_WARNING( "mm::parse: bailing, nonstandard version = " << version );
+        return false;
+      }
     }
 
-    version = io::readText(rdr, 4);
-    if (version.size() != 4 ||
-        !isdigit(version[0]) || version[1] != '.' ||
-        !isdigit(version[2]) ||
-        !isdigit(version[3]))
+    ID3_Reader::pos_type beg = rdr.setCur(end - 48);
+    et.setExitPos(beg);
+    if (end < 68)
     {
-      ID3D_WARNING( "mm::parse: bailing, nonstandard version = " << version );
+      ID3D_NOTICE( "mm::parse: bailing, not enough bytes to parse offsets, pos = " << end );
       return false;
     }
-  }
+    rdr.setCur(end - 68);
 
-  ID3_Reader::pos_type beg = rdr.setCur(end - 48);
-  et.setExitPos(beg);
-  if (end < 68)
-  {
-    ID3D_NOTICE( "mm::parse: bailing, not enough bytes to parse offsets, pos = " << end );
-    return false;
-  }
-  rdr.setCur(end - 68);
+    io::WindowedReader dataWindow(rdr);
+    dataWindow.setEnd(rdr.getCur());
 
-  io::WindowedReader dataWindow(rdr);
-  dataWindow.setEnd(rdr.getCur());
-
-  uint32 offsets[5];
-
-  io::WindowedReader offsetWindow(rdr, 20);
-  for (i = 0; i < 5; ++i)
-  {
-    offsets[i] = io::readLENumber(rdr, sizeof(uint32));
-  }
-
-  size_t metadataSize = 0;
-  if (version <= "3.00")
-  {
-    // All MusicMatch tags up to and including version 3.0 had metadata
-    // sections exactly 7868 bytes in length.
-    metadataSize = 7868;
-  }
-  else
-  {
-    // MusicMatch tags after version 3.0 had three possible lengths for their
-    // metadata sections.  We can determine which it was by searching for
-    // the version section signature that should precede the metadata section
-    // by exactly 256 bytes.
-    size_t possibleSizes[] = { 8132, 8004, 7936 };
+    io::WindowedReader offsetWindow(rdr, 20);
+    for (i = 0; i < 5; ++i)
+    {
+      offsets[i] = io::readLENumber(rdr, sizeof(uint32));
+    }
 
-    for (i = 0; i < sizeof(possibleSizes)/sizeof(size_t); ++i)
+    size_t metadataSize = 0;
+    if (version <= "3.00")
+    {
+      // All MusicMatch tags up to and including version 3.0 had metadata
+      // sections exactly 7868 bytes in length.
+      metadataSize = 7868;
+    }
+    else
     {
-      dataWindow.setCur(dataWindow.getEnd());
+      // MusicMatch tags after version 3.0 had three possible lengths for their
+      // metadata sections.  We can determine which it was by searching for
+      // the version section signature that should precede the metadata section
+      // by exactly 256 bytes.
+      size_t possibleSizes[] = { 8132, 8004, 7936 };
 
-      // Our offset will be exactly 256 bytes prior to our potential metadata
-      // section
-      size_t offset = possibleSizes[i] + 256;
-      if (dataWindow.getCur() < offset)
+      for (i = 0; i < sizeof(possibleSizes)/sizeof(size_t); ++i)
       {
-        // if our filesize is less than the offset, then it can't possibly
-        // be the correct offset, so try again.
-        continue;
+        dataWindow.setCur(dataWindow.getEnd());
+
+        // Our offset will be exactly 256 bytes prior to our potential metadata
+        // section
+        size_t offset = possibleSizes[i] + 256;
+        if (dataWindow.getCur() < offset)
+        {
+          // if our filesize is less than the offset, then it can't possibly
+          // be the correct offset, so try again.
+          continue;
+        }
+        dataWindow.setCur(dataWindow.getCur() - offset);
+
+        // now read in the signature to see if it's a match
+        if (io::readText(dataWindow, 8) == "18273645")
+        {
+          metadataSize = possibleSizes[i];
+          break;
+        }
       }
-      dataWindow.setCur(dataWindow.getCur() - offset);
+    }
+    if (0 == metadataSize)
+    {
+      // if we didn't establish a size for the metadata, then something is
+      // wrong.  probably should log this.
+      ID3D_WARNING( "mm::parse: bailing, couldn't find meta data signature, end = " << end );
+      return false;
+    }
 
-      // now read in the signature to see if it's a match
-      if (io::readText(dataWindow, 8) == "18273645")
+    // parse the offset pointers to determine the actual sizes of all the
+    // sections
+    size_t sectionSizes[5];
+    size_t tagSize = metadataSize;
+
+    // we already know the size of the last section
+    sectionSizes[4] = metadataSize;
+
+    size_t lastOffset = 0;
+    for (i = 0; i < 5; i++)
+    {
+      size_t thisOffset = offsets[i];
+      //ASSERT(thisOffset > lastOffset);
+      if (i > 0)
       {
-        metadataSize = possibleSizes[i];
-        break;
+        size_t sectionSize = thisOffset - lastOffset;
+        sectionSizes[i-1] = sectionSize;
+        tagSize += sectionSize;
       }
+      lastOffset = thisOffset;
     }
-  }
-  if (0 == metadataSize)
-  {
-    // if we didn't establish a size for the metadata, then something is
-    // wrong.  probably should log this.
-    ID3D_WARNING( "mm::parse: bailing, couldn't find meta data signature, end = " << end );
-    return false;
-  }
 
-  // parse the offset pointers to determine the actual sizes of all the
-  // sections
-  size_t sectionSizes[5];
-  size_t tagSize = metadataSize;
+    // now check to see that our tag size is reasonable
+    if (dataWindow.getEnd() < tagSize)
+    {
+      // Ack!  The tag size doesn't jive with the tag's ending position in
+      // the file.  Bail!
+      ID3D_WARNING( "mm::parse: bailing, tag size is too big, tag size = " << tagSize << ", end = " << end );
+      return false;
+    }
 
-  // we already know the size of the last section
-  sectionSizes[4] = metadataSize;
+    dataWindow.setBeg(dataWindow.getEnd() - tagSize);
+    dataWindow.setCur(dataWindow.getBeg());
 
-  size_t lastOffset = 0;
-  for (i = 0; i < 5; i++)
-  {
-    size_t thisOffset = offsets[i];
-    //ASSERT(thisOffset > lastOffset);
-    if (i > 0)
+    // Now calculate the adjusted offsets
+    offsets[0] = dataWindow.getBeg();
+    for (i = 0; i < 4; ++i)
     {
-      size_t sectionSize = thisOffset - lastOffset;
-      sectionSizes[i-1] = sectionSize;
-      tagSize += sectionSize;
+      offsets[i+1] = offsets[i] + sectionSizes[i];
     }
-    lastOffset = thisOffset;
-  }
 
-  // now check to see that our tag size is reasonable
-  if (dataWindow.getEnd() < tagSize)
-  {
-    // Ack!  The tag size doesn't jive with the tag's ending position in
-    // the file.  Bail!
-    ID3D_WARNING( "mm::parse: bailing, tag size is too big, tag size = " << tagSize << ", end = " << end );
-    return false;
+    // now check for a tag header and adjust the tag_beg pointer appropriately
+    if (dataWindow.getBeg() >= 256)
+    {
+      rdr.setCur(dataWindow.getBeg() - 256);
+      if (io::readText(rdr, 8) == "18273645")
+      {
+        et.setExitPos(rdr.getCur() - 8);
+      }
+      else
+      {
+        et.setExitPos(dataWindow.getBeg());
+      }
+    }
+    dataBeg = dataWindow.getBeg();
+    dataEnd = dataWindow.getEnd();
+    return true;
   }
+};
 
-  dataWindow.setBeg(dataWindow.getEnd() - tagSize);
-  dataWindow.setCur(dataWindow.getBeg());
+bool mm::find(ID3_Reader& rdr)
+{
+  io::ExitTrigger et(rdr);
+  ID3_Reader::pos_type dataBeg, dataEnd, offsets[5];
+  return findSections(rdr, et, dataBeg, dataEnd, offsets);
+}
 
-  // Now calculate the adjusted offsets
-  offsets[0] = dataWindow.getBeg();
-  for (i = 0; i < 4; ++i)
+bool mm::parse(ID3_TagImpl& tag, ID3_Reader& rdr)
+{
+  io::ExitTrigger et(rdr);
+  ID3_Reader::pos_type dataBeg, dataEnd, offsets[5];
+  if (!findSections(rdr, et, dataBeg, dataEnd, offsets))
   {
-    offsets[i+1] = offsets[i] + sectionSizes[i];
+    return false;
   }
 
-  // now check for a tag header and adjust the tag_beg pointer appropriately
-  if (dataWindow.getBeg() >= 256)
-  {
-    rdr.setCur(dataWindow.getBeg() - 256);
-    if (io::readText(rdr, 8) == "18273645")
-    {
-      et.setExitPos(rdr.getCur() - 8);
-    }
-    else
-    {
-      et.setExitPos(dataWindow.getBeg());
-    }
-    dataWindow.setCur(dataWindow.getBeg());
-  }
+  io::WindowedReader dataWindow(rdr);
+  dataWindow.setEnd(dataEnd);
+  dataWindow.setBeg(dataBeg);
+  dataWindow.setCur(dataBeg);
 
   // Now parse the various sections...
 
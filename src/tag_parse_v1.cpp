@@ -32,7 +32,7 @@
 
 using namespace dami;
 
-bool id3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+bool id3::v1::find(ID3_Reader& reader)
 {
   io::ExitTrigger et(reader);
   
@@ -62,6 +62,18 @@ bool id3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
     return false;
   }
   et.setExitPos(beg);
+  return true;
+}
+
+bool id3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  if (!id3::v1::find(reader))
+  {
+    return false;
+  }
+  ID3_Reader::pos_type beg = reader.getCur();
+  io::ExitTrigger et(reader);
+  reader.skipChars(ID3_V1_LEN_ID);
   
   // guess so, let's start checking the v2 tag for frames which are the
   // equivalent of the v1 fields.  When we come across a v1 field that has
@@ -73,7 +85,7 @@ bool id3::v1::parse(ID3_TagImpl& tag, ID3_Reader& reader)
 
   ID3D_NOTICE("id3::v1::parse: read bytes: " << reader.getCur() - beg);
   String title = io::readTrailingSpaces(reader, ID3_V1_LEN_TITLE);
-  field = id3::v2::getTitle(tag);
+  String field = id3::v2::getTitle(tag);
   if (title.size() > 0 && (field.size() == 0 || field == ""))
   {
     id3::v2::setTitle(tag, title);
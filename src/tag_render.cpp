@@ -27,6 +27,7 @@
 
 #include <memory.h>
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "frame_impl.h"
 #include "helpers.h"
 #include "writers.h"
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
@@ -72,7 +73,8 @@ namespace
       const ID3_Frame* frame = *iter;
       if (frame)
       {
-        ID3_Err err = frame->Render(writer);
+        // rendered in the tag's spec, without the frame being set to it
+        ID3_Err err = ID3_FrameImpl::Get(*frame).Render(writer, tag.GetSpec());
         if (err != ID3E_NoError)
           return err;
       }
@@ -81,7 +83,7 @@ namespace
   }
 }
 
-ID3_Err id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
+ID3_Err id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag, size_t* padding)
 {
   // There has to be at least one frame for there to be a tag...
   ID3_Err err = ID3E_NoError;
@@ -132,6 +134,10 @@ ID3_Err id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
   // zero the remainder of the buffer so that our padding bytes are zero
   luint nPadding = tag.PaddingSize(frmSize);
   ID3D_NOTICE( "id3::v2::render(): padding size = " << nPadding );
+  if (padding)
+  {
+    *padding = nPadding;
+  }
 
   hdr.SetDataSize(frmSize + tag.GetExtendedBytes() + nPadding);
 
@@ -167,8 +173,7 @@ size_t ID3_TagImpl::Size() const
   {
     if (*cur)
     {
-      (*cur)->SetSpec(this->GetSpec());
-      frameBytes += (*cur)->Size();
+      frameBytes += ID3_FrameImpl::Get(**cur).Size(this->GetSpec());
     }
   }
 
@@ -191,6 +196,40 @@ size_t ID3_TagImpl::Size() const
 #define ID3_PADMULTIPLE (2048)
 #define ID3_PADMAX  (4096)
 
+#define ID3_PADBLOCK (4096)
+
+// The padding the policy asks for behind curSize bytes of frames
+size_t ID3_TagImpl::_Headroom(size_t curSize) const
+{
+  switch (_padding_policy)
+  {
+    case ID3PP_FIXED:
+      return _padding_amount;
+    case ID3PP_PERCENT:
+      return curSize / 100 * _padding_amount + curSize % 100 * _padding_amount / 100;
+    case ID3PP_BLOCK:
+    {
+      size_t block = _padding_amount > 0 ? _padding_amount : ID3_PADBLOCK;
+      size_t tagSize = curSize + ID3_TagHeader::SIZE;
+      return (tagSize / block + 1) * block - tagSize;
+    }
+    case ID3PP_ADAPTIVE:
+    {
+      // the tag has outgrown the room it had, so give it twice what it needed
+      // since then.  If the tag keeps growing, this doubles its room each
+      // time, and the file is only laid out anew a logarithmic number of times.
+      size_t growth = 0;
+      if (_file_frames > 0 && curSize > _file_frames)
+      {
+        growth = curSize - _file_frames;
+      }
+      return max(max(_padding_amount, _file_padding), 2 * growth);
+    }
+    default:
+      return 0;
+  }
+}
+
 size_t ID3_TagImpl::PaddingSize(size_t curSize) const
 {
   luint newSize = 0;
@@ -201,6 +240,23 @@ size_t ID3_TagImpl::PaddingSize(size_t curSize) const
     return 0;
   }
 
+  if (_padding_policy != ID3PP_DEFAULT)
+  {
+    const size_t headroom = this->_Headroom(curSize);
+    // keep the size of the old tag if the new one fits, so it can be written
+    // in place, unless that would leave far more room than the policy asks for
+    if (this->GetPrependedBytes() > ID3_TagHeader::SIZE)
+    {
+      const size_t oldSize = this->GetPrependedBytes() - ID3_TagHeader::SIZE;
+      if (oldSize >= curSize &&
+          oldSize - curSize <= max(2 * headroom, (size_t) ID3_PADMAX))
+      {
+        return oldSize - curSize;
+      }
+    }
+    return headroom;
+  }
+
   // if the old tag was large enough to hold the new tag, then we will simply
   // pad out the difference - that way the new tag can be written without
   // shuffling the rest of the song file around
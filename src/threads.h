@@ -0,0 +1,61 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_THREADS_H_
+#define _ID3LIB_THREADS_H_
+
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  include <pthread.h>
+#  define ID3_WITH_THREADS
+#endif
+
+namespace dami
+{
+  /** The number of workers to start when none is asked for: twice the
+   ** processors, so that there is always a file being read or written while
+   ** others are parsed.
+   **/
+  inline size_t defaultWorkers()
+  {
+    return 2 * numProcessors();
+  }
+
+#if defined ID3_WITH_THREADS
+  /** Holds the lock for as long as it's in scope.
+   **/
+  class Locker
+  {
+    pthread_mutex_t& _mutex;
+  public:
+    Locker(pthread_mutex_t& mutex) : _mutex(mutex) { pthread_mutex_lock(&_mutex); }
+    ~Locker() { pthread_mutex_unlock(&_mutex); }
+  };
+#endif
+};
+
+#endif /* _ID3LIB_THREADS_H_ */
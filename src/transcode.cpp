@@ -0,0 +1,356 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <string.h>
+#include "transcode.h"
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // Most of the text in a tag is ASCII, which is the same character in each
+  // of the encodings.  The converters below look for runs of ASCII, which
+  // they copy a block at a time, and decode only the characters in between.
+  //
+  // Each encoding has a class which:
+  //  - says how many bytes a character takes at most and at least,
+  //  - measures the run of ASCII at the start of some text,
+  //  - reads and writes the ASCII characters of a run, and
+  //  - decodes and encodes any other character, failing on malformed text
+  //    or on a character it can't hold.
+
+  const uint32 MAX_CODE_POINT = 0x10FFFF;
+
+  bool isSurrogate(uint32 ch)
+  {
+    return 0xD800 <= ch && ch <= 0xDFFF;
+  }
+
+  // the number of single byte ASCII characters text starts with
+  size_t asciiBytes(const uchar* text, size_t size)
+  {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+      if (_mm_movemask_epi8(block) != 0)
+      {
+        break;
+      }
+    }
+#else
+    for (; i + sizeof(uint32) <= size; i += sizeof(uint32))
+    {
+      uint32 block;
+      ::memcpy(&block, text + i, sizeof(block));
+      if ((block & 0x80808080) != 0)
+      {
+        break;
+      }
+    }
+#endif
+    while (i < size && text[i] < 0x80)
+    {
+      ++i;
+    }
+    return i;
+  }
+
+  // the number of big endian ASCII characters text starts with
+  size_t asciiUnits(const uchar* text, size_t size)
+  {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // each character is 0x00 0x00-0x7F
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0x80FF));
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+      __m128i bits = _mm_and_si128(block, high);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())) != 0xFFFF)
+      {
+        break;
+      }
+    }
+#endif
+    while (i + 2 <= size && text[i] == 0 && text[i + 1] < 0x80)
+    {
+      i += 2;
+    }
+    return i / 2;
+  }
+
+  class Latin1
+  {
+  public:
+    enum { MIN_BYTES = 1, MAX_BYTES = 1 };
+
+    static size_t ascii(const uchar* text, size_t size) { return asciiBytes(text, size); }
+    static uchar  getAscii(const uchar* text, size_t i) { return text[i]; }
+    static void   putAscii(uchar* text, size_t i, uchar ch) { text[i] = ch; }
+
+    static bool decode(const uchar*& text, const uchar*, uint32& ch)
+    {
+      ch = *text++;
+      return true;
+    }
+    static bool encode(uint32 ch, uchar*& text)
+    {
+      if (ch > 0xFF)
+      {
+        return false;
+      }
+      *text++ = static_cast<uchar>(ch);
+      return true;
+    }
+  };
+
+  class Utf8
+  {
+  public:
+    enum { MIN_BYTES = 1, MAX_BYTES = 4 };
+
+    static size_t ascii(const uchar* text, size_t size) { return asciiBytes(text, size); }
+    static uchar  getAscii(const uchar* text, size_t i) { return text[i]; }
+    static void   putAscii(uchar* text, size_t i, uchar ch) { text[i] = ch; }
+
+    // Overlong forms, surrogates and anything past U+10FFFF are malformed
+    static bool decode(const uchar*& text, const uchar* end, uint32& ch)
+    {
+      const uchar lead = *text;
+      size_t more = 0;
+      uint32 least = 0;
+      if (lead < 0x80)
+      {
+        ch = lead;
+      }
+      else if (lead < 0xC2)
+      {
+        return false;
+      }
+      else if (lead < 0xE0)
+      {
+        ch = lead & 0x1F;
+        more = 1;
+        least = 0x80;
+      }
+      else if (lead < 0xF0)
+      {
+        ch = lead & 0x0F;
+        more = 2;
+        least = 0x800;
+      }
+      else if (lead < 0xF5)
+      {
+        ch = lead & 0x07;
+        more = 3;
+        least = 0x10000;
+      }
+      else
+      {
+        return false;
+      }
+      if (static_cast<size_t>(end - text) <= more)
+      {
+        return false;
+      }
+      for (size_t i = 1; i <= more; ++i)
+      {
+        if ((text[i] & 0xC0) != 0x80)
+        {
+          return false;
+        }
+        ch = (ch << 6) | (text[i] & 0x3F);
+      }
+      if (ch < least || ch > MAX_CODE_POINT || isSurrogate(ch))
+      {
+        return false;
+      }
+      text += more + 1;
+      return true;
+    }
+    static bool encode(uint32 ch, uchar*& text)
+    {
+      if (ch < 0x80)
+      {
+        *text++ = static_cast<uchar>(ch);
+      }
+      else if (ch < 0x800)
+      {
+        *text++ = static_cast<uchar>(0xC0 | (ch >> 6));
+        *text++ = static_cast<uchar>(0x80 | (ch & 0x3F));
+      }
+      else if (ch < 0x10000)
+      {
+        *text++ = static_cast<uchar>(0xE0 | (ch >> 12));
+        *text++ = static_cast<uchar>(0x80 | ((ch >> 6) & 0x3F));
+        *text++ = static_cast<uchar>(0x80 | (ch & 0x3F));
+      }
+      else
+      {
+        *text++ = static_cast<uchar>(0xF0 | (ch >> 18));
+        *text++ = static_cast<uchar>(0x80 | ((ch >> 12) & 0x3F));
+        *text++ = static_cast<uchar>(0x80 | ((ch >> 6) & 0x3F));
+        *text++ = static_cast<uchar>(0x80 | (ch & 0x3F));
+      }
+      return true;
+    }
+  };
+
+  class Utf16BE
+  {
+  public:
+    enum { MIN_BYTES = 2, MAX_BYTES = 4 };
+
+    static size_t ascii(const uchar* text, size_t size) { return asciiUnits(text, size); }
+    static uchar  getAscii(const uchar* text, size_t i) { return text[2 * i + 1]; }
+    static void   putAscii(uchar* text, size_t i, uchar ch)
+    {
+      text[2 * i] = 0;
+      text[2 * i + 1] = ch;
+    }
+
+    // A surrogate must be the first of a pair, followed by the second
+    static bool decode(const uchar*& text, const uchar* end, uint32& ch)
+    {
+      if (end - text < 2)
+      {
+        return false;
+      }
+      ch = (text[0] << 8) | text[1];
+      if (!isSurrogate(ch))
+      {
+        text += 2;
+        return true;
+      }
+      if (ch > 0xDBFF || end - text < 4)
+      {
+        return false;
+      }
+      const uint32 low = (text[2] << 8) | text[3];
+      if (low < 0xDC00 || low > 0xDFFF)
+      {
+        return false;
+      }
+      ch = 0x10000 + ((ch - 0xD800) << 10) + (low - 0xDC00);
+      text += 4;
+      return true;
+    }
+    static bool encode(uint32 ch, uchar*& text)
+    {
+      if (ch >= 0x10000)
+      {
+        const uint32 high = 0xD800 + ((ch - 0x10000) >> 10);
+        const uint32 low = 0xDC00 + ((ch - 0x10000) & 0x3FF);
+        *text++ = static_cast<uchar>(high >> 8);
+        *text++ = static_cast<uchar>(high & 0xFF);
+        ch = low;
+      }
+      *text++ = static_cast<uchar>(ch >> 8);
+      *text++ = static_cast<uchar>(ch & 0xFF);
+      return true;
+    }
+  };
+
+  template <typename From, typename To>
+  bool transcodeAs(const String& source, String& target)
+  {
+    const size_t size = source.size();
+    if (size % From::MIN_BYTES != 0)
+    {
+      return false;
+    }
+    // each character grows by at most this many times
+    const size_t growth = (To::MAX_BYTES + From::MIN_BYTES - 1) / From::MIN_BYTES;
+    String result(size * growth, '\0');
+
+    const uchar* text = reinterpret_cast<const uchar*>(source.data());
+    const uchar* end = text + size;
+    uchar* const beg = reinterpret_cast<uchar*>(&result[0]);
+    uchar* out = beg;
+    while (text < end)
+    {
+      const size_t run = From::ascii(text, end - text);
+      for (size_t i = 0; i < run; ++i)
+      {
+        To::putAscii(out, i, From::getAscii(text, i));
+      }
+      text += run * From::MIN_BYTES;
+      out += run * To::MIN_BYTES;
+      if (text == end)
+      {
+        break;
+      }
+
+      uint32 ch = 0;
+      if (!From::decode(text, end, ch) || !To::encode(ch, out))
+      {
+        return false;
+      }
+    }
+    result.resize(out - beg);
+    target.swap(result);
+    return true;
+  }
+
+  template <typename From>
+  bool transcodeFrom(const String& source, ID3_TextEnc targetEnc, String& target)
+  {
+    switch (targetEnc)
+    {
+      case ID3TE_ISO8859_1:
+        return transcodeAs<From, Latin1>(source, target);
+      case ID3TE_UTF8:
+        return transcodeAs<From, Utf8>(source, target);
+      case ID3TE_UTF16:
+      case ID3TE_UTF16BE:
+        return transcodeAs<From, Utf16BE>(source, target);
+      default:
+        return false;
+    }
+  }
+};
+
+bool dami::transcode(const String& source, ID3_TextEnc sourceEnc,
+                     ID3_TextEnc targetEnc, String& target)
+{
+  switch (sourceEnc)
+  {
+    case ID3TE_ISO8859_1:
+      return transcodeFrom<Latin1>(source, targetEnc, target);
+    case ID3TE_UTF8:
+      return transcodeFrom<Utf8>(source, targetEnc, target);
+    case ID3TE_UTF16:
+    case ID3TE_UTF16BE:
+      return transcodeFrom<Utf16BE>(source, targetEnc, target);
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,47 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_TRANSCODE_H_
+#define _ID3LIB_TRANSCODE_H_
+
+#include "id3/globals.h" //has <stdlib.h> "id3/sized_types.h"
+#include "id3/id3lib_strings.h"
+
+namespace dami
+{
+  /** Converts text between the encodings id3lib keeps it in, without iconv:
+   ** ISO-8859-1, UTF-8, and UTF-16 in big endian order without a byte order
+   ** mark, which is how both ID3TE_UTF16 and ID3TE_UTF16BE text is held.
+   **
+   ** Returns false, leaving target alone, for text which is malformed in its
+   ** encoding or has characters the target encoding can't hold.  It is then
+   ** up to the caller what to make of it.
+   **/
+  bool transcode(const String& source, ID3_TextEnc sourceEnc,
+                 ID3_TextEnc targetEnc, String& target);
+};
+
+#endif /* _ID3LIB_TRANSCODE_H_ */
@@ -37,12 +37,20 @@
 #endif
 
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "transcode.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
 
 #if defined HAVE_ICONV_H
    // check if we have all unicodes
 #  if (defined(ID3_ICONV_FORMAT_UTF16BE) && defined(ID3_ICONV_FORMAT_UTF16) && defined(ID3_ICONV_FORMAT_UTF8) && defined(ID3_ICONV_FORMAT_ASCII))
 #    include <iconv.h>
 #    include <errno.h>
+#    if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#      include <pthread.h>
+#    endif
 #  else
 #    undef HAVE_ICONV_H
 #  endif
@@ -59,6 +67,11 @@
 
 using namespace dami;
 
+#if defined (ID3_ENABLE_DEBUG) && defined (HAVE_LIBCW_SYS_H) && defined (HAVE_PTHREAD_H) && defined (HAVE_LIBPTHREAD)
+// serializes ID3D_NOTICE and ID3D_WARNING, see config.h
+pthread_mutex_t id3d_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
   // converts an ASCII string into a Unicode one
 String mbstoucs(String data)
 {
@@ -205,45 +218,53 @@ String dami::renderNumber(uint32 val, size_t size)
 
 namespace
 {
-  String convert_i(iconv_t cd, String source)
+  // Converts all of source, or as much of it as is complete.  Returns an
+  // empty string when source has characters that are invalid, or that can't
+  // be converted.
+  String convert_i(iconv_t cd, const String& source)
   {
-    String target;
+    // start from the initial shift state, whatever the last use left behind
+    iconv(cd, NULL, NULL, NULL, NULL);
+
     size_t source_size = source.size();
 #if defined(ID3LIB_ICONV_OLDSTYLE)
     const char *source_str = source.data();
 #else
-    char *source_str = LEAKTESTNEW(char[source.size()+1]);
-    source.copy(source_str, String::npos);
-    source_str[source.length()] = 0;
+    // iconv only advances the pointer, it never writes through it
+    char *source_str = const_cast<char*>(source.data());
 #endif
 
-#define ID3LIB_BUFSIZ 1024
-    char buf[ID3LIB_BUFSIZ];
-    char *target_str = buf;
-    size_t target_size = ID3LIB_BUFSIZ;
-    
-    do
+    String target(source_size * 2 + 4, '\0');
+    size_t done = 0;
+    while (source_size > 0)
     {
+      char *target_str = &target[done];
+      size_t target_size = target.size() - done;
       errno = 0;
       size_t nconv = iconv(cd,
                            &source_str, &source_size,
                            &target_str, &target_size);
-      if (nconv == (size_t) -1 && errno != EINVAL && errno != E2BIG)
+      done = target.size() - target_size;
+      if (nconv != (size_t) -1)
+      {
+        break;
+      }
+      if (errno == E2BIG)
+      {
+        target.resize(target.size() * 2);
+      }
+      else if (errno == EINVAL)
+      {
+        // the source ends part way through a character: drop what's left
+        break;
+      }
+      else
       {
 // errno is probably EILSEQ here, which means either an invalid byte sequence or a valid but unconvertible byte sequence
-#if !defined(ID3LIB_ICONV_OLDSTYLE)
-        delete [] source_str;
-#endif
-        return target;
+        return String();
       }
-      target.append(buf, ID3LIB_BUFSIZ - target_size);
-      target_str = buf;
-      target_size = ID3LIB_BUFSIZ;
     }
-    while (source_size > 0);
-#if !defined(ID3LIB_ICONV_OLDSTYLE)
-    delete [] source_str;
-#endif
+    target.resize(done);
     return target;
   }
 
@@ -256,10 +277,7 @@ namespace
         format = ID3_ICONV_FORMAT_ASCII;
         break;
 
-      case ID3TE_UTF16:
-        format = ID3_ICONV_FORMAT_UTF16;
-        break;
-
+      case ID3TE_UTF16: //id3lib strips the byte order, hence the actual string becomes ID3TE_UTF16BE
       case ID3TE_UTF16BE:
         format = ID3_ICONV_FORMAT_UTF16BE;
         break;
@@ -273,14 +291,119 @@ namespace
     }
     return format;
   }
-}
+
+  // Opening a conversion descriptor costs far more than most of the text a
+  // tag holds takes to convert, so each thread keeps those it has opened, one
+  // for each pair of encodings.  A descriptor carries state from one
+  // conversion to the next, so they can't be shared between threads.  A pair
+  // iconv can't convert between is remembered too, so that it isn't asked
+  // again for each piece of text.
+  class IconvCache
+  {
+  public:
+    IconvCache()
+    {
+      for (size_t i = 0; i < ID3TE_NUMENCODINGS; ++i)
+      {
+        for (size_t j = 0; j < ID3TE_NUMENCODINGS; ++j)
+        {
+          _cds[i][j] = (iconv_t) -1;
+          _tried[i][j] = false;
+        }
+      }
+    }
+    ~IconvCache()
+    {
+      for (size_t i = 0; i < ID3TE_NUMENCODINGS; ++i)
+      {
+        for (size_t j = 0; j < ID3TE_NUMENCODINGS; ++j)
+        {
+          if (_cds[i][j] != (iconv_t) -1)
+          {
+            iconv_close(_cds[i][j]);
+          }
+        }
+      }
+    }
+
+    // the descriptor from sourceEnc to targetEnc, or (iconv_t) -1 if iconv
+    // can't convert between them
+    iconv_t Get(ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc)
+    {
+      if (sourceEnc < 0 || sourceEnc >= ID3TE_NUMENCODINGS ||
+          targetEnc < 0 || targetEnc >= ID3TE_NUMENCODINGS)
+      {
+        return (iconv_t) -1;
+      }
+      iconv_t& cd = _cds[sourceEnc][targetEnc];
+      if (!_tried[sourceEnc][targetEnc])
+      {
+        _tried[sourceEnc][targetEnc] = true;
+        const char* targetFormat = getFormat(targetEnc);
+        const char* sourceFormat = getFormat(sourceEnc);
+        if (targetFormat != NULL && sourceFormat != NULL)
+        {
+          cd = iconv_open(targetFormat, sourceFormat);
+        }
+      }
+      return cd;
+    }
+
+  private:
+    iconv_t _cds[ID3TE_NUMENCODINGS][ID3TE_NUMENCODINGS];
+    bool    _tried[ID3TE_NUMENCODINGS][ID3TE_NUMENCODINGS]; // opened yet?
+  };
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+  pthread_key_t  cacheKey;
+  pthread_once_t cacheOnce = PTHREAD_ONCE_INIT;
+
+  void deleteCache(void* cache)
+  {
+    delete static_cast<IconvCache*>(cache);
+  }
+
+  void createCacheKey()
+  {
+    pthread_key_create(&cacheKey, deleteCache);
+  }
+
+  // the calling thread's cache, made on first use and gone with the thread
+  IconvCache& threadCache()
+  {
+    pthread_once(&cacheOnce, createCacheKey);
+    IconvCache* cache = static_cast<IconvCache*>(pthread_getspecific(cacheKey));
+    if (cache == NULL)
+    {
+      cache = LEAKTESTNEW(IconvCache);
+      pthread_setspecific(cacheKey, cache);
+    }
+    return *cache;
+  }
+#else
+  IconvCache& threadCache()
+  {
+    static IconvCache cache;
+    return cache;
+  }
+#endif
+};
 #endif
 
+/** Converts data from sourceEnc to targetEnc.  Text id3lib holds is
+ ** converted by transcode(); the platform's converter (iconv, or mlang on
+ ** windows) is only left what that turns down, and what it turns down in
+ ** turn gets the old ASCII only conversion.
+ **/
 String dami::convert(String data, ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc)
 {
   String target;
   if ((sourceEnc != targetEnc) && (data.size() > 0 ))
   {
+    if (transcode(data, sourceEnc, targetEnc, target))
+    {
+      return target;
+    }
 #if !defined HAVE_ICONV_H
 #  if defined(HAVE_MS_CONVERT)
     target = msconvert(data, sourceEnc, targetEnc);
@@ -288,24 +411,16 @@ String dami::convert(String data, ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc)
     target = oldconvert(data, sourceEnc, targetEnc);
 #  endif
 #else
-    const char* targetFormat = getFormat(targetEnc);
-    const char* sourceFormat = getFormat(sourceEnc);
-
-    iconv_t cd = iconv_open (targetFormat, sourceFormat);
+    iconv_t cd = threadCache().Get(sourceEnc, targetEnc);
     if (cd != (iconv_t) -1)
     {
       target = convert_i(cd, data);
-      if (target.size() == 0)
-      {
-        //try it without iconv
-        target = oldconvert(data, sourceEnc, targetEnc);
-      }
     }
-    else
+    if (target.size() == 0)
     {
+      //try it without iconv
       target = oldconvert(data, sourceEnc, targetEnc);
     }
-    iconv_close (cd);
 #endif
   }
   return target;
@@ -351,9 +466,9 @@ ID3_Err dami::createFile(String name, fstream& file)
   return ID3E_NoError;
 }
 
-size_t dami::getFileSize(fstream& file)
+uint64 dami::getFileSize(fstream& file)
 {
-  size_t size = 0;
+  uint64 size = 0;
   if (file.is_open())
   {
     streamoff curpos = file.tellg();
@@ -364,9 +479,9 @@ size_t dami::getFileSize(fstream& file)
   return size;
 }
 
-size_t dami::getFileSize(ifstream& file)
+uint64 dami::getFileSize(ifstream& file)
 {
-  size_t size = 0;
+  uint64 size = 0;
   if (file.is_open())
   {
     streamoff curpos = file.tellg();
@@ -377,9 +492,9 @@ size_t dami::getFileSize(ifstream& file)
   return size;
 }
 
-size_t dami::getFileSize(ofstream& file)
+uint64 dami::getFileSize(ofstream& file)
 {
-  size_t size = 0;
+  uint64 size = 0;
   if (file.is_open())
   {
     streamoff curpos = file.tellp();
@@ -460,6 +575,19 @@ ID3_Err dami::openReadableFile(String name, ifstream& file)
   return ID3E_NoError;
 }
 
+// The processors online, or 1 where they can't be counted
+size_t dami::numProcessors()
+{
+#if defined _SC_NPROCESSORS_ONLN
+  long num = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (num > 0)
+  {
+    return num;
+  }
+#endif
+  return 1;
+}
+
 String dami::toString(uint32 val)
 {
   if (val == 0)